@@ -38,6 +38,8 @@
 #include <map>
 #include <set>
 #include <cstdio>
+#include <cstdint>
+#include <cstring>
 
 #include <ProfilerApp.h>
 
@@ -442,6 +444,133 @@ std::vector<MeshDatabase> read( const std::string& filename )
 }
 
 
+// Pack the header of the binary index
+static const char index_magic[8] = { 'L', 'B', 'M', 'I', 'N', 'D', 'E', 'X' };
+static const int index_version = 1;
+static inline void packIndexInt( std::vector<char>& buf, int x )
+{
+    int32_t y = x;
+    buf.insert( buf.end(), (char*) &y, (char*) &y + sizeof(y) );
+}
+static inline void packIndexString( std::vector<char>& buf, const std::string& str )
+{
+    packIndexInt( buf, str.size() );
+    buf.insert( buf.end(), str.begin(), str.end() );
+}
+static inline int unpackIndexInt( const std::vector<char>& buf, size_t& pos )
+{
+    int32_t y = 0;
+    INSIST(pos+sizeof(y)<=buf.size(),"Error reading index");
+    memcpy(&y,&buf[pos],sizeof(y));
+    pos += sizeof(y);
+    return y;
+}
+static inline std::string unpackIndexString( const std::vector<char>& buf, size_t& pos )
+{
+    size_t N = unpackIndexInt( buf, pos );
+    INSIST(pos+N<=buf.size(),"Error reading index");
+    std::string str( &buf[pos], N );
+    pos += N;
+    return str;
+}
+std::vector<char> packIndex( const std::vector<MeshDatabase>& meshes, int nprocs, int ranks_per_file )
+{
+    std::vector<char> buf( index_magic, index_magic+sizeof(index_magic) );
+    packIndexInt( buf, index_version );
+    packIndexInt( buf, nprocs );
+    packIndexInt( buf, ranks_per_file );
+    packIndexInt( buf, meshes.size() );
+    for ( const auto& mesh : meshes ) {
+        packIndexString( buf, mesh.name );
+        packIndexString( buf, mesh.meshClass );
+        packIndexInt( buf, static_cast<int>(mesh.type) );
+        packIndexInt( buf, mesh.variables.size() );
+        for ( const auto& var : mesh.variables ) {
+            packIndexString( buf, var.name );
+            packIndexInt( buf, static_cast<int>(var.type) );
+            packIndexInt( buf, var.dim );
+        }
+    }
+    return buf;
+}
+size_t indexRecordSize( const std::vector<MeshDatabase>& meshes )
+{
+    size_t N = 0;
+    for ( const auto& mesh : meshes )
+        N += 1 + mesh.variables.size();
+    return N;
+}
+
+
+//! Read the mesh databases from a binary index
+std::vector<MeshDatabase> readIndex( const std::string& filename )
+{
+    PROFILE_START("readIndex");
+    FILE *fid = fopen(filename.c_str(),"rb");
+    if ( fid==NULL )
+        ERROR("Error opening file");
+    fseek(fid,0,SEEK_END);
+    std::vector<char> buf( ftell(fid) );
+    fseek(fid,0,SEEK_SET);
+    size_t count = fread(buf.data(),1,buf.size(),fid);
+    fclose(fid);
+    INSIST(count==buf.size(),"Error reading index");
+    INSIST(buf.size()>=sizeof(index_magic)&&memcmp(buf.data(),index_magic,sizeof(index_magic))==0,
+        "Not a binary index: "+filename);
+    size_t pos = sizeof(index_magic);
+    INSIST(unpackIndexInt(buf,pos)==index_version,"Unknown index version");
+    int nprocs = unpackIndexInt( buf, pos );
+    int ranks_per_file = unpackIndexInt( buf, pos );
+    std::vector<MeshDatabase> meshes( unpackIndexInt( buf, pos ) );
+    for ( auto& mesh : meshes ) {
+        mesh.name = unpackIndexString( buf, pos );
+        mesh.meshClass = unpackIndexString( buf, pos );
+        mesh.type = static_cast<MeshType>( unpackIndexInt( buf, pos ) );
+        mesh.format = 2;
+        mesh.variables.resize( unpackIndexInt( buf, pos ) );
+        for ( auto& var : mesh.variables ) {
+            var.name = unpackIndexString( buf, pos );
+            var.type = static_cast<VariableType>( unpackIndexInt( buf, pos ) );
+            var.dim = unpackIndexInt( buf, pos );
+        }
+    }
+    // The records of offsets (one per rank)
+    size_t N_record = indexRecordSize( meshes );
+    INSIST(pos+nprocs*N_record*sizeof(uint64_t)==buf.size(),"Error reading index");
+    const char *record = &buf[pos];
+    for ( auto& mesh : meshes )
+        mesh.domains.resize( nprocs );
+    for (int rank=0; rank<nprocs; rank++) {
+        char file[100];
+        sprintf(file,"LBM.%05i",rank/ranks_per_file);
+        for ( auto& mesh : meshes ) {
+            uint64_t offset = 0;
+            memcpy(&offset,record,sizeof(offset));
+            record += sizeof(offset);
+            char domainname[100];
+            sprintf(domainname,"%s_%05i",mesh.name.c_str(),rank);
+            DatabaseEntry& domain = mesh.domains[rank];
+            domain.name = domainname;
+            domain.file = file;
+            domain.offset = offset;
+            for ( const auto& var : mesh.variables ) {
+                memcpy(&offset,record,sizeof(offset));
+                record += sizeof(offset);
+                DatabaseEntry variable;
+                variable.name = var.name;
+                variable.file = file;
+                variable.offset = offset;
+                std::pair<std::string,std::string> key(domain.name,var.name);
+                mesh.variable_data.insert( 
+                    std::pair<std::pair<std::string,std::string>,DatabaseEntry>(key,variable) );
+            }
+        }
+    }
+    PROFILE_STOP("readIndex");
+    return meshes;
+}
+
+
 // Return the mesh type
 IO::MeshType meshType( const IO::Mesh& mesh )
 {
@@ -96,6 +96,26 @@ void write( const std::vector<MeshDatabase>& meshes, const std::string& filename
 std::vector<MeshDatabase> read( const std::string& filename );
 
 
+/*!
+ * @brief  Pack the header of the binary index
+ * @details  The binary index of the mpiio format replaces the summary file.  The header
+ *    holds the meshes and variables (the same on all ranks) and is followed by one record
+ *    of offsets per rank: the offset of each mesh followed by the offsets of its variables.
+ * @param[in] meshes        The mesh databases (the domains are ignored)
+ * @param[in] nprocs        The number of ranks
+ * @param[in] ranks_per_file  The number of ranks sharing each data file
+ */
+std::vector<char> packIndex( const std::vector<MeshDatabase>& meshes, int nprocs, int ranks_per_file );
+
+
+//! Number of offsets in the record of each rank in the binary index
+size_t indexRecordSize( const std::vector<MeshDatabase>& meshes );
+
+
+//! Read the mesh databases from a binary index
+std::vector<MeshDatabase> readIndex( const std::string& filename );
+
+
 //! Return the mesh type
 IO::MeshType meshType( const IO::Mesh& mesh );
 
@@ -81,6 +81,12 @@ std::vector<std::string> IO::readTimesteps( const std::string& filename )
 std::vector<IO::MeshDatabase> IO::getMeshList( const std::string& path, const std::string& timestep )
 {
     std::string filename = path + "/" + timestep + "/LBM.summary";
+    FILE *fid = fopen(filename.c_str(),"rb");
+    if ( fid==NULL ) {
+        // Shared files written with MPI-IO (binary index)
+        return IO::readIndex( path + "/" + timestep + "/LBM.index" );
+    }
+    fclose(fid);
     return IO::read( filename );
 }
 
@@ -25,10 +25,11 @@
 #include <vector>
 #include <set>
 #include <memory>
+#include <cstdint>
 
 
 
-enum class Format { OLD, NEW, SILO, UNKNOWN }; 
+enum class Format { OLD, NEW, SILO, MPIIO, UNKNOWN }; 
 
 
 
@@ -37,7 +38,9 @@ enum class Format { OLD, NEW, SILO, UNKNOWN };
 ****************************************************/
 static std::string global_IO_path;
 static Format global_IO_format = Format::UNKNOWN;
-void IO::initialize( const std::string& path, const std::string& format, bool append )
+static int global_IO_ranks_per_file = 0;
+void IO::initialize( const std::string& path, const std::string& format, bool append,
+    int ranks_per_file )
 {
     if ( path.empty() )
         global_IO_path = ".";
@@ -49,13 +52,17 @@ void IO::initialize( const std::string& path, const std::string& format, bool ap
         global_IO_format = Format::NEW;
     else if ( format == "silo" )
         global_IO_format = Format::SILO;
+    else if ( format == "mpiio" )
+        global_IO_format = Format::MPIIO;
     else
         ERROR("Unknown format");
+    INSIST(ranks_per_file>=0,"ranks_per_file must be non-negative");
+    global_IO_ranks_per_file = ranks_per_file;
     int rank = comm_rank(MPI_COMM_WORLD);
     if ( !append && rank==0 ) {
         mkdir(path.c_str(),S_IRWXU|S_IRGRP);
         std::string filename;
-        if ( global_IO_format==Format::OLD || global_IO_format==Format::NEW )
+        if ( global_IO_format==Format::OLD || global_IO_format==Format::NEW || global_IO_format==Format::MPIIO )
             filename = global_IO_path + "/summary.LBM";
         else if ( global_IO_format==Format::SILO )
             filename = global_IO_path + "/LBM.visit";
@@ -171,27 +178,33 @@ static IO::MeshDatabase getDatabase( const std::string& filename, const IO::Mesh
 }
 
 
-// Write a mesh (and variables) to a file
-static IO::MeshDatabase write_domain( FILE *fid, const std::string& filename,
+// Pack a mesh (and variables) in the new format (offsets relative to the buffer)
+static IO::MeshDatabase pack_domain( std::vector<char>& buf, const std::string& filename,
     const IO::MeshDataStruct& mesh, int format )
 {
     const int level = 0;
     int rank = MPI_WORLD_RANK();
+    auto append = [&buf]( const void *data, size_t bytes ) {
+        buf.insert( buf.end(), (const char*) data, (const char*) data + bytes );
+    };
+    char line[1000];
     // Create the MeshDatabase
     IO::MeshDatabase database = getDatabase( filename, mesh, format );
     // Write the mesh
     IO::DatabaseEntry& domain = database.domains[0];
-    domain.offset = ftell(fid);
+    domain.offset = buf.size();
     std::pair<size_t,void*> data = mesh.mesh->pack(level);
-    fprintf(fid,"Mesh: %s-%05i: %lu\n",mesh.meshName.c_str(),rank,data.first);
-    fwrite(data.second,1,data.first,fid);
-    fprintf(fid,"\n");
+    int N_line = snprintf(line,sizeof(line),"Mesh: %s-%05i: %lu\n",mesh.meshName.c_str(),rank,data.first);
+    INSIST(N_line<(int)sizeof(line),"Mesh name too long");
+    append(line,N_line);
+    append(data.second,data.first);
+    append("\n",1);
     delete [] (char*) data.second;
     // Write the variables
     for (size_t i=0; i<mesh.vars.size(); i++) {
         std::pair<std::string,std::string> key(domain.name,mesh.vars[i]->name);
         IO::DatabaseEntry& variable = database.variable_data[key];
-        variable.offset = ftell(fid);
+        variable.offset = buf.size();
         int dim = mesh.vars[i]->dim;
         int type = static_cast<int>(mesh.vars[i]->type);
         size_t N = mesh.vars[i]->data.length();
@@ -200,16 +213,40 @@ static IO::MeshDatabase write_domain( FILE *fid, const std::string& filename,
         }
         size_t N_mesh = mesh.mesh->numberPointsVar(mesh.vars[i]->type);
         ASSERT(N==dim*N_mesh);
-        fprintf(fid,"Var: %s-%05i-%s: %i, %i, %lu, %lu, double\n",
+        N_line = snprintf(line,sizeof(line),"Var: %s-%05i-%s: %i, %i, %lu, %lu, double\n",
             database.name.c_str(), rank, variable.name.c_str(),
             dim, type, N_mesh, N*sizeof(double) );
-        fwrite(mesh.vars[i]->data.data(),sizeof(double),N,fid);
-        fprintf(fid,"\n");
+        INSIST(N_line<(int)sizeof(line),"Variable name too long");
+        append(line,N_line);
+        append(mesh.vars[i]->data.data(),N*sizeof(double));
+        append("\n",1);
     }
     return database;
 }
 
 
+// Shift the offsets of the mesh (and variables)
+static void shift_offsets( IO::MeshDatabase& database, size_t offset )
+{
+    for ( auto& domain : database.domains )
+        domain.offset += offset;
+    for ( auto& variable : database.variable_data )
+        variable.second.offset += offset;
+}
+
+
+// Write a mesh (and variables) to a file
+static IO::MeshDatabase write_domain( FILE *fid, const std::string& filename,
+    const IO::MeshDataStruct& mesh, int format )
+{
+    std::vector<char> buf;
+    IO::MeshDatabase database = pack_domain( buf, filename, mesh, format );
+    shift_offsets( database, ftell(fid) );
+    fwrite(buf.data(),1,buf.size(),fid);
+    return database;
+}
+
+
 #ifdef USE_SILO
 // Write a PointList mesh (and variables) to a file
 template<class TYPE>
@@ -453,6 +490,91 @@ static std::vector<IO::MeshDatabase> writeMeshesSilo(
 }        
 
 
+// Write the mesh data in the new format to shared files with collective MPI-IO
+static std::vector<IO::MeshDatabase> writeMeshesMPIIO( const std::vector<IO::MeshDataStruct>& meshData,
+    const std::string& path, int ranks_per_file, MPI_Comm comm )
+{
+#ifdef USE_MPI
+    int rank = comm_rank(comm);
+    int nprocs = comm_size(comm);
+    if ( ranks_per_file <= 0 || ranks_per_file > nprocs )
+        ranks_per_file = nprocs;
+    int group = rank / ranks_per_file;
+    char filename[100], fullpath[200];
+    sprintf(filename,"LBM.%05i",group);
+    sprintf(fullpath,"%s/%s",path.c_str(),filename);
+    // Pack the local domains
+    PROFILE_START("writeMeshesMPIIO-pack",2);
+    std::vector<char> buf;
+    std::vector<IO::MeshDatabase> meshes_written;
+    for (size_t i=0; i<meshData.size(); i++)
+        meshes_written.push_back( pack_domain(buf,filename,meshData[i],2) );
+    PROFILE_STOP("writeMeshesMPIIO-pack",2);
+    // Get the offset of the local data in the file of the group
+    MPI_Comm group_comm;
+    MPI_Comm_split(comm,group,rank,&group_comm);
+    unsigned long long bytes = buf.size(), offset = 0, file_size = 0;
+    MPI_Exscan(&bytes,&offset,1,MPI_UNSIGNED_LONG_LONG,MPI_SUM,group_comm);
+    MPI_Allreduce(&bytes,&file_size,1,MPI_UNSIGNED_LONG_LONG,MPI_SUM,group_comm);
+    if ( comm_rank(group_comm) == 0 )
+        offset = 0;
+    for ( auto& database : meshes_written )
+        shift_offsets( database, offset );
+    // Write the data (in blocks that fit the int count)
+    PROFILE_START("writeMeshesMPIIO-write",2);
+    const size_t block = 1<<30;
+    int N_blocks = maxReduce( group_comm, (int) ((buf.size()+block-1)/block) );
+    MPI_File fid;
+    int err = MPI_File_open(group_comm,fullpath,MPI_MODE_CREATE|MPI_MODE_WRONLY,MPI_INFO_NULL,&fid);
+    INSIST(err==MPI_SUCCESS,std::string("Error opening file: ")+fullpath);
+    for (int i=0; i<N_blocks; i++) {
+        size_t start = std::min<size_t>(i*block,buf.size());
+        int count = std::min<size_t>(block,buf.size()-start);
+        MPI_File_write_at_all(fid,offset+start,buf.data()+start,count,MPI_CHAR,MPI_STATUS_IGNORE);
+    }
+    MPI_File_set_size(fid,file_size);   // Truncate an older file
+    MPI_File_close(&fid);
+    MPI_Comm_free(&group_comm);
+    PROFILE_STOP("writeMeshesMPIIO-write",2);
+    // Write the binary index: the header (rank 0) and the record of offsets of each rank
+    PROFILE_START("writeMeshesMPIIO-index",2);
+    auto header = IO::packIndex( meshes_written, nprocs, ranks_per_file );
+    int header_size = header.size();
+    std::vector<char> header0( header );
+    MPI_Bcast(&header_size,1,MPI_INT,0,comm);
+    header0.resize(header_size);
+    MPI_Bcast(header0.data(),header_size,MPI_CHAR,0,comm);
+    int mismatch = header0!=header ? 1:0;
+    INSIST(maxReduce(comm,mismatch)==0,"The meshes and variables must match on all ranks");
+    std::vector<uint64_t> record;
+    for ( const auto& database : meshes_written ) {
+        record.push_back( database.domains[0].offset );
+        for ( const auto& var : database.variables ) {
+            std::pair<std::string,std::string> key(database.domains[0].name,var.name);
+            record.push_back( database.variable_data.find(key)->second.offset );
+        }
+    }
+    ASSERT(record.size()==IO::indexRecordSize(meshes_written));
+    std::vector<char> data;
+    if ( rank == 0 )
+        data = header;
+    data.insert( data.end(), (char*) record.data(), (char*) (record.data()+record.size()) );
+    MPI_Offset index_offset = rank==0 ? 0 : header.size()+rank*record.size()*sizeof(uint64_t);
+    sprintf(fullpath,"%s/LBM.index",path.c_str());
+    err = MPI_File_open(comm,fullpath,MPI_MODE_CREATE|MPI_MODE_WRONLY,MPI_INFO_NULL,&fid);
+    INSIST(err==MPI_SUCCESS,std::string("Error opening file: ")+fullpath);
+    MPI_File_write_at_all(fid,index_offset,data.data(),data.size(),MPI_CHAR,MPI_STATUS_IGNORE);
+    MPI_File_set_size(fid,header.size()+nprocs*record.size()*sizeof(uint64_t));
+    MPI_File_close(&fid);
+    PROFILE_STOP("writeMeshesMPIIO-index",2);
+    return meshes_written;
+#else
+    ERROR("Application built without MPI support");
+    return std::vector<IO::MeshDatabase>();
+#endif
+}
+
+
 /****************************************************
 * Write the mesh data                               *
 ****************************************************/
@@ -484,13 +606,23 @@ void IO::writeData( const std::string& subdir, const std::vector<IO::MeshDataStr
     } else if ( global_IO_format == Format::SILO ) {
         // Write silo
         meshes_written = writeMeshesSilo( meshData, path, 4 );
+    } else if ( global_IO_format == Format::MPIIO ) {
+        // Write the new format to shared files (the binary index replaces the summary)
+        meshes_written = writeMeshesMPIIO( meshData, path, global_IO_ranks_per_file, comm );
     } else {
         ERROR("Unknown format");
     }
     // Gather a complete list of files on rank 0
-    meshes_written = gatherAll(meshes_written,comm);
+    if ( global_IO_format != Format::MPIIO )
+        meshes_written = gatherAll(meshes_written,comm);
     // Write the summary files
-    if ( rank == 0 ) {
+    if ( rank == 0 && global_IO_format == Format::MPIIO ) {
+        // Add the timestep to the global summary file
+        auto filename = global_IO_path+"/summary.LBM";
+        FILE *fid = fopen(filename.c_str(),"ab");
+        fprintf(fid,"%s/\n",subdir.c_str());
+        fclose(fid);
+    } else if ( rank == 0 ) {
         // Write the summary file for the current timestep
         char filename[200];
         sprintf(filename,"%s/LBM.summary",path.c_str());
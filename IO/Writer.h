@@ -37,9 +37,14 @@ namespace IO {
  *                          old - Old mesh format (provided for backward compatibility, cannot write variables)
  *                          new - New format, 1 file/process
  *                          silo - Silo
+ *                          mpiio - New format written with collective MPI-IO, 1 file/timestep
+ *                             (or 1 file per ranks_per_file processes) and a binary index
  * @param[in] append        Append any existing data (default is false)
+ * @param[in] ranks_per_file  Number of processes sharing a file with the mpiio format
+ *                          (default is 0: all processes write a single file)
  */
-void initialize( const std::string& path="", const std::string& format="silo", bool append=false );
+void initialize( const std::string& path="", const std::string& format="silo", bool append=false,
+    int ranks_per_file=0 );
 
 
 /*!
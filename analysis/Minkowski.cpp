@@ -26,7 +26,9 @@
 
 #include "ProfilerApp.h"
 
+#include <array>
 #include <memory>
+#include <vector>
 
 
 #define PI 3.14159265359
@@ -61,66 +63,252 @@ Minkowski::~Minkowski()
     if ( LOGFILE!=NULL ) { fclose(LOGFILE); }
 }
 
-void Minkowski::ComputeScalar(const DoubleArray& Field, const double isovalue)
+/*
+ * Marching cubes topology for each of the 256 sign cases: the vertex order, the half edges
+ * and their twins are the ones DECL::LocalIsosurface builds in every cube, so they are found
+ * once instead of searched per cube. Ghost twins (cube faces) depend on the vertex coordinates,
+ * so the table only records which half edges may take one.
+ */
+struct CubeCase {
+	int nverts, ntris;
+	int edge[12];     // cube edge of each vertex
+	int v1[15];       // first vertex of each half edge (three per triangle)
+	int twin[15];     // twin half edge within the cube (-1 if none)
+	bool ghost[15];   // the face test is the last assignment of the twin
+};
+static const int CubeEdge[12][2] = {{0,1},{1,2},{2,3},{3,0},{4,5},{5,6},{6,7},{7,4},{0,4},{1,5},{2,6},{3,7}};
+static const double CubeCorner[8][3] = {{0.0,0.0,0.0},{1.0,0.0,0.0},{1.0,1.0,0.0},{0.0,1.0,0.0},
+	{0.0,0.0,1.0},{1.0,0.0,1.0},{1.0,1.0,1.0},{0.0,1.0,1.0}};
+
+static inline int NextEdge(int e){ return (e%3 == 2) ? e-2 : e+1; }
+
+static const std::array<CubeCase,256>& CubeCases()
 {
-    PROFILE_START("ComputeScalar");
-	Xi = Ji = Ai = 0.0;
-	DECL object;
-	int e1,e2,e3;
-	double s,s1,s2,s3;
-	double a1,a2,a3;
-	//double Vx,Vy,Vz,Wx,Wy,Wz,nx,ny,nz,norm;
-	//int Nx = Field.size(0);
-	//int Ny = Field.size(1);
-	//int Nz = Field.size(2);
-	for (int k=1; k<Nz-1; k++){
-		for (int j=1; j<Ny-1; j++){
-			for (int i=1; i<Nx-1; i++){
-				object.LocalIsosurface(Field,isovalue,i,j,k);
-				for (int idx=0; idx<object.TriangleCount; idx++){
-					e1 = object.Face(idx); 
-					e2 = object.halfedge.next(e1);
-					e3 = object.halfedge.next(e2);
-					auto P1 = object.vertex.coords(object.halfedge.v1(e1));
-					auto P2 = object.vertex.coords(object.halfedge.v1(e2));
-					auto P3 = object.vertex.coords(object.halfedge.v1(e3));
-					// Surface area
-					s1 = Distance( P1, P2 );
-					s2 = Distance( P2, P3 );
-					s3 = Distance( P1, P3 );
-					s = 0.5*(s1+s2+s3);
-					Ai += sqrt(s*(s-s1)*(s-s2)*(s-s3));
-					// Mean curvature based on half edge angle
-					a1 = object.EdgeAngle(e1);
-					a2 = object.EdgeAngle(e2);
-					a3 = object.EdgeAngle(e3);
-					Ji += (a1*s1+a2*s2+a3*s3);
-					//if (0.08333333333333*(a1*s1+a2*s2+a3*s3) < 0.f){
-					//double intcurv=0.08333333333333*(a1*s1+a2*s2+a3*s3);
-					//double surfarea=sqrt(s*(s-s1)*(s-s2)*(s-s3));
-					//printf("   (%i,%i,%i) PQ(%i,%i)={%f,%f,%f} {%f,%f,%f} a=%f l=%f \n",i,j,k,e1,object.halfedge.twin(e1),P1.x,P1.y,P1.z,P2.x,P2.y,P2.z,a1,s1);
-					// printf("   (%i,%i,%i) QR(%i,%i)={%f,%f,%f} {%f,%f,%f} a=%f l=%f \n",i,j,k,e2,object.halfedge.twin(e2),P2.x,P2.y,P2.z,P3.x,P3.y,P3.z,a2,s2);
-					// printf("   (%i,%i,%i) RP(%i,%i)={%f,%f,%f} {%f,%f,%f} a=%f l=%f \n",i,j,k,e3,object.halfedge.twin(e3),P3.x,P3.y,P3.z,P1.x,P1.y,P1.z,a3,s3);
-					  //}
-					// Euler characteristic (half edge rule: one face - 0.5*(three edges))
-					Xi -= 0.5;
+	static const std::array<CubeCase,256> cases = []{
+		std::array<CubeCase,256> table;
+		for (int c=0; c<256; c++){
+			CubeCase &cc = table[c];
+			int remap[12];
+			for (int e=0; e<12; e++) remap[e] = -1;
+			cc.nverts = 0;
+			int n = 0;
+			for (; triTable[c][n]!=-1; n++){
+				int e = triTable[c][n];
+				if (remap[e] == -1){
+					remap[e] = cc.nverts;
+					cc.edge[cc.nverts++] = e;
+				}
+				cc.v1[n] = remap[e];
+			}
+			cc.ntris = n/3;
+			// same search as LocalIsosurface: a twin set by a later half edge overrides the face test
+			int last[15];
+			for (int h=0; h<n; h++){
+				cc.twin[h] = -1;
+				last[h] = -1;
+			}
+			for (int h=0; h<n; h++){
+				for (int g=0; g<n; g++){
+					if (cc.v1[NextEdge(g)] == cc.v1[h] && cc.v1[g] == cc.v1[NextEdge(h)]){
+						cc.twin[h] = g;  last[h] = h;
+						cc.twin[g] = h;  last[g] = h;
+					}
 				}
-				// Euler characteristic -- each vertex shared by four cubes
-				Xi += 0.25*double(object.VertexCount);
 			}
+			for (int h=0; h<n; h++) cc.ghost[h] = (last[h] <= h);
 		}
+		return table;
+	}();
+	return cases;
+}
+
+// outward normal of a cube face (ghost twin)
+static inline Point CubeFaceNormal(int face)
+{
+	Point W;
+	if (face == -1) W.x = -1.0;
+	else if (face == -2) W.y = -1.0;
+	else if (face == -3) W.z = -1.0;
+	else if (face == -4) W.x = 1.0;
+	else if (face == -5) W.y = 1.0;
+	else W.z = 1.0;
+	return W;
+}
+
+/*
+ * Area, mean curvature and Euler characteristic of the isosurface in the cube (i,j,k),
+ * with the same arithmetic and order of accumulation as DECL (LocalIsosurface, TriNormal, EdgeAngle)
+ */
+static inline void CubeMeasures(const CubeCase &cc, const double *CubeValues, int i, int j, int k,
+		double &Ai, double &Ji, double &Xi)
+{
+	Point local[12], P[12], normal[15];
+	int twin[15];
+	for (int v=0; v<cc.nverts; v++){
+		const int *e = CubeEdge[cc.edge[v]];
+		Point C0(CubeCorner[e[0]][0],CubeCorner[e[0]][1],CubeCorner[e[0]][2]);
+		Point C1(CubeCorner[e[1]][0],CubeCorner[e[1]][1],CubeCorner[e[1]][2]);
+		local[v] = VertexInterp(C0,C1,CubeValues[e[0]],CubeValues[e[1]]);
+		P[v] = local[v];
+		P[v].x += i;
+		P[v].y += j;
+		P[v].z += k;
 	}
-	// Voxel counting for volume fraction
-	Vi = 0.f;
-	for (int k=1; k<Nz-1; k++){
-		for (int j=1; j<Ny-1; j++){
-			for (int i=1; i<Nx-1; i++){
-				if (Field(i,j,k) < isovalue){
-					Vi += 1.0;
+	int nedges = 3*cc.ntris;
+	for (int e=0; e<nedges; e++){
+		twin[e] = cc.twin[e];
+		if (cc.ghost[e]){
+			// use "ghost" twins if edge is on a cube face
+			const Point &p = local[cc.v1[e]];
+			const Point &q = local[cc.v1[NextEdge(e)]];
+			if (p.x == 0.0 && q.x == 0.0) twin[e] = -1;
+			if (p.x == 1.0 && q.x == 1.0) twin[e] = -4;
+			if (p.y == 0.0 && q.y == 0.0) twin[e] = -2;
+			if (p.y == 1.0 && q.y == 1.0) twin[e] = -5;
+			if (p.z == 0.0 && q.z == 0.0) twin[e] = -3;
+			if (p.z == 1.0 && q.z == 1.0) twin[e] = -6;
+		}
+		// triangle normal seen from this half edge
+		int e2 = NextEdge(e);
+		Point U = P[cc.v1[e2]] - P[cc.v1[e]];
+		Point V = P[cc.v1[NextEdge(e2)]] - P[cc.v1[e2]];
+		double nx = U.y*V.z - U.z*V.y;
+		double ny = U.z*V.x - U.x*V.z;
+		double nz = U.x*V.y - U.y*V.x;
+		double len = sqrt(nx*nx+ny*ny+nz*nz);
+		normal[e] = Point(nx/len,ny/len,nz/len);
+	}
+	for (int t=0; t<cc.ntris; t++){
+		double angle[3];
+		for (int m=0; m<3; m++){
+			int e = 3*t+m;
+			int e2 = NextEdge(e);
+			const Point &p = P[cc.v1[e]];
+			const Point &q = P[cc.v1[e2]];
+			const Point &r = P[cc.v1[NextEdge(e2)]];
+			Point U = normal[e];
+			Point V = (twin[e] < 0) ? CubeFaceNormal(twin[e]) : normal[twin[e]];
+			Point W;
+			double a, dotprod;
+			if (twin[e] < 0){
+				// edge normal within the plane of the cube face
+				W = p - q;
+				double length = sqrt(W.x*W.x+W.y*W.y+W.z*W.z);
+				W.x /= length;
+				W.y /= length;
+				W.z /= length;
+				double nx = W.y*V.z - W.z*V.y;
+				double ny = W.z*V.x - W.x*V.z;
+				double nz = W.x*V.y - W.y*V.x;
+				length = sqrt(nx*nx+ny*ny+nz*nz);
+				V.x = nx/length; V.y = ny/length; V.z = nz/length;
+				dotprod = U.x*V.x + U.y*V.y + U.z*V.z;
+				if (dotprod < 0.f){
+					dotprod=-dotprod;
+					V.x = -V.x; V.y = -V.y; V.z = -V.z;
 				}
+				if (dotprod > 1.f) dotprod=1.f;
+				if (dotprod < -1.f) dotprod=-1.f;
+				a = acos(dotprod);
+			}
+			else{
+				dotprod = U.x*V.x + U.y*V.y + U.z*V.z;
+				if (dotprod > 1.f) dotprod=1.f;
+				if (dotprod < -1.f) dotprod=-1.f;
+				a = 0.5*acos(dotprod);
+			}
+			// determine if angle is concave or convex based on edge normal
+			W.x = (p.y-q.y)*U.z - (p.z-q.z)*U.y;
+			W.y = (p.z-q.z)*U.x - (p.x-q.x)*U.z;
+			W.z = (p.x-q.x)*U.y - (p.y-q.y)*U.x;
+			Point w = 0.5*(p+q)-r;
+			if (W.x*w.x + W.y*w.y + W.z*w.z < 0.f){
+				W.x = -W.x; W.y = -W.y; W.z = -W.z;
 			}
+			if (W.x*V.x + W.y*V.y + W.z*V.z > 0.f) a = -a;
+			if (a != a) a = 0.0;
+			angle[m] = a;
+		}
+		const Point &P1 = P[cc.v1[3*t]];
+		const Point &P2 = P[cc.v1[3*t+1]];
+		const Point &P3 = P[cc.v1[3*t+2]];
+		// Surface area
+		double s1 = Distance(P1,P2);
+		double s2 = Distance(P2,P3);
+		double s3 = Distance(P1,P3);
+		double s = 0.5*(s1+s2+s3);
+		Ai += sqrt(s*(s-s1)*(s-s2)*(s-s3));
+		// Mean curvature based on half edge angle
+		Ji += (angle[0]*s1+angle[1]*s2+angle[2]*s3);
+		// Euler characteristic (half edge rule: one face - 0.5*(three edges))
+		Xi -= 0.5;
+	}
+	// Euler characteristic -- each vertex shared by four cubes
+	Xi += 0.25*double(cc.nverts);
+}
+
+// Add the measures of the cubes in the k-slab, in the order of the cubes
+static void ComputeSlab(const std::array<CubeCase,256>& cases, const DoubleArray& Field, const double isovalue, int k,
+		std::vector<unsigned char>& sign, double& Ai, double& Ji, double& Xi, double& Vi)
+{
+	int Nx = Field.size(0);
+	int Ny = Field.size(1);
+	double CubeValues[8];
+	for (int j=1; j<Ny-1; j++){
+		// sign bits of the four corners (j,k), (j+1,k), (j,k+1), (j+1,k+1) at each x
+		for (int i=1; i<Nx; i++){
+			sign[i] = ((Field(i,j,k) - isovalue < 0.0f) ? 1:0)
+					| ((Field(i,j+1,k) - isovalue < 0.0f) ? 2:0)
+					| ((Field(i,j,k+1) - isovalue < 0.0f) ? 4:0)
+					| ((Field(i,j+1,k+1) - isovalue < 0.0f) ? 8:0);
+		}
+		for (int i=1; i<Nx-1; i++){
+			// voxel counting for volume fraction
+			if (Field(i,j,k) < isovalue) Vi += 1.0;
+			// skip cubes without a sign change
+			if ((sign[i] | sign[i+1]) == 0 || (sign[i] & sign[i+1]) == 15) continue;
+			int CubeIndex = (sign[i]&1) | ((sign[i+1]&1)<<1) | ((sign[i+1]&2)<<1) | ((sign[i]&2)<<2)
+					| ((sign[i]&4)<<2) | ((sign[i+1]&4)<<3) | ((sign[i+1]&8)<<3) | ((sign[i]&8)<<4);
+			CubeValues[0] = Field(i,j,k) - isovalue;
+			CubeValues[1] = Field(i+1,j,k) - isovalue;
+			CubeValues[2] = Field(i+1,j+1,k) - isovalue;
+			CubeValues[3] = Field(i,j+1,k) - isovalue;
+			CubeValues[4] = Field(i,j,k+1) - isovalue;
+			CubeValues[5] = Field(i+1,j,k+1) - isovalue;
+			CubeValues[6] = Field(i+1,j+1,k+1) - isovalue;
+			CubeValues[7] = Field(i,j+1,k+1) - isovalue;
+			CubeMeasures(cases[CubeIndex],CubeValues,i,j,k,Ai,Ji,Xi);
 		}
 	}
+}
+
+void Minkowski::ComputeScalar(const DoubleArray& Field, const double isovalue)
+{
+    PROFILE_START("ComputeScalar");
+	const auto& cases = CubeCases();
+	Xi = Ji = Ai = Vi = 0.0;
+#ifdef USE_OPENMP
+	// sums for each k-slab, added in order so the result does not depend on the number of threads
+	std::vector<double> Ak(Nz,0.0), Jk(Nz,0.0), Xk(Nz,0.0), Vk(Nz,0.0);
+    #pragma omp parallel
+	{
+		std::vector<unsigned char> sign(Nx);
+        #pragma omp for schedule(dynamic)
+		for (int k=1; k<Nz-1; k++)
+			ComputeSlab(cases,Field,isovalue,k,sign,Ak[k],Jk[k],Xk[k],Vk[k]);
+	}
+	for (int k=1; k<Nz-1; k++){
+		Ai += Ak[k];
+		Ji += Jk[k];
+		Xi += Xk[k];
+		Vi += Vk[k];
+	}
+#else
+	// one running sum in the order of the cubes, so the measures match the DECL construction exactly
+	std::vector<unsigned char> sign(Nx);
+	for (int k=1; k<Nz-1; k++)
+		ComputeSlab(cases,Field,isovalue,k,sign,Ai,Ji,Xi,Vi);
+#endif
 	// convert X for 2D manifold to 3D object
 	Xi *= 0.5;
 	
@@ -155,9 +155,7 @@ void SubPhase::SetParams(double rhoA, double rhoB, double tauA, double tauB, dou
 	beta = B;
 }
 
-void SubPhase::Basic(){
-	int i,j,k,n,imin,jmin,kmin,kmax;
-
+void SubPhase::AverageRange(int &imin, int &jmin, int &kmin, int &kmax) const {
 	// If external boundary conditions are set, do not average over the inlet
 	kmin=1; kmax=Nz-1;
 	imin=jmin=1;
@@ -166,6 +164,11 @@ void SubPhase::Basic(){
 	if (Dm->inlet_layers_y > 0) jmin = Dm->inlet_layers_y;
 	if (Dm->inlet_layers_z > 0 && Dm->kproc() == 0) kmin += Dm->inlet_layers_z; 
 	if (Dm->outlet_layers_z > 0 && Dm->kproc() == Dm->nprocz()-1) kmax -= Dm->outlet_layers_z; 
+}
+
+void SubPhase::Basic(){
+	int i,j,k,n,imin,jmin,kmin,kmax;
+	AverageRange(imin,jmin,kmin,kmax);
 	
 	nb.reset(); wb.reset();
 
@@ -230,25 +233,44 @@ void SubPhase::Basic(){
 			}
 		}
 	}
-	gwb.V=sumReduce( Dm->Comm, wb.V);
-	gnb.V=sumReduce( Dm->Comm, nb.V);
-	gwb.M=sumReduce( Dm->Comm, wb.M);
-	gnb.M=sumReduce( Dm->Comm, nb.M);
-	gwb.Px=sumReduce( Dm->Comm, wb.Px);
-	gwb.Py=sumReduce( Dm->Comm, wb.Py);
-	gwb.Pz=sumReduce( Dm->Comm, wb.Pz);
-	gnb.Px=sumReduce( Dm->Comm, nb.Px);
-	gnb.Py=sumReduce( Dm->Comm, nb.Py);
-	gnb.Pz=sumReduce( Dm->Comm, nb.Pz);
-	
-	count_w=sumReduce( Dm->Comm, count_w);
-	count_n=sumReduce( Dm->Comm, count_n);
+	BasicReduce(count_w,count_n,Pressure(Nx*Ny + Nx + 1));
+}
+
+void SubPhase::BasicCompact(const double *sums){
+	nb.reset(); wb.reset();
+	nb.V = sums[0];  nb.M = sums[1];
+	nb.Px = sums[2]; nb.Py = sums[3]; nb.Pz = sums[4];
+	wb.V = sums[5];  wb.M = sums[6];
+	wb.Px = sums[7]; wb.Py = sums[8]; wb.Pz = sums[9];
+	nb.p = sums[10]; wb.p = sums[12];
+	BasicReduce(sums[13],sums[11],sums[14]);
+}
+
+void SubPhase::BasicReduce(double count_w, double count_n, double inlet_pressure){
+	// reduce the sums in one collective
+	double sum_pw = 0.0, sum_pn = 0.0;
+	ReduceSet sums;
+	sums.add(ReduceSet::SUM,&wb.V,&gwb.V);
+	sums.add(ReduceSet::SUM,&nb.V,&gnb.V);
+	sums.add(ReduceSet::SUM,&wb.M,&gwb.M);
+	sums.add(ReduceSet::SUM,&nb.M,&gnb.M);
+	sums.add(ReduceSet::SUM,&wb.Px,&gwb.Px);
+	sums.add(ReduceSet::SUM,&wb.Py,&gwb.Py);
+	sums.add(ReduceSet::SUM,&wb.Pz,&gwb.Pz);
+	sums.add(ReduceSet::SUM,&nb.Px,&gnb.Px);
+	sums.add(ReduceSet::SUM,&nb.Py,&gnb.Py);
+	sums.add(ReduceSet::SUM,&nb.Pz,&gnb.Pz);
+	sums.add(ReduceSet::SUM,&count_w,&count_w);
+	sums.add(ReduceSet::SUM,&count_n,&count_n);
+	sums.add(ReduceSet::SUM,&wb.p,&sum_pw);
+	sums.add(ReduceSet::SUM,&nb.p,&sum_pn);
+	sums.reduce( Dm->Comm );
 	if (count_w > 0.0)
-		gwb.p=sumReduce( Dm->Comm, wb.p) / count_w;
+		gwb.p=sum_pw / count_w;
 	else 
 		gwb.p = 0.0;
 	if (count_n > 0.0)
-		gnb.p=sumReduce( Dm->Comm, nb.p) / count_n;
+		gnb.p=sum_pn / count_n;
 	else 
 		gnb.p = 0.0;
 
@@ -283,7 +305,7 @@ void SubPhase::Basic(){
 		}
 		if (Dm->BoundaryCondition > 0 ){
 			// compute the pressure drop
-			double pressure_drop = (Pressure(Nx*Ny + Nx + 1) - 1.0) / 3.0;
+			double pressure_drop = (inlet_pressure - 1.0) / 3.0;
 			double length = ((Nz-2)*Dm->nprocz());
 			force_mag -= pressure_drop/length;
 		}
@@ -444,15 +466,6 @@ void SubPhase::Full(){
 	nd.H -= nc.H;
 	nd.X -= nc.X;
 
-	// compute global entities
-	gnc.V=sumReduce( Dm->Comm, nc.V);
-	gnc.A=sumReduce( Dm->Comm, nc.A);
-	gnc.H=sumReduce( Dm->Comm, nc.H);
-	gnc.X=sumReduce( Dm->Comm, nc.X);
-	gnd.V=sumReduce( Dm->Comm, nd.V);
-	gnd.A=sumReduce( Dm->Comm, nd.A);
-	gnd.H=sumReduce( Dm->Comm, nd.H);
-	gnd.X=sumReduce( Dm->Comm, nd.X);
 	gnd.Nc = nd.Nc;
  	// wetting
 	for (k=0; k<Nz; k++){
@@ -491,15 +504,6 @@ void SubPhase::Full(){
 	wd.A -= wc.A;
 	wd.H -= wc.H;
 	wd.X -= wc.X;
-	// compute global entities
-	gwc.V=sumReduce( Dm->Comm, wc.V);
-	gwc.A=sumReduce( Dm->Comm, wc.A);
-	gwc.H=sumReduce( Dm->Comm, wc.H);
-	gwc.X=sumReduce( Dm->Comm, wc.X);
-	gwd.V=sumReduce( Dm->Comm, wd.V);
-	gwd.A=sumReduce( Dm->Comm, wd.A);
-	gwd.H=sumReduce( Dm->Comm, wd.H);
-	gwd.X=sumReduce( Dm->Comm, wd.X);
 	gwd.Nc = wd.Nc;
 	
  	/*  Set up geometric analysis of interface region */
@@ -527,22 +531,34 @@ void SubPhase::Full(){
 	iwn.A = morph_i->A(); 
 	iwn.H = morph_i->H(); 
 	iwn.X = morph_i->X(); 
-	giwn.V=sumReduce( Dm->Comm, iwn.V);
-	giwn.A=sumReduce( Dm->Comm, iwn.A);
-	giwn.H=sumReduce( Dm->Comm, iwn.H);
-	giwn.X=sumReduce( Dm->Comm, iwn.X);
 	// measure only the connected part
 	iwnc.Nc = morph_i->MeasureConnectedPathway();
 	iwnc.V = morph_i->V(); 
 	iwnc.A = morph_i->A(); 
 	iwnc.H = morph_i->H(); 
 	iwnc.X = morph_i->X(); 
-	giwnc.V=sumReduce( Dm->Comm, iwnc.V);
-	giwnc.A=sumReduce( Dm->Comm, iwnc.A);
-	giwnc.H=sumReduce( Dm->Comm, iwnc.H);
-	giwnc.X=sumReduce( Dm->Comm, iwnc.X);
 	giwnc.Nc = iwnc.Nc;
 
+	// compute global entities (the reduction completes during the volume averages)
+	ReduceSet geometry;
+	const phase *local_phase[4] = { &nc, &nd, &wc, &wd };
+	phase *global_phase[4] = { &gnc, &gnd, &gwc, &gwd };
+	for (int p=0; p<4; p++){
+		geometry.add(ReduceSet::SUM,&local_phase[p]->V,&global_phase[p]->V);
+		geometry.add(ReduceSet::SUM,&local_phase[p]->A,&global_phase[p]->A);
+		geometry.add(ReduceSet::SUM,&local_phase[p]->H,&global_phase[p]->H);
+		geometry.add(ReduceSet::SUM,&local_phase[p]->X,&global_phase[p]->X);
+	}
+	const interface *local_interface[2] = { &iwn, &iwnc };
+	interface *global_interface[2] = { &giwn, &giwnc };
+	for (int p=0; p<2; p++){
+		geometry.add(ReduceSet::SUM,&local_interface[p]->V,&global_interface[p]->V);
+		geometry.add(ReduceSet::SUM,&local_interface[p]->A,&global_interface[p]->A);
+		geometry.add(ReduceSet::SUM,&local_interface[p]->H,&global_interface[p]->H);
+		geometry.add(ReduceSet::SUM,&local_interface[p]->X,&global_interface[p]->X);
+	}
+	geometry.start( Dm->Comm );
+
 	double vol_nc_bulk = 0.0;
 	double vol_wc_bulk = 0.0;
 	double vol_nd_bulk = 0.0;
@@ -631,46 +647,32 @@ void SubPhase::Full(){
 		}
 	}
 
-	gnd.M=sumReduce( Dm->Comm, nd.M);
-	gnd.Px=sumReduce( Dm->Comm, nd.Px);
-	gnd.Py=sumReduce( Dm->Comm, nd.Py);
-	gnd.Pz=sumReduce( Dm->Comm, nd.Pz);
-	gnd.K=sumReduce( Dm->Comm, nd.K);
-
-	gwd.M=sumReduce( Dm->Comm, wd.M);
-	gwd.Px=sumReduce( Dm->Comm, wd.Px);
-	gwd.Py=sumReduce( Dm->Comm, wd.Py);
-	gwd.Pz=sumReduce( Dm->Comm, wd.Pz);
-	gwd.K=sumReduce( Dm->Comm, wd.K);
-	
-	gnc.M=sumReduce( Dm->Comm, nc.M);
-	gnc.Px=sumReduce( Dm->Comm, nc.Px);
-	gnc.Py=sumReduce( Dm->Comm, nc.Py);
-	gnc.Pz=sumReduce( Dm->Comm, nc.Pz);
-	gnc.K=sumReduce( Dm->Comm, nc.K);
-
-	gwc.M=sumReduce( Dm->Comm, wc.M);
-	gwc.Px=sumReduce( Dm->Comm, wc.Px);
-	gwc.Py=sumReduce( Dm->Comm, wc.Py);
-	gwc.Pz=sumReduce( Dm->Comm, wc.Pz);
-	gwc.K=sumReduce( Dm->Comm, wc.K);
-	
-	giwn.Mn=sumReduce( Dm->Comm, iwn.Mn);
-	giwn.Pnx=sumReduce( Dm->Comm, iwn.Pnx);
-	giwn.Pny=sumReduce( Dm->Comm, iwn.Pny);
-	giwn.Pnz=sumReduce( Dm->Comm, iwn.Pnz);
-	giwn.Kn=sumReduce( Dm->Comm, iwn.Kn);
-	giwn.Mw=sumReduce( Dm->Comm, iwn.Mw);
-	giwn.Pwx=sumReduce( Dm->Comm, iwn.Pwx);
-	giwn.Pwy=sumReduce( Dm->Comm, iwn.Pwy);
-	giwn.Pwz=sumReduce( Dm->Comm, iwn.Pwz);
-	giwn.Kw=sumReduce( Dm->Comm, iwn.Kw);
-	
-	// pressure averaging
-	gnc.p=sumReduce( Dm->Comm, nc.p);
-	gnd.p=sumReduce( Dm->Comm, nd.p);
-	gwc.p=sumReduce( Dm->Comm, wc.p);
-	gwd.p=sumReduce( Dm->Comm, wd.p);
+	// reduce the transport measures in one collective
+	ReduceSet transport;
+	for (int p=0; p<4; p++){
+		transport.add(ReduceSet::SUM,&local_phase[p]->M,&global_phase[p]->M);
+		transport.add(ReduceSet::SUM,&local_phase[p]->Px,&global_phase[p]->Px);
+		transport.add(ReduceSet::SUM,&local_phase[p]->Py,&global_phase[p]->Py);
+		transport.add(ReduceSet::SUM,&local_phase[p]->Pz,&global_phase[p]->Pz);
+		transport.add(ReduceSet::SUM,&local_phase[p]->K,&global_phase[p]->K);
+		// pressure averaging
+		transport.add(ReduceSet::SUM,&local_phase[p]->p,&global_phase[p]->p);
+	}
+	transport.add(ReduceSet::SUM,&iwn.Mn,&giwn.Mn);
+	transport.add(ReduceSet::SUM,&iwn.Pnx,&giwn.Pnx);
+	transport.add(ReduceSet::SUM,&iwn.Pny,&giwn.Pny);
+	transport.add(ReduceSet::SUM,&iwn.Pnz,&giwn.Pnz);
+	transport.add(ReduceSet::SUM,&iwn.Kn,&giwn.Kn);
+	transport.add(ReduceSet::SUM,&iwn.Mw,&giwn.Mw);
+	transport.add(ReduceSet::SUM,&iwn.Pwx,&giwn.Pwx);
+	transport.add(ReduceSet::SUM,&iwn.Pwy,&giwn.Pwy);
+	transport.add(ReduceSet::SUM,&iwn.Pwz,&giwn.Pwz);
+	transport.add(ReduceSet::SUM,&iwn.Kw,&giwn.Kw);
+	double vol_bulk[4] = { vol_nc_bulk, vol_nd_bulk, vol_wc_bulk, vol_wd_bulk };
+	double vol_bulk_global[4];
+	transport.add(ReduceSet::SUM,vol_bulk,vol_bulk_global,4);
+	transport.reduce( Dm->Comm );
+	geometry.finish();
 
 	if (vol_wc_bulk > 0.0)
 		wc.p = wc.p /vol_wc_bulk;
@@ -681,10 +683,10 @@ void SubPhase::Full(){
 	if (vol_nd_bulk > 0.0)
 		nd.p = nd.p /vol_nd_bulk;
 
-	vol_wc_bulk=sumReduce( Dm->Comm, vol_wc_bulk);
-	vol_wd_bulk=sumReduce( Dm->Comm, vol_wd_bulk);
-	vol_nc_bulk=sumReduce( Dm->Comm, vol_nc_bulk);
-	vol_nd_bulk=sumReduce( Dm->Comm, vol_nd_bulk);
+	vol_nc_bulk = vol_bulk_global[0];
+	vol_nd_bulk = vol_bulk_global[1];
+	vol_wc_bulk = vol_bulk_global[2];
+	vol_wd_bulk = vol_bulk_global[3];
 	
 	if (vol_wc_bulk > 0.0)
 		gwc.p = gwc.p /vol_wc_bulk;
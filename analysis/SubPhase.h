@@ -99,11 +99,16 @@ public:
 	
 	void SetParams(double rhoA, double rhoB, double tauA, double tauB, double force_x, double force_y, double force_z, double alpha, double beta);
 	void Basic();
+	// Basic averages from the sums of ScaLBL_D3Q19_PhaseSums (no copy to the regular layout)
+	void BasicCompact(const double *sums);
+	// Sites included in the basic averages: i>=imin, j>=jmin, kmin<=k<kmax
+	void AverageRange(int &imin, int &jmin, int &kmin, int &kmax) const;
 	void Full();
 	void Write(int time);
     void AggregateLabels(char *FILENAME);
 
 private:
+	void BasicReduce(double count_w, double count_n, double inlet_pressure);
 	FILE *TIMELOG;
 	FILE *SUBPHASE;
 };
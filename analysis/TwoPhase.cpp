@@ -352,28 +352,79 @@ void TwoPhase::SetParams(double rhoA, double rhoB, double tauA, double tauB, dou
 	
 }
 
-/*
-void TwoPhase::SetupCubes(Domain &Dm)
+// Range of the cubes to average (the inlet / outlet layers are excluded)
+void TwoPhase::GetCubeRange(int &imin, int &jmin, int &kmin, int &kmax)
 {
-	int i,j,k;
-	kstart = 1;
-	kfinish = Nz-1;
-	if (Dm->BoundaryCondition !=0 && Dm->kproc==0)			kstart = 4;
-	if (Dm->BoundaryCondition !=0 && Dm->kproc==Dm->nprocz-1)	kfinish = Nz-4;
-	nc=0;
-	for (k=kstart; k<kfinish; k++){
-		for (j=1; j<Ny-1; j++){
-			for (i=1; i<Nx-1; i++){
-				cubeList(0,nc) = i;
-				cubeList(1,nc) = j;
-				cubeList(2,nc) = k;
-				nc++;
+	// If external boundary conditions are set, do not average over the inlet
+	kmin=1; kmax=Nz-1;
+	if (Dm->BoundaryCondition > 0 && Dm->kproc() == 0) kmin=4;
+	if (Dm->BoundaryCondition > 0 && Dm->kproc() == Dm->nprocz()-1) kmax=Nz-4;
+
+	imin=jmin=1;
+	// If inlet layers exist use these as default
+	if (Dm->inlet_layers_x > 0) imin = Dm->inlet_layers_x;
+	if (Dm->inlet_layers_y > 0) jmin = Dm->inlet_layers_y;
+	if (Dm->inlet_layers_z > 0) kmin = Dm->inlet_layers_z;
+}
+
+
+// True unless the corners of the cube are all above or all below the isovalue
+static inline bool CubeStraddles(const DoubleArray &A, double v, int i, int j, int k)
+{
+	double lo = A(i,j,k), hi = lo;
+	for (int p=1; p<8; p++){
+		double x = A(i+(p&1),j+((p>>1)&1),k+(p>>2));
+		lo = std::min(lo,x);
+		hi = std::max(hi,x);
+	}
+	return lo <= v && hi >= v;
+}
+
+
+void TwoPhase::SetupCubes()
+{
+	// The interfaces (and the common curve) of a cube are only constructed if the
+	// signed distance or the phase indicator changes sign on one of its edges, so
+	// the other cubes do not add to the interfacial averages
+	int imin,jmin,kmin,kmax;
+	GetCubeRange(imin,jmin,kmin,kmax);
+	int nk = std::max(kmax-kmin,0);
+	cubePlane.assign(nk+1,0);
+#ifdef USE_OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int k=kmin; k<kmax; k++){
+		int count = 0;
+		for (int j=jmin; j<Ny-1; j++){
+			for (int i=imin; i<Nx-1; i++){
+				if ( CubeStraddles(SDn,fluid_isovalue,i,j,k) || CubeStraddles(SDs,solid_isovalue,i,j,k) )
+					count++;
+			}
+		}
+		cubePlane[k-kmin+1] = count;
+	}
+	for (int p=0; p<nk; p++)
+		cubePlane[p+1] += cubePlane[p];
+	nc = cubePlane[nk];
+	if ( cubeList.size(0) != 3 || (int) cubeList.size(1) < nc )
+		cubeList.resize(3,nc+nc/4+1);
+#ifdef USE_OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int k=kmin; k<kmax; k++){
+		int c = cubePlane[k-kmin];
+		for (int j=jmin; j<Ny-1; j++){
+			for (int i=imin; i<Nx-1; i++){
+				if ( CubeStraddles(SDn,fluid_isovalue,i,j,k) || CubeStraddles(SDs,solid_isovalue,i,j,k) ){
+					cubeList(0,c) = i;
+					cubeList(1,c) = j;
+					cubeList(2,c) = k;
+					c++;
+				}
 			}
 		}
 	}
-	ncubes = nc;
 }
-*/
 
 
 void TwoPhase::UpdateSolid()
@@ -384,11 +435,7 @@ void TwoPhase::UpdateSolid()
 	//...........................................................................
 	pmmc_MeshGradient(SDs,SDs_x,SDs_y,SDs_z,Nx,Ny,Nz);
 	//...........................................................................
-	Dm->CommunicateMeshHalo(SDs_x);
-	//...........................................................................
-	Dm->CommunicateMeshHalo(SDs_y);
-	//...........................................................................
-	Dm->CommunicateMeshHalo(SDs_z);
+	Dm->CommunicateMeshHalo({&SDs_x,&SDs_y,&SDs_z});
 	//...........................................................................
 }
 
@@ -397,27 +444,15 @@ void TwoPhase::UpdateMeshValues()
 {
 	int i,j,k,n;
 	//...........................................................................
-	Dm->CommunicateMeshHalo(SDn);
+	Dm->CommunicateMeshHalo({&SDn,&SDs});
 	//...........................................................................
 	// Compute the gradients of the phase indicator and signed distance fields
 	pmmc_MeshGradient(SDn,SDn_x,SDn_y,SDn_z,Nx,Ny,Nz);
-	//...........................................................................
-	// Gradient of the phase indicator field
-	//...........................................................................
-	Dm->CommunicateMeshHalo(SDn_x);
-	//...........................................................................
-	Dm->CommunicateMeshHalo(SDn_y);
-	//...........................................................................
-	Dm->CommunicateMeshHalo(SDn_z);
-	//...........................................................................
-	Dm->CommunicateMeshHalo(SDs);
 	pmmc_MeshGradient(SDs,SDs_x,SDs_y,SDs_z,Nx,Ny,Nz);
 	//...........................................................................
-	Dm->CommunicateMeshHalo(SDs_x);
+	// Gradient of the phase indicator field and the signed distance
 	//...........................................................................
-	Dm->CommunicateMeshHalo(SDs_y);
-	//...........................................................................
-	Dm->CommunicateMeshHalo(SDs_z);
+	Dm->CommunicateMeshHalo({&SDn_x,&SDn_y,&SDn_z,&SDs_x,&SDs_y,&SDs_z});
 	//...........................................................................
 	// Compute the mesh curvature of the phase indicator field
 	pmmc_MeshCurvature(SDn, MeanCurvature, GaussCurvature, Nx, Ny, Nz);
@@ -426,19 +461,7 @@ void TwoPhase::UpdateMeshValues()
 	// Map Phase_tplus and Phase_tminus
 	for (int n=0; n<Nx*Ny*Nz; n++)	dPdt(n) = 0.125*(Phase_tplus(n) - Phase_tminus(n));
 	//...........................................................................
-	Dm->CommunicateMeshHalo(Press);
-	//...........................................................................
-	Dm->CommunicateMeshHalo(Vel_x);
-	//...........................................................................
-	Dm->CommunicateMeshHalo(Vel_y);
-	//...........................................................................
-	Dm->CommunicateMeshHalo(Vel_z);
-	//...........................................................................
-	Dm->CommunicateMeshHalo(MeanCurvature);
-	//...........................................................................
-	Dm->CommunicateMeshHalo(GaussCurvature);
-	//...........................................................................
-	Dm->CommunicateMeshHalo(DelPhi);
+	Dm->CommunicateMeshHalo({&Press,&Vel_x,&Vel_y,&Vel_z,&MeanCurvature,&GaussCurvature,&DelPhi});
 	//...........................................................................
 	// Initializing the blob ID
 	for (k=0; k<Nz; k++){
@@ -461,143 +484,246 @@ void TwoPhase::UpdateMeshValues()
 		}
 	}
 }
-void TwoPhase::ComputeLocal()
+TwoPhase::CubeScratch::CubeScratch():
+	n_nw_pts(0), n_ns_pts(0), n_ws_pts(0), n_nws_pts(0), n_local_sol_pts(0), n_local_nws_pts(0),
+	n_nw_tris(0), n_ns_tris(0), n_ws_tris(0), n_nws_seg(0), n_local_sol_tris(0),
+	nw_pts(20), ns_pts(20), ws_pts(20), nws_pts(20), local_sol_pts(20), local_nws_pts(20)
 {
-	int i,j,k,n,imin,jmin,kmin,kmax;
-	int cube[8][3] = {{0,0,0},{1,0,0},{0,1,0},{1,1,0},{0,0,1},{1,0,1},{0,1,1},{1,1,1}};
+	CubeValues.resize(2,2,2);
+	nw_tris.resize(3,20);
+	ns_tris.resize(3,20);
+	ws_tris.resize(3,20);
+	nws_seg.resize(2,20);
+	local_sol_tris.resize(3,18);
+	Values.resize(20);
+	DistanceValues.resize(20);
+	KGwns_values.resize(20);
+	KNwns_values.resize(20);
+	InterfaceSpeed.resize(20);
+	NormalVector.resize(60);
+}
 
-	// If external boundary conditions are set, do not average over the inlet
-	kmin=1; kmax=Nz-1;
-	if (Dm->BoundaryCondition > 0 && Dm->kproc() == 0) kmin=4;
-	if (Dm->BoundaryCondition > 0 && Dm->kproc() == Dm->nprocz()-1) kmax=Nz-4;
 
-	imin=jmin=1;
-	// If inlet layers exist use these as default
-	if (Dm->inlet_layers_x > 0) imin = Dm->inlet_layers_x;
-	if (Dm->inlet_layers_y > 0) jmin = Dm->inlet_layers_y;
-	if (Dm->inlet_layers_z > 0) kmin = Dm->inlet_layers_z;
-		
-	for (k=kmin; k<kmax; k++){
-		for (j=jmin; j<Ny-1; j++){
-			for (i=imin; i<Nx-1; i++){
-				//...........................................................................
-				n_nw_pts=n_ns_pts=n_ws_pts=n_nws_pts=n_local_sol_pts=n_local_nws_pts=0;
-				n_nw_tris=n_ns_tris=n_ws_tris=n_nws_seg=n_local_sol_tris=0;
-				//...........................................................................
-				// Compute volume averages
-				for (int p=0;p<8;p++){
-					n = i+cube[p][0] + (j+cube[p][1])*Nx + (k+cube[p][2])*Nx*Ny;
-					if ( Dm->id[n] > 0 ){
-						// 1-D index for this cube corner
-						// compute the norm of the gradient of the phase indicator field
-						// Compute the non-wetting phase volume contribution
-						if ( Phase(i+cube[p][0],j+cube[p][1],k+cube[p][2]) > 0 ){
-							nwp_volume += 0.125;
-							// velocity
-							van(0) += 0.125*Vel_x(n);
-							van(1) += 0.125*Vel_y(n);
-							van(2) += 0.125*Vel_z(n);
-							// volume the excludes the interfacial region
-							if (DelPhi(n) < 1e-4){
-								vol_n += 0.125;
-								// pressure
-								pan += 0.125*Press(n);
+TwoPhase::CubeAverages::CubeAverages():
+	nwp_volume(0), wp_volume(0), vol_n(0), vol_w(0), pan(0), paw(0),
+	awn(0), ans(0), aws(0), lwns(0), As(0), dummy(0),
+	Kwn(0), Jwn(0), wwndnw(0), Jwnwwndnw(0), trawn(0), trJwn(0), trRwn(0),
+	efawns(0), wwnsdnwn(0), KNwns(0), KGwns(0),
+	An(0), Jn(0), Kn(0), euler(0)
+{
+	van.resize(3);		van.fill(0);
+	vaw.resize(3);		vaw.fill(0);
+	vawn.resize(3);		vawn.fill(0);
+	vawns.resize(3);	vawns.fill(0);
+	Gwn.resize(6);		Gwn.fill(0);
+	Gns.resize(6);		Gns.fill(0);
+	Gws.resize(6);		Gws.fill(0);
+}
 
-							}
-						}
-						else{
-							wp_volume += 0.125;
-							// velocity
-							vaw(0) += 0.125*Vel_x(n);
-							vaw(1) += 0.125*Vel_y(n);
-							vaw(2) += 0.125*Vel_z(n);
-							if (DelPhi(n) < 1e-4){
-								// volume the excludes the interfacial region
-								vol_w += 0.125;
-								// pressure
-								paw += 0.125*Press(n);
 
-							}
-						}
-					}
+void TwoPhase::CubeAverages::add( const CubeAverages& x )
+{
+	nwp_volume += x.nwp_volume;	wp_volume += x.wp_volume;
+	vol_n += x.vol_n;			vol_w += x.vol_w;
+	pan += x.pan;				paw += x.paw;
+	awn += x.awn;	ans += x.ans;	aws += x.aws;
+	lwns += x.lwns;	As += x.As;		dummy += x.dummy;
+	Kwn += x.Kwn;	Jwn += x.Jwn;
+	wwndnw += x.wwndnw;			Jwnwwndnw += x.Jwnwwndnw;
+	trawn += x.trawn;	trJwn += x.trJwn;	trRwn += x.trRwn;
+	efawns += x.efawns;			wwnsdnwn += x.wwnsdnwn;
+	KNwns += x.KNwns;			KGwns += x.KGwns;
+	An += x.An;	Jn += x.Jn;	Kn += x.Kn;	euler += x.euler;
+	for (int p=0; p<3; p++){
+		van(p) += x.van(p);
+		vaw(p) += x.vaw(p);
+		vawn(p) += x.vawn(p);
+		vawns(p) += x.vawns(p);
+	}
+	for (int p=0; p<6; p++){
+		Gwn(p) += x.Gwn(p);
+		Gns(p) += x.Gns(p);
+		Gws(p) += x.Gws(p);
+	}
+}
+
+
+void TwoPhase::ComputeCubeVolume( int i, int j, int k, CubeAverages& avg )
+{
+	static const int cube[8][3] = {{0,0,0},{1,0,0},{0,1,0},{1,1,0},{0,0,1},{1,0,1},{0,1,1},{1,1,1}};
+	// Compute volume averages
+	for (int p=0;p<8;p++){
+		int n = i+cube[p][0] + (j+cube[p][1])*Nx + (k+cube[p][2])*Nx*Ny;
+		if ( Dm->id[n] > 0 ){
+			// 1-D index for this cube corner
+			// compute the norm of the gradient of the phase indicator field
+			// Compute the non-wetting phase volume contribution
+			if ( Phase(i+cube[p][0],j+cube[p][1],k+cube[p][2]) > 0 ){
+				avg.nwp_volume += 0.125;
+				// velocity
+				avg.van(0) += 0.125*Vel_x(n);
+				avg.van(1) += 0.125*Vel_y(n);
+				avg.van(2) += 0.125*Vel_z(n);
+				// volume the excludes the interfacial region
+				if (DelPhi(n) < 1e-4){
+					avg.vol_n += 0.125;
+					// pressure
+					avg.pan += 0.125*Press(n);
+
 				}
+			}
+			else{
+				avg.wp_volume += 0.125;
+				// velocity
+				avg.vaw(0) += 0.125*Vel_x(n);
+				avg.vaw(1) += 0.125*Vel_y(n);
+				avg.vaw(2) += 0.125*Vel_z(n);
+				if (DelPhi(n) < 1e-4){
+					// volume the excludes the interfacial region
+					avg.vol_w += 0.125;
+					// pressure
+					avg.paw += 0.125*Press(n);
 
-				//...........................................................................
-				// Construct the interfaces and common curve
-				pmmc_ConstructLocalCube(SDs, SDn, solid_isovalue, fluid_isovalue,
-						nw_pts, nw_tris, Values, ns_pts, ns_tris, ws_pts, ws_tris,
-						local_nws_pts, nws_pts, nws_seg, local_sol_pts, local_sol_tris,
-						n_local_sol_tris, n_local_sol_pts, n_nw_pts, n_nw_tris,
-						n_ws_pts, n_ws_tris, n_ns_tris, n_ns_pts, n_local_nws_pts, n_nws_pts, n_nws_seg,
-						i, j, k, Nx, Ny, Nz);
+				}
+			}
+		}
+	}
+}
 
-				// wn interface averages
-				if (n_nw_pts > 0){
-					awn += pmmc_CubeSurfaceOrientation(Gwn,nw_pts,nw_tris,n_nw_tris);
-					Kwn += pmmc_CubeSurfaceInterpValue(CubeValues,GaussCurvature,nw_pts,nw_tris,Values,i,j,k,n_nw_pts,n_nw_tris);
-					Jwn += pmmc_CubeSurfaceInterpValue(CubeValues,MeanCurvature,nw_pts,nw_tris,Values,i,j,k,n_nw_pts,n_nw_tris);
 
-					// Compute the normal speed of the interface
-					wwndnw += pmmc_InterfaceSpeed(dPdt, SDn_x, SDn_y, SDn_z, CubeValues, nw_pts, nw_tris,
-							NormalVector, InterfaceSpeed, vawn, i, j, k, n_nw_pts, n_nw_tris);
+void TwoPhase::ComputeCube( int i, int j, int k, CubeScratch& c, CubeAverages& avg )
+{
+	//...........................................................................
+	c.n_nw_pts=c.n_ns_pts=c.n_ws_pts=c.n_nws_pts=c.n_local_sol_pts=c.n_local_nws_pts=0;
+	c.n_nw_tris=c.n_ns_tris=c.n_ws_tris=c.n_nws_seg=c.n_local_sol_tris=0;
+	//...........................................................................
+	// Construct the interfaces and common curve
+	pmmc_ConstructLocalCube(SDs, SDn, solid_isovalue, fluid_isovalue,
+			c.nw_pts, c.nw_tris, c.Values, c.ns_pts, c.ns_tris, c.ws_pts, c.ws_tris,
+			c.local_nws_pts, c.nws_pts, c.nws_seg, c.local_sol_pts, c.local_sol_tris,
+			c.n_local_sol_tris, c.n_local_sol_pts, c.n_nw_pts, c.n_nw_tris,
+			c.n_ws_pts, c.n_ws_tris, c.n_ns_tris, c.n_ns_pts, c.n_local_nws_pts, c.n_nws_pts, c.n_nws_seg,
+			i, j, k, Nx, Ny, Nz);
 
-					//for (int p=0; p <n_nw_tris; p++) wwndnw += InterfaceSpeed(p);
-					for (int p=0; p <n_nw_tris; p++) Jwnwwndnw += InterfaceSpeed(p)*Values(p);
+	// wn interface averages
+	if (c.n_nw_pts > 0){
+		avg.awn += pmmc_CubeSurfaceOrientation(avg.Gwn,c.nw_pts,c.nw_tris,c.n_nw_tris);
+		avg.Kwn += pmmc_CubeSurfaceInterpValue(c.CubeValues,GaussCurvature,c.nw_pts,c.nw_tris,c.Values,i,j,k,c.n_nw_pts,c.n_nw_tris);
+		avg.Jwn += pmmc_CubeSurfaceInterpValue(c.CubeValues,MeanCurvature,c.nw_pts,c.nw_tris,c.Values,i,j,k,c.n_nw_pts,c.n_nw_tris);
 
-					// Integrate the trimmed mean curvature (hard-coded to use a distance of 4 pixels)
-					pmmc_CubeTrimSurfaceInterpValues(CubeValues,MeanCurvature,SDs,nw_pts,nw_tris,Values,DistanceValues,
-							i,j,k,n_nw_pts,n_nw_tris,trimdist,dummy,trJwn);
+		// Compute the normal speed of the interface
+		avg.wwndnw += pmmc_InterfaceSpeed(dPdt, SDn_x, SDn_y, SDn_z, c.CubeValues, c.nw_pts, c.nw_tris,
+				c.NormalVector, c.InterfaceSpeed, avg.vawn, i, j, k, c.n_nw_pts, c.n_nw_tris);
 
-					pmmc_CubeTrimSurfaceInterpInverseValues(CubeValues,MeanCurvature,SDs,nw_pts,nw_tris,Values,DistanceValues,
-							i,j,k,n_nw_pts,n_nw_tris,trimdist,dummy,trRwn);
+		for (int p=0; p <c.n_nw_tris; p++) avg.Jwnwwndnw += c.InterfaceSpeed(p)*c.Values(p);
 
-				}
-				// wns common curve averages
-				if (n_local_nws_pts > 0){
-					efawns += pmmc_CubeContactAngle(CubeValues,Values,SDn_x,SDn_y,SDn_z,SDs_x,SDs_y,SDs_z,
-							local_nws_pts,i,j,k,n_local_nws_pts);
+		// Integrate the trimmed mean curvature (hard-coded to use a distance of 4 pixels)
+		pmmc_CubeTrimSurfaceInterpValues(c.CubeValues,MeanCurvature,SDs,c.nw_pts,c.nw_tris,c.Values,c.DistanceValues,
+				i,j,k,c.n_nw_pts,c.n_nw_tris,trimdist,avg.dummy,avg.trJwn);
 
-					wwnsdnwn += pmmc_CommonCurveSpeed(CubeValues, dPdt, vawns, SDn_x, SDn_y, SDn_z,SDs_x,SDs_y,SDs_z,
-							local_nws_pts,i,j,k,n_local_nws_pts);
+		pmmc_CubeTrimSurfaceInterpInverseValues(c.CubeValues,MeanCurvature,SDs,c.nw_pts,c.nw_tris,c.Values,c.DistanceValues,
+				i,j,k,c.n_nw_pts,c.n_nw_tris,trimdist,avg.dummy,avg.trRwn);
 
-					pmmc_CurveCurvature(SDn, SDs, SDn_x, SDn_y, SDn_z, SDs_x, SDs_y,
-							SDs_z, KNwns_values, KGwns_values, KNwns, KGwns,
-							nws_pts, n_nws_pts, i, j, k);
+	}
+	// wns common curve averages
+	if (c.n_local_nws_pts > 0){
+		avg.efawns += pmmc_CubeContactAngle(c.CubeValues,c.Values,SDn_x,SDn_y,SDn_z,SDs_x,SDs_y,SDs_z,
+				c.local_nws_pts,i,j,k,c.n_local_nws_pts);
 
-					lwns +=  pmmc_CubeCurveLength(local_nws_pts,n_local_nws_pts);
-				}
+		avg.wwnsdnwn += pmmc_CommonCurveSpeed(c.CubeValues, dPdt, avg.vawns, SDn_x, SDn_y, SDn_z,SDs_x,SDs_y,SDs_z,
+				c.local_nws_pts,i,j,k,c.n_local_nws_pts);
 
-				// Solid interface averagees
-				if (n_local_sol_tris > 0){
-					As  += pmmc_CubeSurfaceArea(local_sol_pts,local_sol_tris,n_local_sol_tris);
+		pmmc_CurveCurvature(SDn, SDs, SDn_x, SDn_y, SDn_z, SDs_x, SDs_y,
+				SDs_z, c.KNwns_values, c.KGwns_values, avg.KNwns, avg.KGwns,
+				c.nws_pts, c.n_nws_pts, i, j, k);
 
-					// Compute the surface orientation and the interfacial area
-					ans += pmmc_CubeSurfaceOrientation(Gns,ns_pts,ns_tris,n_ns_tris);
-					aws += pmmc_CubeSurfaceOrientation(Gws,ws_pts,ws_tris,n_ws_tris);
-				}
-				//...........................................................................
-				// Compute the integral curvature of the non-wetting phase
+		avg.lwns +=  pmmc_CubeCurveLength(c.local_nws_pts,c.n_local_nws_pts);
+	}
+
+	// Solid interface averagees
+	if (c.n_local_sol_tris > 0){
+		avg.As  += pmmc_CubeSurfaceArea(c.local_sol_pts,c.local_sol_tris,c.n_local_sol_tris);
+
+		// Compute the surface orientation and the interfacial area
+		avg.ans += pmmc_CubeSurfaceOrientation(avg.Gns,c.ns_pts,c.ns_tris,c.n_ns_tris);
+		avg.aws += pmmc_CubeSurfaceOrientation(avg.Gws,c.ws_pts,c.ws_tris,c.n_ws_tris);
+	}
+	//...........................................................................
+	// Compute the integral curvature of the non-wetting phase
+
+	c.n_nw_pts=c.n_nw_tris=0;
+	// Compute the non-wetting phase surface and associated area
+	avg.An += geomavg_MarchingCubes(SDn,fluid_isovalue,i,j,k,c.nw_pts,c.n_nw_pts,c.nw_tris,c.n_nw_tris);
+	// Compute the integral of mean curvature
+	if (c.n_nw_pts>0){
+		pmmc_CubeTrimSurfaceInterpValues(c.CubeValues,MeanCurvature,SDs,c.nw_pts,c.nw_tris,c.Values,c.DistanceValues,
+				i,j,k,c.n_nw_pts,c.n_nw_tris,trimdist,avg.trawn,avg.dummy);
+	}
+
+	avg.Jn += pmmc_CubeSurfaceInterpValue(c.CubeValues,MeanCurvature,c.nw_pts,c.nw_tris,c.Values,
+							i,j,k,c.n_nw_pts,c.n_nw_tris);
+	// Compute Euler characteristic from integral of gaussian curvature
+	avg.Kn += pmmc_CubeSurfaceInterpValue(c.CubeValues,GaussCurvature,c.nw_pts,c.nw_tris,c.Values,
+			i,j,k,c.n_nw_pts,c.n_nw_tris);
+
+	avg.euler += geomavg_EulerCharacteristic(c.nw_pts,c.nw_tris,c.n_nw_pts,c.n_nw_tris,i,j,k);
+}
 
-				n_nw_pts=n_nw_tris=0;
-				// Compute the non-wetting phase surface and associated area
-				An += geomavg_MarchingCubes(SDn,fluid_isovalue,i,j,k,nw_pts,n_nw_pts,nw_tris,n_nw_tris);
-				// Compute the integral of mean curvature
-				if (n_nw_pts>0){
-					pmmc_CubeTrimSurfaceInterpValues(CubeValues,MeanCurvature,SDs,nw_pts,nw_tris,Values,DistanceValues,
-							i,j,k,n_nw_pts,n_nw_tris,trimdist,trawn,dummy);
-				}
 
-				Jn += pmmc_CubeSurfaceInterpValue(CubeValues,MeanCurvature,nw_pts,nw_tris,Values,
-										i,j,k,n_nw_pts,n_nw_tris);
-				// Compute Euler characteristic from integral of gaussian curvature
-				Kn += pmmc_CubeSurfaceInterpValue(CubeValues,GaussCurvature,nw_pts,nw_tris,Values,
-						i,j,k,n_nw_pts,n_nw_tris);
+void TwoPhase::ComputeLocal()
+{
+	int i,j,k,n,imin,jmin,kmin,kmax;
+	GetCubeRange(imin,jmin,kmin,kmax);
 
-				euler += geomavg_EulerCharacteristic(nw_pts,nw_tris,n_nw_pts,n_nw_tris,i,j,k);
+	// Find the cubes on the interfaces
+	SetupCubes();
 
+	// Each plane of cubes is summed on its own and the planes are added in order,
+	// so the averages do not depend on the number of threads
+	std::vector<CubeAverages> plane(std::max(kmax-kmin,0));
+#ifdef USE_OPENMP
+	#pragma omp parallel
+#endif
+	{
+		CubeScratch scratch;
+#ifdef USE_OPENMP
+		#pragma omp for schedule(dynamic,1)
+#endif
+		for (int kk=kmin; kk<kmax; kk++){
+			CubeAverages &avg = plane[kk-kmin];
+			for (int jj=jmin; jj<Ny-1; jj++){
+				for (int ii=imin; ii<Nx-1; ii++)
+					ComputeCubeVolume( ii, jj, kk, avg );
 			}
+			for (int c=cubePlane[kk-kmin]; c<cubePlane[kk-kmin+1]; c++)
+				ComputeCube( cubeList(0,c), cubeList(1,c), cubeList(2,c), scratch, avg );
 		}
 	}
+	CubeAverages local;
+	for (size_t p=0; p<plane.size(); p++)
+		local.add( plane[p] );
+	nwp_volume += local.nwp_volume;	wp_volume += local.wp_volume;
+	vol_n += local.vol_n;			vol_w += local.vol_w;
+	pan += local.pan;				paw += local.paw;
+	awn += local.awn;	ans += local.ans;	aws += local.aws;
+	lwns += local.lwns;	As += local.As;		dummy += local.dummy;
+	Kwn += local.Kwn;	Jwn += local.Jwn;
+	wwndnw += local.wwndnw;			Jwnwwndnw += local.Jwnwwndnw;
+	trawn += local.trawn;	trJwn += local.trJwn;	trRwn += local.trRwn;
+	efawns += local.efawns;			wwnsdnwn += local.wwnsdnwn;
+	KNwns += local.KNwns;			KGwns += local.KGwns;
+	An += local.An;	Jn += local.Jn;	Kn += local.Kn;	euler += local.euler;
+	for (int p=0; p<3; p++){
+		van(p) += local.van(p);
+		vaw(p) += local.vaw(p);
+		vawn(p) += local.vawn(p);
+		vawns(p) += local.vawns(p);
+	}
+	for (int p=0; p<6; p++){
+		Gwn(p) += local.Gwn(p);
+		Gns(p) += local.Gns(p);
+		Gws(p) += local.Gws(p);
+	}
 
 	Array <char> phase_label(Nx,Ny,Nz);
 	Array <double> phase_distance(Nx,Ny,Nz);
@@ -1104,46 +1230,56 @@ void TwoPhase::ComponentAverages()
 
 void TwoPhase::Reduce()
 {
-	int i;
-	double iVol_global=1.0/Volume;
-	//...........................................................................
-	MPI_Barrier(Dm->Comm);
-	MPI_Allreduce(&nwp_volume,&nwp_volume_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&wp_volume,&wp_volume_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&awn,&awn_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&ans,&ans_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&aws,&aws_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&lwns,&lwns_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&As,&As_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&Jwn,&Jwn_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&Kwn,&Kwn_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&KGwns,&KGwns_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&KNwns,&KNwns_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&efawns,&efawns_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&wwndnw,&wwndnw_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&wwnsdnwn,&wwnsdnwn_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&Jwnwwndnw,&Jwnwwndnw_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
+	ReduceStart();
+	ReduceFinish();
+}
+
+void TwoPhase::ReduceStart()
+{
+	// Add the local averages to the set (one collective for all the sums)
+	Reduction.clear();
+	Reduction.add(ReduceSet::SUM,&nwp_volume,&nwp_volume_global);
+	Reduction.add(ReduceSet::SUM,&wp_volume,&wp_volume_global);
+	Reduction.add(ReduceSet::SUM,&awn,&awn_global);
+	Reduction.add(ReduceSet::SUM,&ans,&ans_global);
+	Reduction.add(ReduceSet::SUM,&aws,&aws_global);
+	Reduction.add(ReduceSet::SUM,&lwns,&lwns_global);
+	Reduction.add(ReduceSet::SUM,&As,&As_global);
+	Reduction.add(ReduceSet::SUM,&Jwn,&Jwn_global);
+	Reduction.add(ReduceSet::SUM,&Kwn,&Kwn_global);
+	Reduction.add(ReduceSet::SUM,&KGwns,&KGwns_global);
+	Reduction.add(ReduceSet::SUM,&KNwns,&KNwns_global);
+	Reduction.add(ReduceSet::SUM,&efawns,&efawns_global);
+	Reduction.add(ReduceSet::SUM,&wwndnw,&wwndnw_global);
+	Reduction.add(ReduceSet::SUM,&wwnsdnwn,&wwnsdnwn_global);
+	Reduction.add(ReduceSet::SUM,&Jwnwwndnw,&Jwnwwndnw_global);
 	// Phase averages
-	MPI_Allreduce(&vol_w,&vol_w_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&vol_n,&vol_n_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&paw,&paw_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&pan,&pan_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&vaw(0),&vaw_global(0),3,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&van(0),&van_global(0),3,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&vawn(0),&vawn_global(0),3,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&vawns(0),&vawns_global(0),3,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&Gwn(0),&Gwn_global(0),6,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&Gns(0),&Gns_global(0),6,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&Gws(0),&Gws_global(0),6,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&trawn,&trawn_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&trJwn,&trJwn_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&trRwn,&trRwn_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&euler,&euler_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&An,&An_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&Jn,&Jn_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&Kn,&Kn_global,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
+	Reduction.add(ReduceSet::SUM,&vol_w,&vol_w_global);
+	Reduction.add(ReduceSet::SUM,&vol_n,&vol_n_global);
+	Reduction.add(ReduceSet::SUM,&paw,&paw_global);
+	Reduction.add(ReduceSet::SUM,&pan,&pan_global);
+	Reduction.add(ReduceSet::SUM,&vaw(0),&vaw_global(0),3);
+	Reduction.add(ReduceSet::SUM,&van(0),&van_global(0),3);
+	Reduction.add(ReduceSet::SUM,&vawn(0),&vawn_global(0),3);
+	Reduction.add(ReduceSet::SUM,&vawns(0),&vawns_global(0),3);
+	Reduction.add(ReduceSet::SUM,&Gwn(0),&Gwn_global(0),6);
+	Reduction.add(ReduceSet::SUM,&Gns(0),&Gns_global(0),6);
+	Reduction.add(ReduceSet::SUM,&Gws(0),&Gws_global(0),6);
+	Reduction.add(ReduceSet::SUM,&trawn,&trawn_global);
+	Reduction.add(ReduceSet::SUM,&trJwn,&trJwn_global);
+	Reduction.add(ReduceSet::SUM,&trRwn,&trRwn_global);
+	Reduction.add(ReduceSet::SUM,&euler,&euler_global);
+	Reduction.add(ReduceSet::SUM,&An,&An_global);
+	Reduction.add(ReduceSet::SUM,&Jn,&Jn_global);
+	Reduction.add(ReduceSet::SUM,&Kn,&Kn_global);
+	Reduction.start(Dm->Comm);
+}
 
-	MPI_Barrier(Dm->Comm);
+void TwoPhase::ReduceFinish()
+{
+	int i;
+	double iVol_global=1.0/Volume;
+	Reduction.finish();
 
 	// Normalize the phase averages
 	// (density of both components = 1.0)
@@ -71,6 +71,35 @@ class TwoPhase{
 
 	DoubleArray RecvBuffer;
 
+	// Surfaces and common curve of one cube (each thread of ComputeLocal has its own)
+	struct CubeScratch {
+		int n_nw_pts,n_ns_pts,n_ws_pts,n_nws_pts,n_local_sol_pts,n_local_nws_pts;
+		int n_nw_tris,n_ns_tris,n_ws_tris,n_nws_seg,n_local_sol_tris;
+		DTMutableList<Point> nw_pts, ns_pts, ws_pts, nws_pts, local_sol_pts, local_nws_pts;
+		IntArray nw_tris, ns_tris, ws_tris, nws_seg, local_sol_tris;
+		DoubleArray CubeValues, Values, DistanceValues, KGwns_values, KNwns_values;
+		DoubleArray InterfaceSpeed, NormalVector;
+		CubeScratch();
+	};
+	// Local averages of a plane of cubes (summed in the order of the planes)
+	struct CubeAverages {
+		double nwp_volume, wp_volume, vol_n, vol_w, pan, paw;
+		double awn, ans, aws, lwns, As, dummy;
+		double Kwn, Jwn, wwndnw, Jwnwwndnw, trawn, trJwn, trRwn;
+		double efawns, wwnsdnwn, KNwns, KGwns;
+		double An, Jn, Kn, euler;
+		DoubleArray van, vaw, vawn, vawns, Gwn, Gns, Gws;
+		CubeAverages();
+		void add( const CubeAverages& x );
+	};
+	void ComputeCubeVolume( int i, int j, int k, CubeAverages& avg );
+	void ComputeCube( int i, int j, int k, CubeScratch& cube, CubeAverages& avg );
+	void GetCubeRange( int &imin, int &jmin, int &kmin, int &kmax );
+	std::vector<int> cubePlane;		// first cube of each plane in cubeList
+
+	// Local/global averages reduced by Reduce
+	ReduceSet Reduction;
+
 	char *TempID;
 
 	// CSV / text file where time history of averages is saved
@@ -174,7 +203,11 @@ public:
 	TwoPhase(std::shared_ptr <Domain> Dm);
 	~TwoPhase();
 	void Initialize();
-//	void SetupCubes(Domain &Dm);
+	// Cubes on the interfaces: the 3 x nc cubeList holds the cubes (i,j,k) whose
+	// corners straddle the isovalue of SDn or SDs (set by ComputeLocal)
+	IntArray cubeList;
+	int NumberCubes() const { return nc; }
+	void SetupCubes();
 	void UpdateMeshValues();
 	void UpdateSolid();
 	void ComputeDelPhi();
@@ -183,6 +216,10 @@ public:
 	void AssignComponentLabels();
 	void ComponentAverages();
 	void Reduce();
+	// Reduce in two parts (the local averages are copied by ReduceStart, so they may
+	// be changed before ReduceFinish stores and normalizes the global averages)
+	void ReduceStart();
+	void ReduceFinish();
 	void NonDimensionalize(double D, double viscosity, double IFT);
 	void PrintAll(int timestep);
 	int GetCubeLabel(int i, int j, int k, IntArray &BlobLabel);
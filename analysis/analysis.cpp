@@ -17,6 +17,8 @@
 #include "ProfilerApp.h"
 
 #include <algorithm>
+#include <array>
+#include <cstring>
 #include <iostream>
 
 
@@ -200,63 +202,123 @@ int ComputeLocalPhaseComponent(const IntArray &PhaseID, int &VALUE, BlobIDArray
 }
 
 
+/******************************************************************
+* Reductions over a binomial tree of ranks                        *
+******************************************************************/
+static const int tree_tag = 3823;
+// Parent (-1 on rank 0) and children (in the order they are recieved) of a rank
+static void treeNeighbors( MPI_Comm comm, int& parent, std::vector<int>& children )
+{
+    int rank = comm_rank(comm);
+    int nprocs = comm_size(comm);
+    parent = -1;
+    children.clear();
+    for (int s=1; s<nprocs; s*=2) {
+        if ( rank & s ) {
+            parent = rank - s;
+            break;
+        }
+        if ( rank + s < nprocs )
+            children.push_back( rank + s );
+    }
+}
+static void sendTree( const std::vector<int64_t>& data, int dst, MPI_Comm comm )
+{
+    MPI_Send( getPtr(data), data.size(), MPI_LONG_LONG, dst, tree_tag, comm );
+}
+static std::vector<int64_t> recvTree( int src, MPI_Comm comm )
+{
+    MPI_Status status;
+    MPI_Probe( src, tree_tag, comm, &status );
+    int count = 0;
+    MPI_Get_count( &status, MPI_LONG_LONG, &count );
+    std::vector<int64_t> data(count);
+    MPI_Recv( getPtr(data), count, MPI_LONG_LONG, src, tree_tag, comm, &status );
+    return data;
+}
+
+
 /******************************************************************
 * Reorder the global blob ids                                     *
 ******************************************************************/
-static int ReorderBlobIDs2( BlobIDArray& ID, int N_blobs, int ngx, int ngy, int ngz, MPI_Comm comm )
+// Reorder the ids by the number of cells in the interior (largest first), the
+// (id,size) lists are summed up the tree and rank 0 sends back the new ids
+static int ReorderBlobIDs2( BlobIDArray& ID, int ngx, int ngy, int ngz, MPI_Comm comm )
 {
-    if ( N_blobs==0 )
-        return 0;
     PROFILE_START("ReorderBlobIDs2",1);
-    ASSERT(sizeof(long long int)==sizeof(int64_t));
-    double *local_size = new double[N_blobs];
-    double *global_size = new double[N_blobs];
-    for (int i=0; i<N_blobs; i++)
-        local_size[i] = 0;
-    for (int i=0; i<N_blobs; i++)
-        global_size[i] = 0;
-    int max_id = -1;
+    // Local size of each id (ids that only appear in the ghosts have size 0)
+    std::map<int64_t,int64_t> size;
+    for (size_t i=0; i<ID.length(); i++) {
+        if ( ID(i) >= 0 )
+            size.insert(std::pair<int64_t,int64_t>(ID(i),0));
+    }
     for (size_t k=ngz; k<ID.size(2)-ngz; k++) {
         for (size_t j=ngy; j<ID.size(1)-ngy; j++) {
             for (size_t i=ngx; i<ID.size(0)-ngx; i++) {
                 int id = ID(i,j,k);
-                if ( id >= 0 ) 
-                    local_size[id] += 1;
-                max_id = std::max(max_id,id);
+                if ( id >= 0 )
+                    size[id]++;
             }
         }
     }
-    ASSERT(max_id<N_blobs);
-    MPI_Allreduce(local_size,global_size,N_blobs,MPI_DOUBLE,MPI_SUM,comm);
-    std::vector<std::pair<double,int> > map1(N_blobs);
-    int N_blobs2 = 0;
-    for (int i=0; i<N_blobs; i++) {
-        map1[i].first = global_size[i];
-        map1[i].second = i;
-        if ( global_size[i] > 0 )
-            N_blobs2++;
+    // Sum the sizes up the tree
+    int parent;
+    std::vector<int> children;
+    treeNeighbors( comm, parent, children );
+    std::vector<std::vector<int64_t> > child_ids(children.size());
+    for (size_t c=0; c<children.size(); c++) {
+        std::vector<int64_t> data = recvTree( children[c], comm );
+        for (size_t i=0; i<data.size(); i+=2) {
+            size[data[i]] += data[i+1];
+            child_ids[c].push_back(data[i]);
+        }
+    }
+    std::map<int64_t,int64_t> new_id;
+    int N_blobs = 0;
+    if ( parent >= 0 ) {
+        std::vector<int64_t> data;
+        data.reserve(2*size.size());
+        for (std::map<int64_t,int64_t>::const_iterator it=size.begin(); it!=size.end(); ++it) {
+            data.push_back(it->first);
+            data.push_back(it->second);
+        }
+        sendTree( data, parent, comm );
+        data = recvTree( parent, comm );
+        N_blobs = data[0];
+        std::map<int64_t,int64_t>::const_iterator it=size.begin();
+        for (size_t i=1; i<data.size(); i++, ++it)
+            new_id[it->first] = data[i];
+    } else {
+        // Sort the blobs by size (largest first)
+        std::vector<std::pair<int64_t,int64_t> > map1;
+        map1.reserve(size.size());
+        for (std::map<int64_t,int64_t>::const_iterator it=size.begin(); it!=size.end(); ++it) {
+            map1.push_back(std::pair<int64_t,int64_t>(it->second,it->first));
+            if ( it->second > 0 )
+                N_blobs++;
+        }
+        std::sort( map1.begin(), map1.end() );
+        for (size_t i=0; i<map1.size(); i++)
+            new_id[map1[map1.size()-i-1].second] = i;
     }
-    std::sort( map1.begin(), map1.end() );
-    std::vector<int> map2(N_blobs,-1);
-    for (int i=0; i<N_blobs; i++) {
-        map2[map1[N_blobs-i-1].second] = i;
+    // Send the new ids down the tree
+    for (int c=children.size()-1; c>=0; c--) {
+        std::vector<int64_t> data(1,N_blobs);
+        for (size_t i=0; i<child_ids[c].size(); i++)
+            data.push_back(new_id[child_ids[c][i]]);
+        sendTree( data, children[c], comm );
     }
     for (size_t i=0; i<ID.length(); i++) {
         if ( ID(i) >= 0 )
-            ID(i) = map2[ID(i)];
+            ID(i) = new_id[ID(i)];
     }
-    delete [] local_size;
-    delete [] global_size;
     PROFILE_STOP("ReorderBlobIDs2",1);
-    return N_blobs2;
+    return N_blobs;
 }
 void ReorderBlobIDs( BlobIDArray& ID, MPI_Comm comm )
 {
     PROFILE_START("ReorderBlobIDs");
-    int tmp = ID.max()+1;
-    int N_blobs = 0;
-    MPI_Allreduce(&tmp,&N_blobs,1,MPI_INT,MPI_MAX,comm);
-    ReorderBlobIDs2(ID,N_blobs,1,1,1,comm);
+    ReorderBlobIDs2(ID,1,1,1,comm);
     PROFILE_STOP("ReorderBlobIDs");
 }
 
@@ -264,80 +326,59 @@ void ReorderBlobIDs( BlobIDArray& ID, MPI_Comm comm )
 /******************************************************************
 * Compute the global blob ids                                     *
 ******************************************************************/
-struct global_id_info_struct {
-    int64_t new_id;
-    std::set<int64_t> remote_ids;
-};
-// Send the local ids and their new value to all neighbors
-static void updateRemoteIds( 
-    const std::map<int64_t,global_id_info_struct>& map,
-    const std::vector<int>& neighbors,
-    int N_send, const std::vector<int>& N_recv,
-    int64_t *send_buf, std::vector<int64_t*>& recv_buf,
-    std::map<int64_t,int64_t>& remote_map,
-    MPI_Comm comm )
-{
-    std::vector<MPI_Request> send_req(neighbors.size());
-    std::vector<MPI_Request> recv_req(neighbors.size());
-    std::vector<MPI_Status> status(neighbors.size());
-    std::map<int64_t,global_id_info_struct>::const_iterator it = map.begin();
-    ASSERT(N_send==(int)map.size());
-    for (size_t i=0; i<map.size(); i++, ++it) {
-        send_buf[2*i+0] = it->first;
-        send_buf[2*i+1] = it->second.new_id;
-    }
-    for (size_t i=0; i<neighbors.size(); i++) {
-        MPI_Isend( send_buf,    2*N_send,    MPI_LONG_LONG, neighbors[i], 0, comm, &send_req[i] );
-        MPI_Irecv( recv_buf[i], 2*N_recv[i], MPI_LONG_LONG, neighbors[i], 0, comm, &recv_req[i] );
-    }
-    for (it=map.begin(); it!=map.end(); ++it) {
-        remote_map[it->first] = it->second.new_id;
-    }
-    for (size_t i=0; i<neighbors.size(); i++) {
-        MPI_Wait(&recv_req[i],&status[i]);
-        for (int j=0; j<N_recv[i]; j++)
-            remote_map[recv_buf[i][2*j+0]] = recv_buf[i][2*j+1];
-    }
-    MPI_Waitall(neighbors.size(),getPtr(send_req),getPtr(status));
-}
-// Compute a new local id for each local id
-static bool updateLocalIds( const std::map<int64_t,int64_t>& remote_map, 
-    std::map<int64_t,global_id_info_struct>& map )
+// Union-find of global ids, the root of each set is its smallest id
+class BlobIDUnionFind
 {
-    bool changed = false;
-    std::map<int64_t,global_id_info_struct>::iterator it;
-    for (it=map.begin(); it!=map.end(); ++it) {
-        int64_t id = it->second.new_id;
-        std::set<int64_t>::const_iterator it2;
-        for (it2=it->second.remote_ids.begin(); it2!=it->second.remote_ids.end(); ++it2) {
-            int64_t id2 = remote_map.find(*it2)->second;
-            id = std::min(id,id2);
-        }
-        changed = changed || it->second.new_id!=id;
-        it->second.new_id = id;
-    }
-    return changed;
-}
+public:
+    int64_t find( int64_t id ) {
+        int64_t root = id;
+        std::map<int64_t,int64_t>::iterator it = parent.find(root);
+        while ( it != parent.end() ) {
+            root = it->second;
+            it = parent.find(root);
+        }
+        while ( id != root ) {
+            it = parent.find(id);
+            id = it->second;
+            it->second = root;
+        }
+        return root;
+    }
+    void unite( int64_t id1, int64_t id2 ) {
+        id1 = find(id1);
+        id2 = find(id2);
+        if ( id1 < id2 )
+            parent[id2] = id1;
+        else if ( id2 < id1 )
+            parent[id1] = id2;
+    }
+    // (id,root) for every id that is not a root
+    std::vector<int64_t> pairs() {
+        std::vector<int64_t> data;
+        data.reserve(2*parent.size());
+        for (std::map<int64_t,int64_t>::iterator it=parent.begin(); it!=parent.end(); ++it) {
+            data.push_back(it->first);
+            data.push_back(find(it->first));
+        }
+        return data;
+    }
+    std::map<int64_t,int64_t> parent;   // only ids that are not a root
+};
 static int LocalToGlobalIDs( int nx, int ny, int nz, const RankInfoStruct& rank_info, 
     int nblobs, BlobIDArray& IDs, MPI_Comm comm )
 {
     PROFILE_START("LocalToGlobalIDs",1);
-    const int rank = rank_info.rank[1][1][1];
-    int nprocs = comm_size(comm);
     const int ngx = (IDs.size(0)-nx)/2;
     const int ngy = (IDs.size(1)-ny)/2;
     const int ngz = (IDs.size(2)-nz)/2;
-    // Get the number of blobs for each rank
-    std::vector<int> N_blobs(nprocs,0);
-    PROFILE_START("LocalToGlobalIDs-Allgather",1);
-    MPI_Allgather(&nblobs,1,MPI_INT,getPtr(N_blobs),1,MPI_INT,comm);
-    PROFILE_STOP("LocalToGlobalIDs-Allgather",1);
-    int64_t N_blobs_tot = 0;
+    // Get the offset for the ids of each rank
     int offset = 0;
-    for (int i=0; i<rank; i++)
-        offset += N_blobs[i];
-    for (int i=0; i<nprocs; i++)
-        N_blobs_tot += N_blobs[i];
+    int64_t N_blobs_tot = 0;
+    int64_t nblobs2 = nblobs;
+    MPI_Exscan(&nblobs,&offset,1,MPI_INT,MPI_SUM,comm);
+    if ( comm_rank(comm) == 0 )
+        offset = 0;
+    MPI_Allreduce(&nblobs2,&N_blobs_tot,1,MPI_LONG_LONG,MPI_SUM,comm);
     INSIST(N_blobs_tot<0x80000000,"Maximum number of blobs exceeded");
     // Compute temporary global ids
     for (size_t i=0; i<IDs.length(); i++) {
@@ -348,91 +389,48 @@ static int LocalToGlobalIDs( int nx, int ny, int nz, const RankInfoStruct& rank_
     // Copy the ids and get the neighbors through the halos
     fillHalo<BlobIDType> fillData(comm,rank_info,{nx,ny,nz},{1,1,1},0,1,{true,true,true});
     fillData.fill(IDs);
-    // Create a list of all neighbor ranks (excluding self)
-    std::vector<int> neighbors;
-    neighbors.push_back( rank_info.rank[0][1][1] );
-    neighbors.push_back( rank_info.rank[2][1][1] );
-    neighbors.push_back( rank_info.rank[1][0][1] );
-    neighbors.push_back( rank_info.rank[1][2][1] );
-    neighbors.push_back( rank_info.rank[1][1][0] );
-    neighbors.push_back( rank_info.rank[1][1][2] );
-    std::sort( neighbors.begin(), neighbors.end() );
-    neighbors.erase( std::unique( neighbors.begin(), neighbors.end() ), neighbors.end() );
-    // Create a map of all local ids to the neighbor ids
-    std::map<int64_t,global_id_info_struct> map;
-    std::set<int64_t> local;
+    // Merge the local ids with the ids of the neighbors across the sub-domain faces
+    BlobIDUnionFind sets;
     for (size_t i=0; i<LocalIDs.length(); i++) {
-        if ( LocalIDs(i)>=0 ) {
-            local.insert(LocalIDs(i));
-            if ( LocalIDs(i)!=IDs(i) && IDs(i)>=0 )
-                map[LocalIDs(i)].remote_ids.insert(IDs(i));
-        }
-    }
-    std::map<int64_t,global_id_info_struct>::iterator it;
-    for (it=map.begin(); it!=map.end(); ++it) {
-        it->second.new_id = it->first;
-        local.erase(it->first);
-    }
-    // Get the number of ids we will recieve from each rank
-    int N_send = map.size();
-    std::vector<int> N_recv(neighbors.size(),0);
-    std::vector<MPI_Request> send_req(neighbors.size());
-    std::vector<MPI_Request> recv_req(neighbors.size());
-    std::vector<MPI_Status> status(neighbors.size());
-    for (size_t i=0; i<neighbors.size(); i++) {
-        MPI_Isend( &N_send,    1, MPI_INT, neighbors[i], 0, comm, &send_req[i] );
-        MPI_Irecv( &N_recv[i], 1, MPI_INT, neighbors[i], 0, comm, &recv_req[i] );
-    }
-    MPI_Waitall(neighbors.size(),getPtr(send_req),getPtr(status));
-    MPI_Waitall(neighbors.size(),getPtr(recv_req),getPtr(status));
-    // Allocate memory for communication
-    int64_t *send_buf = new int64_t[2*N_send];
-    std::vector<int64_t*> recv_buf(neighbors.size());
-    for (size_t i=0; i<neighbors.size(); i++)
-        recv_buf[i] = new int64_t[2*N_recv[i]];
-    // Compute a map for the remote ids, and new local id for each id
-    std::map<int64_t,int64_t> remote_map;
-    for (it=map.begin(); it!=map.end(); ++it) {
-        int64_t id = it->first;
-        std::set<int64_t>::const_iterator it2;
-        for (it2=it->second.remote_ids.begin(); it2!=it->second.remote_ids.end(); ++it2) {
-            int64_t id2 = *it2;
-            id = std::min(id,id2);
-            remote_map.insert(std::pair<int64_t,int64_t>(id2,id2));
-        }
-        it->second.new_id = id;
-    }
-    // Iterate until we are done
-    int iteration = 1;
-    PROFILE_START("LocalToGlobalIDs-loop",1);
-    while ( 1 ) {
-        iteration++;
-        // Send the local ids and their new value to all neighbors
-        updateRemoteIds( map, neighbors, N_send, N_recv,send_buf, recv_buf, remote_map, comm );
-        // Compute a new local id for each local id
-        bool changed = updateLocalIds( remote_map, map );
-        // Check if we are finished
-        int test = changed ? 1:0;
-        int result = 0;
-        MPI_Allreduce(&test,&result,1,MPI_INT,MPI_SUM,comm);
-        if ( result==0 )
-            break;
+        if ( LocalIDs(i)>=0 && IDs(i)>=0 && LocalIDs(i)!=IDs(i) )
+            sets.unite( LocalIDs(i), IDs(i) );
+    }
+    // Merge the sets up the tree of ranks
+    PROFILE_START("LocalToGlobalIDs-tree",1);
+    int parent;
+    std::vector<int> children;
+    treeNeighbors( comm, parent, children );
+    std::vector<std::vector<int64_t> > child_pairs(children.size());
+    for (size_t c=0; c<children.size(); c++) {
+        child_pairs[c] = recvTree( children[c], comm );
+        for (size_t i=0; i<child_pairs[c].size(); i+=2)
+            sets.unite( child_pairs[c][i], child_pairs[c][i+1] );
     }
-    PROFILE_STOP("LocalToGlobalIDs-loop",1);
+    if ( parent >= 0 ) {
+        // Send the sets to the parent and get back the final root of each id
+        std::vector<int64_t> pairs = sets.pairs();
+        sendTree( pairs, parent, comm );
+        std::vector<int64_t> root = recvTree( parent, comm );
+        for (size_t i=0; i<pairs.size(); i+=2) {
+            sets.parent[pairs[i]] = root[i/2];
+            if ( pairs[i+1] != root[i/2] )
+                sets.parent[pairs[i+1]] = root[i/2];
+        }
+    }
+    for (int c=children.size()-1; c>=0; c--) {
+        std::vector<int64_t> root(child_pairs[c].size()/2);
+        for (size_t i=0; i<root.size(); i++)
+            root[i] = sets.find( child_pairs[c][2*i] );
+        sendTree( root, children[c], comm );
+    }
+    PROFILE_STOP("LocalToGlobalIDs-tree",1);
     // Relabel the ids
-    std::vector<int> final_map(nblobs,-1);
-    for (it=map.begin(); it!=map.end(); ++it)
-        final_map[it->first-offset] = it->second.new_id;
-    for (std::set<int64_t>::const_iterator it2=local.begin(); it2!=local.end(); ++it2)
-        final_map[*it2-offset] = *it2;
-    for (size_t i=0; i<final_map.size(); i++)
-        ASSERT(final_map[i]>=0);
     for (size_t k=ngz; k<IDs.size(2)-ngz; k++) {
         for (size_t j=ngy; j<IDs.size(1)-ngy; j++) {
             for (size_t i=ngx; i<IDs.size(0)-ngx; i++) {
-                BlobIDType id = IDs(i,j,k);
+                BlobIDType id = LocalIDs(i,j,k);
                 if ( id >= 0 )
-                    IDs(i,j,k) = final_map[id-offset];
+                    IDs(i,j,k) = sets.find(id);
             }
         }
     }
@@ -440,11 +438,7 @@ static int LocalToGlobalIDs( int nx, int ny, int nz, const RankInfoStruct& rank_
     fillHalo<BlobIDType> fillData2(comm,rank_info,{nx,ny,nz},{1,1,1},0,1,{true,true,true});
     fillData2.fill(IDs);
     // Reorder based on size (and compress the id space
-    int N_blobs_global = ReorderBlobIDs2(IDs,N_blobs_tot,ngx,ngy,ngz,comm);
-    // Finished
-    delete [] send_buf;
-    for (size_t i=0; i<neighbors.size(); i++)
-        delete [] recv_buf[i];
+    int N_blobs_global = ReorderBlobIDs2(IDs,ngx,ngy,ngz,comm);
     PROFILE_STOP("LocalToGlobalIDs",1);
     return N_blobs_global;
 }
@@ -477,71 +471,69 @@ int ComputeGlobalPhaseComponent( int nx, int ny, int nz, const RankInfoStruct& r
 * Compute the mapping of blob ids between timesteps               *
 ******************************************************************/
 typedef std::map<BlobIDType,std::map<BlobIDType,int64_t> > map_type;
-template<class TYPE> inline MPI_Datatype getMPIType();
-template<> inline MPI_Datatype getMPIType<int32_t>() { return MPI_INT; }
-template<> inline MPI_Datatype getMPIType<int64_t>() { 
-    if ( sizeof(int64_t)==sizeof(long int) )
-        return MPI_LONG;
-    else if ( sizeof(int64_t)==sizeof(double) )
-        return MPI_DOUBLE;
-}
-template<class TYPE>
-void gatherSet( std::set<TYPE>& set, MPI_Comm comm )
-{
-    int nprocs = comm_size(comm);
-    MPI_Datatype type = getMPIType<TYPE>();
-    std::vector<TYPE> send_data(set.begin(),set.end());
-    int send_count = send_data.size();
-    std::vector<int> recv_count(nprocs,0), recv_disp(nprocs,0);
-    MPI_Allgather(&send_count,1,MPI_INT,getPtr(recv_count),1,MPI_INT,comm);
-    for (int i=1; i<nprocs; i++)
-        recv_disp[i] = recv_disp[i-1] + recv_count[i-1];
-    std::vector<TYPE> recv_data(recv_disp[nprocs-1]+recv_count[nprocs-1]);
-    MPI_Allgatherv(getPtr(send_data),send_count,type,
-        getPtr(recv_data),getPtr(recv_count),getPtr(recv_disp),type,comm);
-    for (size_t i=0; i<recv_data.size(); i++)
-        set.insert(recv_data[i]);
-}
-void gatherSrcIDMap( map_type& src_map, MPI_Comm comm )
+// Serialize the src/dst ids and the src id map (the overlaps are added when merging)
+static void packIDMap( const std::set<BlobIDType>& src_set, const std::set<BlobIDType>& dst_set,
+    const map_type& src_map, std::vector<int64_t>& data )
 {
-    int nprocs = comm_size(comm);
-    MPI_Datatype type = getMPIType<int64_t>();
-    std::vector<int64_t> send_data;
+    data.clear();
+    data.push_back(src_set.size());
+    data.insert(data.end(),src_set.begin(),src_set.end());
+    data.push_back(dst_set.size());
+    data.insert(data.end(),dst_set.begin(),dst_set.end());
     for (map_type::const_iterator it=src_map.begin(); it!=src_map.end(); ++it) {
-        int id = it->first;
         const std::map<BlobIDType,int64_t>& src_ids = it->second;
-        send_data.push_back(id);
-        send_data.push_back(src_ids.size());
+        data.push_back(it->first);
+        data.push_back(src_ids.size());
         std::map<BlobIDType,int64_t>::const_iterator it2;
         for (it2=src_ids.begin(); it2!=src_ids.end(); ++it2) {
-            send_data.push_back(it2->first);
-            send_data.push_back(it2->second);
-        }
-    }
-    int send_count = send_data.size();
-    std::vector<int> recv_count(nprocs,0), recv_disp(nprocs,0);
-    MPI_Allgather(&send_count,1,MPI_INT,getPtr(recv_count),1,MPI_INT,comm);
-    for (int i=1; i<nprocs; i++)
-        recv_disp[i] = recv_disp[i-1] + recv_count[i-1];
-    std::vector<int64_t> recv_data(recv_disp[nprocs-1]+recv_count[nprocs-1]);
-    MPI_Allgatherv(getPtr(send_data),send_count,type,
-        getPtr(recv_data),getPtr(recv_count),getPtr(recv_disp),type,comm);
-    size_t i=0;
-    src_map.clear();
-    while ( i < recv_data.size() ) {
-        BlobIDType id = recv_data[i];
-        size_t count = recv_data[i+1];
+            data.push_back(it2->first);
+            data.push_back(it2->second);
+        }
+    }
+}
+static void unpackIDMap( const std::vector<int64_t>& data, std::set<BlobIDType>& src_set,
+    std::set<BlobIDType>& dst_set, map_type& src_map, size_t i=0 )
+{
+    for (int64_t n=data[i++]; n>0; n--)
+        src_set.insert(data[i++]);
+    for (int64_t n=data[i++]; n>0; n--)
+        dst_set.insert(data[i++]);
+    while ( i < data.size() ) {
+        BlobIDType id = data[i];
+        size_t count = data[i+1];
         i += 2;
         std::map<BlobIDType,int64_t>& src_ids = src_map[id];
         for (size_t j=0; j<count; j++,i+=2) {
-            std::map<BlobIDType,int64_t>::iterator it = src_ids.find(recv_data[i]);
+            std::map<BlobIDType,int64_t>::iterator it = src_ids.find(data[i]);
             if ( it == src_ids.end() )
-                src_ids.insert(std::pair<BlobIDType,int64_t>(recv_data[i],recv_data[i+1]));
+                src_ids.insert(std::pair<BlobIDType,int64_t>(data[i],data[i+1]));
             else
-                it->second += recv_data[i+1];
+                it->second += data[i+1];
         }
     }
 }
+// Merge the src/dst ids and the src id map up the tree and broadcast the result
+static void reduceIDMap( std::set<BlobIDType>& src_set, std::set<BlobIDType>& dst_set,
+    map_type& src_map, MPI_Comm comm )
+{
+    int parent;
+    std::vector<int> children;
+    treeNeighbors( comm, parent, children );
+    for (size_t c=0; c<children.size(); c++)
+        unpackIDMap( recvTree( children[c], comm ), src_set, dst_set, src_map );
+    std::vector<int64_t> data;
+    packIDMap( src_set, dst_set, src_map, data );
+    if ( parent >= 0 )
+        sendTree( data, parent, comm );
+    int64_t N = data.size();
+    MPI_Bcast(&N,1,MPI_LONG_LONG,0,comm);
+    data.resize(N);
+    MPI_Bcast(getPtr(data),N,MPI_LONG_LONG,0,comm);
+    src_set.clear();
+    dst_set.clear();
+    src_map.clear();
+    unpackIDMap( data, src_set, dst_set, src_map );
+}
 void addSrcDstIDs( BlobIDType src_id, map_type& src_map, map_type& dst_map, 
     std::set<BlobIDType>& src, std::set<BlobIDType>& dst )
 {
@@ -552,6 +544,8 @@ void addSrcDstIDs( BlobIDType src_id, map_type& src_map, map_type& dst_map,
             addSrcDstIDs(it->first,dst_map,src_map,dst,src);
     }
 }
+static ID_map_struct buildIDMap( const std::set<BlobIDType>& src_set, const std::set<BlobIDType>& dst_set,
+    map_type& src_map );
 ID_map_struct computeIDMap( int nx, int ny, int nz, 
     const BlobIDArray& ID1, const BlobIDArray& ID2, MPI_Comm comm )
 {
@@ -586,9 +580,14 @@ ID_map_struct computeIDMap( int nx, int ny, int nz,
         }
     }
     // Communicate the src/dst ids and src id map to all processors and reduce
-    gatherSet( src_set, comm );
-    gatherSet( dst_set, comm );
-    gatherSrcIDMap( src_map, comm );
+    reduceIDMap( src_set, dst_set, src_map, comm );
+    ID_map_struct id_map = buildIDMap( src_set, dst_set, src_map );
+    PROFILE_STOP("computeIDMap");
+    return id_map;
+}
+static ID_map_struct buildIDMap( const std::set<BlobIDType>& src_set, const std::set<BlobIDType>& dst_set,
+    map_type& src_map )
+{
     // Compute the dst id map
     map_type dst_map;   // Map of the dst ids for each src id
     for (map_type::const_iterator it=src_map.begin(); it!=src_map.end(); ++it) {
@@ -665,8 +664,6 @@ ID_map_struct computeIDMap( int nx, int ny, int nz,
             src_map.erase(*it);
     }
     ASSERT(src_map.empty());
-
-    PROFILE_STOP("computeIDMap");
     return id_map;
 }
 
@@ -848,3 +845,210 @@ void writeIDMap( const ID_map_struct& map, long long int timestep, const std::st
     fclose(fid);
 }
 
+
+
+/******************************************************************
+* Track the blobs between timesteps                               *
+******************************************************************/
+static const char blob_event_magic[8] = { 'L','B','P','M','B','L','O','B' };
+static const int32_t blob_event_version = 1;
+BlobTracker::BlobTracker( const std::string& filename, MPI_Comm comm, const std::string& id_map ):
+    d_filename(filename), d_id_map(id_map), d_id_max(-1), d_first(true)
+{
+    MPI_Comm_rank(comm,&d_rank);
+    if ( d_rank!=0 )
+        return;
+    if ( !d_id_map.empty() )
+        writeIDMap(ID_map_struct(),0,d_id_map);
+    FILE *fid = fopen(d_filename.c_str(),"wb");
+    INSIST(fid!=NULL,std::string("Error opening file: ")+d_filename);
+    fwrite(blob_event_magic,1,8,fid);
+    fwrite(&blob_event_version,sizeof(int32_t),1,fid);
+    fclose(fid);
+}
+static inline BlobSummary getSummary( const std::map<BlobIDType,BlobSummary>& blobs, BlobIDType id )
+{
+    std::map<BlobIDType,BlobSummary>::const_iterator it = blobs.find(id);
+    ASSERT(it!=blobs.end());
+    return it->second;
+}
+static void writeBlobEvent( FILE *fid, long long int timestep, BlobEvent::EventType type,
+    const std::vector<BlobIDType>& src, const std::vector<BlobIDType>& dst,
+    const std::map<BlobIDType,BlobSummary>& src_blobs, const std::map<BlobIDType,BlobSummary>& dst_blobs )
+{
+    int64_t header[2] = { timestep, type };
+    int32_t count[2] = { (int32_t) src.size(), (int32_t) dst.size() };
+    fwrite(header,sizeof(int64_t),2,fid);
+    fwrite(count,sizeof(int32_t),2,fid);
+    for (size_t i=0; i<src.size()+dst.size(); i++) {
+        BlobIDType id = i<src.size() ? src[i]:dst[i-src.size()];
+        BlobSummary blob = getSummary( i<src.size() ? src_blobs:dst_blobs, id );
+        int64_t data[2] = { id, blob.count };
+        fwrite(data,sizeof(int64_t),2,fid);
+        fwrite(blob.centroid,sizeof(double),3,fid);
+    }
+}
+void BlobTracker::update( long long int timestep, const Domain& Dm,
+    const BlobIDArray& ids, std::vector<BlobIDType>& new_ids, MPI_Comm comm )
+{
+    PROFILE_START("BlobTracker::update");
+    const int nx = Dm.Nx-2;
+    const int ny = Dm.Ny-2;
+    const int nz = Dm.Nz-2;
+    const int ngx = (ids.size(0)-nx)/2;
+    const int ngy = (ids.size(1)-ny)/2;
+    const int ngz = (ids.size(2)-nz)/2;
+    const int64_t ox = Dm.slab_x[Dm.iproc()] - ngx;
+    const int64_t oy = Dm.slab_y[Dm.jproc()] - ngy;
+    const int64_t oz = Dm.slab_z[Dm.kproc()] - ngz;
+    if ( d_first )
+        d_last.resize(nx,ny,nz);
+    ASSERT(d_last.size(0)==(size_t)nx&&d_last.size(1)==(size_t)ny&&d_last.size(2)==(size_t)nz);
+
+    // Sum the cells and positions of each blob and the overlaps with the last timestep (src id map)
+    std::map<BlobIDType,std::array<int64_t,4> > sums;
+    map_type src_map;
+    std::array<int64_t,4> *sum = NULL;
+    BlobIDType last_id = -1;
+    for (int k=ngz; k<ngz+nz; k++) {
+        for (int j=ngy; j<ngy+ny; j++) {
+            for (int i=ngx; i<ngx+nx; i++) {
+                BlobIDType id = ids(i,j,k);
+                if ( id<0 )
+                    continue;
+                if ( id!=last_id ) {
+                    std::map<BlobIDType,std::array<int64_t,4> >::iterator it = sums.find(id);
+                    if ( it==sums.end() )
+                        it = sums.insert(std::make_pair(id,std::array<int64_t,4>{0,0,0,0})).first;
+                    sum = &it->second;
+                    last_id = id;
+                }
+                (*sum)[0]++;
+                (*sum)[1] += ox+i;
+                (*sum)[2] += oy+j;
+                (*sum)[3] += oz+k;
+                BlobIDType id1 = d_first ? -1:d_last(i-ngx,j-ngy,k-ngz);
+                if ( id1>=0 )
+                    src_map[id][id1]++;
+            }
+        }
+    }
+
+    // Reduce the sums and the (sparse) overlap table up the tree to rank 0
+    int parent;
+    std::vector<int> children;
+    treeNeighbors( comm, parent, children );
+    std::set<BlobIDType> src_set, dst_set;
+    for (size_t c=0; c<children.size(); c++) {
+        std::vector<int64_t> data = recvTree( children[c], comm );
+        size_t i = 1;
+        for (int64_t n=data[0]; n>0; n--, i+=5) {
+            std::array<int64_t,4>& s = sums[data[i]];
+            for (int d=0; d<4; d++)
+                s[d] += data[i+1+d];
+        }
+        unpackIDMap( data, src_set, dst_set, src_map, i );
+    }
+    if ( parent>=0 ) {
+        std::vector<int64_t> data(1,sums.size());
+        for (std::map<BlobIDType,std::array<int64_t,4> >::const_iterator it=sums.begin(); it!=sums.end(); ++it) {
+            data.push_back(it->first);
+            data.insert(data.end(),it->second.begin(),it->second.end());
+        }
+        std::vector<int64_t> map_data;
+        packIDMap( src_set, dst_set, src_map, map_data );
+        data.insert(data.end(),map_data.begin(),map_data.end());
+        sendTree( data, parent, comm );
+    }
+
+    // Match the blobs, write the events and get the new ids (rank 0)
+    int64_t N = 0;
+    if ( d_rank==0 ) {
+        for (std::map<BlobIDType,BlobSummary>::const_iterator it=d_blobs.begin(); it!=d_blobs.end(); ++it)
+            src_set.insert(it->first);
+        for (std::map<BlobIDType,std::array<int64_t,4> >::const_iterator it=sums.begin(); it!=sums.end(); ++it)
+            dst_set.insert(it->first);
+        ID_map_struct map;
+        if ( d_first )
+            map.created = std::vector<BlobIDType>(dst_set.begin(),dst_set.end());
+        else
+            map = buildIDMap( src_set, dst_set, src_map );
+        getNewIDs( map, d_id_max, new_ids );
+        if ( !d_id_map.empty() )
+            writeIDMap(map,timestep,d_id_map);
+        std::map<BlobIDType,BlobSummary> blobs;
+        for (std::map<BlobIDType,std::array<int64_t,4> >::const_iterator it=sums.begin(); it!=sums.end(); ++it) {
+            BlobSummary& blob = blobs[new_ids[it->first]];
+            blob.count = it->second[0];
+            for (int d=0; d<3; d++)
+                blob.centroid[d] = static_cast<double>(it->second[d+1])/static_cast<double>(blob.count);
+        }
+        FILE *fid = fopen(d_filename.c_str(),"ab");
+        INSIST(fid!=NULL,std::string("Error opening file: ")+d_filename);
+        std::vector<BlobIDType> none;
+        for (size_t i=0; i<map.created.size(); i++)
+            writeBlobEvent(fid,timestep,BlobEvent::Birth,none,IDvec(1,map.created[i]),d_blobs,blobs);
+        for (size_t i=0; i<map.destroyed.size(); i++)
+            writeBlobEvent(fid,timestep,BlobEvent::Death,IDvec(1,map.destroyed[i]),none,d_blobs,blobs);
+        for (size_t i=0; i<map.split.size(); i++)
+            writeBlobEvent(fid,timestep,BlobEvent::Split,IDvec(1,map.split[i].first),map.split[i].second,d_blobs,blobs);
+        for (size_t i=0; i<map.merge.size(); i++)
+            writeBlobEvent(fid,timestep,BlobEvent::Merge,map.merge[i].first,IDvec(1,map.merge[i].second),d_blobs,blobs);
+        for (size_t i=0; i<map.merge_split.size(); i++)
+            writeBlobEvent(fid,timestep,BlobEvent::MergeSplit,map.merge_split[i].first,map.merge_split[i].second,d_blobs,blobs);
+        fclose(fid);
+        d_blobs.swap(blobs);
+        N = new_ids.size();
+    }
+    MPI_Bcast(&N,1,MPI_LONG_LONG,0,comm);
+    MPI_Bcast(&d_id_max,1,MPI_INT,0,comm);
+    new_ids.resize(N);
+    MPI_Bcast(getPtr(new_ids),N,MPI_INT,0,comm);
+
+    // Keep the new ids for the next timestep
+    for (int k=0; k<nz; k++) {
+        for (int j=0; j<ny; j++) {
+            for (int i=0; i<nx; i++) {
+                BlobIDType id = ids(i+ngx,j+ngy,k+ngz);
+                d_last(i,j,k) = id<0 ? -1:new_ids[id];
+            }
+        }
+    }
+    d_first = false;
+    PROFILE_STOP("BlobTracker::update");
+}
+std::vector<BlobEvent> readBlobEvents( const std::string& filename )
+{
+    FILE *fid = fopen(filename.c_str(),"rb");
+    INSIST(fid!=NULL,std::string("Error opening file: ")+filename);
+    char magic[8];
+    int32_t version = 0;
+    size_t N = fread(magic,1,8,fid);
+    N += fread(&version,sizeof(int32_t),1,fid);
+    INSIST(N==9&&memcmp(magic,blob_event_magic,8)==0&&version==blob_event_version,
+        std::string("Not a blob event file: ")+filename);
+    std::vector<BlobEvent> events;
+    int64_t header[2];
+    while ( fread(header,sizeof(int64_t),2,fid)==2 ) {
+        BlobEvent event;
+        event.timestep = header[0];
+        event.type = static_cast<BlobEvent::EventType>(header[1]);
+        int32_t count[2] = { 0, 0 };
+        N = fread(count,sizeof(int32_t),2,fid);
+        for (int32_t i=0; i<count[0]+count[1]; i++) {
+            int64_t data[2];
+            BlobSummary blob;
+            N += fread(data,sizeof(int64_t),2,fid);
+            N += fread(blob.centroid,sizeof(double),3,fid);
+            blob.count = data[1];
+            std::vector<BlobIDType>& ids = i<count[0] ? event.src:event.dst;
+            std::vector<BlobSummary>& info = i<count[0] ? event.src_info:event.dst_info;
+            ids.push_back(data[0]);
+            info.push_back(blob);
+        }
+        INSIST(N==2+5*(size_t)(count[0]+count[1]),std::string("Truncated blob event file: ")+filename);
+        events.push_back(event);
+    }
+    fclose(fid);
+    return events;
+}
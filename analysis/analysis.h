@@ -18,6 +18,7 @@
 
 #include "common/Array.h"
 #include "common/Communication.h"
+#include "common/Domain.h"
 
 #include <set>
 #include <map>
@@ -171,5 +172,83 @@ void renumberIDs( const std::vector<BlobIDType>& new_id_list, BlobIDArray& IDs )
 void writeIDMap( const ID_map_struct& map, long long int timestep, const std::string& filename );
 
 
+//! Size and centroid (in global cell coordinates) of a blob
+struct BlobSummary {
+    int64_t count;
+    double centroid[3];
+};
+
+
+//! Change of the blobs between two timesteps (an entry of the blob event log)
+struct BlobEvent {
+    enum EventType { Birth=0, Death=1, Split=2, Merge=3, MergeSplit=4 };
+    long long int timestep;
+    EventType type;
+    std::vector<BlobIDType> src;        // ids at the previous timestep
+    std::vector<BlobIDType> dst;        // ids at the current timestep
+    std::vector<BlobSummary> src_info;  // size and centroid of the src blobs
+    std::vector<BlobSummary> dst_info;  // size and centroid of the dst blobs
+};
+
+
+/*!
+ * @brief  Track the blobs between timesteps
+ * @details  This class keeps the ids of the last timestep (interior cells only) and
+ *    the size and centroid of each blob.  Each update sums the overlaps with the
+ *    last timestep into a sparse table that is reduced to rank 0, which matches the
+ *    blobs (see computeIDMap and getNewIDs), broadcasts the new ids and appends the
+ *    births, deaths, splits and merges to a binary event log (see readBlobEvents).
+ *    Blobs that map 1-1 are not written.  The id map of each timestep can also be
+ *    written in the text format of writeIDMap.
+ */
+class BlobTracker
+{
+public:
+    /*!
+     * @brief  Create the tracker
+     * @details  Rank 0 creates the event log and the id map (overwriting existing files)
+     * @param[in] filename      The event log
+     * @param[in] comm          The communicator used for the updates
+     * @param[in] id_map        The id map written with writeIDMap (empty: no id map)
+     */
+    BlobTracker( const std::string& filename, MPI_Comm comm, const std::string& id_map = "" );
+
+    /*!
+     * @brief  Track the blobs of the current timestep
+     * @details  The first update creates a blob for each id (births)
+     * @param[in] timestep      The current timestep
+     * @param[in] Dm            The domain (size and global offset of the sub-domain, see slab_x)
+     * @param[in] ids           The global blob ids at the current timestep (see ComputeGlobalBlobIDs)
+     * @param[out] new_ids      The time-consistent id for each blob id
+     * @param[in] comm          The communicator
+     */
+    void update( long long int timestep, const Domain& Dm,
+        const BlobIDArray& ids, std::vector<BlobIDType>& new_ids, MPI_Comm comm );
+
+    //! The size and centroid of each blob at the last update (time-consistent ids, rank 0 only)
+    const std::map<BlobIDType,BlobSummary>& blobs() const { return d_blobs; }
+
+private:
+    BlobTracker();
+    BlobTracker( const BlobTracker& );
+    BlobTracker& operator=( const BlobTracker& );
+    std::string d_filename;
+    std::string d_id_map;
+    int d_rank;
+    BlobIDType d_id_max;
+    bool d_first;
+    BlobIDArray d_last;
+    std::map<BlobIDType,BlobSummary> d_blobs;
+};
+
+
+/*!
+ * @brief  Read the blob event log
+ * @details  This functions reads the events written by BlobTracker
+ * @param[in] filename      The event log
+ */
+std::vector<BlobEvent> readBlobEvents( const std::string& filename );
+
+
 
 #endif
@@ -15,13 +15,300 @@
 */
 #include "analysis/distance.h"
 
+#include <algorithm>
+
+
+
+/******************************************************************
+* Exact Euclidean distance transform                              *
+* 1-D pass: lower envelope of the parabolas f(q) + w2*(p-q)^2     *
+* (Felzenszwalb & Huttenlocher), values >= EDT_INF are ignored    *
+******************************************************************/
+static const double EDT_INF = 1e100;
+static void EDT1D( const double *f, double *d, int n, double w2, int *v, double *z )
+{
+    int k = -1;
+    for (int q=0; q<n; q++) {
+        if ( f[q] >= EDT_INF )
+            continue;
+        double fq = f[q] + w2*q*q;
+        double s = -EDT_INF;
+        while ( k >= 0 ) {
+            s = ( fq - (f[v[k]]+w2*v[k]*v[k]) ) / ( 2.0*w2*(q-v[k]) );
+            if ( s > z[k] )
+                break;
+            k--;
+        }
+        k++;
+        v[k] = q;
+        z[k] = ( k == 0 ) ? -EDT_INF : s;
+        z[k+1] = EDT_INF;
+    }
+    if ( k < 0 ) {
+        for (int p=0; p<n; p++)
+            d[p] = EDT_INF;
+        return;
+    }
+    k = 0;
+    for (int p=0; p<n; p++) {
+        while ( z[k+1] < p )
+            k++;
+        d[p] = w2*(p-v[k])*(p-v[k]) + f[v[k]];
+    }
+}
+
+
+// First pass: f is 0 at the features and EDT_INF elsewhere
+static void EDT1DBinary( const double *f, double *d, int n, double w2 )
+{
+    int last = -1;
+    for (int p=0; p<n; p++) {
+        if ( f[p] == 0 )
+            last = p;
+        d[p] = ( last < 0 ) ? EDT_INF : w2*(p-last)*(p-last);
+    }
+    last = -1;
+    for (int p=n-1; p>=0; p--) {
+        if ( f[p] == 0 )
+            last = p;
+        if ( last >= 0 )
+            d[p] = std::min( d[p], w2*(last-p)*(last-p) );
+    }
+}
+
+
+/******************************************************************
+* Exact Euclidean distance transform                              *
+* Copy the lines along one axis of the local block (interior      *
+* cells only) to / from contiguous storage, line l at             *
+* lines[l*n[axis]]. The copy is tiled so both sides are read /    *
+* written a cache line at a time                                  *
+******************************************************************/
+static void EDTLines( std::vector<double>& f, const std::array<int,3>& n, int axis,
+    double *lines, bool gather )
+{
+    const int TILE = 16;
+    int b = ( axis == 0 ) ? 1 : 0;
+    int c = ( axis == 2 ) ? 1 : 2;
+    size_t stride[3] = { 1, size_t(n[0]), size_t(n[0])*n[1] };
+    int na = n[axis];
+#ifdef USE_OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int ic=0; ic<n[c]; ic++) {
+        double *data = f.data() + ic*stride[c];
+        double *block = lines + size_t(n[b])*ic*na;
+        for (int ib0=0; ib0<n[b]; ib0+=TILE) {
+            int ib1 = std::min( ib0+TILE, n[b] );
+            for (int p0=0; p0<na; p0+=TILE) {
+                int p1 = std::min( p0+TILE, na );
+                for (int p=p0; p<p1; p++) {
+                    for (int ib=ib0; ib<ib1; ib++) {
+                        double &line = block[size_t(ib)*na+p];
+                        double &cell = data[ib*stride[b]+p*stride[axis]];
+                        if ( gather )
+                            line = cell;
+                        else
+                            cell = line;
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+/******************************************************************
+* Exact Euclidean distance transform                              *
+* Pass along one axis. The lines are transposed between the ranks *
+* along the axis so each rank holds complete lines for a share of *
+* them; a periodic line is extended by up to half its length      *
+******************************************************************/
+static void EDTAxis( std::vector<double>& f, const std::array<int,3>& n, int axis,
+    MPI_Comm comm, const std::vector<int>& slab, bool periodic, double w2,
+    std::vector<double>& sendbuf, std::vector<double>& recvbuf )
+{
+    int nprocs = slab.size()-1;
+    int rank = comm_rank( comm );
+    int b = ( axis == 0 ) ? 1 : 0;
+    int c = ( axis == 2 ) ? 1 : 2;
+    int na = n[axis];
+    int N = slab.back();
+    int lines = n[b]*n[c];
+    // lines along x are already contiguous
+    double *local = f.data();
+    if ( axis != 0 ) {
+        sendbuf.resize( f.size() );
+        EDTLines( f, n, axis, sendbuf.data(), true );
+        local = sendbuf.data();
+    }
+    // lines [first[r],first[r+1]) are transformed by rank r
+    std::vector<int> first(nprocs+1);
+    for (int r=0; r<=nprocs; r++)
+        first[r] = (long long) lines * r / nprocs;
+    int mylines = first[rank+1] - first[rank];
+    std::vector<int> sendCount(nprocs), recvCount(nprocs), sendDisp(nprocs,0), recvDisp(nprocs,0);
+    for (int r=0; r<nprocs; r++) {
+        sendCount[r] = (first[r+1]-first[r])*na;
+        recvCount[r] = mylines*(slab[r+1]-slab[r]);
+        if ( r > 0 ) {
+            sendDisp[r] = sendDisp[r-1] + sendCount[r-1];
+            recvDisp[r] = recvDisp[r-1] + recvCount[r-1];
+        }
+    }
+    double *full = local;
+    if ( nprocs > 1 ) {
+        recvbuf.resize( size_t(mylines)*N );
+        MPI_Alltoallv( local, sendCount.data(), sendDisp.data(), MPI_DOUBLE,
+            recvbuf.data(), recvCount.data(), recvDisp.data(), MPI_DOUBLE, comm );
+        full = recvbuf.data();
+    }
+    int hmax = periodic ? (N+1)/2 : 0;
+    int length = N + 2*hmax;
+#ifdef USE_OPENMP
+    #pragma omp parallel
+#endif
+    {
+        std::vector<double> line(length), dist(length), z(length+1);
+        std::vector<int> v(length);
+#ifdef USE_OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int l=0; l<mylines; l++) {
+            // the segments from rank r are stored one after the other in recvbuf
+            if ( nprocs > 1 ) {
+                for (int r=0; r<nprocs; r++) {
+                    int nr = slab[r+1] - slab[r];
+                    const double *src = &full[size_t(mylines)*slab[r] + size_t(l)*nr];
+                    std::copy( src, src+nr, &line[hmax+slab[r]] );
+                }
+            } else {
+                std::copy( &full[size_t(l)*N], &full[size_t(l+1)*N], &line[hmax] );
+            }
+            // a periodic image further than sqrt(max f) can not be the nearest
+            int h = hmax;
+            if ( periodic && axis != 0 ) {
+                double fmax = *std::max_element( &line[hmax], &line[hmax+N] );
+                if ( fmax < EDT_INF )
+                    h = std::min( hmax, int(sqrt(fmax/w2)) + 1 );
+            }
+            double *in = &line[hmax-h];
+            std::copy( &line[hmax+N-h], &line[hmax+N], in );
+            std::copy( &line[hmax], &line[hmax+h], &line[hmax+N] );
+            if ( axis == 0 )
+                EDT1DBinary( in, dist.data(), N+2*h, w2 );
+            else
+                EDT1D( in, dist.data(), N+2*h, w2, v.data(), z.data() );
+            if ( nprocs > 1 ) {
+                for (int r=0; r<nprocs; r++) {
+                    int nr = slab[r+1] - slab[r];
+                    double *dst = &full[size_t(mylines)*slab[r] + size_t(l)*nr];
+                    std::copy( &dist[h+slab[r]], &dist[h+slab[r]+nr], dst );
+                }
+            } else {
+                std::copy( &dist[h], &dist[h+N], &full[size_t(l)*N] );
+            }
+        }
+    }
+    // return the segments to their owners
+    if ( nprocs > 1 ) {
+        MPI_Alltoallv( recvbuf.data(), recvCount.data(), recvDisp.data(), MPI_DOUBLE,
+            local, sendCount.data(), sendDisp.data(), MPI_DOUBLE, comm );
+    }
+    if ( axis != 0 )
+        EDTLines( f, n, axis, sendbuf.data(), false );
+}
 
 
 /******************************************************************
 * A fast distance calculation                                     *
+* Exact Euclidean distance from each cell to the nearest cell of  *
+* the other phase, less half a cell so the interface lies midway  *
+* between cells (positive where ID != 0)                          *
 ******************************************************************/
 template<class TYPE>
-void CalcDist( Array<TYPE> &Distance, const Array<char> &ID, const Domain &Dm,
+static void CalcDistExact( Array<TYPE> &Distance, const Array<char> &ID, const Domain &Dm,
+    const std::array<bool,3>& periodic, const std::array<double,3>& dx )
+{
+    ASSERT( Distance.size() == ID.size() );
+    std::array<int,3> n = { Dm.Nx-2, Dm.Ny-2, Dm.Nz-2 };
+    size_t N = size_t(n[0])*n[1]*n[2];
+    // squared distance to the nearest solid (ID == 0) and the nearest non-solid cell
+    std::vector<double> f[2];
+    f[0].resize( N );
+    f[1].resize( N );
+    for (int k=0; k<n[2]; k++) {
+        for (int j=0; j<n[1]; j++) {
+            for (int i=0; i<n[0]; i++) {
+                size_t m = i + n[0]*(j+size_t(n[1])*k);
+                bool solid = ID(i+1,j+1,k+1) == 0;
+                f[0][m] = solid ? 0 : EDT_INF;
+                f[1][m] = solid ? EDT_INF : 0;
+            }
+        }
+    }
+    // one pass per axis over the ranks along that axis
+    std::vector<double> sendbuf, recvbuf;
+    const std::vector<int> *slabs[3] = { &Dm.slab_x, &Dm.slab_y, &Dm.slab_z };
+    int proc[3] = { Dm.iproc(), Dm.jproc(), Dm.kproc() };
+    int nproc[3] = { Dm.nprocx(), Dm.nprocy(), Dm.nprocz() };
+    for (int axis=0; axis<3; axis++) {
+        int b = ( axis == 0 ) ? 1 : 0;
+        int c = ( axis == 2 ) ? 1 : 2;
+        MPI_Comm lineComm;
+        MPI_Comm_split( Dm.Comm, proc[b]+nproc[b]*proc[c], proc[axis], &lineComm );
+        for (int m=0; m<2; m++)
+            EDTAxis( f[m], n, axis, lineComm, *slabs[axis], periodic[axis], dx[axis]*dx[axis], sendbuf, recvbuf );
+        MPI_Comm_free( &lineComm );
+    }
+    const double h = 0.5 * std::min( std::min(dx[0],dx[1]), dx[2] );
+    for (int k=0; k<n[2]; k++) {
+        for (int j=0; j<n[1]; j++) {
+            for (int i=0; i<n[0]; i++) {
+                size_t m = i + n[0]*(j+size_t(n[1])*k);
+                if ( ID(i+1,j+1,k+1) == 0 )
+                    Distance(i+1,j+1,k+1) = -( sqrt(f[1][m]) - h );
+                else
+                    Distance(i+1,j+1,k+1) = sqrt(f[0][m]) - h;
+            }
+        }
+    }
+    // halo: fill from the neighbors, then copy the nearest cell on a non-periodic boundary
+    fillHalo<TYPE> fillData( Dm.Comm, Dm.rank_info, n, {1,1,1}, 50, 1, {true,true,true}, periodic );
+    fillData.fill( Distance );
+    int Nx = Dm.Nx, Ny = Dm.Ny, Nz = Dm.Nz;
+    if ( !periodic[0] ) {
+        for (int k=0; k<Nz; k++) {
+            for (int j=0; j<Ny; j++) {
+                if ( proc[0] == 0 )          Distance(0,j,k) = Distance(1,j,k);
+                if ( proc[0] == nproc[0]-1 ) Distance(Nx-1,j,k) = Distance(Nx-2,j,k);
+            }
+        }
+    }
+    if ( !periodic[1] ) {
+        for (int k=0; k<Nz; k++) {
+            for (int i=0; i<Nx; i++) {
+                if ( proc[1] == 0 )          Distance(i,0,k) = Distance(i,1,k);
+                if ( proc[1] == nproc[1]-1 ) Distance(i,Ny-1,k) = Distance(i,Ny-2,k);
+            }
+        }
+    }
+    if ( !periodic[2] ) {
+        for (int j=0; j<Ny; j++) {
+            for (int i=0; i<Nx; i++) {
+                if ( proc[2] == 0 )          Distance(i,j,0) = Distance(i,j,1);
+                if ( proc[2] == nproc[2]-1 ) Distance(i,j,Nz-1) = Distance(i,j,Nz-2);
+            }
+        }
+    }
+}
+
+
+/******************************************************************
+* Distance from the vector sweep (CalcVecDist)                    *
+******************************************************************/
+template<class TYPE>
+static void CalcDistVector( Array<TYPE> &Distance, const Array<char> &ID, const Domain &Dm,
     const std::array<bool,3>& periodic, const std::array<double,3>& dx )
 {
     ASSERT( Distance.size() == ID.size() );
@@ -38,6 +325,28 @@ void CalcDist( Array<TYPE> &Distance, const Array<char> &ID, const Domain &Dm,
 }
 
 
+/******************************************************************
+* Signed distance to the phase boundary                           *
+* DistanceMethod in the Domain database selects the transform:    *
+* "exact" (default) or "vector" (the vector sweep)                *
+******************************************************************/
+template<class TYPE>
+void CalcDist( Array<TYPE> &Distance, const Array<char> &ID, const Domain &Dm,
+    const std::array<bool,3>& periodic, const std::array<double,3>& dx )
+{
+    std::string method = "exact";
+    auto db = Dm.getDatabase();
+    if ( db && db->keyExists( "DistanceMethod" ) )
+        method = db->getScalar<std::string>( "DistanceMethod" );
+    if ( method == "exact" )
+        CalcDistExact( Distance, ID, Dm, periodic, dx );
+    else if ( method == "vector" )
+        CalcDistVector( Distance, ID, Dm, periodic, dx );
+    else
+        ERROR( "CalcDist: DistanceMethod must be exact or vector" );
+}
+
+
 /******************************************************************
 * Vector-based distance calculation                               *
 * Initialize cells adjacent to boundaries                         *
@@ -33,8 +33,12 @@ inline bool operator<(const Vec& l, const Vec& r){ return l.x*l.x+l.y*l.y+l.z*l.
 
 
 /*!
- * @brief  Calculate the distance using a simple method
- * @details  This routine calculates the vector distance to the nearest domain surface.
+ * @brief  Calculate the signed distance to the phase boundary
+ * @details  This routine calculates the exact Euclidean distance from each cell to the nearest
+ *    cell of the other phase (less half a cell), positive where ID != 0.  The transform is
+ *    separable: one pass per axis, with the lines transposed across the ranks along that axis.
+ *    DistanceMethod = "vector" in the Domain database selects the previous vector sweep
+ *    (CalcVecDist), which propagates approximate distance vectors from the interface.
  * @param[out] Distance     Distance function
  * @param[in] ID            Segmentation id
  * @param[in] Dm            Domain information
@@ -18,53 +18,129 @@
 #include "ProfilerApp.h"
 
 
+#include <algorithm>
+#include <vector>
+
+
+/********************************************************
+* Median filter (3x3x3)                                 *
+* Integer valued images (up to 16-bit) use a sliding    *
+* histogram along x (Huang), other images select the    *
+* median of each window; both give the exact median     *
+********************************************************/
+static bool isQuantized( const Array<float> &Input, int &offset )
+{
+	float vmin = Input.min();
+	float vmax = Input.max();
+	if ( !( vmax - vmin < 65536.0f ) || vmin != floorf(vmin) )
+		return false;
+	for (size_t i=0; i<Input.length(); i++) {
+		if ( Input(i) != floorf(Input(i)) )
+			return false;
+	}
+	offset = static_cast<int>(vmin);
+	return true;
+}
 void Med3D( const Array<float> &Input, Array<float> &Output )
 {
 	PROFILE_START("Med3D");
-	// Perform a 3D Median filter on Input array with specified width
-	int i,j,k,ii,jj,kk;
-	int imin,jmin,kmin,imax,jmax,kmax;
-
-	float *List;
-	List=new float[27];
-
 	int Nx = int(Input.size(0));
 	int Ny = int(Input.size(1));
 	int Nz = int(Input.size(2));
-
-	for (k=1; k<Nz-1; k++){
-		for (j=1; j<Ny-1; j++){
-			for (i=1; i<Nx-1; i++){
-
-				// Just use a 3x3x3 window (hit recursively if needed)
-				imin = i-1;
-				jmin = j-1;
-				kmin = k-1;
-				imax = i+2;
-				jmax = j+2;
-				kmax = k+2;
-
-				// Populate the list with values in the window
-				int Number=0;
-				for (kk=kmin; kk<kmax; kk++){
-					for (jj=jmin; jj<jmax; jj++){
-						for (ii=imin; ii<imax; ii++){
-							List[Number++] = Input(ii,jj,kk);
+	int offset = 0;
+	bool quantized = isQuantized( Input, offset );
+#ifdef USE_OPENMP
+	#pragma omp parallel
+#endif
+	{
+		// histogram of the 27 values in the window (quantized images), with a coarse
+		// histogram (256 values per bin) so the median can skip the empty ranges
+		std::vector<unsigned char> hist( quantized ? 65536:0, 0 ), coarse( quantized ? 256:0, 0 );
+		float List[27];
+#ifdef USE_OPENMP
+		#pragma omp for schedule(static)
+#endif
+		for (int jk=0; jk<(Ny-2)*(Nz-2); jk++){
+			int j = jk%(Ny-2) + 1;
+			int k = jk/(Ny-2) + 1;
+			if ( !quantized ) {
+				for (int i=1; i<Nx-1; i++){
+					int Number=0;
+					for (int kk=k-1; kk<k+2; kk++){
+						for (int jj=j-1; jj<j+2; jj++){
+							for (int ii=i-1; ii<i+2; ii++)
+								List[Number++] = Input(ii,jj,kk);
 						}
 					}
+					std::nth_element( List, List+13, List+27 );
+					Output(i,j,k) = List[13];
 				}
-				// Sort the first 5 entries and return the median
-				for (ii=0; ii<14; ii++){
-					for (jj=ii+1; jj<27; jj++){
-						if (List[jj] < List[ii]){
-							float tmp = List[ii];
-							List[ii] = List[jj];
-							List[jj] = tmp;
+				continue;
+			}
+			// the window columns (3x3 in y,z) at x=ii
+			auto column = [&]( int ii, int *v ) {
+				int Number=0;
+				for (int kk=k-1; kk<k+2; kk++){
+					for (int jj=j-1; jj<j+2; jj++)
+						v[Number++] = static_cast<int>(Input(ii,jj,kk)) - offset;
+				}
+			};
+			int v[9];
+			int v0[27];
+			for (int ii=0; ii<3; ii++){
+				column( ii, &v0[9*ii] );
+				for (int n=0; n<9; n++) {
+					hist[v0[9*ii+n]]++;
+					coarse[v0[9*ii+n]>>8]++;
+				}
+			}
+			// median m and the number of values below m
+			std::nth_element( v0, v0+13, v0+27 );
+			int m = v0[13];
+			int lt = 0;
+			for (int n=0; n<27; n++)
+				lt += v0[n]<m ? 1:0;
+			for (int i=1; i<Nx-1; i++){
+				if ( i > 1 ) {
+					column( i-2, v );
+					for (int n=0; n<9; n++) {
+						hist[v[n]]--;
+						coarse[v[n]>>8]--;
+						lt -= v[n]<m ? 1:0;
+					}
+					column( i+1, v );
+					for (int n=0; n<9; n++) {
+						hist[v[n]]++;
+						coarse[v[n]>>8]++;
+						lt += v[n]<m ? 1:0;
+					}
+					while ( lt > 13 ) {
+						if ( (m&255)==0 && lt-coarse[(m>>8)-1] > 13 ) {
+							lt -= coarse[(m>>8)-1];
+							m -= 256;
+						} else {
+							m--;
+							lt -= hist[m];
+						}
+					}
+					while ( lt + hist[m] <= 13 ) {
+						if ( (m&255)==0 && lt+coarse[m>>8] <= 13 ) {
+							lt += coarse[m>>8];
+							m += 256;
+						} else {
+							lt += hist[m];
+							m++;
 						}
 					}
 				}
-				// Return the median
-				Output(i,j,k) = List[13];
+				Output(i,j,k) = static_cast<float>( m + offset );
+			}
+			for (int ii=Nx-3; ii<Nx; ii++){
+				column( ii, v );
+				for (int n=0; n<9; n++) {
+					hist[v[n]]--;
+					coarse[v[n]>>8]--;
+				}
 			}
 		}
 	}
@@ -72,6 +148,48 @@ void Med3D( const Array<float> &Input, Array<float> &Output )
 }
 
 
+/********************************************************
+* Box sums along one direction (stride Ns) over the     *
+* window [max(0,n-d),min(N-1,n+d)), from the prefix     *
+* sums of tiles of neighboring lines                    *
+********************************************************/
+static void boxSum( int Ns, int N, int Ne, int d, float *A )
+{
+	const int Nt = std::min( Ns, 64 );
+	const int N_tiles = (Ns+Nt-1)/Nt;
+	const size_t Ns2 = Ns;
+#ifdef USE_OPENMP
+	#pragma omp parallel
+#endif
+	{
+		std::vector<double> P((N+1)*Nt);
+#ifdef USE_OPENMP
+		#pragma omp for schedule(static)
+#endif
+		for (int t=0; t<Ne*N_tiles; t++) {
+			int i0 = (t % N_tiles) * Nt;
+			int Nt2 = std::min( Nt, Ns-i0 );
+			float *A2 = &A[i0+(t/N_tiles)*Ns2*N];
+			for (int i=0; i<Nt2; i++)
+				P[i] = 0;
+			for (int n=0; n<N; n++) {
+				for (int i=0; i<Nt2; i++)
+					P[(n+1)*Nt+i] = P[n*Nt+i] + A2[n*Ns2+i];
+			}
+			for (int n=0; n<N; n++) {
+				int n1 = std::max(0,n-d);
+				int n2 = std::min(N-1,n+d);
+				for (int i=0; i<Nt2; i++)
+					A2[n*Ns2+i] = static_cast<float>( P[n2*Nt+i] - P[n1*Nt+i] );
+			}
+		}
+	}
+}
+
+
+/********************************************************
+* Non-local means                                       *
+********************************************************/
 int NLM3D( const Array<float> &Input, Array<float> &Mean, 
     const Array<float> &Distance, Array<float> &Output, const int d, const float h)
 {
@@ -83,79 +201,88 @@ int NLM3D( const Array<float> &Input, Array<float> &Mean,
 	// 		If Distance(i,j,k) > THRESHOLD_DIST then don't compute NLM
 
 	float THRESHOLD_DIST = float(d);
-	float weight, sum;
-	int i,j,k,ii,jj,kk;
-	int imin,jmin,kmin,imax,jmax,kmax;
 	int returnCount=0;
 
 	int Nx = int(Input.size(0));
 	int Ny = int(Input.size(1));
 	int Nz = int(Input.size(2));
 
-	// Compute the local means
-	for (k=1; k<Nz-1; k++){
-		for (j=1; j<Ny-1; j++){
-			for (i=1; i<Nx-1; i++){
-
-				imin = std::max(0,i-d);
-				jmin = std::max(0,j-d);
-				kmin = std::max(0,k-d);
-				imax = std::min(Nx-1,i+d);
-				jmax = std::min(Ny-1,j+d);
-				kmax = std::min(Nz-1,k+d);
-
-				// Populate the list with values in the window
-				sum = 0; weight=0;
-				for (kk=kmin; kk<kmax; kk++){
-					for (jj=jmin; jj<jmax; jj++){
-						for (ii=imin; ii<imax; ii++){
-							sum += Input(ii,jj,kk);
-							weight++;
-						}
-					}
-				}
-
-				Mean(i,j,k) = sum / weight;
+	// Compute the local means (the sum over the window is separable)
+	Array<float> Sum( Input );
+	boxSum( 1, Nx, Ny*Nz, d, Sum.data() );
+	boxSum( Nx, Ny, Nz, d, Sum.data() );
+	boxSum( Nx*Ny, Nz, 1, d, Sum.data() );
+#ifdef USE_OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int k=1; k<Nz-1; k++){
+		int nk = std::min(Nz-1,k+d) - std::max(0,k-d);
+		for (int j=1; j<Ny-1; j++){
+			int njk = nk * ( std::min(Ny-1,j+d) - std::max(0,j-d) );
+			for (int i=1; i<Nx-1; i++){
+				int weight = njk * ( std::min(Nx-1,i+d) - std::max(0,i-d) );
+				Mean(i,j,k) = Sum(i,j,k) / static_cast<float>(weight);
 			}
 		}
 	}
 
 	// Compute the non-local means
-	for (k=1; k<Nz-1; k++){
-		for (j=1; j<Ny-1; j++){
-			for (i=1; i<Nx-1; i++){
-
-
+	//    each row sums over the rows of the window, and each row of the window over
+	//    the offsets in x, so the terms are added in the same order for each site
+#ifdef USE_OPENMP
+	#pragma omp parallel reduction(+:returnCount)
+#endif
+	{
+		std::vector<int> list(Nx);
+		std::vector<float> sum(Nx), weight(Nx), M(Nx);
+#ifdef USE_OPENMP
+		#pragma omp for schedule(dynamic)
+#endif
+		for (int jk=0; jk<(Ny-2)*(Nz-2); jk++){
+			int j = jk%(Ny-2) + 1;
+			int k = jk/(Ny-2) + 1;
+			// sites to compute the expensive non-local means, just return the mean for the others
+			int N = 0;
+			for (int i=1; i<Nx-1; i++){
 				if (fabs(Distance(i,j,k)) < THRESHOLD_DIST){
-					// compute the expensive non-local means
-					sum = 0; weight=0;
-
-					imin = std::max(0,i-d);
-					jmin = std::max(0,j-d);
-					kmin = std::max(0,k-d);
-					imax = std::min(Nx-1,i+d);
-					jmax = std::min(Ny-1,j+d);
-					kmax = std::min(Nz-1,k+d);
-
-					for (kk=kmin; kk<kmax; kk++){
-						for (jj=jmin; jj<jmax; jj++){
-							for (ii=imin; ii<imax; ii++){
-								float tmp = Mean(i,j,k) - Mean(ii,jj,kk);
-								sum += exp(-tmp*tmp*h)*Input(ii,jj,kk);
-								weight += exp(-tmp*tmp*h);
-							}
+					list[N] = i;
+					M[N] = Mean(i,j,k);
+					sum[N] = 0;
+					weight[N] = 0;
+					N++;
+				} else {
+					Output(i,j,k) = Mean(i,j,k);
+				}
+			}
+			if ( N == 0 )
+				continue;
+			int kmin = std::max(0,k-d);
+			int jmin = std::max(0,j-d);
+			int kmax = std::min(Nz-1,k+d);
+			int jmax = std::min(Ny-1,j+d);
+			for (int kk=kmin; kk<kmax; kk++){
+				for (int jj=jmin; jj<jmax; jj++){
+					const float *Mean2 = &Mean(0,jj,kk);
+					const float *Input2 = &Input(0,jj,kk);
+					for (int n=0; n<N; n++){
+						int i = list[n];
+						int imin = std::max(0,i-d);
+						int imax = std::min(Nx-1,i+d);
+						float sum2 = sum[n], weight2 = weight[n];
+						for (int ii=imin; ii<imax; ii++){
+							float tmp = M[n] - Mean2[ii];
+							float w = exp(-tmp*tmp*h);
+							sum2 += w*Input2[ii];
+							weight2 += w;
 						}
+						sum[n] = sum2;
+						weight[n] = weight2;
 					}
-
-					returnCount++;
-					//Output(i,j,k) = Mean(i,j,k);
-					Output(i,j,k) = sum / weight;
-				}
-				else{
-					// Just return the mean
-					Output(i,j,k) = Mean(i,j,k);
 				}
 			}
+			for (int n=0; n<N; n++)
+				Output(list[n],j,k) = sum[n] / weight[n];
+			returnCount += N;
 		}
 	}
 	// Return the number of sites where NLM was applied
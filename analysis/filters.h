@@ -22,7 +22,8 @@
 
 /*!
  * @brief  Filter image
- * @details  This routine performs a median filter
+ * @details  This routine performs a median filter (3x3x3).  Integer valued images
+ *    (at most 65536 levels) use a sliding histogram, the result is the exact median.
  * @param[in] Input     Input image
  * @param[out] Output   Output image
  */
@@ -31,7 +32,9 @@ void Med3D( const Array<float> &Input, Array<float> &Output );
 
 /*!
  * @brief  Filter image
- * @details  This routine performs a non-linear local means filter
+ * @details  This routine performs a non-linear local means filter.  The local means
+ *    (returned in Mean) use the box sums of the window, the non-local means are only
+ *    computed where |Distance| < d, elsewhere the local mean is returned.
  * @param[in] Input     Input image
  * @param[in] Mean      Mean value
  * @param[out] Output   Output image
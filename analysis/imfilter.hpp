@@ -32,6 +32,8 @@
 #include "ProfilerApp.h"
 #include <math.h>
 #include <string.h>
+#include <algorithm>
+#include <vector>
 
 
 #define IMFILTER_INSIST INSIST
@@ -59,7 +61,7 @@ static inline int imfilter_index( int index, const int N, const imfilter::BC bc
 
 // Function to copy a 1D array and pad with the appropriate BC
 template<class TYPE>
-static inline void copy_array( const int N, const int Ns, const int Nh,
+static inline void copy_array( const int N, const size_t Ns, const int Nh,
     const TYPE *A, const imfilter::BC BC, const TYPE X, TYPE *B )
 {
     // Fill the center with a memcpy
@@ -77,7 +79,95 @@ static inline void copy_array( const int N, const int Ns, const int Nh,
 
 /********************************************************
 * Perform a 1D filter in a single direction             *
+* The lines are filtered in tiles of neighboring lines  *
+* (contiguous in memory), so the inner loops run along  *
+* the contiguous axis.  Each output is summed in the    *
+* order of the filter, the result does not depend on    *
+* the tiling or the number of threads.                  *
 ********************************************************/
+static const int imfilter_tile = 64;
+// Copy a tile of Nt lines (each of size N with stride Ns) and pad with the appropriate BC
+template<class TYPE>
+static inline void copy_tile( const int N, const size_t Ns, const int Nt, const int Nh,
+    const TYPE *A, const imfilter::BC BC, const TYPE X, TYPE *B )
+{
+    for (int k=0; k<N; k++)
+        memcpy( &B[(k+Nh)*Nt], &A[k*Ns], Nt*sizeof(TYPE) );
+    for (int k=0; k<Nh; k++) {
+        int j1 = imfilter_index( -(k+1), N, BC );
+        int j2 = imfilter_index(   N+k, N, BC );
+        TYPE *B1 = &B[(Nh-k-1)*Nt];
+        TYPE *B2 = &B[(N+Nh+k)*Nt];
+        for (int i=0; i<Nt; i++) {
+            B1[i] = j1==-1 ? X : B[(Nh+j1)*Nt+i];
+            B2[i] = j2==-1 ? X : B[(Nh+j2)*Nt+i];
+        }
+    }
+}
+// Filter a tile of Nt lines (NH>0 fixes the filter size at compile time)
+template<class TYPE, int NH>
+static inline void filter_tile( const int N, const size_t Ns, const int Nt, const int Nh0,
+    const TYPE *H, const TYPE *B, TYPE *tmp, TYPE *A )
+{
+    const int Nh = NH>0 ? NH : Nh0;
+    for (int k=0; k<N; k++) {
+        for (int i=0; i<Nt; i++)
+            tmp[i] = 0;
+        for (int m=0; m<=2*Nh; m++) {
+            const TYPE h = H[m];
+            const TYPE *B2 = &B[(k+m)*Nt];
+            for (int i=0; i<Nt; i++)
+                tmp[i] += h * B2[i];
+        }
+        memcpy( &A[k*Ns], tmp, Nt*sizeof(TYPE) );
+    }
+}
+// Filter a line along the contiguous direction
+template<class TYPE, int NH>
+static inline void filter_line( const int N, const int Nh0, const TYPE *H, const TYPE *B, TYPE *A )
+{
+    const int Nh = NH>0 ? NH : Nh0;
+    for (int k=0; k<N; k++)
+        A[k] = 0;
+    for (int m=0; m<=2*Nh; m++) {
+        const TYPE h = H[m];
+        const TYPE *B2 = &B[m];
+        for (int k=0; k<N; k++)
+            A[k] += h * B2[k];
+    }
+}
+template<class TYPE, int NH>
+static void filter_direction_tiled( int Ns, int N, int Ne, int Nh, const TYPE *H,
+    imfilter::BC boundary, TYPE X, TYPE *A )
+{
+    const int Nt = std::min( Ns, imfilter_tile );
+    const int N_tiles = (Ns+Nt-1)/Nt;
+    const size_t Ns2 = Ns;
+#ifdef USE_OPENMP
+    #pragma omp parallel
+#endif
+    {
+        std::vector<TYPE> B((N+2*Nh)*Nt), tmp(std::max(N,Nt));
+#ifdef USE_OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int t=0; t<Ne*N_tiles; t++) {
+            int j = t / N_tiles;
+            int i = (t % N_tiles) * Nt;
+            int Nt2 = std::min( Nt, Ns-i );
+            TYPE *A2 = &A[i+j*Ns2*N];
+            if ( Nt2 == 1 ) {
+                copy_array( N, Ns2, Nh, A2, boundary, X, B.data() );
+                filter_line<TYPE,NH>( N, Nh, H, B.data(), tmp.data() );
+                for (int k=0; k<N; k++)
+                    A2[k*Ns2] = tmp[k];
+            } else {
+                copy_tile( N, Ns2, Nt2, Nh, A2, boundary, X, B.data() );
+                filter_tile<TYPE,NH>( N, Ns2, Nt2, Nh, H, B.data(), tmp.data(), A2 );
+            }
+        }
+    }
+}
 template<class TYPE>
 static void filter_direction( int Ns, int N, int Ne, int Nh, const TYPE *H,
     imfilter::BC boundary, TYPE X, TYPE *A )
@@ -85,23 +175,20 @@ static void filter_direction( int Ns, int N, int Ne, int Nh, const TYPE *H,
     if ( Nh < 0 )
         IMFILTER_ERROR("Invalid filter size");
     if ( Nh == 0 ) {
-        for (int i=0; i<Ns*N*Ne; i++)
+        size_t N2 = (size_t) Ns*N*Ne;
+        for (size_t i=0; i<N2; i++)
             A[i] *= H[0];
         return;
     }
-    TYPE *tmp = new TYPE[N+2*Nh];
-    for (int j=0; j<Ne; j++) {
-        for (int i=0; i<Ns; i++) {
-            copy_array( N, Ns, Nh, &A[i+j*Ns*N], boundary, X, tmp );
-            for (int k=0; k<N; k++) {
-                TYPE tmp2 = 0;
-                for (int m=0; m<=2*Nh; m++)
-                    tmp2 += H[m] * tmp[k+m];
-                A[i+k*Ns+j*Ns*N] = tmp2;
-            }
-        }
-    }
-    delete[] tmp;
+    // Use a fixed filter size for the common small filters (gaussian, average)
+    if ( Nh == 1 )
+        filter_direction_tiled<TYPE,1>( Ns, N, Ne, Nh, H, boundary, X, A );
+    else if ( Nh == 2 )
+        filter_direction_tiled<TYPE,2>( Ns, N, Ne, Nh, H, boundary, X, A );
+    else if ( Nh == 3 )
+        filter_direction_tiled<TYPE,3>( Ns, N, Ne, Nh, H, boundary, X, A );
+    else
+        filter_direction_tiled<TYPE,0>( Ns, N, Ne, Nh, H, boundary, X, A );
 }
 template<class TYPE>
 static void filter_direction( int Ns, int N, int Ne, int Nh,
@@ -109,19 +196,26 @@ static void filter_direction( int Ns, int N, int Ne, int Nh,
 {
     if ( Nh < 0 )
         IMFILTER_ERROR("Invalid filter size");
-    TYPE *tmp = new TYPE[N+2*Nh];
-    Array<TYPE> tmp2(2*Nh+1);
-    for (int j=0; j<Ne; j++) {
-        for (int i=0; i<Ns; i++) {
-            copy_array( N, Ns, Nh, &A[i+j*Ns*N], boundary, X, tmp );
+    const size_t Ns2 = Ns;
+#ifdef USE_OPENMP
+    #pragma omp parallel
+#endif
+    {
+        std::vector<TYPE> tmp(N+2*Nh);
+        Array<TYPE> tmp2(2*Nh+1);
+#ifdef USE_OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int ij=0; ij<Ns*Ne; ij++) {
+            TYPE *A2 = &A[ij%Ns+(ij/Ns)*Ns2*N];
+            copy_array( N, Ns, Nh, A2, boundary, X, tmp.data() );
             for (int k=0; k<N; k++) {
                 for (int m=0; m<=2*Nh; m++)
                     tmp2(m) = tmp[k+m];
-                A[i+k*Ns+j*Ns*N] = H(tmp2);
+                A2[k*Ns2] = H(tmp2);
             }
         }
     }
-    delete[] tmp;
 }
 template<class TYPE>
 static void filter_direction( int Ns, int N, int Ne, int Nh,
@@ -129,16 +223,23 @@ static void filter_direction( int Ns, int N, int Ne, int Nh,
 {
     if ( Nh < 0 )
         IMFILTER_ERROR("Invalid filter size");
-    TYPE *tmp = new TYPE[N+2*Nh];
+    const size_t Ns2 = Ns;
     int Nh2 = 2*Nh+1;
-    for (int j=0; j<Ne; j++) {
-        for (int i=0; i<Ns; i++) {
-            copy_array( N, Ns, Nh, &A[i+j*Ns*N], boundary, X, tmp );
+#ifdef USE_OPENMP
+    #pragma omp parallel
+#endif
+    {
+        std::vector<TYPE> tmp(N+2*Nh);
+#ifdef USE_OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int ij=0; ij<Ns*Ne; ij++) {
+            TYPE *A2 = &A[ij%Ns+(ij/Ns)*Ns2*N];
+            copy_array( N, Ns, Nh, A2, boundary, X, tmp.data() );
             for (int k=0; k<N; k++)
-                A[i+k*Ns+j*Ns*N] = H(Nh2,&tmp[k]);
+                A2[k*Ns2] = H(Nh2,&tmp[k]);
         }
     }
-    delete[] tmp;
 }
 
 
@@ -233,6 +334,9 @@ void imfilter_3D( int Nx, int Ny, int Nz, const TYPE *A, int Nhx, int Nhy, int N
     IMFILTER_ASSERT( A != B );
     PROFILE_START( "imfilter_3D" );
     memset( B, 0, Nx * Ny * Nz * sizeof( TYPE ) );
+#ifdef USE_OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
     for ( int k1 = 0; k1 < Nz; k1++ ) {
         for ( int j1 = 0; j1 < Ny; j1++ ) {
             for ( int i1 = 0; i1 < Nx; i1++ ) {
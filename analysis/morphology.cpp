@@ -1,4 +1,6 @@
 #include <analysis/morphology.h>
+#include <algorithm>
+#include <map>
 // Implementation of morphological opening routine
 
 inline void PackID(int *list, int count, signed char *sendbuf, signed char *ID){
@@ -25,52 +27,14 @@ inline void UnpackID(int *list, int count, signed char *recvbuf, signed char *ID
 }
 
 //***************************************************************************************
-double MorphOpen(DoubleArray &SignDist, signed char *id, std::shared_ptr<Domain> Dm, double VoidFraction, signed char ErodeLabel, signed char NewLabel){
-	// SignDist is the distance to the object that you want to constaing the morphological opening
-	// VoidFraction is the the empty space where the object inst
-	// id is a labeled map
-	// Dm contains information about the domain structure
-	
+double MorphOpenStep(DoubleArray &SignDist, signed char *id, std::shared_ptr<Domain> Dm, double Rcrit, signed char ErodeLabel, signed char NewLabel){
+	// One step of MorphOpen: the voxels labeled ErodeLabel within Rcrit of a voxel with
+	// SignDist > Rcrit are set to NewLabel, then the halo of id is updated
+	// Returns the number of voxels set on this rank
 	int nx = Dm->Nx;
 	int ny = Dm->Ny;
 	int nz = Dm->Nz;
-	int iproc = Dm->iproc();
-	int jproc = Dm->jproc();
-	int kproc = Dm->kproc();
-	int nprocx = Dm->nprocx();
-	int nprocy = Dm->nprocy();
-	int nprocz = Dm->nprocz();
-	int rank = Dm->rank();
-
 	int n;
-	double final_void_fraction;
-	double count,countGlobal,totalGlobal;
-	count = 0.f;
-	double maxdist=-200.f;
-	double maxdistGlobal;
-	for (int k=1; k<nz-1; k++){
-		for (int j=1; j<ny-1; j++){
-			for (int i=1; i<nx-1; i++){
-				n = k*nx*ny+j*nx+i;
-				// extract maximum distance for critical radius
-				if ( SignDist(i,j,k) > maxdist) maxdist=SignDist(i,j,k);
-				if ( id[n] == ErodeLabel){
-					count += 1.0;
-					//id[n]  = 2;
-				}
-			}
-		}
-	}
-	MPI_Barrier(Dm->Comm);
-	
-	// total Global is the number of nodes in the pore-space
-	MPI_Allreduce(&count,&totalGlobal,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
-	MPI_Allreduce(&maxdist,&maxdistGlobal,1,MPI_DOUBLE,MPI_MAX,Dm->Comm);
-	double volume=double(nprocx*nprocy*nprocz)*double(nx-2)*double(ny-2)*double(nz-2);
-	double volume_fraction=totalGlobal/volume;
-	if (rank==0) printf("Volume fraction for morphological opening: %f \n",volume_fraction);
-	if (rank==0) printf("Maximum pore size: %f \n",maxdistGlobal);
-	final_void_fraction = volume_fraction; //initialize
 
 	// Communication buffers
 	signed char *sendID_x, *sendID_y, *sendID_z, *sendID_X, *sendID_Y, *sendID_Z;
@@ -122,11 +86,214 @@ double MorphOpen(DoubleArray &SignDist, signed char *id, std::shared_ptr<Domain>
 	int sendtag,recvtag;
 	sendtag = recvtag = 7;
 
-	int x,y,z;
 	int ii,jj,kk;
 	int Nx = nx;
 	int Ny = ny;
 	int Nz = nz;
+	int imin,jmin,kmin,imax,jmax,kmax;
+
+	int Window=round(Rcrit);
+	if (Window == 0) Window = 1; // If Window = 0 at the begining, after the following process will have sw=1.0
+	// and sw<Sw will be immediately broken
+	double LocalNumber=0.f;
+	for(int k=0; k<Nz; k++){
+		for(int j=0; j<Ny; j++){
+			for(int i=0; i<Nx; i++){
+				n = k*nx*ny + j*nx+i;
+				if (SignDist(i,j,k) > Rcrit){
+					// loop over the window and update
+					imin=max(1,i-Window);
+					jmin=max(1,j-Window);
+					kmin=max(1,k-Window);
+					imax=min(Nx-1,i+Window);
+					jmax=min(Ny-1,j+Window);
+					kmax=min(Nz-1,k+Window);
+					for (kk=kmin; kk<kmax; kk++){
+						for (jj=jmin; jj<jmax; jj++){
+							for (ii=imin; ii<imax; ii++){
+								int nn = kk*nx*ny+jj*nx+ii;
+								double dsq = double((ii-i)*(ii-i)+(jj-j)*(jj-j)+(kk-k)*(kk-k));
+								if (id[nn] == ErodeLabel && dsq <= Rcrit*Rcrit){
+									LocalNumber+=1.0;
+									id[nn]=NewLabel;
+								}
+							}
+						}
+					}
+
+				}
+				// move on
+			}
+		}
+	}
+	// Pack and send the updated ID values
+	PackID(Dm->sendList_x, Dm->sendCount_x ,sendID_x, id);
+	PackID(Dm->sendList_X, Dm->sendCount_X ,sendID_X, id);
+	PackID(Dm->sendList_y, Dm->sendCount_y ,sendID_y, id);
+	PackID(Dm->sendList_Y, Dm->sendCount_Y ,sendID_Y, id);
+	PackID(Dm->sendList_z, Dm->sendCount_z ,sendID_z, id);
+	PackID(Dm->sendList_Z, Dm->sendCount_Z ,sendID_Z, id);
+	PackID(Dm->sendList_xy, Dm->sendCount_xy ,sendID_xy, id);
+	PackID(Dm->sendList_Xy, Dm->sendCount_Xy ,sendID_Xy, id);
+	PackID(Dm->sendList_xY, Dm->sendCount_xY ,sendID_xY, id);
+	PackID(Dm->sendList_XY, Dm->sendCount_XY ,sendID_XY, id);
+	PackID(Dm->sendList_xz, Dm->sendCount_xz ,sendID_xz, id);
+	PackID(Dm->sendList_Xz, Dm->sendCount_Xz ,sendID_Xz, id);
+	PackID(Dm->sendList_xZ, Dm->sendCount_xZ ,sendID_xZ, id);
+	PackID(Dm->sendList_XZ, Dm->sendCount_XZ ,sendID_XZ, id);
+	PackID(Dm->sendList_yz, Dm->sendCount_yz ,sendID_yz, id);
+	PackID(Dm->sendList_Yz, Dm->sendCount_Yz ,sendID_Yz, id);
+	PackID(Dm->sendList_yZ, Dm->sendCount_yZ ,sendID_yZ, id);
+	PackID(Dm->sendList_YZ, Dm->sendCount_YZ ,sendID_YZ, id);
+	//......................................................................................
+	MPI_Sendrecv(sendID_x,Dm->sendCount_x,MPI_CHAR,Dm->rank_x(),sendtag,
+			recvID_X,Dm->recvCount_X,MPI_CHAR,Dm->rank_X(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_X,Dm->sendCount_X,MPI_CHAR,Dm->rank_X(),sendtag,
+			recvID_x,Dm->recvCount_x,MPI_CHAR,Dm->rank_x(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_y,Dm->sendCount_y,MPI_CHAR,Dm->rank_y(),sendtag,
+			recvID_Y,Dm->recvCount_Y,MPI_CHAR,Dm->rank_Y(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_Y,Dm->sendCount_Y,MPI_CHAR,Dm->rank_Y(),sendtag,
+			recvID_y,Dm->recvCount_y,MPI_CHAR,Dm->rank_y(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_z,Dm->sendCount_z,MPI_CHAR,Dm->rank_z(),sendtag,
+			recvID_Z,Dm->recvCount_Z,MPI_CHAR,Dm->rank_Z(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_Z,Dm->sendCount_Z,MPI_CHAR,Dm->rank_Z(),sendtag,
+			recvID_z,Dm->recvCount_z,MPI_CHAR,Dm->rank_z(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_xy,Dm->sendCount_xy,MPI_CHAR,Dm->rank_xy(),sendtag,
+			recvID_XY,Dm->recvCount_XY,MPI_CHAR,Dm->rank_XY(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_XY,Dm->sendCount_XY,MPI_CHAR,Dm->rank_XY(),sendtag,
+			recvID_xy,Dm->recvCount_xy,MPI_CHAR,Dm->rank_xy(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_Xy,Dm->sendCount_Xy,MPI_CHAR,Dm->rank_Xy(),sendtag,
+			recvID_xY,Dm->recvCount_xY,MPI_CHAR,Dm->rank_xY(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_xY,Dm->sendCount_xY,MPI_CHAR,Dm->rank_xY(),sendtag,
+			recvID_Xy,Dm->recvCount_Xy,MPI_CHAR,Dm->rank_Xy(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_xz,Dm->sendCount_xz,MPI_CHAR,Dm->rank_xz(),sendtag,
+			recvID_XZ,Dm->recvCount_XZ,MPI_CHAR,Dm->rank_XZ(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_XZ,Dm->sendCount_XZ,MPI_CHAR,Dm->rank_XZ(),sendtag,
+			recvID_xz,Dm->recvCount_xz,MPI_CHAR,Dm->rank_xz(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_Xz,Dm->sendCount_Xz,MPI_CHAR,Dm->rank_Xz(),sendtag,
+			recvID_xZ,Dm->recvCount_xZ,MPI_CHAR,Dm->rank_xZ(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_xZ,Dm->sendCount_xZ,MPI_CHAR,Dm->rank_xZ(),sendtag,
+			recvID_Xz,Dm->recvCount_Xz,MPI_CHAR,Dm->rank_Xz(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_yz,Dm->sendCount_yz,MPI_CHAR,Dm->rank_yz(),sendtag,
+			recvID_YZ,Dm->recvCount_YZ,MPI_CHAR,Dm->rank_YZ(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_YZ,Dm->sendCount_YZ,MPI_CHAR,Dm->rank_YZ(),sendtag,
+			recvID_yz,Dm->recvCount_yz,MPI_CHAR,Dm->rank_yz(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_Yz,Dm->sendCount_Yz,MPI_CHAR,Dm->rank_Yz(),sendtag,
+			recvID_yZ,Dm->recvCount_yZ,MPI_CHAR,Dm->rank_yZ(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	MPI_Sendrecv(sendID_yZ,Dm->sendCount_yZ,MPI_CHAR,Dm->rank_yZ(),sendtag,
+			recvID_Yz,Dm->recvCount_Yz,MPI_CHAR,Dm->rank_Yz(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
+	//......................................................................................
+	UnpackID(Dm->recvList_x, Dm->recvCount_x ,recvID_x, id);
+	UnpackID(Dm->recvList_X, Dm->recvCount_X ,recvID_X, id);
+	UnpackID(Dm->recvList_y, Dm->recvCount_y ,recvID_y, id);
+	UnpackID(Dm->recvList_Y, Dm->recvCount_Y ,recvID_Y, id);
+	UnpackID(Dm->recvList_z, Dm->recvCount_z ,recvID_z, id);
+	UnpackID(Dm->recvList_Z, Dm->recvCount_Z ,recvID_Z, id);
+	UnpackID(Dm->recvList_xy, Dm->recvCount_xy ,recvID_xy, id);
+	UnpackID(Dm->recvList_Xy, Dm->recvCount_Xy ,recvID_Xy, id);
+	UnpackID(Dm->recvList_xY, Dm->recvCount_xY ,recvID_xY, id);
+	UnpackID(Dm->recvList_XY, Dm->recvCount_XY ,recvID_XY, id);
+	UnpackID(Dm->recvList_xz, Dm->recvCount_xz ,recvID_xz, id);
+	UnpackID(Dm->recvList_Xz, Dm->recvCount_Xz ,recvID_Xz, id);
+	UnpackID(Dm->recvList_xZ, Dm->recvCount_xZ ,recvID_xZ, id);
+	UnpackID(Dm->recvList_XZ, Dm->recvCount_XZ ,recvID_XZ, id);
+	UnpackID(Dm->recvList_yz, Dm->recvCount_yz ,recvID_yz, id);
+	UnpackID(Dm->recvList_Yz, Dm->recvCount_Yz ,recvID_Yz, id);
+	UnpackID(Dm->recvList_yZ, Dm->recvCount_yZ ,recvID_yZ, id);
+	UnpackID(Dm->recvList_YZ, Dm->recvCount_YZ ,recvID_YZ, id);
+	//......................................................................................
+
+
+	delete [] sendID_x;
+	delete [] sendID_y;
+	delete [] sendID_z;
+	delete [] sendID_X;
+	delete [] sendID_Y;
+	delete [] sendID_Z;
+	delete [] sendID_xy;
+	delete [] sendID_yz;
+	delete [] sendID_xz;
+	delete [] sendID_Xy;
+	delete [] sendID_Yz;
+	delete [] sendID_xZ;
+	delete [] sendID_xY;
+	delete [] sendID_yZ;
+	delete [] sendID_Xz;
+	delete [] sendID_XY;
+	delete [] sendID_YZ;
+	delete [] sendID_XZ;
+	delete [] recvID_x;
+	delete [] recvID_y;
+	delete [] recvID_z;
+	delete [] recvID_X;
+	delete [] recvID_Y;
+	delete [] recvID_Z;
+	delete [] recvID_xy;
+	delete [] recvID_yz;
+	delete [] recvID_xz;
+	delete [] recvID_Xy;
+	delete [] recvID_xZ;
+	delete [] recvID_xY;
+	delete [] recvID_yZ;
+	delete [] recvID_Yz;
+	delete [] recvID_Xz;
+	delete [] recvID_XY;
+	delete [] recvID_YZ;
+	delete [] recvID_XZ;
+	return LocalNumber;
+}
+
+double MorphOpen(DoubleArray &SignDist, signed char *id, std::shared_ptr<Domain> Dm, double VoidFraction, signed char ErodeLabel, signed char NewLabel){
+	// SignDist is the distance to the object that you want to constaing the morphological opening
+	// VoidFraction is the the empty space where the object inst
+	// id is a labeled map
+	// Dm contains information about the domain structure
+	
+	int nx = Dm->Nx;
+	int ny = Dm->Ny;
+	int nz = Dm->Nz;
+	int iproc = Dm->iproc();
+	int jproc = Dm->jproc();
+	int kproc = Dm->kproc();
+	int nprocx = Dm->nprocx();
+	int nprocy = Dm->nprocy();
+	int nprocz = Dm->nprocz();
+	int rank = Dm->rank();
+
+	int n;
+	double final_void_fraction;
+	double count,countGlobal,totalGlobal;
+	count = 0.f;
+	double maxdist=-200.f;
+	double maxdistGlobal;
+	for (int k=1; k<nz-1; k++){
+		for (int j=1; j<ny-1; j++){
+			for (int i=1; i<nx-1; i++){
+				n = k*nx*ny+j*nx+i;
+				// extract maximum distance for critical radius
+				if ( SignDist(i,j,k) > maxdist) maxdist=SignDist(i,j,k);
+				if ( id[n] == ErodeLabel){
+					count += 1.0;
+					//id[n]  = 2;
+				}
+			}
+		}
+	}
+	MPI_Barrier(Dm->Comm);
+	
+	// total Global is the number of nodes in the pore-space
+	MPI_Allreduce(&count,&totalGlobal,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
+	MPI_Allreduce(&maxdist,&maxdistGlobal,1,MPI_DOUBLE,MPI_MAX,Dm->Comm);
+	double volume=double(nprocx*nprocy*nprocz)*double(nx-2)*double(ny-2)*double(nz-2);
+	double volume_fraction=totalGlobal/volume;
+	if (rank==0) printf("Volume fraction for morphological opening: %f \n",volume_fraction);
+	if (rank==0) printf("Maximum pore size: %f \n",maxdistGlobal);
+	final_void_fraction = volume_fraction; //initialize
+
+	int x,y,z;
+	int Nx = nx;
+	int Ny = ny;
+	int Nz = nz;
 
 	double void_fraction_old=1.0;
 	double void_fraction_new=1.0; 
@@ -138,7 +305,6 @@ double MorphOpen(DoubleArray &SignDist, signed char *id, std::shared_ptr<Domain>
 	double Rcrit_old;
 
 	double GlobalNumber = 1.f;
-	int imin,jmin,kmin,imax,jmax,kmax;
 
 	if (ErodeLabel == 1){
 		VoidFraction = 1.0 - VoidFraction;
@@ -152,117 +318,7 @@ double MorphOpen(DoubleArray &SignDist, signed char *id, std::shared_ptr<Domain>
 		void_fraction_old = void_fraction_new;
 		Rcrit_old = Rcrit_new;
 		Rcrit_new -= deltaR*Rcrit_old;
-		int Window=round(Rcrit_new);
-		if (Window == 0) Window = 1; // If Window = 0 at the begining, after the following process will have sw=1.0
-		// and sw<Sw will be immediately broken
-		double LocalNumber=0.f;
-		for(int k=0; k<Nz; k++){
-			for(int j=0; j<Ny; j++){
-				for(int i=0; i<Nx; i++){
-					n = k*nx*ny + j*nx+i;
-					if (SignDist(i,j,k) > Rcrit_new){
-						// loop over the window and update
-						imin=max(1,i-Window);
-						jmin=max(1,j-Window);
-						kmin=max(1,k-Window);
-						imax=min(Nx-1,i+Window);
-						jmax=min(Ny-1,j+Window);
-						kmax=min(Nz-1,k+Window);
-						for (kk=kmin; kk<kmax; kk++){
-							for (jj=jmin; jj<jmax; jj++){
-								for (ii=imin; ii<imax; ii++){
-									int nn = kk*nx*ny+jj*nx+ii;
-									double dsq = double((ii-i)*(ii-i)+(jj-j)*(jj-j)+(kk-k)*(kk-k));
-									if (id[nn] == ErodeLabel && dsq <= Rcrit_new*Rcrit_new){
-										LocalNumber+=1.0;
-										id[nn]=NewLabel;
-									}
-								}
-							}
-						}
-
-					}
-					// move on
-				}
-			}
-		}
-		// Pack and send the updated ID values
-		PackID(Dm->sendList_x, Dm->sendCount_x ,sendID_x, id);
-		PackID(Dm->sendList_X, Dm->sendCount_X ,sendID_X, id);
-		PackID(Dm->sendList_y, Dm->sendCount_y ,sendID_y, id);
-		PackID(Dm->sendList_Y, Dm->sendCount_Y ,sendID_Y, id);
-		PackID(Dm->sendList_z, Dm->sendCount_z ,sendID_z, id);
-		PackID(Dm->sendList_Z, Dm->sendCount_Z ,sendID_Z, id);
-		PackID(Dm->sendList_xy, Dm->sendCount_xy ,sendID_xy, id);
-		PackID(Dm->sendList_Xy, Dm->sendCount_Xy ,sendID_Xy, id);
-		PackID(Dm->sendList_xY, Dm->sendCount_xY ,sendID_xY, id);
-		PackID(Dm->sendList_XY, Dm->sendCount_XY ,sendID_XY, id);
-		PackID(Dm->sendList_xz, Dm->sendCount_xz ,sendID_xz, id);
-		PackID(Dm->sendList_Xz, Dm->sendCount_Xz ,sendID_Xz, id);
-		PackID(Dm->sendList_xZ, Dm->sendCount_xZ ,sendID_xZ, id);
-		PackID(Dm->sendList_XZ, Dm->sendCount_XZ ,sendID_XZ, id);
-		PackID(Dm->sendList_yz, Dm->sendCount_yz ,sendID_yz, id);
-		PackID(Dm->sendList_Yz, Dm->sendCount_Yz ,sendID_Yz, id);
-		PackID(Dm->sendList_yZ, Dm->sendCount_yZ ,sendID_yZ, id);
-		PackID(Dm->sendList_YZ, Dm->sendCount_YZ ,sendID_YZ, id);
-		//......................................................................................
-		MPI_Sendrecv(sendID_x,Dm->sendCount_x,MPI_CHAR,Dm->rank_x(),sendtag,
-				recvID_X,Dm->recvCount_X,MPI_CHAR,Dm->rank_X(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_X,Dm->sendCount_X,MPI_CHAR,Dm->rank_X(),sendtag,
-				recvID_x,Dm->recvCount_x,MPI_CHAR,Dm->rank_x(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_y,Dm->sendCount_y,MPI_CHAR,Dm->rank_y(),sendtag,
-				recvID_Y,Dm->recvCount_Y,MPI_CHAR,Dm->rank_Y(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_Y,Dm->sendCount_Y,MPI_CHAR,Dm->rank_Y(),sendtag,
-				recvID_y,Dm->recvCount_y,MPI_CHAR,Dm->rank_y(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_z,Dm->sendCount_z,MPI_CHAR,Dm->rank_z(),sendtag,
-				recvID_Z,Dm->recvCount_Z,MPI_CHAR,Dm->rank_Z(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_Z,Dm->sendCount_Z,MPI_CHAR,Dm->rank_Z(),sendtag,
-				recvID_z,Dm->recvCount_z,MPI_CHAR,Dm->rank_z(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_xy,Dm->sendCount_xy,MPI_CHAR,Dm->rank_xy(),sendtag,
-				recvID_XY,Dm->recvCount_XY,MPI_CHAR,Dm->rank_XY(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_XY,Dm->sendCount_XY,MPI_CHAR,Dm->rank_XY(),sendtag,
-				recvID_xy,Dm->recvCount_xy,MPI_CHAR,Dm->rank_xy(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_Xy,Dm->sendCount_Xy,MPI_CHAR,Dm->rank_Xy(),sendtag,
-				recvID_xY,Dm->recvCount_xY,MPI_CHAR,Dm->rank_xY(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_xY,Dm->sendCount_xY,MPI_CHAR,Dm->rank_xY(),sendtag,
-				recvID_Xy,Dm->recvCount_Xy,MPI_CHAR,Dm->rank_Xy(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_xz,Dm->sendCount_xz,MPI_CHAR,Dm->rank_xz(),sendtag,
-				recvID_XZ,Dm->recvCount_XZ,MPI_CHAR,Dm->rank_XZ(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_XZ,Dm->sendCount_XZ,MPI_CHAR,Dm->rank_XZ(),sendtag,
-				recvID_xz,Dm->recvCount_xz,MPI_CHAR,Dm->rank_xz(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_Xz,Dm->sendCount_Xz,MPI_CHAR,Dm->rank_Xz(),sendtag,
-				recvID_xZ,Dm->recvCount_xZ,MPI_CHAR,Dm->rank_xZ(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_xZ,Dm->sendCount_xZ,MPI_CHAR,Dm->rank_xZ(),sendtag,
-				recvID_Xz,Dm->recvCount_Xz,MPI_CHAR,Dm->rank_Xz(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_yz,Dm->sendCount_yz,MPI_CHAR,Dm->rank_yz(),sendtag,
-				recvID_YZ,Dm->recvCount_YZ,MPI_CHAR,Dm->rank_YZ(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_YZ,Dm->sendCount_YZ,MPI_CHAR,Dm->rank_YZ(),sendtag,
-				recvID_yz,Dm->recvCount_yz,MPI_CHAR,Dm->rank_yz(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_Yz,Dm->sendCount_Yz,MPI_CHAR,Dm->rank_Yz(),sendtag,
-				recvID_yZ,Dm->recvCount_yZ,MPI_CHAR,Dm->rank_yZ(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		MPI_Sendrecv(sendID_yZ,Dm->sendCount_yZ,MPI_CHAR,Dm->rank_yZ(),sendtag,
-				recvID_Yz,Dm->recvCount_Yz,MPI_CHAR,Dm->rank_Yz(),recvtag,Dm->Comm,MPI_STATUS_IGNORE);
-		//......................................................................................
-		UnpackID(Dm->recvList_x, Dm->recvCount_x ,recvID_x, id);
-		UnpackID(Dm->recvList_X, Dm->recvCount_X ,recvID_X, id);
-		UnpackID(Dm->recvList_y, Dm->recvCount_y ,recvID_y, id);
-		UnpackID(Dm->recvList_Y, Dm->recvCount_Y ,recvID_Y, id);
-		UnpackID(Dm->recvList_z, Dm->recvCount_z ,recvID_z, id);
-		UnpackID(Dm->recvList_Z, Dm->recvCount_Z ,recvID_Z, id);
-		UnpackID(Dm->recvList_xy, Dm->recvCount_xy ,recvID_xy, id);
-		UnpackID(Dm->recvList_Xy, Dm->recvCount_Xy ,recvID_Xy, id);
-		UnpackID(Dm->recvList_xY, Dm->recvCount_xY ,recvID_xY, id);
-		UnpackID(Dm->recvList_XY, Dm->recvCount_XY ,recvID_XY, id);
-		UnpackID(Dm->recvList_xz, Dm->recvCount_xz ,recvID_xz, id);
-		UnpackID(Dm->recvList_Xz, Dm->recvCount_Xz ,recvID_Xz, id);
-		UnpackID(Dm->recvList_xZ, Dm->recvCount_xZ ,recvID_xZ, id);
-		UnpackID(Dm->recvList_XZ, Dm->recvCount_XZ ,recvID_XZ, id);
-		UnpackID(Dm->recvList_yz, Dm->recvCount_yz ,recvID_yz, id);
-		UnpackID(Dm->recvList_Yz, Dm->recvCount_Yz ,recvID_Yz, id);
-		UnpackID(Dm->recvList_yZ, Dm->recvCount_yZ ,recvID_yZ, id);
-		UnpackID(Dm->recvList_YZ, Dm->recvCount_YZ ,recvID_YZ, id);
-		//......................................................................................
-
+		double LocalNumber = MorphOpenStep(SignDist,id,Dm,Rcrit_new,ErodeLabel,NewLabel);
 		MPI_Allreduce(&LocalNumber,&GlobalNumber,1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
 
 		count = 0.f;
@@ -795,3 +851,295 @@ double MorphGrow(DoubleArray &BoundaryDist, DoubleArray &Dist, Array<char> &id,
 	return count;
 }
 
+
+//***************************************************************************************
+// Opening radius of each voxel for the single pass opening / drainage
+//   a voxel belongs to the opening with critical radius R if Radius > R
+
+// Paint a ball (|x-c| < R + offset) into the interior of the local sub-domain
+static void PaintBall(DoubleArray &Radius, const double *center, double offset, int ox, int oy, int oz)
+{
+	int nx = Radius.size(0);
+	int ny = Radius.size(1);
+	int nz = Radius.size(2);
+	double R = center[3];
+	double r = R + offset;
+	// global index of local voxel i is ox+i-1
+	int imin = std::max(1,int(floor(center[0]-r))-ox+1);
+	int jmin = std::max(1,int(floor(center[1]-r))-oy+1);
+	int kmin = std::max(1,int(floor(center[2]-r))-oz+1);
+	int imax = std::min(nx-2,int(ceil(center[0]+r))-ox+1);
+	int jmax = std::min(ny-2,int(ceil(center[1]+r))-oy+1);
+	int kmax = std::min(nz-2,int(ceil(center[2]+r))-oz+1);
+	for (int k=kmin; k<=kmax; k++){
+		double dz = double(oz+k-1) - center[2];
+		for (int j=jmin; j<=jmax; j++){
+			double dy = double(oy+j-1) - center[1];
+			for (int i=imin; i<=imax; i++){
+				double dx = double(ox+i-1) - center[0];
+				if (dx*dx+dy*dy+dz*dz < r*r && Radius(i,j,k) < R)
+					Radius(i,j,k) = R;
+			}
+		}
+	}
+}
+
+void MorphOpenRadius(const DoubleArray &SignDist, DoubleArray &Radius, std::shared_ptr<Domain> Dm, double offset){
+	// Radius(x) is the largest SignDist(c) of the centers c with |x-c| < SignDist(c) + offset
+	//    offset = 0 for MorphOpenThickness, offset = 1 for MorphDrainThickness
+	// Only centers on the distance ridge are painted: c is skipped if the ball of one of its
+	// 26 neighbors contains its own ball, SignDist(c') - |c-c'| >= SignDist(c)
+	// Balls that cross the sub-domain boundary are sent to the ranks that they overlap
+	// (global coordinates, the balls do not wrap across a periodic boundary)
+	int nx = Dm->Nx;
+	int ny = Dm->Ny;
+	int nz = Dm->Nz;
+	int ox = Dm->slab_x[Dm->iproc()];
+	int oy = Dm->slab_y[Dm->jproc()];
+	int oz = Dm->slab_z[Dm->kproc()];
+	int Gx = Dm->slab_x.back();
+	int Gy = Dm->slab_y.back();
+	int Gz = Dm->slab_z.back();
+	int rank = Dm->rank();
+	int nprocs = Dm->nprocx()*Dm->nprocy()*Dm->nprocz();
+
+	Radius.resize(nx,ny,nz);
+	Radius.fill(0.0);
+
+	// (x,y,z,R) of the local centers and of the centers for each remote rank
+	std::vector<double> centers;
+	std::vector<std::vector<double>> sendCenters(nprocs);
+	for (int k=1; k<nz-1; k++){
+		for (int j=1; j<ny-1; j++){
+			for (int i=1; i<nx-1; i++){
+				double R = SignDist(i,j,k);
+				if (R <= 0.0) continue;
+				bool ridge = true;
+				for (int dk=-1; dk<=1 && ridge; dk++){
+					for (int dj=-1; dj<=1 && ridge; dj++){
+						for (int di=-1; di<=1 && ridge; di++){
+							int x = ox+i-1+di;
+							int y = oy+j-1+dj;
+							int z = oz+k-1+dk;
+							if ((di==0 && dj==0 && dk==0) || x<0 || y<0 || z<0 || x>=Gx || y>=Gy || z>=Gz) continue;
+							if (SignDist(i+di,j+dj,k+dk) - sqrt(double(di*di+dj*dj+dk*dk)) >= R) ridge = false;
+						}
+					}
+				}
+				if (!ridge) continue;
+				double c[4] = { double(ox+i-1), double(oy+j-1), double(oz+k-1), R };
+				centers.insert(centers.end(),c,c+4);
+				double r = R + offset;
+				if (c[0]-r >= ox && c[1]-r >= oy && c[2]-r >= oz &&
+						c[0]+r <= ox+nx-3 && c[1]+r <= oy+ny-3 && c[2]+r <= oz+nz-3) continue;
+				// range of sub-domains overlapped by the ball
+				int lo[3], hi[3];
+				const std::vector<int> *slabs[3] = { &Dm->slab_x, &Dm->slab_y, &Dm->slab_z };
+				for (int d=0; d<3; d++){
+					const std::vector<int> &slab = *slabs[d];
+					int xmin = std::max(0,int(floor(c[d]-r)));
+					int xmax = std::min(slab.back()-1,int(ceil(c[d]+r)));
+					lo[d] = std::upper_bound(slab.begin(),slab.end(),xmin) - slab.begin() - 1;
+					hi[d] = std::upper_bound(slab.begin(),slab.end(),xmax) - slab.begin() - 1;
+				}
+				for (int pk=lo[2]; pk<=hi[2]; pk++){
+					for (int pj=lo[1]; pj<=hi[1]; pj++){
+						for (int pi=lo[0]; pi<=hi[0]; pi++){
+							int dest = Dm->rank_info.getRankForBlock(pi,pj,pk);
+							if (dest != rank) sendCenters[dest].insert(sendCenters[dest].end(),c,c+4);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// exchange the balls that cross the sub-domain boundaries
+	std::vector<int> sendCount(nprocs), recvCount(nprocs), sendDisp(nprocs,0), recvDisp(nprocs,0);
+	for (int p=0; p<nprocs; p++) sendCount[p] = sendCenters[p].size();
+	MPI_Alltoall(sendCount.data(),1,MPI_INT,recvCount.data(),1,MPI_INT,Dm->Comm);
+	for (int p=1; p<nprocs; p++){
+		sendDisp[p] = sendDisp[p-1] + sendCount[p-1];
+		recvDisp[p] = recvDisp[p-1] + recvCount[p-1];
+	}
+	std::vector<double> sendbuf(sendDisp[nprocs-1]+sendCount[nprocs-1]);
+	std::vector<double> recvbuf(recvDisp[nprocs-1]+recvCount[nprocs-1]);
+	for (int p=0; p<nprocs; p++)
+		std::copy(sendCenters[p].begin(),sendCenters[p].end(),sendbuf.begin()+sendDisp[p]);
+	MPI_Alltoallv(sendbuf.data(),sendCount.data(),sendDisp.data(),MPI_DOUBLE,
+			recvbuf.data(),recvCount.data(),recvDisp.data(),MPI_DOUBLE,Dm->Comm);
+
+	for (size_t c=0; c<centers.size(); c+=4) PaintBall(Radius,&centers[c],offset,ox,oy,oz);
+	for (size_t c=0; c<recvbuf.size(); c+=4) PaintBall(Radius,&recvbuf[c],offset,ox,oy,oz);
+	Dm->CommunicateMeshHalo(Radius);
+}
+
+// Critical radius R_b = b*dR for the histogram bin that holds the opening radius
+static inline int RadiusBin(double Radius, double dR, int nbins)
+{
+	if (Radius <= 0.0) return 0;
+	return std::min(nbins,int(ceil(Radius/dR)));
+}
+
+double MorphOpenThickness(DoubleArray &SignDist, signed char *id, std::shared_ptr<Domain> Dm, double VoidFraction, signed char ErodeLabel, signed char NewLabel){
+	// Single pass approximation of MorphOpen (see morphology.h): the opening radius is computed
+	// once and the critical radius is found from its histogram instead of repeating the opening
+	int nx = Dm->Nx;
+	int ny = Dm->Ny;
+	int nz = Dm->Nz;
+	int rank = Dm->rank();
+
+	DoubleArray Radius(nx,ny,nz);
+	MorphOpenRadius(SignDist,Radius,Dm,0.0);
+
+	double count = 0.0;
+	double maxdist = -200.0;
+	for (int k=1; k<nz-1; k++){
+		for (int j=1; j<ny-1; j++){
+			for (int i=1; i<nx-1; i++){
+				if (SignDist(i,j,k) > maxdist) maxdist = SignDist(i,j,k);
+				if (id[k*nx*ny+j*nx+i] == ErodeLabel) count += 1.0;
+			}
+		}
+	}
+	double totalGlobal = sumReduce(Dm->Comm,count);
+	double maxdistGlobal = maxReduce(Dm->Comm,maxdist);
+	double volume = double(Dm->slab_x.back())*double(Dm->slab_y.back())*double(Dm->slab_z.back());
+	if (rank==0) printf("Volume fraction for morphological opening: %f \n",totalGlobal/volume);
+	if (rank==0) printf("Maximum pore size: %f \n",maxdistGlobal);
+
+	// number of voxels that are not eroded for each critical radius R_b = b*dR
+	const int nbins = 65536;
+	double dR = std::max(maxdistGlobal,1.0)/nbins;
+	std::vector<double> hist(nbins+1,0.0), remaining(nbins+1,0.0);
+	for (int k=1; k<nz-1; k++)
+		for (int j=1; j<ny-1; j++)
+			for (int i=1; i<nx-1; i++)
+				if (id[k*nx*ny+j*nx+i] == ErodeLabel) hist[RadiusBin(Radius(i,j,k),dR,nbins)] += 1.0;
+	MPI_Allreduce(hist.data(),remaining.data(),nbins+1,MPI_DOUBLE,MPI_SUM,Dm->Comm);
+	for (int b=1; b<=nbins; b++) remaining[b] += remaining[b-1];
+
+	if (ErodeLabel == 1){
+		VoidFraction = 1.0 - VoidFraction;
+	}
+	// the void fraction increases with the critical radius; take the closest to the target
+	double target = VoidFraction*totalGlobal;
+	int b = std::lower_bound(remaining.begin(),remaining.end(),target) - remaining.begin();
+	b = std::min(b,nbins);
+	if (b > 0 && fabs(remaining[b-1]-target) <= fabs(remaining[b]-target)) b--;
+	double Rcrit = b*dR;
+
+	for (int k=0; k<nz; k++)
+		for (int j=0; j<ny; j++)
+			for (int i=0; i<nx; i++){
+				int n = k*nx*ny+j*nx+i;
+				if (id[n] == ErodeLabel && RadiusBin(Radius(i,j,k),dR,nbins) > b) id[n] = NewLabel;
+			}
+	double final_void_fraction = (totalGlobal > 0.0) ? remaining[b]/totalGlobal : 0.0;
+	if (rank==0){
+		printf("Final void fraction =%f\n",final_void_fraction);
+		printf("Final critical radius=%f\n",Rcrit);
+	}
+	return final_void_fraction;
+}
+
+// Drainage for the critical radius b*dR: pore voxels with a larger opening radius that are
+// connected to the main non-wetting component are set to 1, the rest of the pore space to 2
+static double DrainRadius(const DoubleArray &SignDist, const DoubleArray &Radius, signed char *id, std::shared_ptr<Domain> Dm,
+		int b, double dR, int nbins, DoubleArray &phase, IntArray &phase_label, double totalGlobal)
+{
+	int nx = Dm->Nx;
+	int ny = Dm->Ny;
+	int nz = Dm->Nz;
+	for (int k=0; k<nz; k++){
+		for (int j=0; j<ny; j++){
+			for (int i=0; i<nx; i++){
+				int n = k*nx*ny+j*nx+i;
+				if (SignDist(i,j,k) > 0.0) id[n] = (RadiusBin(Radius(i,j,k),dR,nbins) > b) ? 1 : 2;
+				phase(i,j,k) = (id[n] == 1) ? 1.0 : -1.0;
+			}
+		}
+	}
+	// Extract only the connected part of NWP
+	double vF=0.0; double vS=0.0;
+	ComputeGlobalBlobIDs(nx-2,ny-2,nz-2,Dm->rank_info,phase,SignDist,vF,vS,phase_label,Dm->Comm);
+	double count = 0.0;
+	for (int k=0; k<nz; k++){
+		for (int j=0; j<ny; j++){
+			for (int i=0; i<nx; i++){
+				int n = k*nx*ny+j*nx+i;
+				if (id[n] == 1 && phase_label(i,j,k) > 1) id[n] = 2;
+				if (id[n] > 1 && i>0 && j>0 && k>0 && i<nx-1 && j<ny-1 && k<nz-1) count += 1.0;
+			}
+		}
+	}
+	return sumReduce(Dm->Comm,count)/totalGlobal;
+}
+
+double MorphDrainThickness(DoubleArray &SignDist, signed char *id, std::shared_ptr<Domain> Dm, double VoidFraction){
+	// Single pass approximation of MorphDrain (see morphology.h): the opening radius is computed
+	// once and the critical radius is found by bisection (one connected component search per step)
+	int nx = Dm->Nx;
+	int ny = Dm->Ny;
+	int nz = Dm->Nz;
+	int rank = Dm->rank();
+
+	DoubleArray phase(nx,ny,nz);
+	IntArray phase_label(nx,ny,nz);
+	DoubleArray Radius(nx,ny,nz);
+	MorphOpenRadius(SignDist,Radius,Dm,1.0);
+
+	double count = 0.0;
+	double maxdist = -200.0;
+	for (int k=1; k<nz-1; k++){
+		for (int j=1; j<ny-1; j++){
+			for (int i=1; i<nx-1; i++){
+				if (SignDist(i,j,k) > maxdist) maxdist = SignDist(i,j,k);
+				if (SignDist(i,j,k) > 0.0){
+					count += 1.0;
+					id[k*nx*ny+j*nx+i] = 2;
+				}
+			}
+		}
+	}
+	double totalGlobal = sumReduce(Dm->Comm,count);
+	double maxdistGlobal = maxReduce(Dm->Comm,maxdist);
+	double volume = double(Dm->slab_x.back())*double(Dm->slab_y.back())*double(Dm->slab_z.back());
+	if (rank==0) printf("Volume fraction for morphological opening: %f \n",totalGlobal/volume);
+	if (rank==0) printf("Maximum pore size: %f \n",maxdistGlobal);
+
+	// bisection on the critical radius R_b = b*dR (MorphDrain stops at R = 0.5)
+	// the wetting fraction increases with the critical radius
+	const int nbins = 65536;
+	double dR = std::max(maxdistGlobal,1.0)/nbins;
+	std::map<int,double> sw;
+	auto drain = [&]( int b ) {
+		if (sw.find(b) == sw.end()){
+			sw[b] = DrainRadius(SignDist,Radius,id,Dm,b,dR,nbins,phase,phase_label,totalGlobal);
+			if (rank==0) printf("     %f      %f\n",sw[b],b*dR);
+		}
+		return sw[b];
+	};
+	int blo = std::min(nbins,int(ceil(0.5/dR)));
+	int bhi = nbins;
+	while (blo < bhi){
+		int b = (blo + bhi)/2;
+		if (drain(b) < VoidFraction) blo = b + 1;
+		else bhi = b;
+	}
+	int b = blo;
+	if (b > 0 && sw.find(b-1) != sw.end() && fabs(sw[b-1]-VoidFraction) <= fabs(drain(b)-VoidFraction)) b--;
+	// leave id in the state of the selected radius
+	double final_void_fraction = DrainRadius(SignDist,Radius,id,Dm,b,dR,nbins,phase,phase_label,totalGlobal);
+
+	if (rank==0){
+		FILE *DRAIN = fopen("morphdrain.csv","w");
+		fprintf(DRAIN,"sw radius\n");
+		for (auto it=sw.rbegin(); it!=sw.rend(); ++it)
+			fprintf(DRAIN,"%f %f\n",it->second,it->first*dR);
+		fclose(DRAIN);
+		printf("Final void fraction =%f\n",final_void_fraction);
+		printf("Final critical radius=%f\n",b*dR);
+	}
+	return final_void_fraction;
+}
@@ -4,5 +4,18 @@
 #include "analysis/runAnalysis.h"
 
 double MorphOpen(DoubleArray &SignDist, signed char *id, std::shared_ptr<Domain> Dm, double VoidFraction, signed char ErodeLabel, signed char ReplaceLabel);
+// One step of MorphOpen with the critical radius Rcrit (returns the number of voxels set on this rank)
+double MorphOpenStep(DoubleArray &SignDist, signed char *id, std::shared_ptr<Domain> Dm, double Rcrit, signed char ErodeLabel, signed char NewLabel);
 double MorphDrain(DoubleArray &SignDist, signed char *id, std::shared_ptr<Domain> Dm, double VoidFraction);
+
+// Single pass opening / drainage: the opening radius of each voxel is computed once
+// and the critical radius for the target void fraction is found from it
+// This is a different approximation than MorphOpen / MorphDrain: a voxel is opened at the
+// critical radius R if it lies inside the ball of radius SignDist(c) of a center c with
+// SignDist(c) > R, while MorphOpen only paints the balls of radius R around these centers
+// (accumulated over its decreasing radii). The result contains the MorphOpen result at R,
+// except near a periodic boundary (the balls of MorphOpenRadius do not wrap)
+void MorphOpenRadius(const DoubleArray &SignDist, DoubleArray &Radius, std::shared_ptr<Domain> Dm, double offset);
+double MorphOpenThickness(DoubleArray &SignDist, signed char *id, std::shared_ptr<Domain> Dm, double VoidFraction, signed char ErodeLabel, signed char NewLabel);
+double MorphDrainThickness(DoubleArray &SignDist, signed char *id, std::shared_ptr<Domain> Dm, double VoidFraction);
 double MorphGrow(DoubleArray &BoundaryDist, DoubleArray &Dist, Array<char> &id, std::shared_ptr<Domain> Dm, double TargetVol);
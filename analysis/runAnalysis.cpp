@@ -27,6 +27,8 @@
 
 #include "ProfilerApp.h"
 
+#include <algorithm>
+
 
 AnalysisType& operator |=(AnalysisType &lhs, AnalysisType rhs)  
 {
@@ -88,16 +90,40 @@ private:
 };
 
 
+// Helper class to write the shared (single file) restart from a seperate thread
+class WriteSharedRestartWorkItem: public ThreadPool::WorkItemRet<void>
+{
+public:
+    WriteSharedRestartWorkItem( const char* filename_, std::shared_ptr<Domain> Dm_, const IntArray& Map_,
+        std::shared_ptr<double> cDen_, std::shared_ptr<double> cfq_, int N_, runAnalysis::commWrapper&& comm_ ):
+        filename(filename_), Dm(Dm_), Map(Map_), cfq(cfq_), cDen(cDen_), N(N_), comm(std::move(comm_)) {}
+    virtual void run() {
+        PROFILE_START("Save Checkpoint",1);
+        WriteRestartFile(filename,comm.comm,*Dm,Map,cDen.get(),cfq.get(),N);
+        PROFILE_STOP("Save Checkpoint",1);
+    };
+private:
+    WriteSharedRestartWorkItem();
+    const char* filename;
+    std::shared_ptr<Domain> Dm;
+    const IntArray& Map;
+    std::shared_ptr<double> cfq,cDen;
+    const int N;
+    runAnalysis::commWrapper comm;
+};
+
+
 // Helper class to compute the blob ids
 static const std::string id_map_filename = "lbpm_id_map.txt";
+static const std::string blob_event_filename = "lbpm_blob_events.bin";
 class BlobIdentificationWorkItem1: public ThreadPool::WorkItemRet<void>
 {
 public:
     BlobIdentificationWorkItem1( int timestep_, int Nx_, int Ny_, int Nz_, const RankInfoStruct& rank_info_, 
             std::shared_ptr<const DoubleArray> phase_, const DoubleArray& dist_,
-            BlobIDstruct last_id_, BlobIDstruct new_index_, BlobIDstruct new_id_, BlobIDList new_list_, runAnalysis::commWrapper&& comm_ ):
+            BlobIDstruct new_index_, runAnalysis::commWrapper&& comm_ ):
                 timestep(timestep_), Nx(Nx_), Ny(Ny_), Nz(Nz_), rank_info(rank_info_),
-                phase(phase_), dist(dist_), last_id(last_id_), new_index(new_index_), new_id(new_id_), new_list(new_list_), comm(std::move(comm_))
+                phase(phase_), dist(dist_), new_index(new_index_), comm(std::move(comm_))
 {
 }
     ~BlobIdentificationWorkItem1() { }
@@ -117,52 +143,31 @@ private:
     const RankInfoStruct& rank_info;
     std::shared_ptr<const DoubleArray> phase;
     const DoubleArray& dist;
-    BlobIDstruct last_id, new_index, new_id;
-    BlobIDList new_list;
+    BlobIDstruct new_index;
     runAnalysis::commWrapper comm;
 };
 class BlobIdentificationWorkItem2: public ThreadPool::WorkItemRet<void>
 {
 public:
-    BlobIdentificationWorkItem2( int timestep_, int Nx_, int Ny_, int Nz_, const RankInfoStruct& rank_info_, 
-            std::shared_ptr<const DoubleArray> phase_, const DoubleArray& dist_,
-            BlobIDstruct last_id_, BlobIDstruct new_index_, BlobIDstruct new_id_, BlobIDList new_list_ , runAnalysis::commWrapper&& comm_ ):
-                timestep(timestep_), Nx(Nx_), Ny(Ny_), Nz(Nz_), rank_info(rank_info_),
-                phase(phase_), dist(dist_), last_id(last_id_), new_index(new_index_), new_id(new_id_), new_list(new_list_), comm(std::move(comm_))
+    BlobIdentificationWorkItem2( int timestep_, std::shared_ptr<Domain> Dm_, 
+            std::shared_ptr<BlobTracker> tracker_, BlobIDstruct new_index_, BlobIDList new_list_, runAnalysis::commWrapper&& comm_ ):
+                timestep(timestep_), Dm(Dm_),
+                tracker(tracker_), new_index(new_index_), new_list(new_list_), comm(std::move(comm_))
 {
 }
     ~BlobIdentificationWorkItem2() { }
     virtual void run() {
-        // Compute the global blob id and compare to the previous version
+        // Match the blobs to the last timestep and get the time-consistent ids
         PROFILE_START("Identify blobs maps",1);
-        const IntArray& ids = new_index->second;
-        static int max_id = -1;
-        new_id->first = new_index->first;
-        new_id->second = new_index->second;
-        if ( last_id.get()!=NULL ) {
-            // Compute the timestep-timestep map
-            const IntArray& old_ids = last_id->second;
-            ID_map_struct map = computeIDMap(Nx,Ny,Nz,old_ids,ids,comm.comm);
-            // Renumber the current timestep's ids
-            getNewIDs(map,max_id,*new_list);
-            renumberIDs(*new_list,new_id->second);
-            writeIDMap(map,timestep,id_map_filename);
-        } else {
-            max_id = -1;
-            ID_map_struct map(new_id->first);
-            getNewIDs(map,max_id,*new_list);
-            writeIDMap(map,timestep,id_map_filename);
-        }
+        tracker->update(timestep,*Dm,new_index->second,*new_list,comm.comm);
         PROFILE_STOP("Identify blobs maps",1);
     }
 private:
     BlobIdentificationWorkItem2();
     int timestep;
-    int Nx, Ny, Nz;
-    const RankInfoStruct& rank_info;
-    std::shared_ptr<const DoubleArray> phase;
-    const DoubleArray& dist;
-    BlobIDstruct last_id, new_index, new_id;
+    std::shared_ptr<Domain> Dm;
+    std::shared_ptr<BlobTracker> tracker;
+    BlobIDstruct new_index;
     BlobIDList new_list;
     runAnalysis::commWrapper comm;
 };
@@ -429,8 +434,9 @@ private:
 class BasicWorkItem: public ThreadPool::WorkItemRet<void>
 {
 public:
-	BasicWorkItem( AnalysisType type_, int timestep_, SubPhase& Averages_ ):
-                type(type_), timestep(timestep_), Averages(Averages_){ }
+	BasicWorkItem( AnalysisType type_, int timestep_, SubPhase& Averages_,
+            const std::vector<double>& sums_ = std::vector<double>() ):
+                type(type_), timestep(timestep_), Averages(Averages_), sums(sums_){ }
     ~BasicWorkItem() { }
     virtual void run() {
 
@@ -439,7 +445,10 @@ public:
         }
         if ( matches(type,AnalysisType::ComputeAverages) ) {
             PROFILE_START("Compute basic averages",1);
-            Averages.Basic();
+            if ( sums.empty() )
+                Averages.Basic();
+            else
+                Averages.BasicCompact(sums.data());
             PROFILE_STOP("Compute basic averages",1);
         }
     }
@@ -448,6 +457,7 @@ private:
     AnalysisType type;
     int timestep;
     SubPhase& Averages;
+    std::vector<double> sums;   // sums from the compact arrays (empty: use the regular layout)
     double beta;
 };
 
@@ -472,6 +482,38 @@ private:
     double beta;
 };
 
+// Helper class to convert a snapshot of the simulation state to the regular layout
+class SnapshotWorkItem: public ThreadPool::WorkItemRet<void>
+{
+public:
+    SnapshotWorkItem( const double *data_, int Np_, const IntArray& Map_,
+            const std::vector<int>& slot_, const std::vector<DoubleArray*>& regdata_ ):
+                data(data_), Np(Np_), Map(Map_), slot(slot_), regdata(regdata_) { }
+    ~SnapshotWorkItem() { }
+    virtual void run() {
+        PROFILE_START("Snapshot regular layout",1);
+        size_t N = Map.length();
+        for (size_t f=0; f<regdata.size(); f++){
+            const double *values = &data[slot[f]*Np];
+            DoubleArray& reg = *regdata[f];
+            reg.fill(0);
+            for (size_t n=0; n<N; n++){
+                int idx = Map(n);
+                if (!(idx<0))
+                    reg(n) = values[idx];
+            }
+        }
+        PROFILE_STOP("Snapshot regular layout",1);
+    }
+private:
+    SnapshotWorkItem();
+    const double *data;             // snapshot buffer (owned by runAnalysis)
+    int Np;
+    const IntArray& Map;
+    std::vector<int> slot;          // field in the buffer for each regular array
+    std::vector<DoubleArray*> regdata;
+};
+
 
 
 /******************************************************************
@@ -528,6 +570,7 @@ runAnalysis::runAnalysis(std::shared_ptr<Database> input_db, const RankInfoStruc
             d_regular ( Regular),
             d_rank_info( rank_info ),
             d_Map( Map ),
+            d_Dm( Dm ),
             d_fillData(Dm->Comm,Dm->rank_info,{Dm->Nx-2,Dm->Ny-2,Dm->Nz-2},{1,1,1},0,1),
             d_ScaLBL_Comm( ScaLBL_Comm)
 {
@@ -559,16 +602,52 @@ runAnalysis::runAnalysis(std::shared_ptr<Database> input_db, const RankInfoStruc
 	if (db->keyExists( "visualization_interval" )){
 	    d_visualization_interval = db->getScalar<int>( "visualization_interval" );
 	}
+	// the silo output places each sub-domain at iproc*nx (etc.)
+	if (d_visualization_interval < INT_MAX && !Dm->UniformBlocks())
+	    ERROR("runAnalysis: visualization requires Decomposition = \"uniform\"");
 	if (db->keyExists( "subphase_analysis_interval" )){
 		d_subphase_analysis_interval = db->getScalar<int>( "subphase_analysis_interval" );
 	}
 	
     auto restart_file = db->getScalar<std::string>( "restart_file" );
     d_restartFile = restart_file + "." + rankString;
-    
+    // "shared" writes a single restart file with collective MPI-IO, "rank" one file per rank
+    d_restart_format = db->getWithDefault<std::string>( "restart_format", "rank" );
+    if (d_restart_format == "shared")
+        d_restartFile = restart_file;
+    else if (d_restart_format != "rank")
+        ERROR("runAnalysis: restart_format must be shared or rank");
+    // "regular" copies to the regular layout at every analysis_interval, "compact" computes the basic
+    // averages on the compact arrays and copies only for the subphase analysis and visualization
+    d_basic_analysis = db->getWithDefault<std::string>( "basic_analysis", "regular" );
+    if (d_basic_analysis != "compact" && d_basic_analysis != "regular")
+        ERROR("runAnalysis: basic_analysis must be compact or regular");
+    d_dvcMap = NULL;
+    if (d_basic_analysis == "compact"){
+        // regular index of each site
+        std::vector<int> TmpMap(d_Np,-1);
+        for (int k=1; k<d_N[2]-1; k++){
+            for (int j=1; j<d_N[1]-1; j++){
+                for (int i=1; i<d_N[0]-1; i++){
+                    int idx = d_Map(i,j,k);
+                    if (!(idx < 0))
+                        TmpMap[idx] = k*d_N[0]*d_N[1] + j*d_N[0] + i;
+                }
+            }
+        }
+        ScaLBL_AllocateDeviceMemory((void **) &d_dvcMap, sizeof(int)*d_Np);
+        ScaLBL_CopyToDevice(d_dvcMap, TmpMap.data(), sizeof(int)*d_Np);
+    }
+    // two snapshot buffers, so the next snapshot can be taken while the last one is converted
+    for (int b=0; b<2; b++)
+        ScaLBL_AllocateHostMemory((void **) &d_snapshot[b], sizeof(double)*7*d_Np);
+    d_snapshot_index = 1;
+    d_stall_time = 0.0;
+    d_stall_count = 0;
+
     
     d_rank = MPI_WORLD_RANK();
-    writeIDMap(ID_map_struct(),0,id_map_filename);
+    d_blob_tracker = std::make_shared<BlobTracker>(blob_event_filename,MPI_COMM_WORLD,id_map_filename);
     // Initialize IO for silo
     IO::initialize("","silo","false");
     // Create the MeshDataStruct    
@@ -650,7 +729,14 @@ runAnalysis::~runAnalysis( )
 {
     // Finish processing analysis
     finish();
+    if ( d_rank == 0 && d_stall_count > 0 )
+        printf("Analysis stall: %i steps, %0.4f s per step (%0.4f s total) \n",
+            d_stall_count,d_stall_time/d_stall_count,d_stall_time);
     // Clear internal data
+    if ( d_dvcMap != NULL )
+        ScaLBL_FreeDeviceMemory(d_dvcMap);
+    for (int b=0; b<2; b++)
+        ScaLBL_FreeHostMemory(d_snapshot[b]);
     MPI_Comm_free( &d_comm );
     for (int i=0; i<1024; i++) {
         if ( d_comms[i] != MPI_COMM_NULL )
@@ -668,6 +754,8 @@ void runAnalysis::finish( )
     d_wait_vis.reset();
     d_wait_subphase.reset();
     d_wait_restart.reset();
+    d_wait_snapshot[0].reset();
+    d_wait_snapshot[1].reset();
     // Syncronize
     MPI_Barrier( d_comm );
     PROFILE_STOP("finish");
@@ -774,12 +862,51 @@ AnalysisType runAnalysis::computeAnalysisType( int timestep )
 }
 
 
+/******************************************************************
+ *  Snapshot of the simulation state                               *
+ ******************************************************************/
+ThreadPool::thread_id_t runAnalysis::snapshot( const std::vector<const double*>& src, const std::vector<DoubleArray*>& dst )
+{
+    ASSERT( src.size() == dst.size() );
+    PROFILE_START("Snapshot",1);
+    // wait for the conversion from the buffer before the last one
+    int b = d_snapshot_index ^ 1;
+    if ( !d_wait_snapshot[b].isNull() ) {
+        PROFILE_START("Snapshot-Wait",1);
+        d_tpool.wait(d_wait_snapshot[b]);
+        PROFILE_STOP("Snapshot-Wait",1);
+    }
+    // copy each field once into consecutive slots of the buffer
+    std::vector<const double*> fields;
+    std::vector<int> slot(src.size());
+    for (size_t f=0; f<src.size(); f++){
+        slot[f] = std::find(fields.begin(),fields.end(),src[f]) - fields.begin();
+        if ( slot[f] == (int) fields.size() )
+            fields.push_back(src[f]);
+    }
+    if ( fields.size() > 7 )
+        ERROR("runAnalysis: too many fields for the snapshot buffer");
+    for (size_t f=0; f<fields.size(); f++)
+        ScaLBL_CopyToHost(&d_snapshot[b][f*d_Np],fields[f],d_Np*sizeof(double));
+    // convert in a thread once the analysis is done with the regular arrays
+    auto work = new SnapshotWorkItem(d_snapshot[b],d_Np,d_Map,slot,dst);
+    work->add_dependency(d_wait_snapshot[d_snapshot_index]);
+    work->add_dependency(d_wait_analysis);
+    work->add_dependency(d_wait_subphase);
+    work->add_dependency(d_wait_vis);
+    d_wait_snapshot[b] = d_tpool.add_work(work);
+    d_snapshot_index = b;
+    PROFILE_STOP("Snapshot",1);
+    return d_wait_snapshot[b];
+}
+
+
 
 /******************************************************************
  *  Run the analysis                                               *
  ******************************************************************/
 void runAnalysis::run(int timestep, std::shared_ptr<Database> input_db, TwoPhase& Averages, const double *Phi,
-        double *Pressure, double *Velocity, double *fq, double *Den)
+        double *Pressure, double *Velocity, dist_t *fq, double *Den)
 {
     int N = d_N[0]*d_N[1]*d_N[2];
     
@@ -791,6 +918,9 @@ void runAnalysis::run(int timestep, std::shared_ptr<Database> input_db, TwoPhase
     if ( type == AnalysisType::AnalyzeNone )
         return;
 
+    // Time the simulation waits for the analysis
+    double stall_start = MPI_Wtime();
+
     // Check how may queued items we have
     if ( d_tpool.N_queued() > 20 ) {
         std::cerr << "Analysis queue is getting behind, waiting ...\n";
@@ -834,18 +964,23 @@ void runAnalysis::run(int timestep, std::shared_ptr<Database> input_db, TwoPhase
         delete [] TmpDat;
     }
     */
+    // fields to convert to the regular layout (in a thread, from a snapshot)
+    std::vector<const double*> snapshot_src;
+    std::vector<DoubleArray*> snapshot_dst;
     //if ( matches(type,AnalysisType::CopyPhaseIndicator) ) {
     if ( timestep%d_analysis_interval + 8 == d_analysis_interval ) {
-      if (d_regular)
-        d_ScaLBL_Comm->RegularLayout(d_Map,Phi,Averages.Phase_tplus);
-      else 
+      if (d_regular) {
+        snapshot_src.push_back(Phi);
+        snapshot_dst.push_back(&Averages.Phase_tplus);
+      } else 
     ScaLBL_CopyToHost(Averages.Phase_tplus.data(),Phi,N*sizeof(double));
         //memcpy(Averages.Phase_tplus.data(),phase->data(),N*sizeof(double));
     }
     if ( timestep%d_analysis_interval == 0 ) {
-      if (d_regular)
-        d_ScaLBL_Comm->RegularLayout(d_Map,Phi,Averages.Phase_tminus);
-      else 
+      if (d_regular) {
+        snapshot_src.push_back(Phi);
+        snapshot_dst.push_back(&Averages.Phase_tminus);
+      } else 
     ScaLBL_CopyToHost(Averages.Phase_tminus.data(),Phi,N*sizeof(double));
         //memcpy(Averages.Phase_tminus.data(),phase->data(),N*sizeof(double));
     }
@@ -857,19 +992,16 @@ void runAnalysis::run(int timestep, std::shared_ptr<Database> input_db, TwoPhase
         //ScaLBL_D3Q19_Momentum(fq,Velocity,d_Np);
         ScaLBL_DeviceBarrier();
         PROFILE_STOP("Copy-Pressure",1);
-        PROFILE_START("Copy-Wait",1);
-        PROFILE_STOP("Copy-Wait",1);
         PROFILE_START("Copy-State",1);
         //memcpy(Averages.Phase.data(),phase->data(),N*sizeof(double));
-        if (d_regular)
-            d_ScaLBL_Comm->RegularLayout(d_Map,Phi,Averages.Phase);
-        else
+        if (d_regular) {
+            snapshot_src.push_back(Phi);
+            snapshot_dst.push_back(&Averages.Phase);
+        } else
             ScaLBL_CopyToHost(Averages.Phase.data(),Phi,N*sizeof(double));
         // copy other variables
-        d_ScaLBL_Comm->RegularLayout(d_Map,Pressure,Averages.Press);
-        d_ScaLBL_Comm->RegularLayout(d_Map,&Velocity[0],Averages.Vel_x);
-        d_ScaLBL_Comm->RegularLayout(d_Map,&Velocity[d_Np],Averages.Vel_y);
-        d_ScaLBL_Comm->RegularLayout(d_Map,&Velocity[2*d_Np],Averages.Vel_z);
+        snapshot_src.insert(snapshot_src.end(),{ Pressure, &Velocity[0], &Velocity[d_Np], &Velocity[2*d_Np] });
+        snapshot_dst.insert(snapshot_dst.end(),{ &Averages.Press, &Averages.Vel_x, &Averages.Vel_y, &Averages.Vel_z });
         PROFILE_STOP("Copy-State",1);
     }
     std::shared_ptr<double> cfq,cDen;
@@ -878,31 +1010,36 @@ void runAnalysis::run(int timestep, std::shared_ptr<Database> input_db, TwoPhase
         // Copy restart data to the CPU
         cDen = std::shared_ptr<double>(new double[2*d_Np],DeleteArray<double>);
         cfq = std::shared_ptr<double>(new double[19*d_Np],DeleteArray<double>);
-        ScaLBL_CopyToHost(cfq.get(),fq,19*d_Np*sizeof(double));
+        ScaLBL_CopyDistToHost(cfq.get(),fq,19*d_Np);
         ScaLBL_CopyToHost(cDen.get(),Den,2*d_Np*sizeof(double));
     }
+    if ( matches(type,AnalysisType::IdentifyBlobs) ) {
+        phase = std::shared_ptr<DoubleArray>(new DoubleArray(d_N[0],d_N[1],d_N[2]));
+        if (d_regular) {
+            snapshot_src.push_back(Phi);
+            snapshot_dst.push_back(phase.get());
+        } else
+      ScaLBL_CopyToHost(phase->data(),Phi,N*sizeof(double));
+    }
+    ThreadPool::thread_id_t wait_snapshot;
+    if ( !snapshot_src.empty() )
+        wait_snapshot = snapshot(snapshot_src,snapshot_dst);
     PROFILE_STOP("Copy data to host",1);
 
     // Spawn threads to do blob identification work
     if ( matches(type,AnalysisType::IdentifyBlobs) ) {
-        phase = std::shared_ptr<DoubleArray>(new DoubleArray(d_N[0],d_N[1],d_N[2]));
-        if (d_regular)
-            d_ScaLBL_Comm->RegularLayout(d_Map,Phi,*phase);
-        else
-      ScaLBL_CopyToHost(phase->data(),Phi,N*sizeof(double));
 
         BlobIDstruct new_index(new std::pair<int,IntArray>(0,IntArray()));
-        BlobIDstruct new_ids(new std::pair<int,IntArray>(0,IntArray()));
         BlobIDList new_list(new std::vector<BlobIDType>());
         auto work1 = new BlobIdentificationWorkItem1(timestep,d_N[0],d_N[1],d_N[2],d_rank_info,
-            phase,Averages.SDs,d_last_ids,new_index,new_ids,new_list,getComm());
-        auto work2 = new BlobIdentificationWorkItem2(timestep,d_N[0],d_N[1],d_N[2],d_rank_info,
-            phase,Averages.SDs,d_last_ids,new_index,new_ids,new_list,getComm());
+            phase,Averages.SDs,new_index,getComm());
+        auto work2 = new BlobIdentificationWorkItem2(timestep,d_Dm,
+            d_blob_tracker,new_index,new_list,getComm());
         work1->add_dependency(d_wait_blobID);
+        work1->add_dependency(wait_snapshot);
         work2->add_dependency(d_tpool.add_work(work1));
         d_wait_blobID = d_tpool.add_work(work2);
         d_last_index = new_index;
-        d_last_ids = new_ids;
         d_last_id_map = new_list;
     }
 
@@ -912,6 +1049,7 @@ void runAnalysis::run(int timestep, std::shared_ptr<Database> input_db, TwoPhase
     if ( timestep%d_analysis_interval == 0 ) {
         auto work = new AnalysisWorkItem(type,timestep,Averages,d_last_index,d_last_id_map,d_beta);
         work->add_dependency(d_wait_blobID);
+        work->add_dependency(d_wait_snapshot[d_snapshot_index]);
         work->add_dependency(d_wait_analysis);
         work->add_dependency(d_wait_vis);     // Make sure we are done using analysis before modifying
         d_wait_analysis = d_tpool.add_work(work);
@@ -928,7 +1066,11 @@ void runAnalysis::run(int timestep, std::shared_ptr<Database> input_db, TwoPhase
     		OutStream.close();
     	}
     	// Write the restart file (using a seperate thread)
-        auto work = new WriteRestartWorkItem(d_restartFile.c_str(),cDen,cfq,d_Np);
+        ThreadPool::WorkItem *work;
+        if (d_restart_format == "shared")
+            work = new WriteSharedRestartWorkItem(d_restartFile.c_str(),d_Dm,d_Map,cDen,cfq,d_Np,getComm());
+        else
+            work = new WriteRestartWorkItem(d_restartFile.c_str(),cDen,cfq,d_Np);
         work->add_dependency(d_wait_restart);
         d_wait_restart = d_tpool.add_work(work);
     }
@@ -939,10 +1081,13 @@ void runAnalysis::run(int timestep, std::shared_ptr<Database> input_db, TwoPhase
         // Write the vis files
         auto work = new WriteVisWorkItem( timestep, d_meshData, Averages, d_fillData, getComm() );
         work->add_dependency(d_wait_blobID);
+        work->add_dependency(d_wait_snapshot[d_snapshot_index]);
         work->add_dependency(d_wait_analysis);
         work->add_dependency(d_wait_vis);
         d_wait_vis = d_tpool.add_work(work);
     }
+    d_stall_time += MPI_Wtime() - stall_start;
+    d_stall_count++;
     PROFILE_STOP("run");
 }
 
@@ -950,7 +1095,7 @@ void runAnalysis::run(int timestep, std::shared_ptr<Database> input_db, TwoPhase
 /******************************************************************
  *  Run the analysis                                               *
  ******************************************************************/
-void runAnalysis::basic(int timestep, std::shared_ptr<Database> input_db, SubPhase &Averages, const double *Phi, double *Pressure, double *Velocity, double *fq, double *Den)
+void runAnalysis::basic(int timestep, std::shared_ptr<Database> input_db, SubPhase &Averages, const double *Phi, double *Pressure, double *Velocity, dist_t *fq, double *Den)
 {
     int N = d_N[0]*d_N[1]*d_N[2];
 
@@ -963,6 +1108,9 @@ void runAnalysis::basic(int timestep, std::shared_ptr<Database> input_db, SubPha
     if ( type == AnalysisType::AnalyzeNone )
         return;
 
+    // Time the simulation waits for the analysis
+    double stall_start = MPI_Wtime();
+
     // Check how may queued items we have
     if ( d_tpool.N_queued() > 20 ) {
         std::cerr << "Analysis queue is getting behind, waiting ...\n";
@@ -975,25 +1123,33 @@ void runAnalysis::basic(int timestep, std::shared_ptr<Database> input_db, SubPha
     ScaLBL_DeviceBarrier();
     PROFILE_START("Copy data to host",1);
 
+    // the regular layout is only needed by the subphase analysis and visualization in compact mode
+    bool copy_state = d_basic_analysis == "regular" || timestep%d_subphase_analysis_interval == 0
+        || timestep%d_visualization_interval == 0;
+    std::vector<double> sums;
+
     //if ( matches(type,AnalysisType::CopySimState) ) {
-    if ( timestep%d_analysis_interval == 0 ) {
-        finish(); // can't copy if threads are still working on data
+    if ( timestep%d_analysis_interval == 0 && !copy_state ) {
+        PROFILE_START("Phase-Sums",1);
+        int imin, jmin, kmin, kmax;
+        Averages.AverageRange(imin,jmin,kmin,kmax);
+        sums.resize(15);
+        ScaLBL_D3Q19_PhaseSums(d_dvcMap,fq,Den,Velocity,sums.data(),Averages.rho_n,Averages.rho_w,
+            imin,jmin,kmin,kmax,d_N[0],d_N[0]*d_N[1],0,d_Np,d_Np);
+        PROFILE_STOP("Phase-Sums",1);
+    }
+    else if ( timestep%d_analysis_interval == 0 ) {
+        // the conversion to the regular layout waits for the threads still using the data
         // Copy the members of Averages to the cpu (phase was copied above)
         PROFILE_START("Copy-Pressure",1);
         ScaLBL_D3Q19_Pressure(fq,Pressure,d_Np);
         //ScaLBL_D3Q19_Momentum(fq,Velocity,d_Np);
         ScaLBL_DeviceBarrier();
         PROFILE_STOP("Copy-Pressure",1);
-        PROFILE_START("Copy-Wait",1);
-        PROFILE_STOP("Copy-Wait",1);
         PROFILE_START("Copy-State",1);
         // copy other variables
-        d_ScaLBL_Comm->RegularLayout(d_Map,Pressure,Averages.Pressure);
-        d_ScaLBL_Comm->RegularLayout(d_Map,&Den[0],Averages.Rho_n);
-        d_ScaLBL_Comm->RegularLayout(d_Map,&Den[d_Np],Averages.Rho_w);
-        d_ScaLBL_Comm->RegularLayout(d_Map,&Velocity[0],Averages.Vel_x);
-        d_ScaLBL_Comm->RegularLayout(d_Map,&Velocity[d_Np],Averages.Vel_y);
-        d_ScaLBL_Comm->RegularLayout(d_Map,&Velocity[2*d_Np],Averages.Vel_z);
+        snapshot({ Pressure, &Den[0], &Den[d_Np], &Velocity[0], &Velocity[d_Np], &Velocity[2*d_Np] },
+            { &Averages.Pressure, &Averages.Rho_n, &Averages.Rho_w, &Averages.Vel_x, &Averages.Vel_y, &Averages.Vel_z });
         PROFILE_STOP("Copy-State",1);
     }
     PROFILE_STOP("Copy data to host");
@@ -1003,7 +1159,8 @@ void runAnalysis::basic(int timestep, std::shared_ptr<Database> input_db, SubPha
     //if (timestep%d_restart_interval==0){
     // if ( matches(type,AnalysisType::ComputeAverages) ) {
     if ( timestep%d_analysis_interval == 0 ) {
-        auto work = new BasicWorkItem(type,timestep,Averages);
+        auto work = new BasicWorkItem(type,timestep,Averages,sums);
+        work->add_dependency(d_wait_snapshot[d_snapshot_index]);
         work->add_dependency(d_wait_subphase);    // Make sure we are done using analysis before modifying
         work->add_dependency(d_wait_analysis);  
         work->add_dependency(d_wait_vis);
@@ -1012,6 +1169,7 @@ void runAnalysis::basic(int timestep, std::shared_ptr<Database> input_db, SubPha
     
     if ( timestep%d_subphase_analysis_interval == 0 ) {
         auto work = new SubphaseWorkItem(type,timestep,Averages);
+        work->add_dependency(d_wait_snapshot[d_snapshot_index]);
         work->add_dependency(d_wait_subphase);    // Make sure we are done using analysis before modifying
         work->add_dependency(d_wait_analysis);  
         work->add_dependency(d_wait_vis);
@@ -1023,7 +1181,7 @@ void runAnalysis::basic(int timestep, std::shared_ptr<Database> input_db, SubPha
     	// Copy restart data to the CPU
     	cDen = std::shared_ptr<double>(new double[2*d_Np],DeleteArray<double>);
     	cfq = std::shared_ptr<double>(new double[19*d_Np],DeleteArray<double>);
-    	ScaLBL_CopyToHost(cfq.get(),fq,19*d_Np*sizeof(double));
+    	ScaLBL_CopyDistToHost(cfq.get(),fq,19*d_Np);
     	ScaLBL_CopyToHost(cDen.get(),Den,2*d_Np*sizeof(double));
 
     	if (d_rank==0) {
@@ -1036,7 +1194,11 @@ void runAnalysis::basic(int timestep, std::shared_ptr<Database> input_db, SubPha
   
     	}
     	// Write the restart file (using a seperate thread)
-    	auto work1 = new WriteRestartWorkItem(d_restartFile.c_str(),cDen,cfq,d_Np);
+    	ThreadPool::WorkItem *work1;
+    	if (d_restart_format == "shared")
+    		work1 = new WriteSharedRestartWorkItem(d_restartFile.c_str(),d_Dm,d_Map,cDen,cfq,d_Np,getComm());
+    	else
+    		work1 = new WriteRestartWorkItem(d_restartFile.c_str(),cDen,cfq,d_Np);
     	work1->add_dependency(d_wait_restart);
     	d_wait_restart = d_tpool.add_work(work1);
 
@@ -1045,16 +1207,19 @@ void runAnalysis::basic(int timestep, std::shared_ptr<Database> input_db, SubPha
     if (timestep%d_visualization_interval==0){
         // Write the vis files
          auto work = new IOWorkItem( timestep, input_db, d_meshData, Averages, d_fillData, getComm() );
+        work->add_dependency(d_wait_snapshot[d_snapshot_index]);
         work->add_dependency(d_wait_analysis);
         work->add_dependency(d_wait_subphase);
         work->add_dependency(d_wait_vis);
         d_wait_vis = d_tpool.add_work(work);
     }
 
+    d_stall_time += MPI_Wtime() - stall_start;
+    d_stall_count++;
     PROFILE_STOP("run");
 }
 
-void runAnalysis::WriteVisData(int timestep, std::shared_ptr<Database> input_db, SubPhase &Averages, const double *Phi, double *Pressure, double *Velocity, double *fq, double *Den)
+void runAnalysis::WriteVisData(int timestep, std::shared_ptr<Database> input_db, SubPhase &Averages, const double *Phi, double *Pressure, double *Velocity, dist_t *fq, double *Den)
 {
     int N = d_N[0]*d_N[1]*d_N[2];
 	auto color_db =  input_db->getDatabase( "Color" );
@@ -47,10 +47,10 @@ public:
 
     //! Run the next analysis
     void run(int timestep, std::shared_ptr<Database> db,  TwoPhase &Averages, const double *Phi,
-        double *Pressure, double *Velocity, double *fq, double *Den );
+        double *Pressure, double *Velocity, dist_t *fq, double *Den );
     
-    void basic( int timestep, std::shared_ptr<Database> db, SubPhase &Averages, const double *Phi, double *Pressure, double *Velocity, double *fq, double *Den );
-    void WriteVisData(int timestep, std::shared_ptr<Database> vis_db, SubPhase &Averages, const double *Phi, double *Pressure, double *Velocity, double *fq, double *Den);
+    void basic( int timestep, std::shared_ptr<Database> db, SubPhase &Averages, const double *Phi, double *Pressure, double *Velocity, dist_t *fq, double *Den );
+    void WriteVisData(int timestep, std::shared_ptr<Database> vis_db, SubPhase &Averages, const double *Phi, double *Pressure, double *Velocity, dist_t *fq, double *Den);
 
     //! Finish all active analysis
     void finish();
@@ -78,6 +78,10 @@ private:
     // Determine the analysis to perform
     AnalysisType computeAnalysisType( int timestep );
 
+    // Copy the fields (d_Np values each) into the next snapshot buffer and queue the
+    // conversion to the regular layout (src[i] is scattered into dst[i])
+    ThreadPool::thread_id_t snapshot( const std::vector<const double*>& src, const std::vector<DoubleArray*>& dst );
+
 public:
 
     class commWrapper
@@ -109,12 +113,20 @@ private:
     ThreadPool d_tpool;
     RankInfoStruct d_rank_info;
     IntArray d_Map;
-    BlobIDstruct d_last_ids;
+    std::shared_ptr<Domain> d_Dm;
     BlobIDstruct d_last_index;
+    std::shared_ptr<BlobTracker> d_blob_tracker;
     BlobIDList d_last_id_map;
     std::vector<IO::MeshDataStruct> d_meshData;
     fillHalo<double> d_fillData;
     std::string d_restartFile;
+    std::string d_restart_format;
+    std::string d_basic_analysis;
+    int *d_dvcMap;
+    double *d_snapshot[2];          // pinned host buffers for the simulation state
+    int d_snapshot_index;           // buffer used by the last snapshot
+    double d_stall_time;            // time the simulation waited for the analysis
+    int d_stall_count;
     MPI_Comm d_comm;
     MPI_Comm d_comms[1024];
     volatile bool d_comm_used[1024];
@@ -126,6 +138,7 @@ private:
     ThreadPool::thread_id_t d_wait_subphase;
     ThreadPool::thread_id_t d_wait_vis;
     ThreadPool::thread_id_t d_wait_restart;
+    ThreadPool::thread_id_t d_wait_snapshot[2];
 
     // Friends
     friend commWrapper::~commWrapper();
@@ -106,8 +106,11 @@ void InterpolateMesh( const Array<float> &Coarse, Array<float> &Fine )
 
 
 // Smooth the data using the distance
-void smooth( const Array<float>& VOL, const Array<float>& Dist, float sigma, Array<float>& MultiScaleSmooth, fillHalo<float>& fillFloat )
+void smooth( const Array<float>& VOL, const Array<float>& Dist, float sigma, Array<float>& MultiScaleSmooth )
 {
+#ifdef USE_OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
     for (size_t i=0; i<VOL.length(); i++) {
 		// use exponential weight based on the distance
 		float dst = Dist(i);
@@ -115,7 +118,6 @@ void smooth( const Array<float>& VOL, const Array<float>& Dist, float sigma, Arr
 		float value = dst>0 ? -1:1;
 		MultiScaleSmooth(i) = tmp*VOL(i) + (1-tmp)*value;
 	}
-	fillFloat.fill(MultiScaleSmooth);
 }
 
 
@@ -123,6 +125,9 @@ void smooth( const Array<float>& VOL, const Array<float>& Dist, float sigma, Arr
 void segment( const Array<float>& data, Array<char>& ID, float tol )
 {
     ASSERT(data.size()==ID.size());
+#ifdef USE_OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
     for (size_t i=0; i<data.length(); i++) {
         if ( data(i) > tol )
             ID(i) = 0;
@@ -167,7 +172,7 @@ void solve( const Array<float>& VOL, Array<float>& Mean, Array<char>& ID,
     // Compute the distance using the segmented volume
 	CalcDist( Dist, ID, Dm );
 	fillFloat.fill(Dist);
-    smooth( VOL, Dist, 2.0, MultiScaleSmooth, fillFloat );
+    smooth( VOL, Dist, 2.0, MultiScaleSmooth );
     // Compute non-local mean
     //	int depth = 5;
     //	float sigsq=0.1;
@@ -187,11 +192,12 @@ void refine( const Array<float>& Dist_coarse,
     int ratio[3] = { int(Dist.size(0)/Dist_coarse.size(0)),
                      int(Dist.size(1)/Dist_coarse.size(1)),
                      int(Dist.size(2)/Dist_coarse.size(2)) };
-    // Interpolate the distance from the coarse to fine grid
-	InterpolateMesh( Dist_coarse, Dist );
-    // Compute the median filter on the array and segment
+    // Compute the median filter on the array and interpolate the distance from the
+    // coarse to fine grid while the halos of the median are exchanged
     Med3D( VOL, Mean );
-    fillFloat.fill( Mean );
+    fillFloat.fillStart( Mean );
+	InterpolateMesh( Dist_coarse, Dist );
+    fillFloat.fillFinish( Mean );
     segment( Mean, ID, threshold );
     // If the ID has the wrong distance, set the distance to 0 and run a simple filter to set neighbors to 0
     for (size_t i=0; i<ID.length(); i++) {
@@ -211,7 +217,7 @@ void refine( const Array<float>& Dist_coarse,
     fillFloat.fill( Dist );
     // Smooth the volume data
     float h = 2*lamda*sqrt(double(ratio[0]*ratio[0]+ratio[1]*ratio[1]+ratio[2]*ratio[2]));
-    smooth( VOL, Dist, h, MultiScaleSmooth, fillFloat );
+    smooth( VOL, Dist, h, MultiScaleSmooth );
     // Compute non-local mean
 //	int depth = 3;
 //	float sigsq = 0.1;
@@ -233,6 +239,222 @@ void refine( const Array<float>& Dist_coarse,
 }
 
 
+/******************************************************************
+* Gather a level onto a subset of the ranks                       *
+******************************************************************/
+gatherDomain::gatherDomain( const Domain& Dm, std::array<int,3> factor ):
+    d_factor(factor), d_comm(MPI_COMM_NULL), d_level_comm(Dm.Comm), d_info(Dm.rank_info)
+{
+    d_n = { Dm.Nx-2, Dm.Ny-2, Dm.Nz-2 };
+    int nproc[3] = { Dm.nprocx(), Dm.nprocy(), Dm.nprocz() };
+    int proc[3] = { Dm.iproc(), Dm.jproc(), Dm.kproc() };
+    const std::vector<int> *slabs[3] = { &Dm.slab_x, &Dm.slab_y, &Dm.slab_z };
+    int block[3], nblock[3], pos[3];
+    for (int d=0; d<3; d++) {
+        INSIST(factor[d]>0&&nproc[d]%factor[d]==0,"gatherDomain: the factor must divide the number of ranks");
+        INSIST((*slabs[d]).back()==nproc[d]*d_n[d],"gatherDomain: the level must have a uniform decomposition");
+        block[d] = proc[d]/factor[d];
+        nblock[d] = nproc[d]/factor[d];
+        pos[d] = proc[d]%factor[d];
+    }
+    int block_id = block[0] + block[1]*nblock[0] + block[2]*nblock[0]*nblock[1];
+    int pos_id = pos[0] + pos[1]*factor[0] + pos[2]*factor[0]*factor[1];
+    // Communicator for each block (the first rank of the block gathers the data)
+    MPI_Comm_split( Dm.Comm, block_id, pos_id, &d_comm );
+    // Create the gathered domain on the first rank of each block
+    MPI_Comm active_comm;
+    MPI_Comm_split( Dm.Comm, pos_id==0 ? 0:MPI_UNDEFINED, block_id, &active_comm );
+    if ( pos_id == 0 ) {
+        auto db = Dm.getDatabase()->cloneDatabase();
+        db->putVector<int>( "n", { d_n[0]*factor[0], d_n[1]*factor[1], d_n[2]*factor[2] } );
+        db->putVector<int>( "nproc", { nblock[0], nblock[1], nblock[2] } );
+        if ( db->keyExists( "Decomposition" ) )
+            db->putScalar<std::string>( "Decomposition", "uniform" );
+        d_Dm.reset( new Domain( db, active_comm ) );
+        MPI_Comm_free( &active_comm );
+        d_fillFloat.reset( new fillHalo<float>( d_Dm->Comm, d_Dm->rank_info,
+            { d_Dm->Nx-2, d_Dm->Ny-2, d_Dm->Nz-2 }, {1,1,1}, 0, 1 ) );
+    }
+}
+gatherDomain::~gatherDomain( )
+{
+    d_fillFloat.reset();
+    d_Dm.reset();
+    MPI_Comm_free( &d_comm );
+}
+std::array<int,3> gatherDomain::getFactor( const Domain& Dm, int min_size )
+{
+    int n[3] = { Dm.Nx-2, Dm.Ny-2, Dm.Nz-2 };
+    int nproc[3] = { Dm.nprocx(), Dm.nprocy(), Dm.nprocz() };
+    std::array<int,3> factor = { 1, 1, 1 };
+    for (int d=0; d<3; d++) {
+        while ( n[d]*factor[d] < min_size && factor[d] < nproc[d] ) {
+            factor[d]++;
+            while ( nproc[d]%factor[d] != 0 )
+                factor[d]++;
+        }
+    }
+    return factor;
+}
+template<class TYPE>
+void gatherDomain::gather( const Array<TYPE>& src, Array<TYPE>& dst ) const
+{
+    PROFILE_START("gatherDomain::gather");
+    int rank, size;
+    MPI_Comm_rank( d_comm, &rank );
+    MPI_Comm_size( d_comm, &size );
+    // Gather the interior of each sub-domain of the block
+    size_t N_local = d_n[0]*d_n[1]*d_n[2];
+    std::vector<TYPE> local(N_local), buffer(rank==0 ? size*N_local:0);
+    for (int k=0, m=0; k<d_n[2]; k++) {
+        for (int j=0; j<d_n[1]; j++) {
+            for (int i=0; i<d_n[0]; i++, m++)
+                local[m] = src(i+1,j+1,k+1);
+        }
+    }
+    MPI_Gather( local.data(), N_local*sizeof(TYPE), MPI_BYTE,
+        buffer.data(), N_local*sizeof(TYPE), MPI_BYTE, 0, d_comm );
+    if ( rank == 0 ) {
+        dst.resize( d_n[0]*d_factor[0]+2, d_n[1]*d_factor[1]+2, d_n[2]*d_factor[2]+2 );
+        dst.fill( 0 );
+        for (int p=0; p<size; p++) {
+            int i0 = d_n[0]*(p%d_factor[0]);
+            int j0 = d_n[1]*((p/d_factor[0])%d_factor[1]);
+            int k0 = d_n[2]*(p/(d_factor[0]*d_factor[1]));
+            const TYPE *data = &buffer[p*N_local];
+            for (int k=0, m=0; k<d_n[2]; k++) {
+                for (int j=0; j<d_n[1]; j++) {
+                    for (int i=0; i<d_n[0]; i++, m++)
+                        dst(i0+i+1,j0+j+1,k0+k+1) = data[m];
+                }
+            }
+        }
+        fillHalo<TYPE> fill( d_Dm->Comm, d_Dm->rank_info, { d_Dm->Nx-2, d_Dm->Ny-2, d_Dm->Nz-2 }, {1,1,1}, 0, 1 );
+        fill.fill( dst );
+    }
+    PROFILE_STOP("gatherDomain::gather");
+}
+template<class TYPE>
+void gatherDomain::scatter( const Array<TYPE>& src, Array<TYPE>& dst ) const
+{
+    PROFILE_START("gatherDomain::scatter");
+    int rank, size;
+    MPI_Comm_rank( d_comm, &rank );
+    MPI_Comm_size( d_comm, &size );
+    size_t N_local = d_n[0]*d_n[1]*d_n[2];
+    std::vector<TYPE> local(N_local), buffer(rank==0 ? size*N_local:0);
+    if ( rank == 0 ) {
+        for (int p=0; p<size; p++) {
+            int i0 = d_n[0]*(p%d_factor[0]);
+            int j0 = d_n[1]*((p/d_factor[0])%d_factor[1]);
+            int k0 = d_n[2]*(p/(d_factor[0]*d_factor[1]));
+            TYPE *data = &buffer[p*N_local];
+            for (int k=0, m=0; k<d_n[2]; k++) {
+                for (int j=0; j<d_n[1]; j++) {
+                    for (int i=0; i<d_n[0]; i++, m++)
+                        data[m] = src(i0+i+1,j0+j+1,k0+k+1);
+                }
+            }
+        }
+    }
+    MPI_Scatter( buffer.data(), N_local*sizeof(TYPE), MPI_BYTE,
+        local.data(), N_local*sizeof(TYPE), MPI_BYTE, 0, d_comm );
+    dst.resize( d_n[0]+2, d_n[1]+2, d_n[2]+2 );
+    for (int k=0, m=0; k<d_n[2]; k++) {
+        for (int j=0; j<d_n[1]; j++) {
+            for (int i=0; i<d_n[0]; i++, m++)
+                dst(i+1,j+1,k+1) = local[m];
+        }
+    }
+    fillHalo<TYPE> fill( d_level_comm, d_info, d_n, {1,1,1}, 0, 1 );
+    fill.fill( dst );
+    PROFILE_STOP("gatherDomain::scatter");
+}
+template void gatherDomain::gather<float>( const Array<float>&, Array<float>& ) const;
+template void gatherDomain::gather<char>( const Array<char>&, Array<char>& ) const;
+template void gatherDomain::scatter<float>( const Array<float>&, Array<float>& ) const;
+template void gatherDomain::scatter<char>( const Array<char>&, Array<char>& ) const;
+
+
+/******************************************************************
+* Segment a multiscale image                                      *
+******************************************************************/
+std::vector<double> segmentLevels( const std::vector<std::shared_ptr<Domain>>& Dm,
+    const std::vector<Array<float>>& VOL, std::vector<Array<float>>& Mean,
+    std::vector<Array<char>>& ID, std::vector<Array<float>>& Dist,
+    std::vector<Array<float>>& MultiScaleSmooth, std::vector<Array<float>>& NonLocalMean,
+    std::vector<std::shared_ptr<fillHalo<float>>>& fillFloat,
+    float threshold, float lamda, float sigsq, int depth, int gather_size )
+{
+    PROFILE_SCOPED(timer,"segmentLevels");
+    int rank, nprocs;
+    MPI_Comm_rank( Dm[0]->Comm, &rank );
+    MPI_Comm_size( Dm[0]->Comm, &nprocs );
+    int N_levels = Dm.size();
+    std::vector<double> time(N_levels,0);
+    for (int i=N_levels-1; i>=0; i--) {
+        MPI_Barrier( Dm[i]->Comm );
+        double t0 = MPI_Wtime();
+        auto factor = gatherDomain::getFactor( *Dm[i], gather_size );
+        int N_gather = factor[0]*factor[1]*factor[2];
+        if ( N_gather == 1 ) {
+            // Solve the level on all ranks
+            if ( i == N_levels-1 ) {
+                solve( VOL[i], Mean[i], ID[i], Dist[i], MultiScaleSmooth[i], NonLocalMean[i],
+                    *fillFloat[i], *Dm[i], Dm[i]->nprocx(), threshold, lamda, sigsq, depth );
+            } else {
+                refine( Dist[i+1], VOL[i], Mean[i], ID[i], Dist[i], MultiScaleSmooth[i], NonLocalMean[i],
+                    *fillFloat[i], *Dm[i], Dm[i]->nprocx(), i, threshold, lamda, sigsq, depth );
+            }
+        } else {
+            // Gather the level (and the coarse distance) and solve it on the active ranks
+            gatherDomain level( *Dm[i], factor );
+            Array<float> VOL2, Mean2, Dist2, MultiScaleSmooth2, NonLocalMean2, Dist_coarse;
+            Array<char> ID2;
+            level.gather( VOL[i], VOL2 );
+            if ( i < N_levels-1 ) {
+                gatherDomain coarse( *Dm[i+1], factor );
+                coarse.gather( Dist[i+1], Dist_coarse );
+            }
+            if ( level.active() ) {
+                auto size = VOL2.size();
+                Mean2.resize( size );
+                ID2.resize( size );
+                Dist2.resize( size );
+                MultiScaleSmooth2.resize( size );
+                NonLocalMean2.resize( size );
+                Mean2.fill( 0 );
+                ID2.fill( 0 );
+                Dist2.fill( 0 );
+                MultiScaleSmooth2.fill( 0 );
+                NonLocalMean2.fill( 0 );
+                auto& Dm2 = *level.domain();
+                if ( i == N_levels-1 ) {
+                    solve( VOL2, Mean2, ID2, Dist2, MultiScaleSmooth2, NonLocalMean2,
+                        *level.fillFloat(), Dm2, Dm2.nprocx(), threshold, lamda, sigsq, depth );
+                } else {
+                    refine( Dist_coarse, VOL2, Mean2, ID2, Dist2, MultiScaleSmooth2, NonLocalMean2,
+                        *level.fillFloat(), Dm2, Dm2.nprocx(), i, threshold, lamda, sigsq, depth );
+                }
+            }
+            level.scatter( Mean2, Mean[i] );
+            level.scatter( ID2, ID[i] );
+            level.scatter( Dist2, Dist[i] );
+            level.scatter( MultiScaleSmooth2, MultiScaleSmooth[i] );
+            level.scatter( NonLocalMean2, NonLocalMean[i] );
+        }
+        time[i] = maxReduce( Dm[i]->Comm, MPI_Wtime() - t0 );
+        if ( rank == 0 ) {
+            int N[3] = { (Dm[i]->Nx-2)*Dm[i]->nprocx(), (Dm[i]->Ny-2)*Dm[i]->nprocy(), (Dm[i]->Nz-2)*Dm[i]->nprocz() };
+            double cells = double(N[0])*double(N[1])*double(N[2]);
+            printf("   Level %i: %i x %i x %i on %i ranks, %0.3f s (%0.2f Mcells/s)\n",
+                i, N[0], N[1], N[2], nprocs/N_gather, time[i], 1e-6*cells/time[i] );
+        }
+    }
+    return time;
+}
+
+
 // Remove regions that are likely noise by shrinking the volumes by dx,
 // removing all values that are more than dx+delta from the surface, and then
 // growing by dx+delta and intersecting with the original data
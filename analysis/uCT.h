@@ -31,8 +31,9 @@
 void InterpolateMesh( const Array<float> &Coarse, Array<float> &Fine );
 
 
-// Smooth the data using the distance
-void smooth( const Array<float>& VOL, const Array<float>& Dist, float sigma, Array<float>& MultiScaleSmooth, fillHalo<float>& fillFloat );
+// Smooth the data using the distance (the ghost cells are computed from the
+// ghost cells of VOL and Dist, so no halo exchange is needed)
+void smooth( const Array<float>& VOL, const Array<float>& Dist, float sigma, Array<float>& MultiScaleSmooth );
 
 
 // Segment the data
@@ -58,6 +59,93 @@ void refine( const Array<float>& Dist_coarse,
     float threshold, float lamda, float sigsq, int depth);
 
 
+/*!
+ * @brief  Gather a level onto a subset of the ranks
+ * @details  The coarse levels of the multiscale segmentation have few cells per rank,
+ *    so their time is set by the latency of the halo exchanges and the distance
+ *    calculation rather than by the work.  This class gathers the sub-domains of each
+ *    block of factor[0] x factor[1] x factor[2] ranks onto the first rank of the block,
+ *    which solves the level on a domain with fewer (and larger) sub-domains.
+ *    The level must have a uniform decomposition.
+ */
+class gatherDomain
+{
+public:
+    /*!
+     * @brief  Default constructor
+     * @param[in] Dm            Domain of the level (all ranks)
+     * @param[in] factor        Number of ranks gathered in each direction (must divide nproc)
+     */
+    gatherDomain( const Domain& Dm, std::array<int,3> factor );
+
+    //!  Destructor
+    ~gatherDomain( );
+
+    /*!
+     * @brief  Choose the gather factor
+     * @details  Returns the smallest factor (in each direction) so that each active rank
+     *    holds at least min_size cells in the direction, or all the ranks in the direction
+     * @param[in] Dm            Domain of the level
+     * @param[in] min_size      Minimum number of cells per rank (0 to not gather)
+     */
+    static std::array<int,3> getFactor( const Domain& Dm, int min_size );
+
+    //!  Does this rank solve the gathered level
+    inline bool active() const { return d_Dm.get()!=nullptr; }
+
+    //!  The gathered domain (null on the inactive ranks)
+    inline std::shared_ptr<Domain> domain() { return d_Dm; }
+
+    //!  Fill the halos of the gathered arrays (null on the inactive ranks)
+    inline std::shared_ptr<fillHalo<float>> fillFloat() { return d_fillFloat; }
+
+    /*!
+     * @brief  Gather an array
+     * @param[in] src           Local array (with the ghost cells)
+     * @param[out] dst          Gathered array with the ghost cells filled (active ranks only)
+     */
+    template<class TYPE>
+    void gather( const Array<TYPE>& src, Array<TYPE>& dst ) const;
+
+    /*!
+     * @brief  Scatter an array
+     * @param[in] src           Gathered array (active ranks only)
+     * @param[out] dst          Local array with the ghost cells filled
+     */
+    template<class TYPE>
+    void scatter( const Array<TYPE>& src, Array<TYPE>& dst ) const;
+
+private:
+    std::array<int,3> d_n, d_factor;
+    MPI_Comm d_comm;                        // Ranks of the block (the first rank is active)
+    MPI_Comm d_level_comm;                  // Communicator of the level
+    RankInfoStruct d_info;                  // Rank info of the level
+    std::shared_ptr<Domain> d_Dm;
+    std::shared_ptr<fillHalo<float>> d_fillFloat;
+    gatherDomain(const gatherDomain&);              // Private copy constructor
+    gatherDomain& operator=(const gatherDomain&);   // Private assignment operator
+};
+
+
+/*!
+ * @brief  Segment a multiscale image
+ * @details  This routine solves the coarsest level and refines the solution to the
+ *    finest level.  Levels with fewer than gather_size cells per rank (in a direction)
+ *    are gathered onto a subset of the ranks (see gatherDomain) and the results are
+ *    scattered back to all ranks.  Rank 0 reports the time and throughput of each level.
+ * @param[in] Dm            Domain of each level (finest first)
+ * @param[in] VOL           Source data of each level
+ * @param[in] gather_size   Minimum number of cells per rank before a level is gathered (0 to not gather)
+ * @return                  Time to solve each level
+ */
+std::vector<double> segmentLevels( const std::vector<std::shared_ptr<Domain>>& Dm,
+    const std::vector<Array<float>>& VOL, std::vector<Array<float>>& Mean,
+    std::vector<Array<char>>& ID, std::vector<Array<float>>& Dist,
+    std::vector<Array<float>>& MultiScaleSmooth, std::vector<Array<float>>& NonLocalMean,
+    std::vector<std::shared_ptr<fillHalo<float>>>& fillFloat,
+    float threshold, float lamda, float sigsq, int depth, int gather_size );
+
+
 // Remove regions that are likely noise by shrinking the volumes by dx,
 // removing all values that are more than dx+delta from the surface, and then
 // growing by dx+delta and intersecting with the original data
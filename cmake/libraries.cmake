@@ -38,6 +38,58 @@ MACRO( CONFIGURE_MIC )
 ENDMACRO()
 
 
+# Macro to configure the vectorized (SIMD) CPU kernels
+#    USE_SIMD enables the "omp simd" loops in the cpu/ collision kernels
+#    SIMD_ISA selects the instruction set: NATIVE (default), AVX2 (4 sites/iteration) or AVX512 (8 sites/iteration)
+#    Note: the AAodd kernels scatter through neighborList and are only vectorized with AVX512
+MACRO( CONFIGURE_SIMD )
+    CHECK_ENABLE_FLAG( USE_SIMD 0 )
+    IF ( USE_SIMD AND NOT USE_CUDA )
+        IF ( NOT SIMD_ISA )
+            SET( SIMD_ISA NATIVE )
+        ENDIF()
+        STRING( TOUPPER "${SIMD_ISA}" SIMD_ISA )
+        IF ( SIMD_ISA STREQUAL "NATIVE" )
+            SET( SIMD_FLAGS "-march=native" )
+        ELSEIF ( SIMD_ISA STREQUAL "AVX2" )
+            SET( SIMD_FLAGS "-mavx2 -mfma" )
+        ELSEIF ( SIMD_ISA STREQUAL "AVX512" )
+            SET( SIMD_FLAGS "-mavx512f -mavx512cd -mfma -mprefer-vector-width=512" )
+        ELSE()
+            MESSAGE( FATAL_ERROR "Unknown SIMD_ISA (${SIMD_ISA}); use NATIVE, AVX2 or AVX512" )
+        ENDIF()
+        SET( SIMD_FLAGS "${SIMD_FLAGS} -fopenmp-simd -fno-math-errno" )
+        SET( CMAKE_REQUIRED_FLAGS "${CMAKE_CXX_FLAGS} ${SIMD_FLAGS}" )
+        CHECK_CXX_SOURCE_COMPILES( "int main() { return 0;}" SIMD_FLAGS_${SIMD_ISA} )
+        IF ( NOT SIMD_FLAGS_${SIMD_ISA} )
+            MESSAGE( FATAL_ERROR "Compiler does not support the SIMD flags: ${SIMD_FLAGS}" )
+        ENDIF()
+        SET( CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${SIMD_FLAGS}" )
+        ADD_DEFINITIONS( -DUSE_SIMD )
+        MESSAGE( "Using SIMD CPU kernels" )
+        MESSAGE( "   SIMD_ISA = ${SIMD_ISA}" )
+        MESSAGE( "   SIMD_FLAGS = ${SIMD_FLAGS}" )
+    ENDIF()
+ENDMACRO()
+
+
+# Macro to configure OpenMP threading of the CPU kernels (hybrid MPI+threads)
+MACRO( CONFIGURE_OPENMP )
+    CHECK_ENABLE_FLAG( USE_OPENMP 0 )
+    IF ( USE_OPENMP AND NOT USE_CUDA )
+        FIND_PACKAGE( OpenMP )
+        IF ( NOT OPENMP_FOUND )
+            MESSAGE( FATAL_ERROR "OpenMP requested but not found" )
+        ENDIF()
+        SET( CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${OpenMP_CXX_FLAGS}" )
+        SET( EXTERNAL_LIBS ${EXTERNAL_LIBS} ${OpenMP_CXX_LIBRARIES} )
+        ADD_DEFINITIONS( -DUSE_OPENMP )
+        MESSAGE( "Using OpenMP" )
+        MESSAGE( "   OpenMP_CXX_FLAGS = ${OpenMP_CXX_FLAGS}" )
+    ENDIF()
+ENDMACRO()
+
+
 # Macro to find and configure the MPI libraries
 MACRO( CONFIGURE_MPI )
     # Determine if we want to use MPI
@@ -305,4 +357,10 @@ MACRO ( CONFIGURE_LBPM )
         SET( CMAKE_BUILD_WITH_INSTALL_RPATH TRUE )
         SET( CMAKE_INSTALL_RPATH ${CMAKE_INSTALL_RPATH} "${TIMER_DIRECTORY}" "${LBPM_INSTALL_DIR}/lib" )
     ENDIF()
+    # Store the distributions in single precision (kernel arithmetic stays double precision)
+    CHECK_ENABLE_FLAG( USE_FLOAT_DIST 0 )
+    IF ( USE_FLOAT_DIST )
+        ADD_DEFINITIONS( -DUSE_FLOAT_DIST )
+        MESSAGE( "Using single precision storage for distributions" )
+    ENDIF()
 ENDMACRO ()
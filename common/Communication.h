@@ -21,6 +21,7 @@
 #include "common/Array.h"
 
 #include <array>
+#include <vector>
 
 // ********** COMMUNICTION **************************************
 /*
@@ -88,6 +89,42 @@ public:
      */
     void fill( Array<TYPE>& array );
 
+    /*!
+     * @brief  Start communicating the halos
+     * @details  This packs the boundary cells of the array and starts the
+     *    non-blocking sends/recvs.  The caller may work on the array until
+     *    fillFinish is called, but must not change the boundary or ghost cells.
+     * @param[in] array         The array on which we fill the halos
+     */
+    void fillStart( const Array<TYPE>& array );
+
+    /*!
+     * @brief  Finish communicating the halos (started with fillStart)
+     * @param[in] array         The array on which we fill the halos
+     */
+    void fillFinish( Array<TYPE>& array );
+
+    /*!
+     * @brief  Communicate the halos of several arrays
+     * @details  The halos of all the arrays are exchanged with one message per
+     *    neighbor.  The total depth of the arrays (the sum of size(3)) must not
+     *    exceed the depth given to the constructor.
+     * @param[in] arrays        The arrays on which we fill the halos
+     */
+    void fill( const std::vector<Array<TYPE>*>& arrays );
+
+    /*!
+     * @brief  Start communicating the halos of several arrays
+     * @param[in] arrays        The arrays on which we fill the halos
+     */
+    void fillStart( const std::vector<Array<TYPE>*>& arrays );
+
+    /*!
+     * @brief  Finish communicating the halos of several arrays (started with fillStart)
+     * @param[in] arrays        The arrays on which we fill the halos
+     */
+    void fillFinish( const std::vector<Array<TYPE>*>& arrays );
+
     /*!
      * @brief  Copy data from the src array to the dst array
      * @param[in] src           The src array with or without halos
@@ -269,12 +269,40 @@ template<class TYPE>
 void fillHalo<TYPE>::fill( Array<TYPE>& data )
 {
     //PROFILE_START("fillHalo::fill",1);
-    int depth2 = data.size(3);
-    ASSERT((int)data.size(0)==n[0]+2*ng[0]);
-    ASSERT((int)data.size(1)==n[1]+2*ng[1]);
-    ASSERT((int)data.size(2)==n[2]+2*ng[2]);
+    fillStart( data );
+    fillFinish( data );
+    //PROFILE_STOP("fillHalo::fill",1);
+}
+template<class TYPE>
+void fillHalo<TYPE>::fill( const std::vector<Array<TYPE>*>& data )
+{
+    fillStart( data );
+    fillFinish( data );
+}
+template<class TYPE>
+void fillHalo<TYPE>::fillStart( const Array<TYPE>& data )
+{
+    std::vector<Array<TYPE>*> list(1,const_cast<Array<TYPE>*>(&data));
+    fillStart( list );
+}
+template<class TYPE>
+void fillHalo<TYPE>::fillFinish( Array<TYPE>& data )
+{
+    std::vector<Array<TYPE>*> list(1,&data);
+    fillFinish( list );
+}
+template<class TYPE>
+void fillHalo<TYPE>::fillStart( const std::vector<Array<TYPE>*>& data )
+{
+    int depth2 = 0;
+    for (size_t m=0; m<data.size(); m++) {
+        ASSERT((int)data[m]->size(0)==n[0]+2*ng[0]);
+        ASSERT((int)data[m]->size(1)==n[1]+2*ng[1]);
+        ASSERT((int)data[m]->size(2)==n[2]+2*ng[2]);
+        ASSERT(data[m]->ndim()==3||data[m]->ndim()==4);
+        depth2 += data[m]->size(3);
+    }
     ASSERT(depth2<=depth);
-    ASSERT(data.ndim()==3||data.ndim()==4);
     // Start the recieves
     for (int i=0; i<3; i++) {
         for (int j=0; j<3; j++) {
@@ -286,18 +314,26 @@ void fillHalo<TYPE>::fill( Array<TYPE>& data )
             }
         }
     }
-    // Pack the src data and start the sends
+    // Pack the src data (array by array) and start the sends
     for (int i=0; i<3; i++) {
         for (int j=0; j<3; j++) {
             for (int k=0; k<3; k++) {
                 if ( !fill_pattern[i][j][k] )
                     continue;
-                pack( data, i-1, j-1, k-1, send[i][j][k] );
+                size_t offset = 0;
+                for (size_t m=0; m<data.size(); m++) {
+                    pack( *data[m], i-1, j-1, k-1, &send[i][j][k][offset] );
+                    offset += data[m]->size(3)*N_send_recv[i][j][k];
+                }
                 MPI_Isend( send[i][j][k], N_type*depth2*N_send_recv[i][j][k], datatype, 
                     info.rank[i][j][k], tag[i][j][k], comm, &send_req[i][j][k] );
             }
         }
     }
+}
+template<class TYPE>
+void fillHalo<TYPE>::fillFinish( const std::vector<Array<TYPE>*>& data )
+{
     // Recv the dst data and unpack (we recive in reverse order to match the sends)
     MPI_Status status;
     for (int i=2; i>=0; i--) {
@@ -306,7 +342,11 @@ void fillHalo<TYPE>::fill( Array<TYPE>& data )
                 if ( !fill_pattern[i][j][k] )
                     continue;
                 MPI_Wait(&recv_req[i][j][k],&status);
-                unpack( data, i-1, j-1, k-1, recv[i][j][k] );
+                size_t offset = 0;
+                for (size_t m=0; m<data.size(); m++) {
+                    unpack( *data[m], i-1, j-1, k-1, &recv[i][j][k][offset] );
+                    offset += data[m]->size(3)*N_send_recv[i][j][k];
+                }
             }
         }
     }
@@ -320,7 +360,6 @@ void fillHalo<TYPE>::fill( Array<TYPE>& data )
             }
         }
     }
-    //PROFILE_STOP("fillHalo::fill",1);
 }
 template<class TYPE>
 void fillHalo<TYPE>::pack( const Array<TYPE>& data, int i0, int j0, int k0, TYPE *buffer )
@@ -17,12 +17,14 @@
 // Copyright 2008-2013
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <iostream>
 #include <fstream>
 #include <math.h>
 #include <time.h>
 #include <exception>      // std::exception
 #include <stdexcept>
+#include <algorithm>
 
 #include "common/Domain.h"
 #include "common/Array.h"
@@ -37,6 +39,142 @@ static inline void fgetl( char * str, int num, FILE * stream )
     if ( 0 ) {char *temp = (char *)&ptr; temp++;}
 }
 
+// Read an 8-bit or 16-bit segmented image
+static void ReadSegmentedImage( const std::string& Filename, const std::string& ReadType, int64_t SIZE, char *SegData )
+{
+	if (ReadType == "16bit"){
+		short int *InputData = new short int[SIZE];
+		FILE *SEGDAT = fopen(Filename.c_str(),"rb");
+		if (SEGDAT==NULL) ERROR("Domain.cpp: Error reading segmented data");
+		size_t ReadSeg;
+		ReadSeg=fread(InputData,2,SIZE,SEGDAT);
+		if (ReadSeg != size_t(SIZE)) printf("Domain.cpp: Error reading segmented data \n");
+		fclose(SEGDAT);
+		for (int64_t n=0; n<SIZE; n++){
+			SegData[n] = char(InputData[n]);
+		}
+		delete [] InputData;
+	}
+	else {
+		FILE *SEGDAT = fopen(Filename.c_str(),"rb");
+		if (SEGDAT==NULL) ERROR("Domain.cpp: Error reading segmented data");
+		size_t ReadSeg;
+		ReadSeg=fread(SegData,1,SIZE,SEGDAT);
+		if (ReadSeg != size_t(SIZE)) printf("Domain.cpp: Error reading segmented data \n");
+		fclose(SEGDAT);
+	}
+}
+
+// Position in the segmented image of the global (interior) simulation coordinate x (same clamping as Decomp)
+static inline int64_t ImageCoordinate( int64_t x, int64_t start, int64_t global_N )
+{
+	if (x<start) x=start;
+	if (!(x<global_N)) x=global_N-1;
+	return x;
+}
+
+// Cut points that split the plane weights into nproc slabs of (nearly) equal weight
+static std::vector<int> BalanceSlabs( const std::vector<double>& weight, int nproc, int min_width )
+{
+	int L = weight.size();
+	std::vector<int> cut(nproc+1,0);
+	double total = 0.0;
+	for (int i=0; i<L; i++) total += weight[i];
+	for (int p=0; p<=nproc; p++) cut[p] = (p*L)/nproc;
+	if (total == 0.0) return cut;
+	double sum = 0.0;
+	int i = 0;
+	for (int p=1; p<nproc; p++){
+		double target = total*p/nproc;
+		while (i < L && sum + 0.5*weight[i] < target) sum += weight[i++];
+		int lo = cut[p-1] + min_width;
+		int hi = L - (nproc-p)*min_width;
+		cut[p] = std::min(std::max(i,lo),hi);
+		while (i < cut[p]) sum += weight[i++];
+		while (i > cut[p]) sum -= weight[--i];
+	}
+	return cut;
+}
+
+// Part [lo,lo+n) of the segmented image that holds the (shifted) simulation coordinates first..last
+static inline void ImageRange( int64_t first, int64_t last, int64_t start, int64_t global_N, int64_t &lo, int64_t &n )
+{
+	lo = ImageCoordinate(start + first, start, global_N);
+	n = ImageCoordinate(start + last, start, global_N) - lo + 1;
+}
+
+// Collective read of the box [lo,lo+n) of an 8-bit or 16-bit segmented image (one MPI_File_read_all per rank)
+static void ReadImageBox( MPI_Comm Comm, const std::string& Filename, const std::string& ReadType,
+		const int64_t global_N[3], const int64_t lo[3], const int64_t n[3], char *data )
+{
+	MPI_Datatype etype = (ReadType == "16bit") ? MPI_SHORT : MPI_CHAR;
+	int sizes[3] = { int(global_N[2]), int(global_N[1]), int(global_N[0]) };
+	int subsizes[3] = { int(n[2]), int(n[1]), int(n[0]) };
+	int starts[3] = { int(lo[2]), int(lo[1]), int(lo[0]) };
+	MPI_Datatype filetype;
+	MPI_Type_create_subarray(3,sizes,subsizes,starts,MPI_ORDER_C,etype,&filetype);
+	MPI_Type_commit(&filetype);
+	MPI_File fh;
+	int err = MPI_File_open(Comm,(char*) Filename.c_str(),MPI_MODE_RDONLY,MPI_INFO_NULL,&fh);
+	if (err != MPI_SUCCESS) ERROR("Domain.cpp: Error reading segmented data");
+	MPI_File_set_view(fh,0,etype,filetype,(char*) "native",MPI_INFO_NULL);
+	int count = n[0]*n[1]*n[2];
+	int ReadSeg = 0;
+	MPI_Status status;
+	if (ReadType == "16bit"){
+		short int *InputData = new short int[count];
+		MPI_File_read_all(fh,InputData,count,MPI_SHORT,&status);
+		for (int64_t idx=0; idx<count; idx++){
+			data[idx] = char(InputData[idx]);
+		}
+		delete [] InputData;
+	}
+	else {
+		MPI_File_read_all(fh,data,count,MPI_CHAR,&status);
+	}
+	MPI_Get_count(&status,etype,&ReadSeg);
+	if (ReadSeg != count) printf("Domain.cpp: Error reading segmented data \n");
+	MPI_File_close(&fh);
+	MPI_Type_free(&filetype);
+}
+
+// Relabel the image box (the first matching ReadValues entry wins); LabelCount counts the voxels in [own_lo,own_hi)
+static void RelabelImage( char *data, const int64_t n[3], const int64_t own_lo[3], const int64_t own_hi[3],
+		const std::vector<int>& ReadValues, const std::vector<int>& WriteValues, std::vector<long int>& LabelCount )
+{
+	int match[256];
+	for (int v=0; v<256; v++) match[v] = -1;
+	for (int idx=ReadValues.size()-1; idx>=0; idx--) match[(unsigned char)(ReadValues[idx])] = idx;
+	for (int64_t k=0; k<n[2]; k++){
+		for (int64_t j=0; j<n[1]; j++){
+			bool own = (k>=own_lo[2] && k<own_hi[2] && j>=own_lo[1] && j<own_hi[1]);
+			for (int64_t i=0; i<n[0]; i++){
+				int64_t idx = k*n[0]*n[1]+j*n[0]+i;
+				int m = match[(unsigned char)(data[idx])];
+				if (m < 0) continue;
+				data[idx] = WriteValues[m];
+				if (own && i>=own_lo[0] && i<own_hi[0]) LabelCount[m]++;
+			}
+		}
+	}
+}
+
+// Copy the image values of the (shifted) simulation coordinates first+[0,local_n) from the box [lo,lo+n)
+static void CopyImageBox( const char *data, const int64_t lo[3], const int64_t n[3],
+		const int64_t first[3], const int64_t local_n[3], const int64_t start[3], const int64_t global_N[3], char *local )
+{
+	for (int64_t k=0; k<local_n[2]; k++){
+		int64_t z = ImageCoordinate(start[2] + first[2] + k, start[2], global_N[2]) - lo[2];
+		for (int64_t j=0; j<local_n[1]; j++){
+			int64_t y = ImageCoordinate(start[1] + first[1] + j, start[1], global_N[1]) - lo[1];
+			for (int64_t i=0; i<local_n[0]; i++){
+				int64_t x = ImageCoordinate(start[0] + first[0] + i, start[0], global_N[0]) - lo[0];
+				local[k*local_n[0]*local_n[1] + j*local_n[0] + i] = data[z*n[0]*n[1] + y*n[0] + x];
+			}
+		}
+	}
+}
+
 /********************************************************
  * Constructors/Destructor                               *
  ********************************************************/
@@ -227,13 +365,18 @@ void Domain::initialize( std::shared_ptr<Database> db )
     Lx = nx*nproc[0]*voxel_length;
     Ly = ny*nproc[1]*voxel_length;
     Lz = nz*nproc[2]*voxel_length;
-    Nx = nx+2;
-    Ny = ny+2;
-    Nz = nz+2;
     // Initialize ranks
     int myrank;
     MPI_Comm_rank( Comm, &myrank );
 	rank_info = RankInfoStruct(myrank,nproc[0],nproc[1],nproc[2]);
+	// Sub-domain extents (uniform blocks unless the decomposition is weighted)
+	SetupSlabs( d_db );
+	nx = slab_x[rank_info.ix+1] - slab_x[rank_info.ix];
+	ny = slab_y[rank_info.jy+1] - slab_y[rank_info.jy];
+	nz = slab_z[rank_info.kz+1] - slab_z[rank_info.kz];
+    Nx = nx+2;
+    Ny = ny+2;
+    Nz = nz+2;
 	// inlet layers only apply to lower part of domain
 	if (rank_info.ix > 0) inlet_layers_x = 0;
 	if (rank_info.jy > 0) inlet_layers_y = 0;
@@ -245,6 +388,8 @@ void Domain::initialize( std::shared_ptr<Database> db )
     // Fill remaining variables
 	N = Nx*Ny*Nz;
 	Volume = nx*ny*nx*nproc[0]*nproc[1]*nproc[2]*1.0;
+	if (d_db->keyExists( "slab_x" ))
+		Volume = double(slab_x.back())*double(slab_y.back())*double(slab_z.back());
 
 	if (myrank==0) printf("voxel length = %f micron \n", voxel_length);
 
@@ -256,6 +401,171 @@ void Domain::initialize( std::shared_ptr<Database> db )
 	INSIST(nprocs == nproc[0]*nproc[1]*nproc[2],"Fatal error in processor count!");
 }
 
+void Domain::SetupSlabs( std::shared_ptr<Database> db )
+{
+	auto nproc = db->getVector<int>("nproc");
+	auto n = db->getVector<int>("n");
+	std::vector<int> *slabs[3] = { &slab_x, &slab_y, &slab_z };
+	slab_imbalance[0] = slab_imbalance[1] = 0.0;
+	for (int d=0; d<3; d++){
+		slabs[d]->resize(nproc[d]+1);
+		for (int p=0; p<=nproc[d]; p++) (*slabs[d])[p] = p*n[d];
+	}
+	std::string method = "uniform";
+	if (db->keyExists( "Decomposition" )){
+		method = db->getScalar<std::string>( "Decomposition" );
+	}
+	if (method == "uniform") return;
+	if (method != "weighted") ERROR("Domain: Decomposition must be uniform or weighted");
+
+	const char *keys[3] = { "slab_x", "slab_y", "slab_z" };
+	if (db->keyExists( "slab_x" ) && db->keyExists( "slab_y" ) && db->keyExists( "slab_z" )){
+		// slabs given in the input (or computed by a previous Domain on this database)
+		for (int d=0; d<3; d++){
+			auto slab = db->getVector<int>( keys[d] );
+			if (int(slab.size()) != nproc[d]+1 || slab[0] != 0 || slab.back() != nproc[d]*n[d])
+				ERROR("Domain: slab_x, slab_y, slab_z must have nproc+1 entries from 0 to nproc*n");
+			*slabs[d] = slab;
+		}
+		return;
+	}
+	if (!db->keyExists( "Filename" )) ERROR("Domain: weighted decomposition requires the Filename of the segmented image");
+
+	// Count the pore voxels in each plane of the simulation domain
+	//    ReadMethod = "serial": rank 0 reads the entire image, "mpiio": each rank reads its uniform block
+	int myrank;
+	MPI_Comm_rank( Comm, &myrank );
+	auto Filename = db->getScalar<std::string>( "Filename" );
+	auto SIZE = db->getVector<int>( "N" );
+	std::string ReadType = "8bit";
+	if (db->keyExists( "ReadType" )) ReadType = db->getScalar<std::string>( "ReadType" );
+	std::string ReadMethod = "serial";
+	if (db->keyExists( "ReadMethod" )) ReadMethod = db->getScalar<std::string>( "ReadMethod" );
+	int64_t start[3] = { 0, 0, 0 };
+	if (db->keyExists( "offset" )){
+		auto offset = db->getVector<int>( "offset" );
+		for (int d=0; d<3; d++) start[d] = offset[d];
+	}
+	int64_t global_N[3] = { SIZE[0], SIZE[1], SIZE[2] };
+	// pore voxels are the labels that are positive after relabeling
+	signed char label[256];
+	for (int v=0; v<256; v++) label[v] = (signed char)(v);
+	if (db->keyExists( "ReadValues" ) && db->keyExists( "WriteValues" )){
+		auto ReadValues = db->getVector<int>( "ReadValues" );
+		auto WriteValues = db->getVector<int>( "WriteValues" );
+		for (int idx=ReadValues.size()-1; idx>=0; idx--)
+			label[(unsigned char)(ReadValues[idx])] = WriteValues[idx];
+	}
+	int64_t z_transition_size = (int64_t(nproc[2])*n[2] - (global_N[2] - start[2]))/2;
+	if (z_transition_size < 0) z_transition_size=0;
+	int64_t shift[3] = { 0, 0, -z_transition_size };
+
+	// range of simulation coordinates counted by this rank and the part of the image under it
+	int ip[3] = { rank_info.ix, rank_info.jy, rank_info.kz };
+	int64_t first[3], last[3], lo[3], box_n[3];
+	char *BoxData = NULL;
+	if (ReadMethod == "serial"){
+		for (int d=0; d<3; d++){
+			first[d] = 0;
+			last[d] = (myrank==0) ? int64_t(nproc[d])*n[d] : 0;
+			lo[d] = 0;
+			box_n[d] = global_N[d];
+		}
+		if (myrank==0){
+			BoxData = new char[global_N[0]*global_N[1]*global_N[2]];
+			ReadSegmentedImage(Filename, ReadType, global_N[0]*global_N[1]*global_N[2], BoxData);
+		}
+	}
+	else {
+		for (int d=0; d<3; d++){
+			first[d] = int64_t(ip[d])*n[d];
+			last[d] = first[d] + n[d];
+			ImageRange(first[d]+shift[d], last[d]-1+shift[d], start[d], global_N[d], lo[d], box_n[d]);
+		}
+		BoxData = new char[box_n[0]*box_n[1]*box_n[2]];
+		ReadImageBox(Comm, Filename, ReadType, global_N, lo, box_n, BoxData);
+	}
+	std::vector<double> weight[3];
+	for (int d=0; d<3; d++) weight[d].assign(nproc[d]*n[d],0.0);
+	for (int64_t k=first[2]; k<last[2]; k++){
+		int64_t z = ImageCoordinate(start[2] + k + shift[2], start[2], global_N[2]) - lo[2];
+		for (int64_t j=first[1]; j<last[1]; j++){
+			int64_t y = ImageCoordinate(start[1] + j, start[1], global_N[1]) - lo[1];
+			for (int64_t i=first[0]; i<last[0]; i++){
+				int64_t x = ImageCoordinate(start[0] + i, start[0], global_N[0]) - lo[0];
+				if (label[(unsigned char)(BoxData[z*box_n[0]*box_n[1]+y*box_n[0]+x])] > 0){
+					weight[0][i] += 1.0;
+					weight[1][j] += 1.0;
+					weight[2][k] += 1.0;
+				}
+			}
+		}
+	}
+	for (int d=0; d<3; d++){
+		MPI_Allreduce(MPI_IN_PLACE,weight[d].data(),nproc[d]*n[d],MPI_DOUBLE,MPI_SUM,Comm);
+		// each slab keeps at least a few layers so that the face / edge lists stay distinct
+		*slabs[d] = BalanceSlabs(weight[d], nproc[d], std::min(4,n[d]));
+		db->putVector<int>( keys[d], *slabs[d] );
+	}
+
+	// Pore voxels of each sub-domain for the uniform blocks and the weighted slabs (reported by Decomp)
+	std::vector<int> owner[3];
+	for (int d=0; d<3; d++){
+		owner[d].resize(nproc[d]*n[d]);
+		for (int p=0; p<nproc[d]; p++)
+			for (int i=(*slabs[d])[p]; i<(*slabs[d])[p+1]; i++) owner[d][i] = p;
+	}
+	int nprocs = nproc[0]*nproc[1]*nproc[2];
+	std::vector<double> count(2*nprocs,0.0);
+	for (int64_t k=first[2]; k<last[2]; k++){
+		int64_t z = ImageCoordinate(start[2] + k + shift[2], start[2], global_N[2]) - lo[2];
+		for (int64_t j=first[1]; j<last[1]; j++){
+			int64_t y = ImageCoordinate(start[1] + j, start[1], global_N[1]) - lo[1];
+			for (int64_t i=first[0]; i<last[0]; i++){
+				int64_t x = ImageCoordinate(start[0] + i, start[0], global_N[0]) - lo[0];
+				if (label[(unsigned char)(BoxData[z*box_n[0]*box_n[1]+y*box_n[0]+x])] > 0){
+					count[(k/n[2])*nproc[0]*nproc[1] + (j/n[1])*nproc[0] + i/n[0]] += 1.0;
+					count[nprocs + owner[2][k]*nproc[0]*nproc[1] + owner[1][j]*nproc[0] + owner[0][i]] += 1.0;
+				}
+			}
+		}
+	}
+	delete [] BoxData;
+	MPI_Allreduce(MPI_IN_PLACE,count.data(),2*nprocs,MPI_DOUBLE,MPI_SUM,Comm);
+	for (int m=0; m<2; m++){
+		double max_count = 0.0, mean_count = 0.0;
+		for (int p=0; p<nprocs; p++){
+			max_count = std::max(max_count,count[m*nprocs+p]);
+			mean_count += count[m*nprocs+p]/nprocs;
+		}
+		slab_imbalance[m] = (mean_count > 0.0) ? max_count/mean_count : 1.0;
+	}
+}
+
+void Domain::MapRecvList(int *list, int count, int dx, int dy, int dz)
+{
+	// Convert the send list of the neighbor at offset (dx,dy,dz) to the local halo indices
+	//    the neighbor may have a different extent along the axes on which it is offset
+	int ix = (rank_info.ix + dx + rank_info.nx) % rank_info.nx;
+	int jy = (rank_info.jy + dy + rank_info.ny) % rank_info.ny;
+	int kz = (rank_info.kz + dz + rank_info.nz) % rank_info.nz;
+	int nbrNx = slab_x[ix+1] - slab_x[ix] + 2;
+	int nbrNy = slab_y[jy+1] - slab_y[jy] + 2;
+	for (int idx=0; idx<count; idx++){
+		int n = list[idx];
+		int k = n/(nbrNx*nbrNy);
+		int j = (n-k*nbrNx*nbrNy)/nbrNx;
+		int i = n-k*nbrNx*nbrNy-j*nbrNx;
+		if (dx < 0) i -= nbrNx-2;
+		if (dx > 0) i += Nx-2;
+		if (dy < 0) j -= nbrNy-2;
+		if (dy > 0) j += Ny-2;
+		if (dz < 0) k -= (slab_z[kz+1] - slab_z[kz]);
+		if (dz > 0) k += Nz-2;
+		list[idx] = k*Nx*Ny + j*Nx + i;
+	}
+}
+
 void Domain::Decomp(std::string Filename)
 {
 	//.......................................................................
@@ -341,8 +651,25 @@ void Domain::Decomp(std::string Filename)
 	global_Ny = SIZE[1];
 	global_Nz = SIZE[2];
 	nprocs=nprocx*nprocy*nprocz;
-	char *SegData = NULL;
-	
+	int64_t global_N[3] = { global_Nx, global_Ny, global_Nz };
+	int64_t start[3] = { xStart, yStart, zStart };
+	int64_t end[3] = { xStart + nx*nprocx, yStart + ny*nprocy, zStart + nz*nprocz };
+	std::string ReadMethod = "serial";
+	if (database->keyExists( "ReadMethod" )){
+		ReadMethod = database->getScalar<std::string>( "ReadMethod" );
+	}
+	if (ReadMethod != "mpiio" && ReadMethod != "serial") ERROR("Domain: ReadMethod must be mpiio or serial");
+
+	// number of sites to use for periodic boundary condition transition zone
+	int64_t z_transition_size = (nprocz*nz - (global_Nz - zStart))/2;
+	if (z_transition_size < 0) z_transition_size=0;
+
+	// Get the rank info (the local size is N = Nx*Ny*Nz, which differs between ranks for a weighted decomposition)
+	int64_t N = int64_t(Nx)*int64_t(Ny)*int64_t(Nz);
+	std::vector<long int> LabelCount(ReadValues.size(),0);
+	char LocalRankFilename[40];
+	char *loc_id;
+
 	if (RANK==0){
 		printf("Input media: %s\n",Filename.c_str());
 		printf("Relabeling %lu values\n",ReadValues.size());
@@ -351,255 +678,184 @@ void Domain::Decomp(std::string Filename)
 			int newvalue=WriteValues[idx];
 			printf("oldvalue=%d, newvalue =%d \n",oldvalue,newvalue);
 		}
-
-		// Rank=0 reads the entire segmented data and distributes to worker processes
 		printf("Dimensions of segmented image: %ld x %ld x %ld \n",global_Nx,global_Ny,global_Nz);
-		int64_t SIZE = global_Nx*global_Ny*global_Nz;
-		SegData = new char[SIZE];
-		if (ReadType == "8bit"){
-			printf("Reading 8-bit input data \n");
-			FILE *SEGDAT = fopen(Filename.c_str(),"rb");
-			if (SEGDAT==NULL) ERROR("Domain.cpp: Error reading segmented data");
-			size_t ReadSeg;
-			ReadSeg=fread(SegData,1,SIZE,SEGDAT);
-			if (ReadSeg != size_t(SIZE)) printf("Domain.cpp: Error reading segmented data \n");
-			fclose(SEGDAT);
-		}
-		else if (ReadType == "16bit"){
-			printf("Reading 16-bit input data \n");
-			short int *InputData;
-			InputData = new short int[SIZE];
-			FILE *SEGDAT = fopen(Filename.c_str(),"rb");
-			if (SEGDAT==NULL) ERROR("Domain.cpp: Error reading segmented data");
-			size_t ReadSeg;
-			ReadSeg=fread(InputData,2,SIZE,SEGDAT);
-			if (ReadSeg != size_t(SIZE)) printf("Domain.cpp: Error reading segmented data \n");
-			fclose(SEGDAT);
-			for (int n=0; n<SIZE; n++){
-				SegData[n] = char(InputData[n]);
-			}
-		}
-		printf("Read segmented data from %s \n",Filename.c_str());
-		
-		// relabel the data
-		std::vector<long int> LabelCount(ReadValues.size(),0);
-		for (int k = 0; k<global_Nz; k++){
-			for (int j = 0; j<global_Ny; j++){
-				for (int i = 0; i<global_Nx; i++){
-					n = k*global_Nx*global_Ny+j*global_Nx+i;
-					//char locval = loc_id[n];
-					char locval = SegData[n];
-					for (int idx=0; idx<ReadValues.size(); idx++){
-						signed char oldvalue=ReadValues[idx];
-						signed char newvalue=WriteValues[idx];
-						if (locval == oldvalue){
-							SegData[n] = newvalue;
-							LabelCount[idx]++;
-							idx = ReadValues.size();
-						}
-					}
-				}
-			}
-		}
+		printf("Reading %s input data (%s) \n",ReadType.c_str(),ReadMethod.c_str());
+	}
+
+	if (ReadMethod == "serial"){
+		char *SegData = NULL;
 		if (RANK==0){
+			// Rank=0 reads the entire segmented data and distributes to worker processes
+			int64_t SIZE = global_Nx*global_Ny*global_Nz;
+			SegData = new char[SIZE];
+			ReadSegmentedImage(Filename, ReadType, SIZE, SegData);
+			printf("Read segmented data from %s \n",Filename.c_str());
+
+			// relabel the data
+			int64_t zero[3] = { 0, 0, 0 };
+			RelabelImage(SegData, global_N, zero, global_N, ReadValues, WriteValues, LabelCount);
 			for (int idx=0; idx<ReadValues.size(); idx++){
 				long int label=ReadValues[idx];
 				long int count=LabelCount[idx];
-				printf("Label=%d, Count=%d \n",label,count);
+				printf("Label=%ld, Count=%ld \n",label,count);
 			}
-		}
+			PrintCheckerboard();
+			Checkerboard(SegData, zero, global_N, start, end, checkerSize);
 
-		if (inlet_layers_x > 0){
-			// use checkerboard pattern
-			printf("Checkerboard pattern at x inlet for %i layers \n",inlet_layers_x);
-			for (int k = 0; k<global_Nz; k++){
-				for (int j = 0; j<global_Ny; j++){
-					for (int i = xStart; i < xStart+inlet_layers_x; i++){
-						if ( (j/checkerSize + k/checkerSize)%2 == 0){
-							// void checkers
-							SegData[k*global_Nx*global_Ny+j*global_Nx+i] = 2;
-						}
-						else{
-							// solid checkers
-							SegData[k*global_Nx*global_Ny+j*global_Nx+i] = 0;
-						}
-					}
-				}
-			}
-		}
+			// Set up the sub-domains
+			printf("Distributing subdomains across %i processors \n",nprocs);
+			printf("Process grid: %i x %i x %i \n",nprocx,nprocy,nprocz);
+			printf("Subdomain size: %i x %i x %i \n",nx,ny,nz);
+			printf("Size of transition region: %ld \n", z_transition_size);
+			if (slab_imbalance[1] > 0.0) PrintSlabs(slab_imbalance[0],slab_imbalance[1]);
 
-		if (inlet_layers_y > 0){
-			printf("Checkerboard pattern at y inlet for %i layers \n",inlet_layers_y);
-			// use checkerboard pattern
-			for (int k = 0; k<global_Nz; k++){
-				for (int j = yStart; j < yStart+inlet_layers_y; j++){
-					for (int i = 0; i<global_Nx; i++){
-						if ( (i/checkerSize + k/checkerSize)%2 == 0){
-							// void checkers
-							SegData[k*global_Nx*global_Ny+j*global_Nx+i] = 2;
+			for (int kp=0; kp<nprocz; kp++){
+				for (int jp=0; jp<nprocy; jp++){
+					for (int ip=0; ip<nprocx; ip++){
+						// rank of the process that gets this subdomain
+						int rnk = kp*nprocx*nprocy + jp*nprocx + ip;
+						int64_t first[3] = { slab_x[ip]-1, slab_y[jp]-1, slab_z[kp]-1-z_transition_size };
+						int64_t local_n[3] = { slab_x[ip+1]-slab_x[ip]+2, slab_y[jp+1]-slab_y[jp]+2, slab_z[kp+1]-slab_z[kp]+2 };
+						int64_t lN = local_n[0]*local_n[1]*local_n[2];
+						loc_id = new char [lN];
+						// Pack and send the subdomain for rnk
+						CopyImageBox(SegData, zero, global_N, first, local_n, start, global_N, loc_id);
+						if (rnk==0){
+							for (n=0; n<lN; n++){
+								id[n] = loc_id[n];
+							}
 						}
 						else{
-							// solid checkers
-							SegData[k*global_Nx*global_Ny+j*global_Nx+i] = 0;
+							//printf("Sending data to process %i \n", rnk);
+							MPI_Send(loc_id,lN,MPI_CHAR,rnk,15,Comm);
 						}
+						// Write the data for this rank data 
+						sprintf(LocalRankFilename,"ID.%05i",rnk+rank_offset);
+						FILE *ID = fopen(LocalRankFilename,"wb");
+						fwrite(loc_id,1,lN,ID);
+						fclose(ID);
+						delete [] loc_id;
 					}
 				}
 			}
+			delete [] SegData;
 		}
-
-		if (inlet_layers_z > 0){
-			printf("Checkerboard pattern at z inlet for %i layers \n",inlet_layers_z);
-			// use checkerboard pattern
-			for (int k = zStart; k < zStart+inlet_layers_z; k++){
-				for (int j = 0; j<global_Ny; j++){
-					for (int i = 0; i<global_Nx; i++){
-						if ( (i/checkerSize+j/checkerSize)%2 == 0){
-							// void checkers
-							//SegData[k*global_Nx*global_Ny+j*global_Nx+i] = 2;
-							SegData[k*global_Nx*global_Ny+j*global_Nx+i] = inlet_layers_phase;
-						}
-						else{
-							// solid checkers
-							SegData[k*global_Nx*global_Ny+j*global_Nx+i] = 0;
-						}
-					}
-				}
-			}
+		else{
+			// Recieve the subdomain from rank = 0
+			//printf("Ready to recieve data %i at process %i \n", N,rank);
+			MPI_Recv(id,N,MPI_CHAR,0,15,Comm,MPI_STATUS_IGNORE);
 		}
-
-		if (outlet_layers_x > 0){
-			// use checkerboard pattern
-			printf("Checkerboard pattern at x outlet for %i layers \n",outlet_layers_x);
-			for (int k = 0; k<global_Nz; k++){
-				for (int j = 0; j<global_Ny; j++){
-					for (int i = xStart + nx*nprocx - outlet_layers_x; i <  xStart + nx*nprocx; i++){
-						if ( (j/checkerSize + k/checkerSize)%2 == 0){
-							// void checkers
-							SegData[k*global_Nx*global_Ny+j*global_Nx+i] = 2;
-						}
-						else{
-							// solid checkers
-							SegData[k*global_Nx*global_Ny+j*global_Nx+i] = 0;
-						}
-					}
-				}
-			}
+	}
+	else {
+		// Each rank reads the part of the image under its sub-domain (including the halo) with a single collective read
+		int ip[3] = { iproc(), jproc(), kproc() };
+		const std::vector<int> *slabs[3] = { &slab_x, &slab_y, &slab_z };
+		int64_t shift[3] = { 0, 0, -z_transition_size };
+		int64_t first[3], local_n[3] = { Nx, Ny, Nz };
+		int64_t lo[3], box_n[3], own_lo[3], own_hi[3];
+		for (int d=0; d<3; d++){
+			first[d] = (*slabs[d])[ip[d]] - 1 + shift[d];
+			ImageRange(first[d], first[d]+local_n[d]-1, start[d], global_N[d], lo[d], box_n[d]);
+			// image voxels under the interior of the sub-domain are counted by this rank
+			own_lo[d] = std::min(std::max(start[d]+first[d]+1-lo[d],int64_t(0)),box_n[d]);
+			own_hi[d] = std::min(std::max(start[d]+first[d]+local_n[d]-1-lo[d],int64_t(0)),box_n[d]);
 		}
-
-		if (outlet_layers_y > 0){
-			printf("Checkerboard pattern at y outlet for %i layers \n",outlet_layers_y);
-			// use checkerboard pattern
-			for (int k = 0; k<global_Nz; k++){
-				for (int j = yStart + ny*nprocy - outlet_layers_y; i < yStart + ny*nprocy; j++){
-					for (int i = 0; i<global_Nx; i++){
-						if ( (i/checkerSize + k/checkerSize)%2 == 0){
-							// void checkers
-							SegData[k*global_Nx*global_Ny+j*global_Nx+i] = 2;
-						}
-						else{
-							// solid checkers
-							SegData[k*global_Nx*global_Ny+j*global_Nx+i] = 0;
-							
-						}
-					}
-				}
+		char *BoxData = new char[box_n[0]*box_n[1]*box_n[2]];
+		ReadImageBox(Comm, Filename, ReadType, global_N, lo, box_n, BoxData);
+		RelabelImage(BoxData, box_n, own_lo, own_hi, ReadValues, WriteValues, LabelCount);
+		std::vector<long int> TotalCount(ReadValues.size(),0);
+		MPI_Reduce(LabelCount.data(),TotalCount.data(),ReadValues.size(),MPI_LONG,MPI_SUM,0,Comm);
+		if (RANK==0){
+			printf("Read segmented data from %s \n",Filename.c_str());
+			for (size_t idx=0; idx<ReadValues.size(); idx++){
+				long int label=ReadValues[idx];
+				long int count=TotalCount[idx];
+				printf("Label=%ld, Count=%ld \n",label,count);
 			}
+			PrintCheckerboard();
+			printf("Process grid: %i x %i x %i \n",nprocx,nprocy,nprocz);
+			printf("Subdomain size: %i x %i x %i \n",nx,ny,nz);
+			printf("Size of transition region: %ld \n", z_transition_size);
 		}
+		Checkerboard(BoxData, lo, box_n, start, end, checkerSize);
+		CopyImageBox(BoxData, lo, box_n, first, local_n, start, global_N, (char*) id);
+		delete [] BoxData;
+		// Write the data for this rank
+		sprintf(LocalRankFilename,"ID.%05i",RANK+rank_offset);
+		FILE *ID = fopen(LocalRankFilename,"wb");
+		fwrite(id,1,N,ID);
+		fclose(ID);
 
-		if (outlet_layers_z > 0){
-			printf("Checkerboard pattern at z outlet for %i layers \n",outlet_layers_z);
-			// use checkerboard pattern
-			for (int k = zStart + nz*nprocz - outlet_layers_z; k < zStart + nz*nprocz; k++){
-				for (int j = 0; j<global_Ny; j++){
-					for (int i = 0; i<global_Nx; i++){
-						if ( (i/checkerSize+j/checkerSize)%2 == 0){
-							// void checkers
-							//SegData[k*global_Nx*global_Ny+j*global_Nx+i] = 2;
-							SegData[k*global_Nx*global_Ny+j*global_Nx+i] = outlet_layers_phase;
-						}
-						else{
-							// solid checkers
-							SegData[k*global_Nx*global_Ny+j*global_Nx+i] = 0;
-						}
-					}
-				}
-			}
-		}
+		if (slab_imbalance[1] > 0.0 && RANK==0) PrintSlabs(slab_imbalance[0],slab_imbalance[1]);
 	}
-	
-	// Get the rank info
-	int64_t N = (nx+2)*(ny+2)*(nz+2);
-
-	// number of sites to use for periodic boundary condition transition zone
-	int64_t z_transition_size = (nprocz*nz - (global_Nz - zStart))/2;
-	if (z_transition_size < 0) z_transition_size=0;
-
-	char LocalRankFilename[40];
-	char *loc_id;
-	loc_id = new char [(nx+2)*(ny+2)*(nz+2)];
+	MPI_Barrier(Comm);
+}
 
-	// Set up the sub-domains
-	if (RANK==0){
-		printf("Distributing subdomains across %i processors \n",nprocs);
-		printf("Process grid: %i x %i x %i \n",nprocx,nprocy,nprocz);
-		printf("Subdomain size: %i x %i x %i \n",nx,ny,nz);
-		printf("Size of transition region: %ld \n", z_transition_size);
-
-		for (int kp=0; kp<nprocz; kp++){
-			for (int jp=0; jp<nprocy; jp++){
-				for (int ip=0; ip<nprocx; ip++){
-					// rank of the process that gets this subdomain
-					int rnk = kp*nprocx*nprocy + jp*nprocx + ip;
-					// Pack and send the subdomain for rnk
-					for (k=0;k<nz+2;k++){
-						for (j=0;j<ny+2;j++){
-							for (i=0;i<nx+2;i++){
-								int64_t x = xStart + ip*nx + i-1;
-								int64_t y = yStart + jp*ny + j-1;
-								// int64_t z = zStart + kp*nz + k-1;
-								int64_t z = zStart + kp*nz + k-1 - z_transition_size;
-								if (x<xStart) 	x=xStart;
-								if (!(x<global_Nx))	x=global_Nx-1;
-								if (y<yStart) 	y=yStart;
-								if (!(y<global_Ny))	y=global_Ny-1;
-								if (z<zStart) 	z=zStart;
-								if (!(z<global_Nz))	z=global_Nz-1;
-								int64_t nlocal = k*(nx+2)*(ny+2) + j*(nx+2) + i;
-								int64_t nglobal = z*global_Nx*global_Ny+y*global_Nx+x;
-								loc_id[nlocal] = SegData[nglobal];
-							}
-						}
-					}
-					if (rnk==0){
-						for (k=0;k<nz+2;k++){
-							for (j=0;j<ny+2;j++){
-								for (i=0;i<nx+2;i++){
-									int nlocal = k*(nx+2)*(ny+2) + j*(nx+2) + i;
-									id[nlocal] = loc_id[nlocal];
-								}
-							}
-						}
+// Checkerboard inlet / outlet layers for the part [lo,lo+n) of the relabeled image
+void Domain::Checkerboard(char *data, const int64_t lo[3], const int64_t n[3], const int64_t start[3], const int64_t end[3], int checkerSize)
+{
+	// x, y, z inlets and then x, y, z outlets (later layers overwrite the corners)
+	int layers[6] = { inlet_layers_x, inlet_layers_y, inlet_layers_z, outlet_layers_x, outlet_layers_y, outlet_layers_z };
+	for (int s=0; s<6; s++){
+		if (layers[s] <= 0) continue;
+		int d = s%3;
+		int64_t a = (s<3) ? start[d] : end[d] - layers[s];
+		int64_t b = (s<3) ? start[d] + layers[s] : end[d];
+		// void checkers are phase 2 at the x and y boundaries
+		char value = 2;
+		if (d==2) value = (s<3) ? inlet_layers_phase : outlet_layers_phase;
+		int64_t first[3] = { 0, 0, 0 }, last[3] = { n[0], n[1], n[2] };
+		first[d] = std::max(a-lo[d],int64_t(0));
+		last[d] = std::min(b-lo[d],n[d]);
+		for (int64_t k=first[2]; k<last[2]; k++){
+			for (int64_t j=first[1]; j<last[1]; j++){
+				for (int64_t i=first[0]; i<last[0]; i++){
+					int64_t g[3] = { lo[0]+i, lo[1]+j, lo[2]+k };
+					if ( (g[(d+1)%3]/checkerSize + g[(d+2)%3]/checkerSize)%2 == 0){
+						// void checkers
+						data[k*n[0]*n[1]+j*n[0]+i] = value;
 					}
 					else{
-						//printf("Sending data to process %i \n", rnk);
-						MPI_Send(loc_id,N,MPI_CHAR,rnk,15,Comm);
+						// solid checkers
+						data[k*n[0]*n[1]+j*n[0]+i] = 0;
 					}
-					// Write the data for this rank data 
-					sprintf(LocalRankFilename,"ID.%05i",rnk+rank_offset);
-					FILE *ID = fopen(LocalRankFilename,"wb");
-					fwrite(loc_id,1,(nx+2)*(ny+2)*(nz+2),ID);
-					fclose(ID);
 				}
 			}
 		}
-
 	}
-	else{
-		// Recieve the subdomain from rank = 0
-		//printf("Ready to recieve data %i at process %i \n", N,rank);
-		MPI_Recv(id,N,MPI_CHAR,0,15,Comm,MPI_STATUS_IGNORE);
+}
+
+void Domain::PrintCheckerboard()
+{
+	if (inlet_layers_x > 0) printf("Checkerboard pattern at x inlet for %i layers \n",inlet_layers_x);
+	if (inlet_layers_y > 0) printf("Checkerboard pattern at y inlet for %i layers \n",inlet_layers_y);
+	if (inlet_layers_z > 0) printf("Checkerboard pattern at z inlet for %i layers \n",inlet_layers_z);
+	if (outlet_layers_x > 0) printf("Checkerboard pattern at x outlet for %i layers \n",outlet_layers_x);
+	if (outlet_layers_y > 0) printf("Checkerboard pattern at y outlet for %i layers \n",outlet_layers_y);
+	if (outlet_layers_z > 0) printf("Checkerboard pattern at z outlet for %i layers \n",outlet_layers_z);
+}
+
+void Domain::PrintSlabs(double uniform, double weighted)
+{
+	printf("Weighted decomposition: slabs x =");
+	for (int p=0; p<=nprocx(); p++) printf(" %i",slab_x[p]);
+	printf(", y =");
+	for (int p=0; p<=nprocy(); p++) printf(" %i",slab_y[p]);
+	printf(", z =");
+	for (int p=0; p<=nprocz(); p++) printf(" %i",slab_z[p]);
+	printf("\n");
+	printf("Load imbalance (max / mean pore voxels per rank): uniform %f, weighted %f \n",uniform,weighted);
+}
+
+bool Domain::UniformBlocks() const
+{
+	const std::vector<int> *slabs[3] = { &slab_x, &slab_y, &slab_z };
+	for (int d=0; d<3; d++){
+		int np = slabs[d]->size()-1;
+		for (int p=0; p<=np; p++)
+			if (int64_t((*slabs[d])[p])*np != int64_t(p)*slabs[d]->back()) return false;
 	}
-	MPI_Barrier(Comm);
+	return true;
 }
 
 void Domain::AggregateLabels(char *FILENAME){
@@ -618,9 +874,10 @@ void Domain::AggregateLabels(char *FILENAME){
 	
 	int nprocs = nprocx()*nprocy()*nprocz();
 		
-	int full_nx = npx*(nx-2);
-	int full_ny = npy*(ny-2);
-	int full_nz = npz*(nz-2);
+	// the sub-domains can differ in size (Decomposition = "weighted")
+	int full_nx = slab_x.back();
+	int full_ny = slab_y.back();
+	int full_nz = slab_z.back();
 	int local_size = (nx-2)*(ny-2)*(nz-2);
 	long int full_size = long(full_nx)*long(full_ny)*long(full_nz);
 	
@@ -652,7 +909,7 @@ void Domain::AggregateLabels(char *FILENAME){
 					int y = j-1;
 					int z = k-1;
 					int n_local = (k-1)*(nx-2)*(ny-2) + (j-1)*(nx-2) + i-1;
-					int n_full = z*full_nx*full_ny + y*full_nx + x;
+					long int n_full = long(z)*full_nx*full_ny + long(y)*full_nx + x;
 					FullID[n_full] = LocalID[n_local];
 				}
 			}
@@ -663,17 +920,21 @@ void Domain::AggregateLabels(char *FILENAME){
 			ipy = (rnk - ipz*npx*npy) / npx;
 			ipx = (rnk - ipz*npx*npy - ipy*npx); 
 			//printf("ipx=%i ipy=%i ipz=%i\n", ipx, ipy, ipz);
+			int rnx = slab_x[ipx+1]-slab_x[ipx];
+			int rny = slab_y[ipy+1]-slab_y[ipy];
+			int rnz = slab_z[ipz+1]-slab_z[ipz];
+			std::vector<signed char> RecvID(rnx*rny*rnz);
 			int tag = 15+rnk;
-			MPI_Recv(LocalID,local_size,MPI_CHAR,rnk,tag,Comm,MPI_STATUS_IGNORE);
-			for (int k=1; k<nz-1; k++){
-				for (int j=1; j<ny-1; j++){
-					for (int i=1; i<nx-1; i++){
-						int x = i-1 + ipx*(nx-2);
-						int y = j-1 + ipy*(ny-2);
-						int z = k-1 + ipz*(nz-2);
-						int n_local = (k-1)*(nx-2)*(ny-2) + (j-1)*(nx-2) + i-1;
-						int n_full = z*full_nx*full_ny + y*full_nx + x;
-						FullID[n_full] = LocalID[n_local];
+			MPI_Recv(RecvID.data(),rnx*rny*rnz,MPI_CHAR,rnk,tag,Comm,MPI_STATUS_IGNORE);
+			for (int k=0; k<rnz; k++){
+				for (int j=0; j<rny; j++){
+					for (int i=0; i<rnx; i++){
+						int x = i + slab_x[ipx];
+						int y = j + slab_y[ipy];
+						int z = k + slab_z[ipz];
+						int n_local = k*rnx*rny + j*rnx + i;
+						long int n_full = long(z)*full_nx*full_ny + long(y)*full_nx + x;
+						FullID[n_full] = RecvID[n_local];
 					}
 				}
 			}
@@ -914,24 +1175,24 @@ void Domain::CommInit()
 	MPI_Waitall(18,req1,stat1);
 	MPI_Waitall(18,req2,stat2);
 	//......................................................................................
-	for (int idx=0; idx<recvCount_x; idx++)    recvList_x[idx] -= (Nx-2);
-	for (int idx=0; idx<recvCount_X; idx++)    recvList_X[idx] += (Nx-2);
-	for (int idx=0; idx<recvCount_y; idx++)    recvList_y[idx] -= (Ny-2)*Nx;
-	for (int idx=0; idx<recvCount_Y; idx++)    recvList_Y[idx] += (Ny-2)*Nx;
-	for (int idx=0; idx<recvCount_z; idx++)    recvList_z[idx] -= (Nz-2)*Nx*Ny;
-	for (int idx=0; idx<recvCount_Z; idx++)    recvList_Z[idx] += (Nz-2)*Nx*Ny;
-	for (int idx=0; idx<recvCount_xy; idx++)    recvList_xy[idx] -= (Nx-2)+(Ny-2)*Nx;
-	for (int idx=0; idx<recvCount_XY; idx++)    recvList_XY[idx] += (Nx-2)+(Ny-2)*Nx;
-	for (int idx=0; idx<recvCount_xY; idx++)    recvList_xY[idx] -= (Nx-2)-(Ny-2)*Nx;
-	for (int idx=0; idx<recvCount_Xy; idx++)    recvList_Xy[idx] += (Nx-2)-(Ny-2)*Nx;
-	for (int idx=0; idx<recvCount_xz; idx++)    recvList_xz[idx] -= (Nx-2)+(Nz-2)*Nx*Ny;
-	for (int idx=0; idx<recvCount_XZ; idx++)    recvList_XZ[idx] += (Nx-2)+(Nz-2)*Nx*Ny;
-	for (int idx=0; idx<recvCount_xZ; idx++)    recvList_xZ[idx] -= (Nx-2)-(Nz-2)*Nx*Ny;
-	for (int idx=0; idx<recvCount_Xz; idx++)    recvList_Xz[idx] += (Nx-2)-(Nz-2)*Nx*Ny;
-	for (int idx=0; idx<recvCount_yz; idx++)    recvList_yz[idx] -= (Ny-2)*Nx + (Nz-2)*Nx*Ny;
-	for (int idx=0; idx<recvCount_YZ; idx++)    recvList_YZ[idx] += (Ny-2)*Nx + (Nz-2)*Nx*Ny;
-	for (int idx=0; idx<recvCount_yZ; idx++)    recvList_yZ[idx] -= (Ny-2)*Nx - (Nz-2)*Nx*Ny;
-	for (int idx=0; idx<recvCount_Yz; idx++)    recvList_Yz[idx] += (Ny-2)*Nx - (Nz-2)*Nx*Ny;
+	MapRecvList(recvList_x, recvCount_x, -1, 0, 0);
+	MapRecvList(recvList_X, recvCount_X, 1, 0, 0);
+	MapRecvList(recvList_y, recvCount_y, 0, -1, 0);
+	MapRecvList(recvList_Y, recvCount_Y, 0, 1, 0);
+	MapRecvList(recvList_z, recvCount_z, 0, 0, -1);
+	MapRecvList(recvList_Z, recvCount_Z, 0, 0, 1);
+	MapRecvList(recvList_xy, recvCount_xy, -1, -1, 0);
+	MapRecvList(recvList_XY, recvCount_XY, 1, 1, 0);
+	MapRecvList(recvList_xY, recvCount_xY, -1, 1, 0);
+	MapRecvList(recvList_Xy, recvCount_Xy, 1, -1, 0);
+	MapRecvList(recvList_xz, recvCount_xz, -1, 0, -1);
+	MapRecvList(recvList_XZ, recvCount_XZ, 1, 0, 1);
+	MapRecvList(recvList_xZ, recvCount_xZ, -1, 0, 1);
+	MapRecvList(recvList_Xz, recvCount_Xz, 1, 0, -1);
+	MapRecvList(recvList_yz, recvCount_yz, 0, -1, -1);
+	MapRecvList(recvList_YZ, recvCount_YZ, 0, 1, 1);
+	MapRecvList(recvList_yZ, recvCount_yZ, 0, -1, 1);
+	MapRecvList(recvList_Yz, recvCount_Yz, 0, 1, -1);
 	//......................................................................................
 	// allocate recv buffers
 	recvBuf_x = new int [recvCount_x];
@@ -1080,83 +1341,65 @@ int Domain::PoreCount(){
 
 void Domain::CommunicateMeshHalo(DoubleArray &Mesh)
 {
-	int sendtag, recvtag;
-	sendtag = recvtag = 7;
-	double *MeshData = Mesh.data();
-	PackMeshData(sendList_x, sendCount_x ,sendData_x, MeshData);
-	PackMeshData(sendList_X, sendCount_X ,sendData_X, MeshData);
-	PackMeshData(sendList_y, sendCount_y ,sendData_y, MeshData);
-	PackMeshData(sendList_Y, sendCount_Y ,sendData_Y, MeshData);
-	PackMeshData(sendList_z, sendCount_z ,sendData_z, MeshData);
-	PackMeshData(sendList_Z, sendCount_Z ,sendData_Z, MeshData);
-	PackMeshData(sendList_xy, sendCount_xy ,sendData_xy, MeshData);
-	PackMeshData(sendList_Xy, sendCount_Xy ,sendData_Xy, MeshData);
-	PackMeshData(sendList_xY, sendCount_xY ,sendData_xY, MeshData);
-	PackMeshData(sendList_XY, sendCount_XY ,sendData_XY, MeshData);
-	PackMeshData(sendList_xz, sendCount_xz ,sendData_xz, MeshData);
-	PackMeshData(sendList_Xz, sendCount_Xz ,sendData_Xz, MeshData);
-	PackMeshData(sendList_xZ, sendCount_xZ ,sendData_xZ, MeshData);
-	PackMeshData(sendList_XZ, sendCount_XZ ,sendData_XZ, MeshData);
-	PackMeshData(sendList_yz, sendCount_yz ,sendData_yz, MeshData);
-	PackMeshData(sendList_Yz, sendCount_Yz ,sendData_Yz, MeshData);
-	PackMeshData(sendList_yZ, sendCount_yZ ,sendData_yZ, MeshData);
-	PackMeshData(sendList_YZ, sendCount_YZ ,sendData_YZ, MeshData);
+	std::vector<DoubleArray*> list(1,&Mesh);
+	CommunicateMeshHalo(list);
+}
+
+void Domain::CommunicateMeshHalo(const std::vector<DoubleArray*>& Mesh)
+{
+	// Message i is sent in direction send*[i] and received from direction recv*[i]
+	// (the same pairing and tags as CommInit).  The values of all the arrays
+	// for a neighbor are packed into one message (array by array).
+	const int tag = 7;
+	const int N = Mesh.size();
+	if ( N == 0 )
+		return;
+	for (int m=0; m<N; m++)
+		ASSERT( (int) Mesh[m]->length() == Nx*Ny*Nz );
+	int *sendList[18] = { sendList_x, sendList_X, sendList_y, sendList_Y, sendList_z, sendList_Z,
+		sendList_xy, sendList_XY, sendList_Xy, sendList_xY, sendList_xz, sendList_XZ,
+		sendList_Xz, sendList_xZ, sendList_yz, sendList_YZ, sendList_Yz, sendList_yZ };
+	int *recvList[18] = { recvList_X, recvList_x, recvList_Y, recvList_y, recvList_Z, recvList_z,
+		recvList_XY, recvList_xy, recvList_xY, recvList_Xy, recvList_XZ, recvList_xz,
+		recvList_xZ, recvList_Xz, recvList_YZ, recvList_yz, recvList_yZ, recvList_Yz };
+	const int sendCount[18] = { sendCount_x, sendCount_X, sendCount_y, sendCount_Y, sendCount_z, sendCount_Z,
+		sendCount_xy, sendCount_XY, sendCount_Xy, sendCount_xY, sendCount_xz, sendCount_XZ,
+		sendCount_Xz, sendCount_xZ, sendCount_yz, sendCount_YZ, sendCount_Yz, sendCount_yZ };
+	const int recvCount[18] = { recvCount_X, recvCount_x, recvCount_Y, recvCount_y, recvCount_Z, recvCount_z,
+		recvCount_XY, recvCount_xy, recvCount_xY, recvCount_Xy, recvCount_XZ, recvCount_xz,
+		recvCount_xZ, recvCount_Xz, recvCount_YZ, recvCount_yz, recvCount_yZ, recvCount_Yz };
+	const int sendRank[18] = { rank_x(), rank_X(), rank_y(), rank_Y(), rank_z(), rank_Z(),
+		rank_xy(), rank_XY(), rank_Xy(), rank_xY(), rank_xz(), rank_XZ(),
+		rank_Xz(), rank_xZ(), rank_yz(), rank_YZ(), rank_Yz(), rank_yZ() };
+	const int recvRank[18] = { rank_X(), rank_x(), rank_Y(), rank_y(), rank_Z(), rank_z(),
+		rank_XY(), rank_xy(), rank_xY(), rank_Xy(), rank_XZ(), rank_xz(),
+		rank_xZ(), rank_Xz(), rank_YZ(), rank_yz(), rank_yZ(), rank_Yz() };
+	size_t sendOffset[19], recvOffset[19];
+	sendOffset[0] = recvOffset[0] = 0;
+	for (int i=0; i<18; i++){
+		sendOffset[i+1] = sendOffset[i] + N*sendCount[i];
+		recvOffset[i+1] = recvOffset[i] + N*recvCount[i];
+	}
+	if ( sendMeshData.size() < sendOffset[18] )
+		sendMeshData.resize( sendOffset[18] );
+	if ( recvMeshData.size() < recvOffset[18] )
+		recvMeshData.resize( recvOffset[18] );
 	//......................................................................................
-	MPI_Sendrecv(sendData_x,sendCount_x,MPI_DOUBLE,rank_x(),sendtag,
-			recvData_X,recvCount_X,MPI_DOUBLE,rank_X(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_X,sendCount_X,MPI_DOUBLE,rank_X(),sendtag,
-			recvData_x,recvCount_x,MPI_DOUBLE,rank_x(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_y,sendCount_y,MPI_DOUBLE,rank_y(),sendtag,
-			recvData_Y,recvCount_Y,MPI_DOUBLE,rank_Y(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_Y,sendCount_Y,MPI_DOUBLE,rank_Y(),sendtag,
-			recvData_y,recvCount_y,MPI_DOUBLE,rank_y(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_z,sendCount_z,MPI_DOUBLE,rank_z(),sendtag,
-			recvData_Z,recvCount_Z,MPI_DOUBLE,rank_Z(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_Z,sendCount_Z,MPI_DOUBLE,rank_Z(),sendtag,
-			recvData_z,recvCount_z,MPI_DOUBLE,rank_z(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_xy,sendCount_xy,MPI_DOUBLE,rank_xy(),sendtag,
-			recvData_XY,recvCount_XY,MPI_DOUBLE,rank_XY(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_XY,sendCount_XY,MPI_DOUBLE,rank_XY(),sendtag,
-			recvData_xy,recvCount_xy,MPI_DOUBLE,rank_xy(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_Xy,sendCount_Xy,MPI_DOUBLE,rank_Xy(),sendtag,
-			recvData_xY,recvCount_xY,MPI_DOUBLE,rank_xY(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_xY,sendCount_xY,MPI_DOUBLE,rank_xY(),sendtag,
-			recvData_Xy,recvCount_Xy,MPI_DOUBLE,rank_Xy(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_xz,sendCount_xz,MPI_DOUBLE,rank_xz(),sendtag,
-			recvData_XZ,recvCount_XZ,MPI_DOUBLE,rank_XZ(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_XZ,sendCount_XZ,MPI_DOUBLE,rank_XZ(),sendtag,
-			recvData_xz,recvCount_xz,MPI_DOUBLE,rank_xz(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_Xz,sendCount_Xz,MPI_DOUBLE,rank_Xz(),sendtag,
-			recvData_xZ,recvCount_xZ,MPI_DOUBLE,rank_xZ(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_xZ,sendCount_xZ,MPI_DOUBLE,rank_xZ(),sendtag,
-			recvData_Xz,recvCount_Xz,MPI_DOUBLE,rank_Xz(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_yz,sendCount_yz,MPI_DOUBLE,rank_yz(),sendtag,
-			recvData_YZ,recvCount_YZ,MPI_DOUBLE,rank_YZ(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_YZ,sendCount_YZ,MPI_DOUBLE,rank_YZ(),sendtag,
-			recvData_yz,recvCount_yz,MPI_DOUBLE,rank_yz(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_Yz,sendCount_Yz,MPI_DOUBLE,rank_Yz(),sendtag,
-			recvData_yZ,recvCount_yZ,MPI_DOUBLE,rank_yZ(),recvtag,Comm,MPI_STATUS_IGNORE);
-	MPI_Sendrecv(sendData_yZ,sendCount_yZ,MPI_DOUBLE,rank_yZ(),sendtag,
-			recvData_Yz,recvCount_Yz,MPI_DOUBLE,rank_Yz(),recvtag,Comm,MPI_STATUS_IGNORE);
-	//........................................................................................
-	UnpackMeshData(recvList_x, recvCount_x ,recvData_x, MeshData);
-	UnpackMeshData(recvList_X, recvCount_X ,recvData_X, MeshData);
-	UnpackMeshData(recvList_y, recvCount_y ,recvData_y, MeshData);
-	UnpackMeshData(recvList_Y, recvCount_Y ,recvData_Y, MeshData);
-	UnpackMeshData(recvList_z, recvCount_z ,recvData_z, MeshData);
-	UnpackMeshData(recvList_Z, recvCount_Z ,recvData_Z, MeshData);
-	UnpackMeshData(recvList_xy, recvCount_xy ,recvData_xy, MeshData);
-	UnpackMeshData(recvList_Xy, recvCount_Xy ,recvData_Xy, MeshData);
-	UnpackMeshData(recvList_xY, recvCount_xY ,recvData_xY, MeshData);
-	UnpackMeshData(recvList_XY, recvCount_XY ,recvData_XY, MeshData);
-	UnpackMeshData(recvList_xz, recvCount_xz ,recvData_xz, MeshData);
-	UnpackMeshData(recvList_Xz, recvCount_Xz ,recvData_Xz, MeshData);
-	UnpackMeshData(recvList_xZ, recvCount_xZ ,recvData_xZ, MeshData);
-	UnpackMeshData(recvList_XZ, recvCount_XZ ,recvData_XZ, MeshData);
-	UnpackMeshData(recvList_yz, recvCount_yz ,recvData_yz, MeshData);
-	UnpackMeshData(recvList_Yz, recvCount_Yz ,recvData_Yz, MeshData);
-	UnpackMeshData(recvList_yZ, recvCount_yZ ,recvData_yZ, MeshData);
-	UnpackMeshData(recvList_YZ, recvCount_YZ ,recvData_YZ, MeshData);
+	for (int i=0; i<18; i++){
+		MPI_Irecv(&recvMeshData[recvOffset[i]],N*recvCount[i],MPI_DOUBLE,recvRank[i],tag+i,Comm,&req2[i]);
+	}
+	for (int i=0; i<18; i++){
+		for (int m=0; m<N; m++)
+			PackMeshData(sendList[i], sendCount[i], &sendMeshData[sendOffset[i]+m*sendCount[i]], Mesh[m]->data());
+		MPI_Isend(&sendMeshData[sendOffset[i]],N*sendCount[i],MPI_DOUBLE,sendRank[i],tag+i,Comm,&req1[i]);
+	}
+	//......................................................................................
+	MPI_Waitall(18,req2,stat2);
+	for (int i=0; i<18; i++){
+		for (int m=0; m<N; m++)
+			UnpackMeshData(recvList[i], recvCount[i], &recvMeshData[recvOffset[i]+m*recvCount[i]], Mesh[m]->data());
+	}
+	MPI_Waitall(18,req1,stat1);
 }
 
 // Ideally stuff below here should be moved somewhere else -- doesn't really belong here
@@ -1198,6 +1441,198 @@ void ReadCheckpoint(char *FILENAME, double *cPhi, double *cfq, int Np)
     File.close();
 }
 
+/********************************************************
+ * Shared restart file                                   *
+ ********************************************************/
+// The file holds a header { version, nprocs, global Nx, Ny, Nz, number of sites } (int64),
+//   the number of sites written by each rank (int64 x nprocs) and one record per site in rank order:
+//   { global site index (int64), Den[2], fq[19] }; the global index lets any decomposition read the file
+static const int RESTART_VERSION = 1;
+static const int RESTART_RECORD = 22;
+
+// Global index (interior coordinates) and compact index of the sites in the layout, in ijk order
+static void RestartSites(const Domain &Dm, const IntArray &Map, std::vector<int64_t> &gid, std::vector<int> &idx)
+{
+	int64_t gx = Dm.slab_x.back();
+	int64_t gy = Dm.slab_y.back();
+	int64_t ox = Dm.slab_x[Dm.iproc()];
+	int64_t oy = Dm.slab_y[Dm.jproc()];
+	int64_t oz = Dm.slab_z[Dm.kproc()];
+	for (int k=1; k<Dm.Nz-1; k++){
+		for (int j=1; j<Dm.Ny-1; j++){
+			for (int i=1; i<Dm.Nx-1; i++){
+				int n = Map(i,j,k);
+				if (n < 0) continue;
+				gid.push_back(((oz+k-1)*gy + oy+j-1)*gx + ox+i-1);
+				idx.push_back(n);
+			}
+		}
+	}
+}
+
+void WriteRestartFile(const char *FILENAME, MPI_Comm comm, const Domain &Dm, const IntArray &Map, const double *cDen, const double *cfq, int Np)
+{
+	int rank, nprocs;
+	MPI_Comm_rank(comm,&rank);
+	MPI_Comm_size(comm,&nprocs);
+	std::vector<int64_t> gid;
+	std::vector<int> idx;
+	RestartSites(Dm,Map,gid,idx);
+	int64_t count = gid.size();
+	std::vector<int64_t> counts(nprocs);
+	MPI_Allgather(&count,1,MPI_INT64_T,counts.data(),1,MPI_INT64_T,comm);
+	int64_t first = 0, total = 0;
+	for (int p=0; p<nprocs; p++){
+		if (p < rank) first += counts[p];
+		total += counts[p];
+	}
+	// pack the records for this rank
+	std::vector<double> buf(RESTART_RECORD*count);
+	for (int64_t s=0; s<count; s++){
+		double *record = &buf[RESTART_RECORD*s];
+		int n = idx[s];
+		memcpy(record,&gid[s],sizeof(int64_t));
+		record[1] = cDen[n];
+		record[2] = cDen[Np+n];
+		for (int q=0; q<19; q++) record[3+q] = cfq[q*Np+n];
+	}
+	MPI_Datatype recordtype;
+	MPI_Type_contiguous(RESTART_RECORD,MPI_DOUBLE,&recordtype);
+	MPI_Type_commit(&recordtype);
+	MPI_File fh;
+	int err = MPI_File_open(comm,(char*) FILENAME,MPI_MODE_WRONLY|MPI_MODE_CREATE,MPI_INFO_NULL,&fh);
+	if (err != MPI_SUCCESS) ERROR("WriteRestartFile: unable to open restart file");
+	MPI_File_set_size(fh,0);
+	if (rank == 0){
+		int64_t header[6] = { RESTART_VERSION, nprocs, Dm.slab_x.back(), Dm.slab_y.back(), Dm.slab_z.back(), total };
+		MPI_File_write_at(fh,0,header,6,MPI_INT64_T,MPI_STATUS_IGNORE);
+		MPI_File_write_at(fh,6*sizeof(int64_t),counts.data(),nprocs,MPI_INT64_T,MPI_STATUS_IGNORE);
+	}
+	MPI_Offset offset = (6+nprocs)*sizeof(int64_t) + first*RESTART_RECORD*sizeof(double);
+	MPI_File_write_at_all(fh,offset,buf.data(),count,recordtype,MPI_STATUS_IGNORE);
+	MPI_File_close(&fh);
+	MPI_Type_free(&recordtype);
+}
+
+void ReadRestartFile(const char *FILENAME, MPI_Comm comm, const Domain &Dm, const IntArray &Map, double *cDen, double *cfq, int Np)
+{
+	int rank, nprocs;
+	MPI_Comm_rank(comm,&rank);
+	MPI_Comm_size(comm,&nprocs);
+	std::vector<int64_t> gid;
+	std::vector<int> idx;
+	RestartSites(Dm,Map,gid,idx);
+	int64_t count = gid.size();
+	MPI_Datatype recordtype;
+	MPI_Type_contiguous(RESTART_RECORD,MPI_DOUBLE,&recordtype);
+	MPI_Type_commit(&recordtype);
+	MPI_File fh;
+	int err = MPI_File_open(comm,(char*) FILENAME,MPI_MODE_RDONLY,MPI_INFO_NULL,&fh);
+	if (err != MPI_SUCCESS) ERROR("ReadRestartFile: unable to open restart file");
+	int64_t header[6];
+	MPI_File_read_at_all(fh,0,header,6,MPI_INT64_T,MPI_STATUS_IGNORE);
+	if (header[0] != RESTART_VERSION) ERROR("ReadRestartFile: not a restart file");
+	if (header[2] != Dm.slab_x.back() || header[3] != Dm.slab_y.back() || header[4] != Dm.slab_z.back())
+		ERROR("ReadRestartFile: domain size does not match the restart file");
+	int file_nprocs = header[1];
+	int64_t total = header[5];
+	std::vector<int64_t> counts(file_nprocs);
+	MPI_File_read_at_all(fh,6*sizeof(int64_t),counts.data(),file_nprocs,MPI_INT64_T,MPI_STATUS_IGNORE);
+	MPI_Offset base = (6+file_nprocs)*sizeof(int64_t);
+
+	// Same decomposition: each rank reads its own block of records
+	std::vector<double> buf;
+	int same = (file_nprocs == nprocs && counts[rank] == count) ? 1 : 0;
+	MPI_Allreduce(MPI_IN_PLACE,&same,1,MPI_INT,MPI_MIN,comm);
+	if (same){
+		int64_t first = 0;
+		for (int p=0; p<rank; p++) first += counts[p];
+		buf.resize(RESTART_RECORD*count);
+		MPI_File_read_at_all(fh,base+first*RESTART_RECORD*sizeof(double),buf.data(),count,recordtype,MPI_STATUS_IGNORE);
+		for (int64_t s=0; s<count; s++){
+			int64_t g;
+			memcpy(&g,&buf[RESTART_RECORD*s],sizeof(int64_t));
+			if (g != gid[s]) same = 0;
+		}
+		MPI_Allreduce(MPI_IN_PLACE,&same,1,MPI_INT,MPI_MIN,comm);
+	}
+	if (!same){
+		// Any other decomposition: read an equal share of the records and send each to the rank that owns the site
+		int64_t lo = total*rank/nprocs;
+		int64_t hi = total*(rank+1)/nprocs;
+		std::vector<double> share(RESTART_RECORD*(hi-lo));
+		MPI_File_read_at_all(fh,base+lo*RESTART_RECORD*sizeof(double),share.data(),hi-lo,recordtype,MPI_STATUS_IGNORE);
+		int64_t gx = Dm.slab_x.back();
+		int64_t gy = Dm.slab_y.back();
+		int npx = Dm.nprocx();
+		int npy = Dm.nprocy();
+		std::vector<int> owner(hi-lo);
+		std::vector<int> sendcount(nprocs,0), recvcount(nprocs,0), senddispl(nprocs,0), recvdispl(nprocs,0);
+		for (int64_t s=0; s<hi-lo; s++){
+			int64_t g;
+			memcpy(&g,&share[RESTART_RECORD*s],sizeof(int64_t));
+			int x = g%gx;
+			int y = (g/gx)%gy;
+			int z = g/(gx*gy);
+			int ip = std::upper_bound(Dm.slab_x.begin(),Dm.slab_x.end(),x) - Dm.slab_x.begin() - 1;
+			int jp = std::upper_bound(Dm.slab_y.begin(),Dm.slab_y.end(),y) - Dm.slab_y.begin() - 1;
+			int kp = std::upper_bound(Dm.slab_z.begin(),Dm.slab_z.end(),z) - Dm.slab_z.begin() - 1;
+			owner[s] = kp*npx*npy + jp*npx + ip;
+			sendcount[owner[s]]++;
+		}
+		MPI_Alltoall(sendcount.data(),1,MPI_INT,recvcount.data(),1,MPI_INT,comm);
+		int64_t received = recvcount[0];
+		for (int p=1; p<nprocs; p++){
+			senddispl[p] = senddispl[p-1] + sendcount[p-1];
+			recvdispl[p] = recvdispl[p-1] + recvcount[p-1];
+			received += recvcount[p];
+		}
+		std::vector<double> sendbuf(share.size());
+		std::vector<int> pos(senddispl);
+		for (int64_t s=0; s<hi-lo; s++){
+			memcpy(&sendbuf[RESTART_RECORD*int64_t(pos[owner[s]]++)],&share[RESTART_RECORD*s],RESTART_RECORD*sizeof(double));
+		}
+		buf.resize(RESTART_RECORD*received);
+		MPI_Alltoallv(sendbuf.data(),sendcount.data(),senddispl.data(),recordtype,
+				buf.data(),recvcount.data(),recvdispl.data(),recordtype,comm);
+		// sort the records into the ijk order of the local sites
+		std::vector<double> local(RESTART_RECORD*count);
+		int64_t ox = Dm.slab_x[Dm.iproc()];
+		int64_t oy = Dm.slab_y[Dm.jproc()];
+		int64_t oz = Dm.slab_z[Dm.kproc()];
+		int nx = Dm.Nx-2;
+		int ny = Dm.Ny-2;
+		std::vector<int64_t> site(int64_t(nx)*ny*(Dm.Nz-2),-1);
+		for (int64_t s=0; s<count; s++){
+			int64_t g = gid[s];
+			site[((g/(gx*gy)-oz)*ny + (g/gx)%gy-oy)*nx + g%gx-ox] = s;
+		}
+		int64_t found = 0;
+		for (int64_t r=0; r<received; r++){
+			int64_t g;
+			memcpy(&g,&buf[RESTART_RECORD*r],sizeof(int64_t));
+			int64_t s = site[((g/(gx*gy)-oz)*ny + (g/gx)%gy-oy)*nx + g%gx-ox];
+			if (s < 0) continue;
+			memcpy(&local[RESTART_RECORD*s],&buf[RESTART_RECORD*r],RESTART_RECORD*sizeof(double));
+			found++;
+		}
+		buf.swap(local);
+		int missing = (found == count) ? 0 : 1;
+		MPI_Allreduce(MPI_IN_PLACE,&missing,1,MPI_INT,MPI_MAX,comm);
+		if (missing) ERROR("ReadRestartFile: restart file does not cover all of the pore sites");
+	}
+	MPI_File_close(&fh);
+	MPI_Type_free(&recordtype);
+	// unpack into the memory optimized layout
+	for (int64_t s=0; s<count; s++){
+		const double *record = &buf[RESTART_RECORD*s];
+		int n = idx[s];
+		cDen[n] = record[1];
+		cDen[Np+n] = record[2];
+		for (int q=0; q<19; q++) cfq[q*Np+n] = record[3+q];
+	}
+}
+
 void ReadBinaryFile(char *FILENAME, double *Data, int N)
 {
   int n;
@@ -24,6 +24,7 @@
 #include <time.h>
 #include <exception>
 #include <stdexcept>
+#include <vector>
 
 #include "common/Array.h"
 #include "common/Utilities.h"
@@ -135,6 +136,12 @@ public: // Public variables (need to create accessors instead)
 
     int BoundaryCondition;
 
+    // First global index (excluding the halo) of the sub-domains along each axis, size nprocx+1 (etc.)
+    //    uniform blocks: slab_x[i] = i*nx; Decomposition = "weighted" balances the pore voxels per slab
+    std::vector<int> slab_x, slab_y, slab_z;
+    //! True if the slabs are the uniform blocks (required by the visualization output)
+    bool UniformBlocks() const;
+
     MPI_Group Group;    // Group of processors associated with this domain
 
     //**********************************
@@ -194,6 +201,8 @@ public: // Public variables (need to create accessors instead)
     void ReadIDs();
     void Decomp(std::string Filename);
     void CommunicateMeshHalo(DoubleArray &Mesh);
+    //! Communicate the halos of several arrays (one message per neighbor)
+    void CommunicateMeshHalo(const std::vector<DoubleArray*>& Mesh);
     void CommInit(); 
     int PoreCount();
     void AggregateLabels(char *FILENAME);
@@ -203,6 +212,13 @@ private:
     void PackID(int *list, int count, signed char *sendbuf, signed char *ID);
     void UnpackID(int *list, int count, signed char *recvbuf, signed char *ID);
     void CommHaloIDs();
+    void SetupSlabs( std::shared_ptr<Database> db );
+    void MapRecvList(int *list, int count, int dx, int dy, int dz);
+    void Checkerboard(char *data, const int64_t lo[3], const int64_t n[3], const int64_t start[3], const int64_t end[3], int checkerSize);
+    void PrintCheckerboard();
+    void PrintSlabs(double uniform, double weighted);
+    // max / mean pore voxels per rank of the uniform and the weighted blocks (zero unless SetupSlabs balanced the slabs)
+    double slab_imbalance[2];
     
 	//......................................................................................
 	MPI_Request req1[18], req2[18];
@@ -222,6 +238,7 @@ private:
     double *recvData_x, *recvData_y, *recvData_z, *recvData_X, *recvData_Y, *recvData_Z;
     double *recvData_xy, *recvData_yz, *recvData_xz, *recvData_Xy, *recvData_Yz, *recvData_xZ;
     double *recvData_xY, *recvData_yZ, *recvData_Xz, *recvData_XY, *recvData_YZ, *recvData_XZ;
+    std::vector<double> sendMeshData, recvMeshData;
 };
 
 
@@ -263,6 +280,12 @@ void WriteCheckpoint(const char *FILENAME, const double *cDen, const double *cfq
 
 void ReadCheckpoint(char *FILENAME, double *cDen, double *cfq, int Np);
 
+// Collective checkpoint of Den (2*Np) and fq (19*Np) in a single shared file; Map is the memory optimized layout
+//    ReadRestartFile accepts files written with any number of processes / decomposition of the same domain
+void WriteRestartFile(const char *FILENAME, MPI_Comm comm, const Domain &Dm, const IntArray &Map, const double *cDen, const double *cfq, int Np);
+
+void ReadRestartFile(const char *FILENAME, MPI_Comm comm, const Domain &Dm, const IntArray &Map, double *cDen, double *cfq, int Np);
+
 void ReadBinaryFile(char *FILENAME, double *Data, int N);
 
 #endif
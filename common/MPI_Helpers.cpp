@@ -147,6 +147,87 @@ void unpack<std::string>( std::string& data, const char *buffer )
 }
 
 
+/********************************************************
+* Reduce many values with one collective per operation  *
+********************************************************/
+static const MPI_Op ReduceSetOps[3] = { MPI_SUM, MPI_MAX, MPI_MIN };
+ReduceSet::ReduceSet( ):
+    d_busy(false)
+{
+}
+ReduceSet::~ReduceSet( )
+{
+    if ( d_busy ) {
+        for (int op=0; op<3; op++) {
+            if ( !d_send[op].empty() )
+                MPI_Wait( &d_request[op], MPI_STATUS_IGNORE );
+        }
+    }
+}
+void ReduceSet::add( Op op, const double *local, double *global, int N )
+{
+    INSIST(!d_busy,"ReduceSet: values added during a reduction");
+    for (int i=0; i<N; i++) {
+        d_local[op].push_back( &local[i] );
+        d_global[op].push_back( &global[i] );
+    }
+}
+void ReduceSet::clear( )
+{
+    INSIST(!d_busy,"ReduceSet: cleared during a reduction");
+    for (int op=0; op<3; op++) {
+        d_local[op].clear();
+        d_global[op].clear();
+    }
+}
+void ReduceSet::pack( )
+{
+    for (int op=0; op<3; op++) {
+        d_send[op].resize( d_local[op].size() );
+        d_recv[op].resize( d_local[op].size() );
+        for (size_t i=0; i<d_local[op].size(); i++)
+            d_send[op][i] = *d_local[op][i];
+    }
+}
+void ReduceSet::unpack( )
+{
+    for (int op=0; op<3; op++) {
+        for (size_t i=0; i<d_global[op].size(); i++)
+            *d_global[op][i] = d_recv[op][i];
+    }
+}
+void ReduceSet::reduce( MPI_Comm comm )
+{
+    INSIST(!d_busy,"ReduceSet: a reduction is already in progress");
+    pack();
+    for (int op=0; op<3; op++) {
+        if ( !d_send[op].empty() )
+            MPI_Allreduce( d_send[op].data(), d_recv[op].data(), d_send[op].size(), MPI_DOUBLE, ReduceSetOps[op], comm );
+    }
+    unpack();
+}
+void ReduceSet::start( MPI_Comm comm )
+{
+    INSIST(!d_busy,"ReduceSet: a reduction is already in progress");
+    pack();
+    for (int op=0; op<3; op++) {
+        if ( !d_send[op].empty() )
+            MPI_Iallreduce( d_send[op].data(), d_recv[op].data(), d_send[op].size(), MPI_DOUBLE, ReduceSetOps[op], comm, &d_request[op] );
+    }
+    d_busy = true;
+}
+void ReduceSet::finish( )
+{
+    INSIST(d_busy,"ReduceSet: no reduction in progress");
+    for (int op=0; op<3; op++) {
+        if ( !d_send[op].empty() )
+            MPI_Wait( &d_request[op], MPI_STATUS_IGNORE );
+    }
+    d_busy = false;
+    unpack();
+}
+
+
 /********************************************************
 * Fake MPI routines                                     *
 ********************************************************/
@@ -220,6 +301,12 @@ int MPI_Allreduce(const void *sendbuf, void *recvbuf, int count,
     ERROR("Not implimented yet");
     return 0;
 }
+int MPI_Iallreduce(const void *sendbuf, void *recvbuf, int count,
+                  MPI_Datatype datatype, MPI_Op op, MPI_Comm comm, MPI_Request *request)
+{
+    ERROR("Not implimented yet");
+    return 0;
+}
 int MPI_Allgather(const void *sendbuf, int sendcount, MPI_Datatype sendtype,
                   void *recvbuf, int recvcount, MPI_Datatype recvtype,
                   MPI_Comm comm)
@@ -63,6 +63,8 @@
               int tag, MPI_Comm comm, MPI_Request *request);
     int MPI_Allreduce(const void *sendbuf, void *recvbuf, int count,
                   MPI_Datatype datatype, MPI_Op op, MPI_Comm comm);
+    int MPI_Iallreduce(const void *sendbuf, void *recvbuf, int count,
+                  MPI_Datatype datatype, MPI_Op op, MPI_Comm comm, MPI_Request *request);
     int MPI_Allgather(const void *sendbuf, int sendcount, MPI_Datatype sendtype,
                   void *recvbuf, int recvcount, MPI_Datatype recvtype,
                   MPI_Comm comm);
@@ -240,6 +242,67 @@ inline int maxReduce( MPI_Comm comm, int x )
 }
 
 
+/*!
+ * @brief  Reduce many values with one collective per operation
+ * @details  The averaging classes add their local accumulators (and where the reduced
+ *    values are stored) to the set.  reduce() packs the local values into one contiguous
+ *    buffer per operation (sum, max, min) and reduces each buffer with a single
+ *    MPI_Allreduce instead of one collective per value.  start() and finish() do the
+ *    same with MPI_Iallreduce: the local values are copied by start(), so the caller
+ *    may change them (or do other work) until finish() stores the reduced values.
+ *    The addresses must stay valid until the reduction is finished.
+ */
+class ReduceSet
+{
+public:
+    enum Op { SUM=0, MAX=1, MIN=2 };
+
+    //!  Empty constructor
+    ReduceSet( );
+
+    //!  Destructor (waits for a reduction in progress)
+    ~ReduceSet( );
+
+    /*!
+     * @brief  Add values to the set
+     * @param[in] op            Reduction operation
+     * @param[in] local         The N local values
+     * @param[out] global       Where the N reduced values are stored
+     * @param[in] N             Number of values
+     */
+    void add( Op op, const double *local, double *global, int N = 1 );
+
+    //!  Remove all values from the set
+    void clear( );
+
+    //!  Number of values in the set for the operation
+    inline size_t size( Op op ) const { return d_local[op].size(); }
+
+    //!  Reduce the values
+    void reduce( MPI_Comm comm );
+
+    //!  Start reducing the values
+    void start( MPI_Comm comm );
+
+    //!  Finish the reduction (started with start) and store the reduced values
+    void finish( );
+
+    //!  Is a reduction in progress
+    inline bool busy() const { return d_busy; }
+
+private:
+    ReduceSet( const ReduceSet& );              // Private copy constructor
+    ReduceSet& operator=( const ReduceSet& );   // Private assignment operator
+    void pack( );
+    void unpack( );
+    std::vector<const double*> d_local[3];
+    std::vector<double*> d_global[3];
+    std::vector<double> d_send[3], d_recv[3];
+    MPI_Request d_request[3];
+    bool d_busy;
+};
+
+
 #endif
 
 
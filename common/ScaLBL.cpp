@@ -14,6 +14,8 @@
   along with OPM.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "common/ScaLBL.h"
+#include <algorithm>
+#include <vector>
 
 ScaLBL_Communicator::ScaLBL_Communicator(std::shared_ptr <Domain> Dm){
 	//......................................................................................
@@ -30,6 +32,23 @@ ScaLBL_Communicator::ScaLBL_Communicator(std::shared_ptr <Domain> Dm){
 	Nz = Dm->Nz;
 	N = Nx*Ny*Nz;
 	next=0;
+	// Ordering of the interior sites for the memory optimized layout
+	SiteOrdering = ORDER_IJK;
+	BrickSize = 4;
+	if (Dm->database){
+		if (Dm->database->keyExists( "SiteOrdering" )){
+			auto ordering = Dm->database->getScalar<std::string>( "SiteOrdering" );
+			if (ordering == "ijk")           SiteOrdering = ORDER_IJK;
+			else if (ordering == "morton")   SiteOrdering = ORDER_MORTON;
+			else if (ordering == "hilbert")  SiteOrdering = ORDER_HILBERT;
+			else if (ordering == "brick")    SiteOrdering = ORDER_BRICK;
+			else ERROR("ScaLBL_Communicator: SiteOrdering must be one of ijk, morton, hilbert, brick \n");
+		}
+		if (Dm->database->keyExists( "BrickSize" )){
+			BrickSize = Dm->database->getScalar<int>( "BrickSize" );
+			if (BrickSize < 1) ERROR("ScaLBL_Communicator: BrickSize must be positive \n");
+		}
+	}
 	rank=Dm->rank();
 	rank_x=Dm->rank_x();
 	rank_y=Dm->rank_y();
@@ -302,6 +321,61 @@ ScaLBL_Communicator::ScaLBL_Communicator(std::shared_ptr <Domain> Dm){
 	D3Q19_MapRecv(0,1,1,Dm->recvList_yz,0,recvCount_yz,dvcRecvDist_yz);
 	//...................................................................................
 
+	//......................................................................................
+	// Neighbor tables for the fused pack / unpack (send order matches the recieve matching order)
+	double *sendbuf_list[18] = {sendbuf_x,sendbuf_X,sendbuf_y,sendbuf_Y,sendbuf_z,sendbuf_Z,
+			sendbuf_xy,sendbuf_Xy,sendbuf_xY,sendbuf_XY,sendbuf_xz,sendbuf_xZ,sendbuf_Xz,sendbuf_XZ,
+			sendbuf_yz,sendbuf_yZ,sendbuf_Yz,sendbuf_YZ};
+	double *recvbuf_list[18] = {recvbuf_x,recvbuf_X,recvbuf_y,recvbuf_Y,recvbuf_z,recvbuf_Z,
+			recvbuf_xy,recvbuf_Xy,recvbuf_xY,recvbuf_XY,recvbuf_xz,recvbuf_xZ,recvbuf_Xz,recvbuf_XZ,
+			recvbuf_yz,recvbuf_yZ,recvbuf_Yz,recvbuf_YZ};
+	int sendcount_list[18] = {sendCount_x,sendCount_X,sendCount_y,sendCount_Y,sendCount_z,sendCount_Z,
+			sendCount_xy,sendCount_Xy,sendCount_xY,sendCount_XY,sendCount_xz,sendCount_xZ,sendCount_Xz,sendCount_XZ,
+			sendCount_yz,sendCount_yZ,sendCount_Yz,sendCount_YZ};
+	int recvcount_list[18] = {recvCount_x,recvCount_X,recvCount_y,recvCount_Y,recvCount_z,recvCount_Z,
+			recvCount_xy,recvCount_Xy,recvCount_xY,recvCount_XY,recvCount_xz,recvCount_xZ,recvCount_Xz,recvCount_XZ,
+			recvCount_yz,recvCount_yZ,recvCount_Yz,recvCount_YZ};
+	int rank_list[18] = {rank_x,rank_X,rank_y,rank_Y,rank_z,rank_Z,
+			rank_xy,rank_Xy,rank_xY,rank_XY,rank_xz,rank_xZ,rank_Xz,rank_XZ,
+			rank_yz,rank_yZ,rank_Yz,rank_YZ};
+	// message sent to neighbor d is recieved (on the other side) into the buffer of its opposite
+	int opposite[18] = {1,0,3,2,5,4,9,8,7,6,13,12,11,10,17,16,15,14};
+	for (int d=0; d<18; d++){
+		nbr_sendbuf[d] = sendbuf_list[d];
+		nbr_recvbuf[d] = recvbuf_list[d];
+		nbr_sendCount[d] = sendcount_list[d];
+		nbr_recvCount[d] = recvcount_list[d];
+		nbr_Q[d] = (d < 6) ? 5 : 1;
+		ScaLBL_AllocateZeroCopy((void **) &dvcPackDist[d], nbr_Q[d]*nbr_sendCount[d]*sizeof(int));
+		ScaLBL_AllocateZeroCopy((void **) &dvcUnpackDist[d], nbr_Q[d]*nbr_recvCount[d]*sizeof(int));
+	}
+	SetupPackLists();
+	// Persistent requests: sends are started in order d, recieves in order opposite[d]
+	for (int d=0; d<18; d++){
+		int r = opposite[d];
+		MPI_Send_init(nbr_sendbuf[d],nbr_Q[d]*nbr_sendCount[d],MPI_DOUBLE,rank_list[d],19,MPI_COMM_SCALBL,&req_D3Q19AA[d]);
+		MPI_Recv_init(nbr_recvbuf[r],nbr_Q[r]*nbr_recvCount[r],MPI_DOUBLE,rank_list[r],19,MPI_COMM_SCALBL,&req_D3Q19AA[18+d]);
+	}
+	for (int d=0; d<6; d++){
+		int r = opposite[d];
+		MPI_Send_init(nbr_sendbuf[d],2*nbr_sendCount[d],MPI_DOUBLE,rank_list[d],14,MPI_COMM_SCALBL,&req_BiD3Q7AA[d]);
+		MPI_Recv_init(nbr_recvbuf[r],2*nbr_recvCount[r],MPI_DOUBLE,rank_list[r],14,MPI_COMM_SCALBL,&req_BiD3Q7AA[6+d]);
+		MPI_Send_init(nbr_sendbuf[d],3*nbr_sendCount[d],MPI_DOUBLE,rank_list[d],15,MPI_COMM_SCALBL,&req_TriD3Q7AA[d]);
+		MPI_Recv_init(nbr_recvbuf[r],3*nbr_recvCount[r],MPI_DOUBLE,rank_list[r],15,MPI_COMM_SCALBL,&req_TriD3Q7AA[6+d]);
+	}
+	// Aggregated D3Q19 + D3Q7 exchange (tag 16)
+	for (int d=0; d<18; d++){
+		int extra = (d < 6) ? 2 : 0;
+		ScaLBL_AllocateZeroCopy((void **) &agg_sendbuf[d], (nbr_Q[d]+extra)*nbr_sendCount[d]*sizeof(double));
+		ScaLBL_AllocateZeroCopy((void **) &agg_recvbuf[d], (nbr_Q[d]+extra)*nbr_recvCount[d]*sizeof(double));
+	}
+	for (int d=0; d<18; d++){
+		int r = opposite[d];
+		int sendsize = (nbr_Q[d] + ((d < 6) ? 2 : 0))*nbr_sendCount[d];
+		int recvsize = (nbr_Q[r] + ((r < 6) ? 2 : 0))*nbr_recvCount[r];
+		MPI_Send_init(agg_sendbuf[d],sendsize,MPI_DOUBLE,rank_list[d],16,MPI_COMM_SCALBL,&req_AggAA[d]);
+		MPI_Recv_init(agg_recvbuf[r],recvsize,MPI_DOUBLE,rank_list[r],16,MPI_COMM_SCALBL,&req_AggAA[18+d]);
+	}
 	//......................................................................................
 	MPI_Barrier(MPI_COMM_SCALBL);
 	ScaLBL_DeviceBarrier();
@@ -325,6 +399,61 @@ ScaLBL_Communicator::ScaLBL_Communicator(std::shared_ptr <Domain> Dm){
 ScaLBL_Communicator::~ScaLBL_Communicator(){
 	// destrutor does nothing (bad idea)
 	// -- note that there needs to be a way to free memory allocated on the device!!!
+	int finalized;
+	MPI_Finalized(&finalized);
+	if (!finalized){
+		for (int i=0; i<36; i++){
+			MPI_Request_free(&req_D3Q19AA[i]);
+			MPI_Request_free(&req_AggAA[i]);
+		}
+		for (int i=0; i<12; i++){
+			MPI_Request_free(&req_BiD3Q7AA[i]);
+			MPI_Request_free(&req_TriD3Q7AA[i]);
+		}
+	}
+}
+
+void ScaLBL_Communicator::SetupPackLists(){
+	// Distributions exchanged with each neighbor (same q for the send and recieve buffers)
+	static const int Q[18][5] = {{2,8,10,12,14},{1,7,9,11,13},{4,8,9,16,18},{3,7,10,15,17},
+			{6,12,13,16,17},{5,11,14,15,18},{8},{9},{10},{7},{12},{14},{13},{11},{16},{18},{17},{15}};
+	int *sendlist[18] = {dvcSendList_x,dvcSendList_X,dvcSendList_y,dvcSendList_Y,dvcSendList_z,dvcSendList_Z,
+			dvcSendList_xy,dvcSendList_Xy,dvcSendList_xY,dvcSendList_XY,dvcSendList_xz,dvcSendList_xZ,
+			dvcSendList_Xz,dvcSendList_XZ,dvcSendList_yz,dvcSendList_yZ,dvcSendList_Yz,dvcSendList_YZ};
+	int *recvdist[18] = {dvcRecvDist_x,dvcRecvDist_X,dvcRecvDist_y,dvcRecvDist_Y,dvcRecvDist_z,dvcRecvDist_Z,
+			dvcRecvDist_xy,dvcRecvDist_Xy,dvcRecvDist_xY,dvcRecvDist_XY,dvcRecvDist_xz,dvcRecvDist_xZ,
+			dvcRecvDist_Xz,dvcRecvDist_XZ,dvcRecvDist_yz,dvcRecvDist_yZ,dvcRecvDist_Yz,dvcRecvDist_YZ};
+	for (int d=0; d<18; d++){
+		int count = nbr_sendCount[d];
+		int *List = new int [count];
+		int *Dist = new int [nbr_Q[d]*count];
+		ScaLBL_CopyToHost(List,sendlist[d],count*sizeof(int));
+		for (int m=0; m<nbr_Q[d]; m++){
+			for (int idx=0; idx<count; idx++) Dist[m*count+idx] = Q[d][m]*N + List[idx];
+		}
+		ScaLBL_CopyToDevice(dvcPackDist[d],Dist,nbr_Q[d]*count*sizeof(int));
+		delete [] List;
+		delete [] Dist;
+
+		count = nbr_recvCount[d];
+		Dist = new int [nbr_Q[d]*count];
+		ScaLBL_CopyToHost(Dist,recvdist[d],nbr_Q[d]*count*sizeof(int));
+		for (int m=0; m<nbr_Q[d]; m++){
+			for (int idx=0; idx<count; idx++){
+				int n = Dist[m*count+idx];
+				Dist[m*count+idx] = (n<0) ? -1 : Q[d][m]*N + n;
+			}
+		}
+		ScaLBL_CopyToDevice(dvcUnpackDist[d],Dist,nbr_Q[d]*count*sizeof(int));
+		delete [] Dist;
+	}
+}
+
+void ScaLBL_Communicator::StartPersistent(MPI_Request *req, int count){
+	// post the recieves (second half) before the sends; MPI_Start is called in order
+	// (rather than MPI_Startall) so that messages to the same rank match as with MPI_Isend
+	for (int i=count; i<2*count; i++) MPI_Start(&req[i]);
+	for (int i=0; i<count; i++) MPI_Start(&req[i]);
 }
 int ScaLBL_Communicator::LastExterior(){
 	return next;
@@ -367,6 +496,65 @@ void ScaLBL_Communicator::D3Q19_MapRecv(int Cqx, int Cqy, int Cqz, int *list,  i
 	delete [] ReturnDist;
 }
 
+unsigned long long ScaLBL_Communicator::SiteKey(int i, int j, int k) const{
+	/*
+	 * Sort key for interior site (i,j,k); interior sites are numbered in increasing key order
+	 *   ORDER_IJK      plain lexicographic order (i fastest)
+	 *   ORDER_MORTON   bit interleaving (Z-order curve)
+	 *   ORDER_HILBERT  3D Hilbert curve (Skilling's transpose algorithm)
+	 *   ORDER_BRICK    BrickSize^3 bricks in lexicographic order, ijk within each brick
+	 */
+	unsigned long long key=0;
+	int bits=1;
+	while ((1<<bits) < std::max(Nx,std::max(Ny,Nz))) bits++;
+
+	if (SiteOrdering == ORDER_MORTON){
+		for (int b=bits-1; b>=0; b--){
+			key = (key<<1) | ((k>>b)&1);
+			key = (key<<1) | ((j>>b)&1);
+			key = (key<<1) | ((i>>b)&1);
+		}
+	}
+	else if (SiteOrdering == ORDER_HILBERT){
+		unsigned int X[3] = {(unsigned int)k, (unsigned int)j, (unsigned int)i};
+		unsigned int M = 1u<<(bits-1);
+		unsigned int P,Q,t;
+		// inverse undo
+		for (Q=M; Q>1; Q>>=1){
+			P=Q-1;
+			for (int d=0; d<3; d++){
+				if (X[d] & Q) X[0] ^= P;
+				else{
+					t = (X[0]^X[d]) & P;
+					X[0] ^= t;
+					X[d] ^= t;
+				}
+			}
+		}
+		// Gray encode
+		for (int d=1; d<3; d++) X[d] ^= X[d-1];
+		t=0;
+		for (Q=M; Q>1; Q>>=1){
+			if (X[2] & Q) t ^= Q-1;
+		}
+		for (int d=0; d<3; d++) X[d] ^= t;
+		// interleave the transposed bits
+		for (int b=bits-1; b>=0; b--){
+			for (int d=0; d<3; d++) key = (key<<1) | ((X[d]>>b)&1);
+		}
+	}
+	else if (SiteOrdering == ORDER_BRICK){
+		unsigned long long nbx = (Nx+BrickSize-1)/BrickSize;
+		unsigned long long nby = (Ny+BrickSize-1)/BrickSize;
+		unsigned long long brick = ((k/BrickSize)*nby + j/BrickSize)*nbx + i/BrickSize;
+		key = brick*BrickSize*BrickSize*BrickSize + ((k%BrickSize)*BrickSize + j%BrickSize)*BrickSize + i%BrickSize;
+	}
+	else{
+		key = (unsigned long long)k*Nx*Ny + j*Nx + i;
+	}
+	return key;
+}
+
 int ScaLBL_Communicator::MemoryOptimizedLayoutAA(IntArray &Map, int *neighborList, signed char *id, int Np){
 	/*
 	 * Generate a memory optimized layout
@@ -424,19 +612,24 @@ int ScaLBL_Communicator::MemoryOptimizedLayoutAA(IntArray &Map, int *neighborLis
 	// align the next read
 	first_interior=(next/16 + 1)*16;
 	idx = first_interior;
-	// Step 2/2: Next loop over the domain interior in block-cyclic fashion
+	// Step 2/2: Next loop over the domain interior in the order set by SiteOrdering
+	std::vector<std::pair<unsigned long long,int> > interior;
 	for (k=2; k<Nz-2; k++){
 		for (j=2; j<Ny-2; j++){
 			for (i=2; i<Nx-2; i++){
 				// Local index (regular layout)
 				n = k*Nx*Ny + j*Nx + i;
 				if (id[n] > 0 ){
-					Map(n) = idx++;
-					//neighborList[idx++] = n; // index of self in regular layout
+					interior.push_back(std::make_pair(SiteKey(i,j,k),n));
 				}
 			}
 		}
 	}
+	if (SiteOrdering != ORDER_IJK) std::sort(interior.begin(),interior.end());
+	for (size_t s=0; s<interior.size(); s++){
+		Map(interior[s].second) = idx++;
+		//neighborList[idx++] = n; // index of self in regular layout
+	}
 	last_interior=idx;
 	
 	Np = (last_interior/16 + 1)*16;
@@ -858,13 +1051,14 @@ int ScaLBL_Communicator::MemoryOptimizedLayoutAA(IntArray &Map, int *neighborLis
 
 	// Reset the value of N to match the dense structure
 	N = Np;
+	SetupPackLists();
 	
 	// Clean up
 	delete [] TempBuffer;
 	return(Np);
 }
 
-void ScaLBL_Communicator::SendD3Q19AA(double *dist){
+void ScaLBL_Communicator::SendD3Q19AA(dist_t *dist){
 
 	// NOTE: the center distribution f0 must NOT be at the start of feven, provide offset to start of f2
 	if (Lock==true){
@@ -873,196 +1067,36 @@ void ScaLBL_Communicator::SendD3Q19AA(double *dist){
 	else{
 		Lock=true;
 	}
-	// assign tag of 19 to D3Q19 communication
-	sendtag = recvtag = 19;
 	ScaLBL_DeviceBarrier();
-	// Pack the distributions
-	//...Packing for x face(2,8,10,12,14)................................
-	ScaLBL_D3Q19_Pack(2,dvcSendList_x,0,sendCount_x,sendbuf_x,dist,N);
-	ScaLBL_D3Q19_Pack(8,dvcSendList_x,sendCount_x,sendCount_x,sendbuf_x,dist,N);
-	ScaLBL_D3Q19_Pack(10,dvcSendList_x,2*sendCount_x,sendCount_x,sendbuf_x,dist,N);
-	ScaLBL_D3Q19_Pack(12,dvcSendList_x,3*sendCount_x,sendCount_x,sendbuf_x,dist,N);
-	ScaLBL_D3Q19_Pack(14,dvcSendList_x,4*sendCount_x,sendCount_x,sendbuf_x,dist,N);
-	
-	MPI_Isend(sendbuf_x, 5*sendCount_x,MPI_DOUBLE,rank_x,sendtag,MPI_COMM_SCALBL,&req1[0]);
-	MPI_Irecv(recvbuf_X, 5*recvCount_X,MPI_DOUBLE,rank_X,recvtag,MPI_COMM_SCALBL,&req2[0]);
-	//...Packing for X face(1,7,9,11,13)................................
-	ScaLBL_D3Q19_Pack(1,dvcSendList_X,0,sendCount_X,sendbuf_X,dist,N);
-	ScaLBL_D3Q19_Pack(7,dvcSendList_X,sendCount_X,sendCount_X,sendbuf_X,dist,N);
-	ScaLBL_D3Q19_Pack(9,dvcSendList_X,2*sendCount_X,sendCount_X,sendbuf_X,dist,N);
-	ScaLBL_D3Q19_Pack(11,dvcSendList_X,3*sendCount_X,sendCount_X,sendbuf_X,dist,N);
-	ScaLBL_D3Q19_Pack(13,dvcSendList_X,4*sendCount_X,sendCount_X,sendbuf_X,dist,N);
-	
-	MPI_Isend(sendbuf_X, 5*sendCount_X,MPI_DOUBLE,rank_X,sendtag,MPI_COMM_SCALBL,&req1[1]);
-	MPI_Irecv(recvbuf_x, 5*recvCount_x,MPI_DOUBLE,rank_x,recvtag,MPI_COMM_SCALBL,&req2[1]);
-	//...Packing for y face(4,8,9,16,18).................................
-	ScaLBL_D3Q19_Pack(4,dvcSendList_y,0,sendCount_y,sendbuf_y,dist,N);
-	ScaLBL_D3Q19_Pack(8,dvcSendList_y,sendCount_y,sendCount_y,sendbuf_y,dist,N);
-	ScaLBL_D3Q19_Pack(9,dvcSendList_y,2*sendCount_y,sendCount_y,sendbuf_y,dist,N);
-	ScaLBL_D3Q19_Pack(16,dvcSendList_y,3*sendCount_y,sendCount_y,sendbuf_y,dist,N);
-	ScaLBL_D3Q19_Pack(18,dvcSendList_y,4*sendCount_y,sendCount_y,sendbuf_y,dist,N);
-	
-	MPI_Isend(sendbuf_y, 5*sendCount_y,MPI_DOUBLE,rank_y,sendtag,MPI_COMM_SCALBL,&req1[2]);
-	MPI_Irecv(recvbuf_Y, 5*recvCount_Y,MPI_DOUBLE,rank_Y,recvtag,MPI_COMM_SCALBL,&req2[2]);
-	//...Packing for Y face(3,7,10,15,17).................................
-	ScaLBL_D3Q19_Pack(3,dvcSendList_Y,0,sendCount_Y,sendbuf_Y,dist,N);
-	ScaLBL_D3Q19_Pack(7,dvcSendList_Y,sendCount_Y,sendCount_Y,sendbuf_Y,dist,N);
-	ScaLBL_D3Q19_Pack(10,dvcSendList_Y,2*sendCount_Y,sendCount_Y,sendbuf_Y,dist,N);
-	ScaLBL_D3Q19_Pack(15,dvcSendList_Y,3*sendCount_Y,sendCount_Y,sendbuf_Y,dist,N);
-	ScaLBL_D3Q19_Pack(17,dvcSendList_Y,4*sendCount_Y,sendCount_Y,sendbuf_Y,dist,N);
-	
-	MPI_Isend(sendbuf_Y, 5*sendCount_Y,MPI_DOUBLE,rank_Y,sendtag,MPI_COMM_SCALBL,&req1[3]);
-	MPI_Irecv(recvbuf_y, 5*recvCount_y,MPI_DOUBLE,rank_y,recvtag,MPI_COMM_SCALBL,&req2[3]);
-	//...Packing for z face(6,12,13,16,17)................................
-	ScaLBL_D3Q19_Pack(6,dvcSendList_z,0,sendCount_z,sendbuf_z,dist,N);
-	ScaLBL_D3Q19_Pack(12,dvcSendList_z,sendCount_z,sendCount_z,sendbuf_z,dist,N);
-	ScaLBL_D3Q19_Pack(13,dvcSendList_z,2*sendCount_z,sendCount_z,sendbuf_z,dist,N);
-	ScaLBL_D3Q19_Pack(16,dvcSendList_z,3*sendCount_z,sendCount_z,sendbuf_z,dist,N);
-	ScaLBL_D3Q19_Pack(17,dvcSendList_z,4*sendCount_z,sendCount_z,sendbuf_z,dist,N);
-	
-	MPI_Isend(sendbuf_z, 5*sendCount_z,MPI_DOUBLE,rank_z,sendtag,MPI_COMM_SCALBL,&req1[4]);
-	MPI_Irecv(recvbuf_Z, 5*recvCount_Z,MPI_DOUBLE,rank_Z,recvtag,MPI_COMM_SCALBL,&req2[4]);
-	
-	//...Packing for Z face(5,11,14,15,18)................................
-	ScaLBL_D3Q19_Pack(5,dvcSendList_Z,0,sendCount_Z,sendbuf_Z,dist,N);
-	ScaLBL_D3Q19_Pack(11,dvcSendList_Z,sendCount_Z,sendCount_Z,sendbuf_Z,dist,N);
-	ScaLBL_D3Q19_Pack(14,dvcSendList_Z,2*sendCount_Z,sendCount_Z,sendbuf_Z,dist,N);
-	ScaLBL_D3Q19_Pack(15,dvcSendList_Z,3*sendCount_Z,sendCount_Z,sendbuf_Z,dist,N);
-	ScaLBL_D3Q19_Pack(18,dvcSendList_Z,4*sendCount_Z,sendCount_Z,sendbuf_Z,dist,N);
-	
-	MPI_Isend(sendbuf_Z, 5*sendCount_Z,MPI_DOUBLE,rank_Z,sendtag,MPI_COMM_SCALBL,&req1[5]);
-	MPI_Irecv(recvbuf_z, 5*recvCount_z,MPI_DOUBLE,rank_z,recvtag,MPI_COMM_SCALBL,&req2[5]);
-	
-	//...Pack the xy edge (8)................................
-	ScaLBL_D3Q19_Pack(8,dvcSendList_xy,0,sendCount_xy,sendbuf_xy,dist,N);
-	MPI_Isend(sendbuf_xy, sendCount_xy,MPI_DOUBLE,rank_xy,sendtag,MPI_COMM_SCALBL,&req1[6]);
-	MPI_Irecv(recvbuf_XY, recvCount_XY,MPI_DOUBLE,rank_XY,recvtag,MPI_COMM_SCALBL,&req2[6]);
-	//...Pack the Xy edge (9)................................
-	ScaLBL_D3Q19_Pack(9,dvcSendList_Xy,0,sendCount_Xy,sendbuf_Xy,dist,N);
-	MPI_Isend(sendbuf_Xy, sendCount_Xy,MPI_DOUBLE,rank_Xy,sendtag,MPI_COMM_SCALBL,&req1[8]);
-	MPI_Irecv(recvbuf_xY, recvCount_xY,MPI_DOUBLE,rank_xY,recvtag,MPI_COMM_SCALBL,&req2[8]);
-	//...Pack the xY edge (10)................................
-	ScaLBL_D3Q19_Pack(10,dvcSendList_xY,0,sendCount_xY,sendbuf_xY,dist,N);
-	MPI_Isend(sendbuf_xY, sendCount_xY,MPI_DOUBLE,rank_xY,sendtag,MPI_COMM_SCALBL,&req1[9]);
-	MPI_Irecv(recvbuf_Xy, recvCount_Xy,MPI_DOUBLE,rank_Xy,recvtag,MPI_COMM_SCALBL,&req2[9]);
-	//...Pack the XY edge (7)................................
-	ScaLBL_D3Q19_Pack(7,dvcSendList_XY,0,sendCount_XY,sendbuf_XY,dist,N);
-	MPI_Isend(sendbuf_XY, sendCount_XY,MPI_DOUBLE,rank_XY,sendtag,MPI_COMM_SCALBL,&req1[7]);
-	MPI_Irecv(recvbuf_xy, recvCount_xy,MPI_DOUBLE,rank_xy,recvtag,MPI_COMM_SCALBL,&req2[7]);
-	//...Pack the xz edge (12)................................
-	ScaLBL_D3Q19_Pack(12,dvcSendList_xz,0,sendCount_xz,sendbuf_xz,dist,N);
-	MPI_Isend(sendbuf_xz, sendCount_xz,MPI_DOUBLE,rank_xz,sendtag,MPI_COMM_SCALBL,&req1[10]);
-	MPI_Irecv(recvbuf_XZ, recvCount_XZ,MPI_DOUBLE,rank_XZ,recvtag,MPI_COMM_SCALBL,&req2[10]);
-	//...Pack the xZ edge (14)................................
-	ScaLBL_D3Q19_Pack(14,dvcSendList_xZ,0,sendCount_xZ,sendbuf_xZ,dist,N);
-	MPI_Isend(sendbuf_xZ, sendCount_xZ,MPI_DOUBLE,rank_xZ,sendtag,MPI_COMM_SCALBL,&req1[13]);
-	MPI_Irecv(recvbuf_Xz, recvCount_Xz,MPI_DOUBLE,rank_Xz,recvtag,MPI_COMM_SCALBL,&req2[13]);
-	//...Pack the Xz edge (13)................................
-	ScaLBL_D3Q19_Pack(13,dvcSendList_Xz,0,sendCount_Xz,sendbuf_Xz,dist,N);
-	MPI_Isend(sendbuf_Xz, sendCount_Xz,MPI_DOUBLE,rank_Xz,sendtag,MPI_COMM_SCALBL,&req1[12]);
-	MPI_Irecv(recvbuf_xZ, recvCount_xZ,MPI_DOUBLE,rank_xZ,recvtag,MPI_COMM_SCALBL,&req2[12]);
-	//...Pack the XZ edge (11)................................
-	ScaLBL_D3Q19_Pack(11,dvcSendList_XZ,0,sendCount_XZ,sendbuf_XZ,dist,N);
-	MPI_Isend(sendbuf_XZ, sendCount_XZ,MPI_DOUBLE,rank_XZ,sendtag,MPI_COMM_SCALBL,&req1[11]);
-	MPI_Irecv(recvbuf_xz, recvCount_xz,MPI_DOUBLE,rank_xz,recvtag,MPI_COMM_SCALBL,&req2[11]);
-	//...Pack the yz edge (16)................................
-	ScaLBL_D3Q19_Pack(16,dvcSendList_yz,0,sendCount_yz,sendbuf_yz,dist,N);
-	MPI_Isend(sendbuf_yz, sendCount_yz,MPI_DOUBLE,rank_yz,sendtag,MPI_COMM_SCALBL,&req1[14]);
-	MPI_Irecv(recvbuf_YZ, recvCount_YZ,MPI_DOUBLE,rank_YZ,recvtag,MPI_COMM_SCALBL,&req2[14]);
-	//...Pack the yZ edge (18)................................
-	ScaLBL_D3Q19_Pack(18,dvcSendList_yZ,0,sendCount_yZ,sendbuf_yZ,dist,N);
-	MPI_Isend(sendbuf_yZ, sendCount_yZ,MPI_DOUBLE,rank_yZ,sendtag,MPI_COMM_SCALBL,&req1[17]);
-	MPI_Irecv(recvbuf_Yz, recvCount_Yz,MPI_DOUBLE,rank_Yz,recvtag,MPI_COMM_SCALBL,&req2[17]);
-	//...Pack the Yz edge (17)................................
-	ScaLBL_D3Q19_Pack(17,dvcSendList_Yz,0,sendCount_Yz,sendbuf_Yz,dist,N);
-	MPI_Isend(sendbuf_Yz, sendCount_Yz,MPI_DOUBLE,rank_Yz,sendtag,MPI_COMM_SCALBL,&req1[16]);
-	MPI_Irecv(recvbuf_yZ, recvCount_yZ,MPI_DOUBLE,rank_yZ,recvtag,MPI_COMM_SCALBL,&req2[16]);
-	//...Pack the YZ edge (15)................................
-	ScaLBL_D3Q19_Pack(15,dvcSendList_YZ,0,sendCount_YZ,sendbuf_YZ,dist,N);
-	MPI_Isend(sendbuf_YZ, sendCount_YZ,MPI_DOUBLE,rank_YZ,sendtag,MPI_COMM_SCALBL,&req1[15]);
-	MPI_Irecv(recvbuf_yz, recvCount_yz,MPI_DOUBLE,rank_yz,recvtag,MPI_COMM_SCALBL,&req2[15]);
+	//...................................................................................
+	// Pack the distributions for each neighbor in a single pass
+	//   faces: x(2,8,10,12,14) X(1,7,9,11,13) y(4,8,9,16,18) Y(3,7,10,15,17) z(6,12,13,16,17) Z(5,11,14,15,18)
+	//   edges: xy(8) Xy(9) xY(10) XY(7) xz(12) xZ(14) Xz(13) XZ(11) yz(16) yZ(18) Yz(17) YZ(15)
+	for (int d=0; d<18; d++){
+		ScaLBL_PackDist(dvcPackDist[d],nbr_Q[d]*nbr_sendCount[d],nbr_sendbuf[d],dist);
+	}
+	ScaLBL_DeviceBarrier();
+	// assign tag of 19 to D3Q19 communication (persistent requests set up in the constructor)
+	StartPersistent(req_D3Q19AA,18);
 	//...................................................................................
 
 }
 
-void ScaLBL_Communicator::RecvD3Q19AA(double *dist){
+void ScaLBL_Communicator::RecvD3Q19AA(dist_t *dist){
 
 	// NOTE: the center distribution f0 must NOT be at the start of feven, provide offset to start of f2
 	//...................................................................................
 	// Wait for completion of D3Q19 communication
-	MPI_Waitall(18,req1,stat1);
-	MPI_Waitall(18,req2,stat2);
+	MPI_Waitall(36,req_D3Q19AA,stat_D3Q19AA);
 	ScaLBL_DeviceBarrier();
 
 	//...................................................................................
 	// NOTE: AA Routine writes to opposite 
-	// Unpack the distributions on the device
+	// Unpack the distributions on the device (same q as the send buffer of each neighbor)
 	//...................................................................................
-	//...Unpacking for x face(2,8,10,12,14)................................
-	ScaLBL_D3Q19_Unpack(2,dvcRecvDist_x,0,recvCount_x,recvbuf_x,dist,N);
-	ScaLBL_D3Q19_Unpack(8,dvcRecvDist_x,recvCount_x,recvCount_x,recvbuf_x,dist,N);
-	ScaLBL_D3Q19_Unpack(10,dvcRecvDist_x,2*recvCount_x,recvCount_x,recvbuf_x,dist,N);
-	ScaLBL_D3Q19_Unpack(12,dvcRecvDist_x,3*recvCount_x,recvCount_x,recvbuf_x,dist,N);
-	ScaLBL_D3Q19_Unpack(14,dvcRecvDist_x,4*recvCount_x,recvCount_x,recvbuf_x,dist,N);
-	//...................................................................................
-	//...Packing for X face(1,7,9,11,13)................................
-	ScaLBL_D3Q19_Unpack(1,dvcRecvDist_X,0,recvCount_X,recvbuf_X,dist,N);
-	ScaLBL_D3Q19_Unpack(7,dvcRecvDist_X,recvCount_X,recvCount_X,recvbuf_X,dist,N);
-	ScaLBL_D3Q19_Unpack(9,dvcRecvDist_X,2*recvCount_X,recvCount_X,recvbuf_X,dist,N);
-	ScaLBL_D3Q19_Unpack(11,dvcRecvDist_X,3*recvCount_X,recvCount_X,recvbuf_X,dist,N);
-	ScaLBL_D3Q19_Unpack(13,dvcRecvDist_X,4*recvCount_X,recvCount_X,recvbuf_X,dist,N);
-	//...................................................................................
-	//...Packing for y face(4,8,9,16,18).................................
-	ScaLBL_D3Q19_Unpack(4,dvcRecvDist_y,0,recvCount_y,recvbuf_y,dist,N);
-	ScaLBL_D3Q19_Unpack(8,dvcRecvDist_y,recvCount_y,recvCount_y,recvbuf_y,dist,N);
-	ScaLBL_D3Q19_Unpack(9,dvcRecvDist_y,2*recvCount_y,recvCount_y,recvbuf_y,dist,N);
-	ScaLBL_D3Q19_Unpack(16,dvcRecvDist_y,3*recvCount_y,recvCount_y,recvbuf_y,dist,N);
-	ScaLBL_D3Q19_Unpack(18,dvcRecvDist_y,4*recvCount_y,recvCount_y,recvbuf_y,dist,N);
-	//...................................................................................
-	//...Packing for Y face(3,7,10,15,17).................................
-	ScaLBL_D3Q19_Unpack(3,dvcRecvDist_Y,0,recvCount_Y,recvbuf_Y,dist,N);
-	ScaLBL_D3Q19_Unpack(7,dvcRecvDist_Y,recvCount_Y,recvCount_Y,recvbuf_Y,dist,N);
-	ScaLBL_D3Q19_Unpack(10,dvcRecvDist_Y,2*recvCount_Y,recvCount_Y,recvbuf_Y,dist,N);
-	ScaLBL_D3Q19_Unpack(15,dvcRecvDist_Y,3*recvCount_Y,recvCount_Y,recvbuf_Y,dist,N);
-	ScaLBL_D3Q19_Unpack(17,dvcRecvDist_Y,4*recvCount_Y,recvCount_Y,recvbuf_Y,dist,N);
-	//...................................................................................
-	//...Packing for z face(6,12,13,16,17)................................
-	ScaLBL_D3Q19_Unpack(6,dvcRecvDist_z,0,recvCount_z,recvbuf_z,dist,N);
-	ScaLBL_D3Q19_Unpack(12,dvcRecvDist_z,recvCount_z,recvCount_z,recvbuf_z,dist,N);
-	ScaLBL_D3Q19_Unpack(13,dvcRecvDist_z,2*recvCount_z,recvCount_z,recvbuf_z,dist,N);
-	ScaLBL_D3Q19_Unpack(16,dvcRecvDist_z,3*recvCount_z,recvCount_z,recvbuf_z,dist,N);
-	ScaLBL_D3Q19_Unpack(17,dvcRecvDist_z,4*recvCount_z,recvCount_z,recvbuf_z,dist,N);
-	//...Packing for Z face(5,11,14,15,18)................................
-	ScaLBL_D3Q19_Unpack(5,dvcRecvDist_Z,0,recvCount_Z,recvbuf_Z,dist,N);
-	ScaLBL_D3Q19_Unpack(11,dvcRecvDist_Z,recvCount_Z,recvCount_Z,recvbuf_Z,dist,N);
-	ScaLBL_D3Q19_Unpack(14,dvcRecvDist_Z,2*recvCount_Z,recvCount_Z,recvbuf_Z,dist,N);
-	ScaLBL_D3Q19_Unpack(15,dvcRecvDist_Z,3*recvCount_Z,recvCount_Z,recvbuf_Z,dist,N);
-	ScaLBL_D3Q19_Unpack(18,dvcRecvDist_Z,4*recvCount_Z,recvCount_Z,recvbuf_Z,dist,N);
-	//..................................................................................
-	//...Pack the xy edge (8)................................
-	ScaLBL_D3Q19_Unpack(8,dvcRecvDist_xy,0,recvCount_xy,recvbuf_xy,dist,N);
-	//...Pack the Xy edge (9)................................
-	ScaLBL_D3Q19_Unpack(9,dvcRecvDist_Xy,0,recvCount_Xy,recvbuf_Xy,dist,N);
-	//...Pack the xY edge (10)................................
-	ScaLBL_D3Q19_Unpack(10,dvcRecvDist_xY,0,recvCount_xY,recvbuf_xY,dist,N);
-	//...Pack the XY edge (7)................................
-	ScaLBL_D3Q19_Unpack(7,dvcRecvDist_XY,0,recvCount_XY,recvbuf_XY,dist,N);
-	//...Pack the xz edge (12)................................
-	ScaLBL_D3Q19_Unpack(12,dvcRecvDist_xz,0,recvCount_xz,recvbuf_xz,dist,N);
-	//...Pack the xZ edge (14)................................
-	ScaLBL_D3Q19_Unpack(14,dvcRecvDist_xZ,0,recvCount_xZ,recvbuf_xZ,dist,N);
-	//...Pack the Xz edge (13)................................
-	ScaLBL_D3Q19_Unpack(13,dvcRecvDist_Xz,0,recvCount_Xz,recvbuf_Xz,dist,N);
-	//...Pack the XZ edge (11)................................
-	ScaLBL_D3Q19_Unpack(11,dvcRecvDist_XZ,0,recvCount_XZ,recvbuf_XZ,dist,N);
-	//...Pack the yz edge (16)................................
-	ScaLBL_D3Q19_Unpack(16,dvcRecvDist_yz,0,recvCount_yz,recvbuf_yz,dist,N);
-	//...Pack the yZ edge (18)................................
-	ScaLBL_D3Q19_Unpack(18,dvcRecvDist_yZ,0,recvCount_yZ,recvbuf_yZ,dist,N);
-	//...Pack the Yz edge (17)................................
-	ScaLBL_D3Q19_Unpack(17,dvcRecvDist_Yz,0,recvCount_Yz,recvbuf_Yz,dist,N);
-	//...Pack the YZ edge (15)................................
-	ScaLBL_D3Q19_Unpack(15,dvcRecvDist_YZ,0,recvCount_YZ,recvbuf_YZ,dist,N);
+	for (int d=0; d<18; d++){
+		ScaLBL_UnpackDist(dvcUnpackDist[d],nbr_Q[d]*nbr_recvCount[d],nbr_recvbuf[d],dist);
+	}
 	//...................................................................................
 	Lock=false; // unlock the communicator after communications complete
 	//...................................................................................
@@ -1151,7 +1185,7 @@ void ScaLBL_Communicator::RecvGrad(double *phi, double *grad){
 
 }
 
-void ScaLBL_Communicator::BiSendD3Q7AA(double *Aq, double *Bq){
+void ScaLBL_Communicator::BiSendD3Q7AA(dist_t *Aq, dist_t *Bq){
 
 	// NOTE: the center distribution f0 must NOT be at the start of feven, provide offset to start of f2
 	if (Lock==true){
@@ -1160,106 +1194,38 @@ void ScaLBL_Communicator::BiSendD3Q7AA(double *Aq, double *Bq){
 	else{
 		Lock=true;
 	}
-	// assign tag of 19 to D3Q19 communication
-	sendtag = recvtag = 14;
 	ScaLBL_DeviceBarrier();
-	// Pack the distributions
-	//...Packing for x face(2,8,10,12,14)................................
-	ScaLBL_D3Q19_Pack(2,dvcSendList_x,0,sendCount_x,sendbuf_x,Aq,N);
-	ScaLBL_D3Q19_Pack(2,dvcSendList_x,sendCount_x,sendCount_x,sendbuf_x,Bq,N);
-
-	MPI_Isend(sendbuf_x, 2*sendCount_x,MPI_DOUBLE,rank_x,sendtag,MPI_COMM_SCALBL,&req1[0]);
-	MPI_Irecv(recvbuf_X, 2*recvCount_X,MPI_DOUBLE,rank_X,recvtag,MPI_COMM_SCALBL,&req2[0]);
-	
-	//...Packing for X face(1,7,9,11,13)................................
-	ScaLBL_D3Q19_Pack(1,dvcSendList_X,0,sendCount_X,sendbuf_X,Aq,N);
-	ScaLBL_D3Q19_Pack(1,dvcSendList_X,sendCount_X,sendCount_X,sendbuf_X,Bq,N);
-	
-	MPI_Isend(sendbuf_X, 2*sendCount_X,MPI_DOUBLE,rank_X,sendtag,MPI_COMM_SCALBL,&req1[1]);
-	MPI_Irecv(recvbuf_x, 2*recvCount_x,MPI_DOUBLE,rank_x,recvtag,MPI_COMM_SCALBL,&req2[1]);
-
-	//...Packing for y face(4,8,9,16,18).................................
-	ScaLBL_D3Q19_Pack(4,dvcSendList_y,0,sendCount_y,sendbuf_y,Aq,N);
-	ScaLBL_D3Q19_Pack(4,dvcSendList_y,sendCount_y,sendCount_y,sendbuf_y,Bq,N);
-
-	MPI_Isend(sendbuf_y, 2*sendCount_y,MPI_DOUBLE,rank_y,sendtag,MPI_COMM_SCALBL,&req1[2]);
-	MPI_Irecv(recvbuf_Y, 2*recvCount_Y,MPI_DOUBLE,rank_Y,recvtag,MPI_COMM_SCALBL,&req2[2]);
-	
-	//...Packing for Y face(3,7,10,15,17).................................
-	ScaLBL_D3Q19_Pack(3,dvcSendList_Y,0,sendCount_Y,sendbuf_Y,Aq,N);
-	ScaLBL_D3Q19_Pack(3,dvcSendList_Y,sendCount_Y,sendCount_Y,sendbuf_Y,Bq,N);
-
-	MPI_Isend(sendbuf_Y, 2*sendCount_Y,MPI_DOUBLE,rank_Y,sendtag,MPI_COMM_SCALBL,&req1[3]);
-	MPI_Irecv(recvbuf_y, 2*recvCount_y,MPI_DOUBLE,rank_y,recvtag,MPI_COMM_SCALBL,&req2[3]);
-	
-	//...Packing for z face(6,12,13,16,17)................................
-	ScaLBL_D3Q19_Pack(6,dvcSendList_z,0,sendCount_z,sendbuf_z,Aq,N);
-	ScaLBL_D3Q19_Pack(6,dvcSendList_z,sendCount_z,sendCount_z,sendbuf_z,Bq,N);
-	
-	MPI_Isend(sendbuf_z, 2*sendCount_z,MPI_DOUBLE,rank_z,sendtag,MPI_COMM_SCALBL,&req1[4]);
-	MPI_Irecv(recvbuf_Z, 2*recvCount_Z,MPI_DOUBLE,rank_Z,recvtag,MPI_COMM_SCALBL,&req2[4]);
-	
-	//...Packing for Z face(5,11,14,15,18)................................
-	ScaLBL_D3Q19_Pack(5,dvcSendList_Z,0,sendCount_Z,sendbuf_Z,Aq,N);
-	ScaLBL_D3Q19_Pack(5,dvcSendList_Z,sendCount_Z,sendCount_Z,sendbuf_Z,Bq,N);
-
+	// Pack the distributions (D3Q7 only uses the first q of each face: x(2) X(1) y(4) Y(3) z(6) Z(5))
+	for (int d=0; d<6; d++){
+		ScaLBL_PackDist(dvcPackDist[d],nbr_sendCount[d],nbr_sendbuf[d],Aq);
+		ScaLBL_PackDist(dvcPackDist[d],nbr_sendCount[d],&nbr_sendbuf[d][nbr_sendCount[d]],Bq);
+	}
+	ScaLBL_DeviceBarrier();
 	//...................................................................................
-	// Send all the distributions
-	MPI_Isend(sendbuf_Z, 2*sendCount_Z,MPI_DOUBLE,rank_Z,sendtag,MPI_COMM_SCALBL,&req1[5]);
-	MPI_Irecv(recvbuf_z, 2*recvCount_z,MPI_DOUBLE,rank_z,recvtag,MPI_COMM_SCALBL,&req2[5]);
+	// Send all the distributions (tag 14)
+	StartPersistent(req_BiD3Q7AA,6);
 
 }
 
 
-void ScaLBL_Communicator::BiRecvD3Q7AA(double *Aq, double *Bq){
+void ScaLBL_Communicator::BiRecvD3Q7AA(dist_t *Aq, dist_t *Bq){
 
 	// NOTE: the center distribution f0 must NOT be at the start of feven, provide offset to start of f2
 	//...................................................................................
-	// Wait for completion of D3Q19 communication
-	MPI_Waitall(6,req1,stat1);
-	MPI_Waitall(6,req2,stat2);
+	// Wait for completion of D3Q7 communication
+	MPI_Waitall(12,req_BiD3Q7AA,stat_D3Q19AA);
 	ScaLBL_DeviceBarrier();
 
 	//...................................................................................
 	// NOTE: AA Routine writes to opposite
 	// Unpack the distributions on the device
 	//...................................................................................
-	//...Unpacking for x face(2,8,10,12,14)................................
-	ScaLBL_D3Q7_Unpack(2,dvcRecvDist_x,0,recvCount_x,recvbuf_x,Aq,N);
-	ScaLBL_D3Q7_Unpack(2,dvcRecvDist_x,recvCount_x,recvCount_x,recvbuf_x,Bq,N);
-	//...................................................................................
-	//...Packing for X face(1,7,9,11,13)................................
-	ScaLBL_D3Q7_Unpack(1,dvcRecvDist_X,0,recvCount_X,recvbuf_X,Aq,N);
-	ScaLBL_D3Q7_Unpack(1,dvcRecvDist_X,recvCount_X,recvCount_X,recvbuf_X,Bq,N);
-	//...................................................................................
-	//...Packing for y face(4,8,9,16,18).................................
-	ScaLBL_D3Q7_Unpack(4,dvcRecvDist_y,0,recvCount_y,recvbuf_y,Aq,N);
-	ScaLBL_D3Q7_Unpack(4,dvcRecvDist_y,recvCount_y,recvCount_y,recvbuf_y,Bq,N);
-	//...................................................................................
-	//...Packing for Y face(3,7,10,15,17).................................
-	ScaLBL_D3Q7_Unpack(3,dvcRecvDist_Y,0,recvCount_Y,recvbuf_Y,Aq,N);
-	ScaLBL_D3Q7_Unpack(3,dvcRecvDist_Y,recvCount_Y,recvCount_Y,recvbuf_Y,Bq,N);
-	//...................................................................................
-	
-	if (BoundaryCondition > 0 && kproc == 0){
-		// don't unpack little z
-		//...Packing for Z face(5,11,14,15,18)................................
-		ScaLBL_D3Q7_Unpack(5,dvcRecvDist_Z,0,recvCount_Z,recvbuf_Z,Aq,N);
-		ScaLBL_D3Q7_Unpack(5,dvcRecvDist_Z,recvCount_Z,recvCount_Z,recvbuf_Z,Bq,N);
-	}
-	else if (BoundaryCondition > 0 && kproc == nprocz-1){
-		// don't unpack big z
-		//...Packing for z face(6,12,13,16,17)................................
-		ScaLBL_D3Q7_Unpack(6,dvcRecvDist_z,0,recvCount_z,recvbuf_z,Aq,N);
-		ScaLBL_D3Q7_Unpack(6,dvcRecvDist_z,recvCount_z,recvCount_z,recvbuf_z,Bq,N);
-	}
-	else {
-		//...Packing for z face(6,12,13,16,17)................................
-		ScaLBL_D3Q7_Unpack(6,dvcRecvDist_z,0,recvCount_z,recvbuf_z,Aq,N);
-		ScaLBL_D3Q7_Unpack(6,dvcRecvDist_z,recvCount_z,recvCount_z,recvbuf_z,Bq,N);
-		//...Packing for Z face(5,11,14,15,18)................................
-		ScaLBL_D3Q7_Unpack(5,dvcRecvDist_Z,0,recvCount_Z,recvbuf_Z,Aq,N);
-		ScaLBL_D3Q7_Unpack(5,dvcRecvDist_Z,recvCount_Z,recvCount_Z,recvbuf_Z,Bq,N);
+	for (int d=0; d<6; d++){
+		// don't unpack little z (big z) at an inlet (outlet) boundary
+		if (d == 4 && BoundaryCondition > 0 && kproc == 0) continue;
+		if (d == 5 && BoundaryCondition > 0 && kproc == nprocz-1) continue;
+		ScaLBL_UnpackDist(dvcUnpackDist[d],nbr_recvCount[d],nbr_recvbuf[d],Aq);
+		ScaLBL_UnpackDist(dvcUnpackDist[d],nbr_recvCount[d],&nbr_recvbuf[d][nbr_recvCount[d]],Bq);
 	}
 	
 	//...................................................................................
@@ -1268,7 +1234,7 @@ void ScaLBL_Communicator::BiRecvD3Q7AA(double *Aq, double *Bq){
 
 }
 
-void ScaLBL_Communicator::TriSendD3Q7AA(double *Aq, double *Bq, double *Cq){
+void ScaLBL_Communicator::TriSendD3Q7AA(dist_t *Aq, dist_t *Bq, dist_t *Cq){
 
 	// NOTE: the center distribution f0 must NOT be at the start of feven, provide offset to start of f2
 	if (Lock==true){
@@ -1277,119 +1243,102 @@ void ScaLBL_Communicator::TriSendD3Q7AA(double *Aq, double *Bq, double *Cq){
 	else{
 		Lock=true;
 	}
-	// assign tag of 19 to D3Q19 communication
-	sendtag = recvtag = 15;
 	ScaLBL_DeviceBarrier();
-	// Pack the distributions
-	//...Packing for x face(2,8,10,12,14)................................
-	ScaLBL_D3Q19_Pack(2,dvcSendList_x,0,sendCount_x,sendbuf_x,Aq,N);
-	ScaLBL_D3Q19_Pack(2,dvcSendList_x,sendCount_x,sendCount_x,sendbuf_x,Bq,N);
-	ScaLBL_D3Q19_Pack(2,dvcSendList_x,2*sendCount_x,sendCount_x,sendbuf_x,Cq,N);
-	//...Packing for X face(1,7,9,11,13)................................
-	ScaLBL_D3Q19_Pack(1,dvcSendList_X,0,sendCount_X,sendbuf_X,Aq,N);
-	ScaLBL_D3Q19_Pack(1,dvcSendList_X,sendCount_X,sendCount_X,sendbuf_X,Bq,N);
-	ScaLBL_D3Q19_Pack(1,dvcSendList_X,2*sendCount_X,sendCount_X,sendbuf_X,Cq,N);
-	//...Packing for y face(4,8,9,16,18).................................
-	ScaLBL_D3Q19_Pack(4,dvcSendList_y,0,sendCount_y,sendbuf_y,Aq,N);
-	ScaLBL_D3Q19_Pack(4,dvcSendList_y,sendCount_y,sendCount_y,sendbuf_y,Bq,N);
-	ScaLBL_D3Q19_Pack(4,dvcSendList_y,2*sendCount_y,sendCount_y,sendbuf_y,Cq,N);
-	//...Packing for Y face(3,7,10,15,17).................................
-	ScaLBL_D3Q19_Pack(3,dvcSendList_Y,0,sendCount_Y,sendbuf_Y,Aq,N);
-	ScaLBL_D3Q19_Pack(3,dvcSendList_Y,sendCount_Y,sendCount_Y,sendbuf_Y,Bq,N);
-	ScaLBL_D3Q19_Pack(3,dvcSendList_Y,2*sendCount_Y,sendCount_Y,sendbuf_Y,Cq,N);
-	//...Packing for z face(6,12,13,16,17)................................
-	ScaLBL_D3Q19_Pack(6,dvcSendList_z,0,sendCount_z,sendbuf_z,Aq,N);
-	ScaLBL_D3Q19_Pack(6,dvcSendList_z,sendCount_z,sendCount_z,sendbuf_z,Bq,N);
-	ScaLBL_D3Q19_Pack(6,dvcSendList_z,2*sendCount_z,sendCount_z,sendbuf_z,Cq,N);
-	//...Packing for Z face(5,11,14,15,18)................................
-	ScaLBL_D3Q19_Pack(5,dvcSendList_Z,0,sendCount_Z,sendbuf_Z,Aq,N);
-	ScaLBL_D3Q19_Pack(5,dvcSendList_Z,sendCount_Z,sendCount_Z,sendbuf_Z,Bq,N);
-	ScaLBL_D3Q19_Pack(5,dvcSendList_Z,2*sendCount_Z,sendCount_Z,sendbuf_Z,Cq,N);
-
+	// Pack the distributions (D3Q7 only uses the first q of each face: x(2) X(1) y(4) Y(3) z(6) Z(5))
+	for (int d=0; d<6; d++){
+		ScaLBL_PackDist(dvcPackDist[d],nbr_sendCount[d],nbr_sendbuf[d],Aq);
+		ScaLBL_PackDist(dvcPackDist[d],nbr_sendCount[d],&nbr_sendbuf[d][nbr_sendCount[d]],Bq);
+		ScaLBL_PackDist(dvcPackDist[d],nbr_sendCount[d],&nbr_sendbuf[d][2*nbr_sendCount[d]],Cq);
+	}
+	ScaLBL_DeviceBarrier();
 	//...................................................................................
-	// Send all the distributions
-	MPI_Isend(sendbuf_x, 3*sendCount_x,MPI_DOUBLE,rank_x,sendtag,MPI_COMM_SCALBL,&req1[0]);
-	MPI_Irecv(recvbuf_X, 3*recvCount_X,MPI_DOUBLE,rank_X,recvtag,MPI_COMM_SCALBL,&req2[0]);
-	MPI_Isend(sendbuf_X, 3*sendCount_X,MPI_DOUBLE,rank_X,sendtag,MPI_COMM_SCALBL,&req1[1]);
-	MPI_Irecv(recvbuf_x, 3*recvCount_x,MPI_DOUBLE,rank_x,recvtag,MPI_COMM_SCALBL,&req2[1]);
-	MPI_Isend(sendbuf_y, 3*sendCount_y,MPI_DOUBLE,rank_y,sendtag,MPI_COMM_SCALBL,&req1[2]);
-	MPI_Irecv(recvbuf_Y, 3*recvCount_Y,MPI_DOUBLE,rank_Y,recvtag,MPI_COMM_SCALBL,&req2[2]);
-	MPI_Isend(sendbuf_Y, 3*sendCount_Y,MPI_DOUBLE,rank_Y,sendtag,MPI_COMM_SCALBL,&req1[3]);
-	MPI_Irecv(recvbuf_y, 3*recvCount_y,MPI_DOUBLE,rank_y,recvtag,MPI_COMM_SCALBL,&req2[3]);
-	MPI_Isend(sendbuf_z, 3*sendCount_z,MPI_DOUBLE,rank_z,sendtag,MPI_COMM_SCALBL,&req1[4]);
-	MPI_Irecv(recvbuf_Z, 3*recvCount_Z,MPI_DOUBLE,rank_Z,recvtag,MPI_COMM_SCALBL,&req2[4]);
-	MPI_Isend(sendbuf_Z, 3*sendCount_Z,MPI_DOUBLE,rank_Z,sendtag,MPI_COMM_SCALBL,&req1[5]);
-	MPI_Irecv(recvbuf_z, 3*recvCount_z,MPI_DOUBLE,rank_z,recvtag,MPI_COMM_SCALBL,&req2[5]);
+	// Send all the distributions (tag 15)
+	StartPersistent(req_TriD3Q7AA,6);
 
 }
 
 
-void ScaLBL_Communicator::TriRecvD3Q7AA(double *Aq, double *Bq, double *Cq){
+void ScaLBL_Communicator::TriRecvD3Q7AA(dist_t *Aq, dist_t *Bq, dist_t *Cq){
 
 	// NOTE: the center distribution f0 must NOT be at the start of feven, provide offset to start of f2
 	//...................................................................................
-	// Wait for completion of D3Q19 communication
-	MPI_Waitall(6,req1,stat1);
-	MPI_Waitall(6,req2,stat2);
+	// Wait for completion of D3Q7 communication
+	MPI_Waitall(12,req_TriD3Q7AA,stat_D3Q19AA);
 	ScaLBL_DeviceBarrier();
 
 	//...................................................................................
 	// NOTE: AA Routine writes to opposite
 	// Unpack the distributions on the device
 	//...................................................................................
-	//...Unpacking for x face(2,8,10,12,14)................................
-	ScaLBL_D3Q7_Unpack(2,dvcRecvDist_x,0,recvCount_x,recvbuf_x,Aq,N);
-	ScaLBL_D3Q7_Unpack(2,dvcRecvDist_x,recvCount_x,recvCount_x,recvbuf_x,Bq,N);
-	ScaLBL_D3Q7_Unpack(2,dvcRecvDist_x,2*recvCount_x,recvCount_x,recvbuf_x,Cq,N);
+	for (int d=0; d<6; d++){
+		// don't unpack little z (big z) at an inlet (outlet) boundary
+		if (d == 4 && BoundaryCondition > 0 && kproc == 0) continue;
+		if (d == 5 && BoundaryCondition > 0 && kproc == nprocz-1) continue;
+		ScaLBL_UnpackDist(dvcUnpackDist[d],nbr_recvCount[d],nbr_recvbuf[d],Aq);
+		ScaLBL_UnpackDist(dvcUnpackDist[d],nbr_recvCount[d],&nbr_recvbuf[d][nbr_recvCount[d]],Bq);
+		ScaLBL_UnpackDist(dvcUnpackDist[d],nbr_recvCount[d],&nbr_recvbuf[d][2*nbr_recvCount[d]],Cq);
+	}
+	
 	//...................................................................................
-	//...Packing for X face(1,7,9,11,13)................................
-	ScaLBL_D3Q7_Unpack(1,dvcRecvDist_X,0,recvCount_X,recvbuf_X,Aq,N);
-	ScaLBL_D3Q7_Unpack(1,dvcRecvDist_X,recvCount_X,recvCount_X,recvbuf_X,Bq,N);
-	ScaLBL_D3Q7_Unpack(1,dvcRecvDist_X,2*recvCount_X,recvCount_X,recvbuf_X,Cq,N);
+	Lock=false; // unlock the communicator after communications complete
 	//...................................................................................
-	//...Packing for y face(4,8,9,16,18).................................
-	ScaLBL_D3Q7_Unpack(4,dvcRecvDist_y,0,recvCount_y,recvbuf_y,Aq,N);
-	ScaLBL_D3Q7_Unpack(4,dvcRecvDist_y,recvCount_y,recvCount_y,recvbuf_y,Bq,N);
-	ScaLBL_D3Q7_Unpack(4,dvcRecvDist_y,2*recvCount_y,recvCount_y,recvbuf_y,Cq,N);
+
+}
+
+void ScaLBL_Communicator::SendD3Q19D3Q7AA(dist_t *fq, dist_t *Aq, dist_t *Bq){
+
+	// NOTE: the center distribution f0 must NOT be at the start of feven, provide offset to start of f2
+	if (Lock==true){
+		ERROR("ScaLBL Error (SendD3Q19D3Q7AA): ScaLBL_Communicator is locked -- did you forget to match Send/Recv calls?");
+	}
+	else{
+		Lock=true;
+	}
+	ScaLBL_DeviceBarrier();
+	// Pack fq for every neighbor, followed by Aq and Bq for the faces
+	for (int d=0; d<18; d++){
+		int count = nbr_sendCount[d];
+		ScaLBL_PackDist(dvcPackDist[d],nbr_Q[d]*count,agg_sendbuf[d],fq);
+		if (d < 6){
+			ScaLBL_PackDist(dvcPackDist[d],count,&agg_sendbuf[d][5*count],Aq);
+			ScaLBL_PackDist(dvcPackDist[d],count,&agg_sendbuf[d][6*count],Bq);
+		}
+	}
+	ScaLBL_DeviceBarrier();
 	//...................................................................................
-	//...Packing for Y face(3,7,10,15,17).................................
-	ScaLBL_D3Q7_Unpack(3,dvcRecvDist_Y,0,recvCount_Y,recvbuf_Y,Aq,N);
-	ScaLBL_D3Q7_Unpack(3,dvcRecvDist_Y,recvCount_Y,recvCount_Y,recvbuf_Y,Bq,N);
-	ScaLBL_D3Q7_Unpack(3,dvcRecvDist_Y,2*recvCount_Y,recvCount_Y,recvbuf_Y,Cq,N);
+	// Send all the distributions (tag 16)
+	StartPersistent(req_AggAA,18);
+
+}
+
+void ScaLBL_Communicator::RecvD3Q19D3Q7AA(dist_t *fq, dist_t *Aq, dist_t *Bq){
+
+	// NOTE: the center distribution f0 must NOT be at the start of feven, provide offset to start of f2
 	//...................................................................................
-	
-	if (BoundaryCondition > 0 && kproc == 0){
-		// don't unpack little z
-		//...Packing for Z face(5,11,14,15,18)................................
-		ScaLBL_D3Q7_Unpack(5,dvcRecvDist_Z,0,recvCount_Z,recvbuf_Z,Aq,N);
-		ScaLBL_D3Q7_Unpack(5,dvcRecvDist_Z,recvCount_Z,recvCount_Z,recvbuf_Z,Bq,N);
-		ScaLBL_D3Q7_Unpack(5,dvcRecvDist_Z,2*recvCount_Z,recvCount_Z,recvbuf_Z,Cq,N);
-	}
-	else if (BoundaryCondition > 0 && kproc == nprocz-1){
-		// don't unpack big z
-		//...Packing for z face(6,12,13,16,17)................................
-		ScaLBL_D3Q7_Unpack(6,dvcRecvDist_z,0,recvCount_z,recvbuf_z,Aq,N);
-		ScaLBL_D3Q7_Unpack(6,dvcRecvDist_z,recvCount_z,recvCount_z,recvbuf_z,Bq,N);
-		ScaLBL_D3Q7_Unpack(6,dvcRecvDist_z,2*recvCount_z,recvCount_z,recvbuf_z,Cq,N);
-	}
-	else {
-		//...Packing for z face(6,12,13,16,17)................................
-		ScaLBL_D3Q7_Unpack(6,dvcRecvDist_z,0,recvCount_z,recvbuf_z,Aq,N);
-		ScaLBL_D3Q7_Unpack(6,dvcRecvDist_z,recvCount_z,recvCount_z,recvbuf_z,Bq,N);
-		ScaLBL_D3Q7_Unpack(6,dvcRecvDist_z,2*recvCount_z,recvCount_z,recvbuf_z,Cq,N);
-		//...Packing for Z face(5,11,14,15,18)................................
-		ScaLBL_D3Q7_Unpack(5,dvcRecvDist_Z,0,recvCount_Z,recvbuf_Z,Aq,N);
-		ScaLBL_D3Q7_Unpack(5,dvcRecvDist_Z,recvCount_Z,recvCount_Z,recvbuf_Z,Bq,N);
-		ScaLBL_D3Q7_Unpack(5,dvcRecvDist_Z,2*recvCount_Z,recvCount_Z,recvbuf_Z,Cq,N);
+	// Wait for completion of the aggregated communication
+	MPI_Waitall(36,req_AggAA,stat_D3Q19AA);
+	ScaLBL_DeviceBarrier();
+
+	//...................................................................................
+	// NOTE: AA Routine writes to opposite
+	// Unpack the distributions on the device
+	//...................................................................................
+	for (int d=0; d<18; d++){
+		int count = nbr_recvCount[d];
+		ScaLBL_UnpackDist(dvcUnpackDist[d],nbr_Q[d]*count,agg_recvbuf[d],fq);
+		if (d > 5) continue;
+		// don't unpack little z (big z) D3Q7 at an inlet (outlet) boundary
+		if (d == 4 && BoundaryCondition > 0 && kproc == 0) continue;
+		if (d == 5 && BoundaryCondition > 0 && kproc == nprocz-1) continue;
+		ScaLBL_UnpackDist(dvcUnpackDist[d],count,&agg_recvbuf[d][5*count],Aq);
+		ScaLBL_UnpackDist(dvcUnpackDist[d],count,&agg_recvbuf[d][6*count],Bq);
 	}
-	
 	//...................................................................................
 	Lock=false; // unlock the communicator after communications complete
 	//...................................................................................
 
 }
 
-
 void ScaLBL_Communicator::SendHalo(double *data){
 	//...................................................................................
 	if (Lock==true){
@@ -1543,7 +1492,7 @@ void ScaLBL_Communicator::Color_BC_Z(int *Map, double *Phi, double *Den, double
 	}
 }
 
-void ScaLBL_Communicator::D3Q19_Pressure_BC_z(int *neighborList, double *fq, double din, int time){
+void ScaLBL_Communicator::D3Q19_Pressure_BC_z(int *neighborList, dist_t *fq, double din, int time){
     //ScaLBL_D3Q19_Pressure_BC_z(int *LIST,fq,din,Nx,Ny,Nz);
 	if (kproc == 0) {
 		if (time%2==0){
@@ -1555,7 +1504,7 @@ void ScaLBL_Communicator::D3Q19_Pressure_BC_z(int *neighborList, double *fq, dou
 	}
 }
 
-void ScaLBL_Communicator::D3Q19_Pressure_BC_Z(int *neighborList, double *fq, double dout, int time){
+void ScaLBL_Communicator::D3Q19_Pressure_BC_Z(int *neighborList, dist_t *fq, double dout, int time){
     //ScaLBL_D3Q19_Pressure_BC_Z(int *LIST,fq,dout,Nx,Ny,Nz);
 	if (kproc == nprocz-1){
 		if (time%2==0){
@@ -1567,7 +1516,7 @@ void ScaLBL_Communicator::D3Q19_Pressure_BC_Z(int *neighborList, double *fq, dou
 	}
 }
 
-double ScaLBL_Communicator::D3Q19_Flux_BC_z(int *neighborList, double *fq, double flux, int time){
+double ScaLBL_Communicator::D3Q19_Flux_BC_z(int *neighborList, dist_t *fq, double flux, int time){
 	double sum, locsum, din;
 	double LocInletArea, InletArea;
 	
@@ -25,28 +25,50 @@
 #ifndef ScalLBL_H
 #define ScalLBL_H
 #include "common/Domain.h"
+#include "common/ScaLBL_Dist.h"
 
 extern "C" int ScaLBL_SetDevice(int rank);
 
 extern "C" void ScaLBL_AllocateDeviceMemory(void** address, size_t size);
 
+// Allocate memory holding per-site data in blocks of stride bytes (e.g. dist[q*Np+n] with stride Np*sizeof(double))
+// On the CPU the sites [0,LastExterior) and [FirstInterior,LastInterior) of each block are first touched
+// by the threads that update them in the kernels (static schedule over each range)
+extern "C" void ScaLBL_AllocateSiteMemory(void** address, size_t size, size_t stride, int Np,
+		int LastExterior, int FirstInterior, int LastInterior);
+
 extern "C" void ScaLBL_FreeDeviceMemory(void* pointer);
 
 extern "C" void ScaLBL_CopyToDevice(void* dest, const void* source, size_t size);
 
 extern "C" void ScaLBL_CopyToHost(void* dest, const void* source, size_t size);
 
+// Copy count distribution values between double precision host memory and dist_t storage
+extern "C" void ScaLBL_CopyDistToDevice(dist_t* dest, const double* source, size_t count);
+
+extern "C" void ScaLBL_CopyDistToHost(double* dest, const dist_t* source, size_t count);
+
 extern "C" void ScaLBL_AllocateZeroCopy(void** address, size_t size);
 
 extern "C" void ScaLBL_CopyToZeroCopy(void* dest, const void* source, size_t size);
 
+// Host memory for device to host copies (page-locked when running on the GPU)
+extern "C" void ScaLBL_AllocateHostMemory(void** address, size_t size);
+
+extern "C" void ScaLBL_FreeHostMemory(void* pointer);
+
 extern "C" void ScaLBL_DeviceBarrier();
 
-extern "C" void ScaLBL_D3Q19_Pack(int q, int *list, int start, int count, double *sendbuf, double *dist, int N);
+extern "C" void ScaLBL_D3Q19_Pack(int q, int *list, int start, int count, double *sendbuf, dist_t *dist, int N);
+
+extern "C" void ScaLBL_D3Q19_Unpack(int q, int *list, int start, int count, double *recvbuf, dist_t *dist, int N);
+
+// Pack / unpack using a precomputed list of offsets q*N+n (negative offsets are skipped on unpack)
+extern "C" void ScaLBL_PackDist(int *list, int count, double *sendbuf, dist_t *dist);
 
-extern "C" void ScaLBL_D3Q19_Unpack(int q, int *list, int start, int count, double *recvbuf, double *dist, int N);
+extern "C" void ScaLBL_UnpackDist(int *list, int count, double *recvbuf, dist_t *dist);
 
-extern "C" void ScaLBL_D3Q7_Unpack(int q, int *list,  int start, int count, double *recvbuf, double *dist, int N);
+extern "C" void ScaLBL_D3Q7_Unpack(int q, int *list,  int start, int count, double *recvbuf, dist_t *dist, int N);
 
 extern "C" void ScaLBL_Scalar_Pack(int *list, int count, double *sendbuf, double *Data, int N);
 
@@ -59,58 +81,76 @@ extern "C" void ScaLBL_PackDenD3Q7(int *list, int count, double *sendbuf, int nu
 
 extern "C" void ScaLBL_UnpackDenD3Q7(int *list, int count, double *recvbuf, int number, double *Data, int N);
 
-extern "C" void ScaLBL_D3Q19_Init(double *Dist, int Np);
+extern "C" void ScaLBL_D3Q19_Init(dist_t *Dist, int Np);
 
-extern "C" void ScaLBL_D3Q19_Momentum(double *dist, double *vel, int Np);
+extern "C" void ScaLBL_D3Q19_Momentum(dist_t *dist, double *vel, int Np);
 
-extern "C" void ScaLBL_D3Q19_Pressure(double *dist, double *press, int Np);
+extern "C" void ScaLBL_D3Q19_Pressure(dist_t *dist, double *press, int Np);
 
 // BGK MODEL
-extern "C" void ScaLBL_D3Q19_AAeven_BGK(double *dist, int start, int finish, int Np, double rlx, double Fx, double Fy, double Fz);
+extern "C" void ScaLBL_D3Q19_AAeven_BGK(dist_t *dist, int start, int finish, int Np, double rlx, double Fx, double Fy, double Fz);
 
-extern "C" void ScaLBL_D3Q19_AAodd_BGK(int *neighborList, double *dist, int start, int finish, int Np, double rlx, double Fx, double Fy, double Fz);
+extern "C" void ScaLBL_D3Q19_AAodd_BGK(int *neighborList, dist_t *dist, int start, int finish, int Np, double rlx, double Fx, double Fy, double Fz);
 
 // MRT MODEL
-extern "C" void ScaLBL_D3Q19_AAeven_MRT(double *dist, int start, int finish, int Np, double rlx_setA, double rlx_setB, double Fx,
+extern "C" void ScaLBL_D3Q19_AAeven_MRT(dist_t *dist, int start, int finish, int Np, double rlx_setA, double rlx_setB, double Fx,
 		double Fy, double Fz);
 
-extern "C" void ScaLBL_D3Q19_AAodd_MRT(int *d_neighborList, double *dist, int start, int finish, int Np,
+extern "C" void ScaLBL_D3Q19_AAodd_MRT(int *d_neighborList, dist_t *dist, int start, int finish, int Np,
 		double rlx_setA, double rlx_setB, double Fx, double Fy, double Fz);
 
 // COLOR MODEL
 
-extern "C" void ScaLBL_D3Q19_AAeven_Color(int *Map, double *dist, double *Aq, double *Bq, double *Den, double *Phi,
+extern "C" void ScaLBL_D3Q19_AAeven_Color(int *Map, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, double *Phi,
 		double *Vel, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int strideY, int strideZ, int start, int finish, int Np);
 
-extern "C" void ScaLBL_D3Q19_AAodd_Color(int *d_neighborList, int *Map, double *dist, double *Aq, double *Bq, double *Den, 
+extern "C" void ScaLBL_D3Q19_AAodd_Color(int *d_neighborList, int *Map, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, 
 		double *Phi, double *Vel, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int strideY, int strideZ, int start, int finish, int Np);
 
-extern "C" void ScaLBL_D3Q7_AAodd_PhaseField(int *NeighborList, int *Map, double *Aq, double *Bq, 
+extern "C" void ScaLBL_D3Q7_AAodd_PhaseField(int *NeighborList, int *Map, dist_t *Aq, dist_t *Bq, 
 			double *Den, double *Phi, int start, int finish, int Np);
 
-extern "C" void ScaLBL_D3Q7_AAeven_PhaseField(int *Map, double *Aq, double *Bq, double *Den, double *Phi, 
+extern "C" void ScaLBL_D3Q7_AAeven_PhaseField(int *Map, dist_t *Aq, dist_t *Bq, double *Den, double *Phi, 
 			int start, int finish, int Np);
 
+// Phase field and color collision in a single blocked sweep; lag is the largest forward offset
+// (in compact index) between a site and the neighbors it reads Phi from
+extern "C" void ScaLBL_D3Q19_AAodd_ColorFused(int *d_neighborList, int *Map, dist_t *dist, dist_t *Aq, dist_t *Bq,
+		double *Den, double *Phi, double *Vel, double rhoA, double rhoB, double tauA, double tauB, double alpha,
+		double beta, double Fx, double Fy, double Fz, int strideY, int strideZ, int start, int finish, int lag,
+		int block, int Np);
+
+extern "C" void ScaLBL_D3Q19_AAeven_ColorFused(int *Map, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den,
+		double *Phi, double *Vel, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
+		double Fx, double Fy, double Fz, int strideY, int strideZ, int start, int finish, int lag, int block, int Np);
+
 extern "C" void ScaLBL_D3Q19_Gradient(int *Map, double *Phi, double *ColorGrad, int start, int finish, int Np, int Nx, int Ny, int Nz);
 
-extern "C" void ScaLBL_PhaseField_Init(int *Map, double *Phi, double *Den, double *Aq, double *Bq, int start, int finish, int Np);
+extern "C" void ScaLBL_PhaseField_Init(int *Map, double *Phi, double *Den, dist_t *Aq, dist_t *Bq, int start, int finish, int Np);
+
+// Sums used for the basic averages of SubPhase, computed directly on the compact arrays (Sums is a host array of 15):
+// non-wetting V, M, Px, Py, Pz; wetting V, M, Px, Py, Pz; non-wetting / wetting bulk pressure and count;
+// the pressure at the first interior site (i,j,k)=(1,1,1). Sites are restricted to i>=imin, j>=jmin, kmin<=k<kmax
+extern "C" void ScaLBL_D3Q19_PhaseSums(int *Map, dist_t *dist, double *Den, double *Vel, double *Sums,
+		double rhoA, double rhoB, int imin, int jmin, int kmin, int kmax, int strideY, int strideZ,
+		int start, int finish, int Np);
 
 // Density functional hydrodynamics LBM
-extern "C" void ScaLBL_DFH_Init(double *Phi, double *Den, double *Aq, double *Bq, int start, int finish, int Np);
+extern "C" void ScaLBL_DFH_Init(double *Phi, double *Den, dist_t *Aq, dist_t *Bq, int start, int finish, int Np);
 
-extern "C" void ScaLBL_D3Q19_AAeven_DFH(int *neighborList, double *dist, double *Aq, double *Bq, double *Den, double *Phi,
+extern "C" void ScaLBL_D3Q19_AAeven_DFH(int *neighborList, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, double *Phi,
 		double *Gradient, double *SolidForce, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int start, int finish, int Np);
 
-extern "C" void ScaLBL_D3Q19_AAodd_DFH(int *neighborList, double *dist, double *Aq, double *Bq, double *Den, 
+extern "C" void ScaLBL_D3Q19_AAodd_DFH(int *neighborList, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, 
 		double *Phi, double *Gradient, double *SolidForce, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int start, int finish, int Np);
 
-extern "C" void ScaLBL_D3Q7_AAodd_DFH(int *NeighborList, double *Aq, double *Bq, double *Den, double *Phi, int start, int finish, int Np);
+extern "C" void ScaLBL_D3Q7_AAodd_DFH(int *NeighborList, dist_t *Aq, dist_t *Bq, double *Den, double *Phi, int start, int finish, int Np);
 
-extern "C" void ScaLBL_D3Q7_AAeven_DFH(double *Aq, double *Bq, double *Den, double *Phi, int start, int finish, int Np);
+extern "C" void ScaLBL_D3Q7_AAeven_DFH(dist_t *Aq, dist_t *Bq, double *Den, double *Phi, int start, int finish, int Np);
 
 extern "C" void ScaLBL_D3Q19_Gradient_DFH(int *NeighborList, double *Phi, double *ColorGrad, int start, int finish, int Np);
 
@@ -121,18 +161,18 @@ extern "C" void ScaLBL_D3Q19_Gradient_DFH(int *NeighborList, double *Phi, double
 //extern "C" void ScaLBL_D3Q19_Pressure_BC_Z(double *disteven, double *distodd, double dout,
 //		int Nx, int Ny, int Nz, int outlet);
 
-extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_z(int *neighborList, int *list, double *dist, double din, int count, int Np);
+extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_z(int *neighborList, int *list, dist_t *dist, double din, int count, int Np);
 
-extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_Z(int *neighborList, int *list, double *dist, double dout, int count, int Np);
+extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_Z(int *neighborList, int *list, dist_t *dist, double dout, int count, int Np);
 
-extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_z(int *list, double *dist, double din, int count, int Np);
+extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_z(int *list, dist_t *dist, double din, int count, int Np);
 
-extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_Z(int *list, double *dist, double dout, int count, int Np);
+extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_Z(int *list, dist_t *dist, double dout, int count, int Np);
 
-extern "C" double ScaLBL_D3Q19_AAodd_Flux_BC_z(int *neighborList, int *list, double *dist, double flux, 
+extern "C" double ScaLBL_D3Q19_AAodd_Flux_BC_z(int *neighborList, int *list, dist_t *dist, double flux, 
 		double area, int count, int N);
 
-extern "C" double ScaLBL_D3Q19_AAeven_Flux_BC_z(int *list, double *dist, double flux, double area, 
+extern "C" double ScaLBL_D3Q19_AAeven_Flux_BC_z(int *list, dist_t *dist, double flux, double area, 
 		 int count, int N);
 
 extern "C" void ScaLBL_Color_BC_z(int *list, int *Map, double *Phi, double *Den, double vA, double vB, int count, int Np);
@@ -173,6 +213,9 @@ public:
 	int FirstInterior();
 	int LastInterior();
 	
+	// Order of the interior sites in MemoryOptimizedLayoutAA
+	// (Domain keys SiteOrdering = "ijk", "morton", "hilbert" or "brick", and BrickSize)
+	enum SiteOrderingType { ORDER_IJK, ORDER_MORTON, ORDER_HILBERT, ORDER_BRICK };
 	int MemoryOptimizedLayoutAA(IntArray &Map, int *neighborList, signed char *id, int Np);
 //	void MemoryOptimizedLayout(IntArray &Map, int *neighborList, char *id, int Np);
 //	void MemoryOptimizedLayoutFull(IntArray &Map, int *neighborList, char *id, int Np);
@@ -182,14 +225,17 @@ public:
 //	void RecvD3Q19(double *f_even, double *f_odd);
 //	void SendD3Q19AA(double *f_even, double *f_odd);
 //	void RecvD3Q19AA(double *f_even, double *f_odd);
-	void SendD3Q19AA(double *dist);
-	void RecvD3Q19AA(double *dist);
+	void SendD3Q19AA(dist_t *dist);
+	void RecvD3Q19AA(dist_t *dist);
 //	void BiSendD3Q7(double *A_even, double *A_odd, double *B_even, double *B_odd);
 //	void BiRecvD3Q7(double *A_even, double *A_odd, double *B_even, double *B_odd);
-	void BiSendD3Q7AA(double *Aq, double *Bq);
-	void BiRecvD3Q7AA(double *Aq, double *Bq);
-	void TriSendD3Q7AA(double *Aq, double *Bq, double *Cq);
-	void TriRecvD3Q7AA(double *Aq, double *Bq, double *Cq);
+	void BiSendD3Q7AA(dist_t *Aq, dist_t *Bq);
+	void BiRecvD3Q7AA(dist_t *Aq, dist_t *Bq);
+	void TriSendD3Q7AA(dist_t *Aq, dist_t *Bq, dist_t *Cq);
+	void TriRecvD3Q7AA(dist_t *Aq, dist_t *Bq, dist_t *Cq);
+	// Aggregated exchange: D3Q19 (fq) and D3Q7 (Aq, Bq) distributions sent in one message per neighbor
+	void SendD3Q19D3Q7AA(dist_t *fq, dist_t *Aq, dist_t *Bq);
+	void RecvD3Q19D3Q7AA(dist_t *fq, dist_t *Aq, dist_t *Bq);
 	void SendHalo(double *data);
 	void RecvHalo(double *data);
 	void RecvGrad(double *Phi, double *Gradient);
@@ -198,9 +244,9 @@ public:
 	// Routines to set boundary conditions
 	void Color_BC_z(int *Map, double *Phi, double *Den, double vA, double vB);
 	void Color_BC_Z(int *Map, double *Phi, double *Den, double vA, double vB);
-	void D3Q19_Pressure_BC_z(int *neighborList, double *fq, double din, int time);
-	void D3Q19_Pressure_BC_Z(int *neighborList, double *fq, double dout, int time);
-	double D3Q19_Flux_BC_z(int *neighborList, double *fq, double flux, int time);
+	void D3Q19_Pressure_BC_z(int *neighborList, dist_t *fq, double din, int time);
+	void D3Q19_Pressure_BC_Z(int *neighborList, dist_t *fq, double dout, int time);
+	double D3Q19_Flux_BC_z(int *neighborList, dist_t *fq, double flux, int time);
 
 //	void TestSendD3Q19(double *f_even, double *f_odd);
 //	void TestRecvD3Q19(double *f_even, double *f_odd);
@@ -212,6 +258,10 @@ private:
 	//void D3Q19_MapRecv_OLD(int q, int Cqx, int Cqy, int Cqz, int *list,  int start, int count, int *d3q19_recvlist);
 	void D3Q19_MapRecv(int Cqx, int Cqy, int Cqz, int *list,  int start, int count, int *d3q19_recvlist);
 
+	unsigned long long SiteKey(int i, int j, int k) const;
+	SiteOrderingType SiteOrdering;
+	int BrickSize;
+
 	bool Lock; 	// use Lock to make sure only one call at a time to protect data in transit
 	// only one set of Send requests can be active at any time (per instance)
 	int i,j,k,n;
@@ -259,6 +309,23 @@ private:
 	int *dvcRecvDist_xy, *dvcRecvDist_yz, *dvcRecvDist_xz, *dvcRecvDist_Xy, *dvcRecvDist_Yz, *dvcRecvDist_xZ;
 	int *dvcRecvDist_xY, *dvcRecvDist_yZ, *dvcRecvDist_Xz, *dvcRecvDist_XY, *dvcRecvDist_YZ, *dvcRecvDist_XZ;
 	//......................................................................................
+	// Fused pack / unpack for the AA distributions
+	//   neighbors are stored in send order x,X,y,Y,z,Z,xy,Xy,xY,XY,xz,xZ,Xz,XZ,yz,yZ,Yz,YZ
+	//   dvcPackDist[d] / dvcUnpackDist[d] hold the offset q*N+n of each value in the buffers for neighbor d
+	//   (built by SetupPackLists whenever the send and recieve lists change)
+	//......................................................................................
+	void SetupPackLists();
+	void StartPersistent(MPI_Request *req, int count);
+	int *dvcPackDist[18], *dvcUnpackDist[18];
+	double *nbr_sendbuf[18], *nbr_recvbuf[18];
+	int nbr_sendCount[18], nbr_recvCount[18], nbr_Q[18];
+	// Persistent requests (sends followed by recieves) created once in the constructor
+	MPI_Request req_D3Q19AA[36], req_BiD3Q7AA[12], req_TriD3Q7AA[12];
+	// Aggregated buffers: faces hold fq (5*count), Aq (count), Bq (count); edges hold fq (count)
+	double *agg_sendbuf[18], *agg_recvbuf[18];
+	MPI_Request req_AggAA[36];
+	MPI_Status stat_D3Q19AA[36];
+	//......................................................................................
 
 };
 
@@ -0,0 +1,31 @@
+/*
+  Copyright 2013--2018 James E. McClure, Virginia Polytechnic & State University
+
+  This file is part of the Open Porous Media project (OPM).
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* ScaLBL_Dist.h
+ *  Storage type for the lattice Boltzmann distributions (fq, Aq, Bq)
+ *     - USE_FLOAT_DIST stores the distributions in single precision
+ *     - kernels load into double, do all arithmetic in double and round on store
+ *  Restart files and communication buffers remain double precision
+ */
+#ifndef ScaLBL_Dist_H
+#define ScaLBL_Dist_H
+
+#ifdef USE_FLOAT_DIST
+typedef float dist_t;
+#else
+typedef double dist_t;
+#endif
+
+#endif
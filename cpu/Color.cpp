@@ -14,6 +14,8 @@
   along with OPM.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <math.h>
+#include "ScaLBL_omp.h"
+#include "common/ScaLBL_Dist.h"
 
 #define STOKES
 
@@ -1263,26 +1265,12 @@ extern "C" void ScaLBL_SetSlice_z(double *Phi, double value, int Nx, int Ny, int
 }
 
 
-//extern "C" void ScaLBL_D3Q19_AAeven_Color(double *dist, double *Aq, double *Bq, double *Den, double *Velocity,
+//extern "C" void ScaLBL_D3Q19_AAeven_Color(dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, double *Velocity,
 //		double *ColorGrad, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 //		double Fx, double Fy, double Fz, int start, int finish, int Np){
-extern "C" void ScaLBL_D3Q19_AAeven_Color(int *Map, double *dist, double *Aq, double *Bq, double *Den, double *Phi,
+extern "C" void ScaLBL_D3Q19_AAeven_Color(int *Map, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, double *Phi,
 		double *Vel, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int strideY, int strideZ, int start, int finish, int Np){
-
-	int ijk,nn,n;
-	double fq;
-	// conserved momemnts
-	double rho,jx,jy,jz;
-	// non-conserved moments
-	double m1,m2,m4,m6,m8,m9,m10,m11,m12,m13,m14,m15,m16,m17,m18;
-	double m3,m5,m7;
-	double nA,nB; // number density
-	double a1,b1,a2,b2,nAB,delta;
-	double C,nx,ny,nz; //color gradient magnitude and direction
-	double ux,uy,uz;
-	double phi,tau,rho0,rlx_setA,rlx_setB;
-	
 	const double mrt_V1=0.05263157894736842;
 	const double mrt_V2=0.012531328320802;
 	const double mrt_V3=0.04761904761904762;
@@ -1296,8 +1284,20 @@ extern "C" void ScaLBL_D3Q19_AAeven_Color(int *Map, double *dist, double *Aq, do
 	const double mrt_V11=0.01388888888888889;
 	const double mrt_V12=0.04166666666666666;
 
-
+	ScaLBL_SITE_LOOP
 	for (int n=start; n<finish; n++){
+		int ijk,nn;
+		double fq;
+		// conserved momemnts
+		double rho,jx,jy,jz;
+		// non-conserved moments
+		double m1,m2,m4,m6,m8,m9,m10,m11,m12,m13,m14,m15,m16,m17,m18;
+		double m3,m5,m7;
+		double nA,nB; // number density
+		double a1,b1,a2,b2,nAB,delta;
+		double C,nx,ny,nz; //color gradient magnitude and direction
+		double ux,uy,uz;
+		double phi,tau,rho0,rlx_setA,rlx_setB;
 		
 		// read the component number densities
 		nA = Den[n];
@@ -1846,29 +1846,13 @@ extern "C" void ScaLBL_D3Q19_AAeven_Color(int *Map, double *dist, double *Aq, do
 	
 }
 
-//extern "C" void ScaLBL_D3Q19_AAodd_Color(int *neighborList, double *dist, double *Aq, double *Bq, double *Den, double *Velocity,
+//extern "C" void ScaLBL_D3Q19_AAodd_Color(int *neighborList, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, double *Velocity,
 //		double *ColorGrad, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 //		double Fx, double Fy, double Fz, int start, int finish, int Np){
-extern "C" void ScaLBL_D3Q19_AAodd_Color(int *neighborList, int *Map, double *dist, double *Aq, double *Bq, double *Den, 
+extern "C" void ScaLBL_D3Q19_AAodd_Color(int *neighborList, int *Map, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, 
 		double *Phi, double *Vel, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int strideY, int strideZ, int start, int finish, int Np){
-	
-	int n,nn,ijk,nread;
-	int nr1,nr2,nr3,nr4,nr5,nr6;
-	int nr7,nr8,nr9,nr10;
-	int nr11,nr12,nr13,nr14;
 	//int nr15,nr16,nr17,nr18;
-	double fq;
-	// conserved momemnts
-	double rho,jx,jy,jz;
-	// non-conserved moments
-	double m1,m2,m4,m6,m8,m9,m10,m11,m12,m13,m14,m15,m16,m17,m18;
-	double m3,m5,m7;
-	double nA,nB; // number density
-	double a1,b1,a2,b2,nAB,delta;
-	double C,nx,ny,nz; //color gradient magnitude and direction
-	double ux,uy,uz;
-	double phi,tau,rho0,rlx_setA,rlx_setB;
 
 	const double mrt_V1=0.05263157894736842;
 	const double mrt_V2=0.012531328320802;
@@ -1883,7 +1867,23 @@ extern "C" void ScaLBL_D3Q19_AAodd_Color(int *neighborList, int *Map, double *di
 	const double mrt_V11=0.01388888888888889;
 	const double mrt_V12=0.04166666666666666;
 
+	ScaLBL_SITE_LOOP
 	for (int n=start; n<finish; n++){
+		int nn,ijk,nread;
+		int nr1,nr2,nr3,nr4,nr5,nr6;
+		int nr7,nr8,nr9,nr10;
+		int nr11,nr12,nr13,nr14;
+		double fq;
+		// conserved momemnts
+		double rho,jx,jy,jz;
+		// non-conserved moments
+		double m1,m2,m4,m6,m8,m9,m10,m11,m12,m13,m14,m15,m16,m17,m18;
+		double m3,m5,m7;
+		double nA,nB; // number density
+		double a1,b1,a2,b2,nAB,delta;
+		double C,nx,ny,nz; //color gradient magnitude and direction
+		double ux,uy,uz;
+		double phi,tau,rho0,rlx_setA,rlx_setB;
 		
 		// read the component number densities
 		nA = Den[n];
@@ -2504,13 +2504,12 @@ extern "C" void ScaLBL_D3Q19_AAodd_Color(int *neighborList, int *Map, double *di
 	}	
 }
 
-extern "C" void ScaLBL_D3Q7_AAodd_PhaseField(int *neighborList, int *Map, double *Aq, double *Bq, 
+extern "C" void ScaLBL_D3Q7_AAodd_PhaseField(int *neighborList, int *Map, dist_t *Aq, dist_t *Bq, 
 			double *Den, double *Phi, int start, int finish, int Np){
-
-	int idx,n,nread;
-	double fq,nA,nB;
-
+	ScaLBL_SITE_LOOP
 	for (int n=start; n<finish; n++){
+		int idx,nread;
+		double fq,nA,nB;
 		
 		//..........Compute the number density for component A............
 		// q=0
@@ -2592,11 +2591,12 @@ extern "C" void ScaLBL_D3Q7_AAodd_PhaseField(int *neighborList, int *Map, double
 	}
 }
 
-extern "C" void ScaLBL_D3Q7_AAeven_PhaseField(int *Map, double *Aq, double *Bq, double *Den, double *Phi, 
+extern "C" void ScaLBL_D3Q7_AAeven_PhaseField(int *Map, dist_t *Aq, dist_t *Bq, double *Den, double *Phi, 
 			int start, int finish, int Np){
-	int idx,n,nread;
-	double fq,nA,nB;
+	ScaLBL_SITE_LOOP
 	for (int n=start; n<finish; n++){
+		int idx,nread;
+		double fq,nA,nB;
 		
 		// compute number density for component A
 		// q=0
@@ -2666,14 +2666,55 @@ extern "C" void ScaLBL_D3Q7_AAeven_PhaseField(int *Map, double *Aq, double *Bq,
 	}	
 }
 
-extern "C" void ScaLBL_D3Q19_Gradient(int *Map, double *phi, double *ColorGrad, int start, int finish, int Np, int Nx, int Ny, int Nz){
-	int idx,n,N,i,j,k,nn;
-	// distributions
-	double f1,f2,f3,f4,f5,f6,f7,f8,f9;
-	double f10,f11,f12,f13,f14,f15,f16,f17,f18;
-	double nx,ny,nz;
+// Fused phase field + color collision over the range [start,finish)
+// The phase field is computed one block ahead of the collision. The collision at site n reads
+// Phi from neighbors with compact index up to n+lag, so the collision trails the phase field
+// by lag sites. Within a half-step each site owns its own Aq/Bq slots, so the phase field for
+// site n is always read before the collision at site n overwrites them.
+extern "C" void ScaLBL_D3Q19_AAodd_ColorFused(int *neighborList, int *Map, dist_t *dist, dist_t *Aq, dist_t *Bq,
+		double *Den, double *Phi, double *Vel, double rhoA, double rhoB, double tauA, double tauB, double alpha,
+		double beta, double Fx, double Fy, double Fz, int strideY, int strideZ, int start, int finish, int lag,
+		int block, int Np){
+	if (block < 1) block = finish-start;
+	int collided = start;
+	for (int n=start; n<finish; n+=block){
+		int next = (n+block < finish) ? n+block : finish;
+		ScaLBL_D3Q7_AAodd_PhaseField(neighborList, Map, Aq, Bq, Den, Phi, n, next, Np);
+		// once the phase field is complete the remaining sites can all be collided
+		int limit = (next == finish) ? finish : next-lag;
+		if (limit > collided){
+			ScaLBL_D3Q19_AAodd_Color(neighborList, Map, dist, Aq, Bq, Den, Phi, Vel, rhoA, rhoB, tauA, tauB,
+					alpha, beta, Fx, Fy, Fz, strideY, strideZ, collided, limit, Np);
+			collided = limit;
+		}
+	}
+}
 
-	for (idx=0; idx<Np; idx++){
+extern "C" void ScaLBL_D3Q19_AAeven_ColorFused(int *Map, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den,
+		double *Phi, double *Vel, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
+		double Fx, double Fy, double Fz, int strideY, int strideZ, int start, int finish, int lag, int block, int Np){
+	if (block < 1) block = finish-start;
+	int collided = start;
+	for (int n=start; n<finish; n+=block){
+		int next = (n+block < finish) ? n+block : finish;
+		ScaLBL_D3Q7_AAeven_PhaseField(Map, Aq, Bq, Den, Phi, n, next, Np);
+		int limit = (next == finish) ? finish : next-lag;
+		if (limit > collided){
+			ScaLBL_D3Q19_AAeven_Color(Map, dist, Aq, Bq, Den, Phi, Vel, rhoA, rhoB, tauA, tauB,
+					alpha, beta, Fx, Fy, Fz, strideY, strideZ, collided, limit, Np);
+			collided = limit;
+		}
+	}
+}
+
+extern "C" void ScaLBL_D3Q19_Gradient(int *Map, double *phi, double *ColorGrad, int start, int finish, int Np, int Nx, int Ny, int Nz){
+	ScaLBL_SITE_LOOP
+	for (int idx=0; idx<Np; idx++){
+		int n,N,i,j,k,nn;
+		// distributions
+		double f1,f2,f3,f4,f5,f6,f7,f8,f9;
+		double f10,f11,f12,f13,f14,f15,f16,f17,f18;
+		double nx,ny,nz;
 
 		// Get the 1D index based on regular data layout
 		n = Map[idx];
@@ -2786,11 +2827,11 @@ extern "C" void ScaLBL_D3Q19_Gradient(int *Map, double *phi, double *ColorGrad,
 	}
 }
 
-extern "C" void ScaLBL_PhaseField_Init(int *Map, double *Phi, double *Den, double *Aq, double *Bq, int start, int finish, int Np){
-	int idx,n;
-	double phi,nA,nB;
-
-	for (idx=start; idx<finish; idx++){
+extern "C" void ScaLBL_PhaseField_Init(int *Map, double *Phi, double *Den, dist_t *Aq, dist_t *Bq, int start, int finish, int Np){
+	ScaLBL_SITE_LOOP
+	for (int idx=start; idx<finish; idx++){
+		int n;
+		double phi,nA,nB;
 
 		n = Map[idx];
 		phi = Phi[n];
@@ -2825,3 +2866,59 @@ extern "C" void ScaLBL_PhaseField_Init(int *Map, double *Phi, double *Den, doubl
 	}
 }
 
+
+extern "C" void ScaLBL_D3Q19_PhaseSums(int *Map, dist_t *dist, double *Den, double *Vel, double *Sums,
+		double rhoA, double rhoB, int imin, int jmin, int kmin, int kmax, int strideY, int strideZ,
+		int start, int finish, int Np){
+	// same selection and sums as SubPhase::Basic, without copying to the regular layout
+	double sum[15];
+	for (int m=0; m<15; m++) sum[m] = 0.0;
+	int origin = strideZ + strideY + 1;
+#ifdef USE_OPENMP
+	#pragma omp parallel for schedule(static) reduction(+:sum[:15])
+#endif
+	for (int n=start; n<finish; n++){
+		int idx = Map[n];
+		if (idx < 0) continue;
+		int k = idx/strideZ;
+		int j = (idx-k*strideZ)/strideY;
+		int i = idx-k*strideZ-j*strideY;
+		bool inside = !(i < imin || j < jmin || k < kmin || !(k < kmax));
+		double nA = Den[n];
+		double nB = Den[Np+n];
+		double phi = (nA-nB)/(nA+nB);
+		if (inside){
+			if (phi > 0.0){
+				sum[0] += 1.0;
+				sum[1] += rhoA;
+				sum[2] += rhoA*Vel[n];
+				sum[3] += rhoA*Vel[Np+n];
+				sum[4] += rhoA*Vel[2*Np+n];
+			}
+			else{
+				sum[5] += 1.0;
+				sum[6] += rhoB;
+				sum[7] += rhoB*Vel[n];
+				sum[8] += rhoB*Vel[Np+n];
+				sum[9] += rhoB*Vel[2*Np+n];
+			}
+		}
+		// the pressure (as in ScaLBL_D3Q19_Pressure) is only needed in the bulk phases
+		if (idx == origin || (inside && (phi > 0.99 || phi < -0.99))){
+			double f[19];
+			for (int q=0; q<19; q++) f[q] = dist[q*Np+n];
+			double p = 0.3333333333333333*(f[0]+f[2]+f[1]+f[4]+f[3]+f[6]+f[5]+f[8]+f[7]+f[10]+
+					f[9]+f[12]+f[11]+f[14]+f[13]+f[16]+f[15]+f[18]+f[17]);
+			if (idx == origin) sum[14] += p;
+			if (inside && phi > 0.99){
+				sum[10] += p;
+				sum[11] += 1.0;
+			}
+			else if (inside && phi < -0.99){
+				sum[12] += p;
+				sum[13] += 1.0;
+			}
+		}
+	}
+	for (int m=0; m<15; m++) Sums[m] = sum[m];
+}
@@ -14,8 +14,10 @@
   along with OPM.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdio.h>
+#include "ScaLBL_omp.h"
+#include "common/ScaLBL_Dist.h"
 
-extern "C" void ScaLBL_D3Q19_Pack(int q, int *list, int start, int count, double *sendbuf, double *dist, int N){
+extern "C" void ScaLBL_D3Q19_Pack(int q, int *list, int start, int count, double *sendbuf, dist_t *dist, int N){
 	//....................................................................................
 	// Pack distribution q into the send buffer for the listed lattice sites
 	// dist may be even or odd distributions stored by stream layout
@@ -28,7 +30,7 @@ extern "C" void ScaLBL_D3Q19_Pack(int q, int *list, int start, int count, double
 }
 
 extern "C" void ScaLBL_D3Q19_Unpack(int q, int *list,  int start, int count,
-		double *recvbuf, double *dist, int N){
+		double *recvbuf, dist_t *dist, int N){
 	//....................................................................................
 	// Unack distribution from the recv buffer
 	// Distribution q matche Cqx, Cqy, Cqz
@@ -46,6 +48,27 @@ extern "C" void ScaLBL_D3Q19_Unpack(int q, int *list,  int start, int count,
 	}
 }
 
+extern "C" void ScaLBL_PackDist(int *list, int count, double *sendbuf, dist_t *dist){
+	//....................................................................................
+	// Pack all distributions sent to one neighbor in a single pass
+	// list holds the offset q*N+n for each entry of the send buffer
+	//....................................................................................
+	for (int idx=0; idx<count; idx++){
+		sendbuf[idx] = dist[list[idx]];
+	}
+}
+
+extern "C" void ScaLBL_UnpackDist(int *list, int count, double *recvbuf, dist_t *dist){
+	//....................................................................................
+	// Unpack all distributions recieved from one neighbor in a single pass
+	// list holds the offset q*N+n for each entry of the recv buffer (negative to skip)
+	//....................................................................................
+	for (int idx=0; idx<count; idx++){
+		int n = list[idx];
+		if (!(n<0)) dist[n] = recvbuf[idx];
+	}
+}
+
 extern "C" void ScaLBL_D3Q19_AA_Init(double *f_even, double *f_odd, int Np)
 {
 	int n;
@@ -73,10 +96,11 @@ extern "C" void ScaLBL_D3Q19_AA_Init(double *f_even, double *f_odd, int Np)
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_Init(double *dist, int Np)
+extern "C" void ScaLBL_D3Q19_Init(dist_t *dist, int Np)
 {
-	int n;
-	for (n=0; n<Np; n++){
+	ScaLBL_SITE_LOOP
+	for (int n=0; n<Np; n++){
+
 		dist[n] = 0.3333333333333333;
 		dist[Np+n] = 0.055555555555555555;		//double(100*n)+1.f;
 		dist[2*Np+n] = 0.055555555555555555;	//double(100*n)+2.f;
@@ -302,7 +326,7 @@ extern "C" double ScaLBL_D3Q19_Flux_BC_z(double *disteven, double *distodd, doub
 	return din;
 }
 
-extern "C" double ScaLBL_D3Q19_AAodd_Flux_BC_z(int *d_neighborList, int *list, double *dist, double flux, 
+extern "C" double ScaLBL_D3Q19_AAodd_Flux_BC_z(int *d_neighborList, int *list, dist_t *dist, double flux, 
 		double area, int count, int Np){
 	int idx, n;
 	int nread;
@@ -363,7 +387,7 @@ extern "C" double ScaLBL_D3Q19_AAodd_Flux_BC_z(int *d_neighborList, int *list, d
 	return sum;
 }
 
-extern "C" double ScaLBL_D3Q19_AAeven_Flux_BC_z(int *list, double *dist, double flux, double area, 
+extern "C" double ScaLBL_D3Q19_AAeven_Flux_BC_z(int *list, dist_t *dist, double flux, double area, 
 		 int count, int Np){
 	int idx, n;
 	// distributions
@@ -442,7 +466,7 @@ extern "C" double ScaLBL_D3Q19_Flux_BC_Z(double *disteven, double *distodd, doub
 	return dout;
 }
 
-extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_z(int *list, double *dist, double din, int count, int Np)
+extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_z(int *list, dist_t *dist, double din, int count, int Np)
 {
 	int idx, n;
 	// distributions
@@ -489,7 +513,7 @@ extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_z(int *list, double *dist, doubl
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_Z(int *list, double *dist, double dout, int count, int Np)
+extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_Z(int *list, dist_t *dist, double dout, int count, int Np)
 {
 	int idx, n;
 	// distributions
@@ -540,7 +564,7 @@ extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_Z(int *list, double *dist, doubl
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_z(int *d_neighborList, int *list, double *dist, double din, int count, int Np)
+extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_z(int *d_neighborList, int *list, dist_t *dist, double din, int count, int Np)
 {
 	int idx, n;
 	int nread;
@@ -624,7 +648,7 @@ extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_z(int *d_neighborList, int *list,
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_Z(int *d_neighborList, int *list, double *dist, double dout, int count, int Np)
+extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_Z(int *d_neighborList, int *list, dist_t *dist, double dout, int count, int Np)
 {
 	int idx,n,nread;
 	int nr6,nr12,nr13,nr16,nr17;
@@ -964,7 +988,7 @@ extern "C" void ScaLBL_D3Q19_Velocity_BC_Z(double *disteven, double *distodd, do
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_Momentum(double *dist, double *vel, int Np)
+extern "C" void ScaLBL_D3Q19_Momentum(dist_t *dist, double *vel, int Np)
 {
 	int n;
 	int N =Np;
@@ -1008,7 +1032,7 @@ extern "C" void ScaLBL_D3Q19_Momentum(double *dist, double *vel, int Np)
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_Pressure(double *dist, double *Pressure, int N)
+extern "C" void ScaLBL_D3Q19_Pressure(dist_t *dist, double *Pressure, int N)
 {
 	int n;
 	// distributions
@@ -1045,15 +1069,8 @@ extern "C" void ScaLBL_D3Q19_Pressure(double *dist, double *Pressure, int N)
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_AAeven_MRT(double *dist, int start, int finish, int Np, double rlx_setA, double rlx_setB, double Fx,
+extern "C" void ScaLBL_D3Q19_AAeven_MRT(dist_t *dist, int start, int finish, int Np, double rlx_setA, double rlx_setB, double Fx,
 		double Fy, double Fz){
-	int n;
-	double fq,fp;
-	// conserved momemnts
-	double rho,jx,jy,jz;
-	// non-conserved moments
-	double m1,m2,m4,m6,m8,m9,m10,m11,m12,m13,m14,m15,m16,m17,m18;
-
 	const double mrt_V1=0.05263157894736842;
 	const double mrt_V2=0.012531328320802;
 	const double mrt_V3=0.04761904761904762;
@@ -1067,8 +1084,14 @@ extern "C" void ScaLBL_D3Q19_AAeven_MRT(double *dist, int start, int finish, int
 	const double mrt_V11=0.01388888888888889;
 	const double mrt_V12=0.04166666666666666;
 
-
+	ScaLBL_SITE_LOOP
 	for (int n=start; n<finish; n++){
+		double fq,fp;
+		// conserved momemnts
+		double rho,jx,jy,jz;
+		// non-conserved moments
+		double m1,m2,m4,m6,m8,m9,m10,m11,m12,m13,m14,m15,m16,m17,m18;
+
 		// q=0
 		fq = dist[n];
 		rho = fq;
@@ -1476,14 +1499,8 @@ extern "C" void ScaLBL_D3Q19_AAeven_MRT(double *dist, int start, int finish, int
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_AAodd_MRT(int *neighborList, double *dist, int start, int finish, int Np, double rlx_setA, double rlx_setB, double Fx,
+extern "C" void ScaLBL_D3Q19_AAodd_MRT(int *neighborList, dist_t *dist, int start, int finish, int Np, double rlx_setA, double rlx_setB, double Fx,
 		double Fy, double Fz){
-	int n;
-	double fq,fp;
-	// conserved momemnts
-	double rho,jx,jy,jz;
-	// non-conserved moments
-	double m1,m2,m4,m6,m8,m9,m10,m11,m12,m13,m14,m15,m16,m17,m18;
 	const double mrt_V1=0.05263157894736842;
 	const double mrt_V2=0.012531328320802;
 	const double mrt_V3=0.04761904761904762;
@@ -1497,9 +1514,15 @@ extern "C" void ScaLBL_D3Q19_AAodd_MRT(int *neighborList, double *dist, int star
 	const double mrt_V11=0.01388888888888889;
 	const double mrt_V12=0.04166666666666666;
 
-
-	int nread;
+	ScaLBL_SITE_LOOP
 	for (int n=start; n<finish; n++){
+		double fq,fp;
+		// conserved momemnts
+		double rho,jx,jy,jz;
+		// non-conserved moments
+		double m1,m2,m4,m6,m8,m9,m10,m11,m12,m13,m14,m15,m16,m17,m18;
+		int nread;
+
 		// q=0
 		fq = dist[n];
 		rho = fq;
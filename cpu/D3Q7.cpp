@@ -14,6 +14,7 @@
   along with OPM.  If not, see <http://www.gnu.org/licenses/>.
 */
 // CPU Functions for D3Q7 Lattice Boltzmann Methods
+#include "common/ScaLBL_Dist.h"
 
 extern "C" void ScaLBL_Scalar_Pack(int *list, int count, double *sendbuf, double *Data, int N){
 	//....................................................................................
@@ -39,7 +40,7 @@ extern "C" void ScaLBL_Scalar_Unpack(int *list, int count, double *recvbuf, doub
 }
 
 extern "C" void ScaLBL_D3Q7_Unpack(int q, int *list,  int start, int count,
-		double *recvbuf, double *dist, int N){
+		double *recvbuf, dist_t *dist, int N){
 	//....................................................................................
 	// Unack distribution from the recv buffer
 	// Distribution q matche Cqx, Cqy, Cqz
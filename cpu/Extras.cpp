@@ -18,8 +18,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <mm_malloc.h>
+#include "ScaLBL_omp.h"
+#include "common/ScaLBL_Dist.h"
 
 extern "C" int ScaLBL_SetDevice(int rank){
+#ifdef USE_OPENMP
+	if (rank==0) printf("MPI rank=%i will use %i OpenMP threads \n",rank,omp_get_max_threads());
+#endif
 	return 0;
 }
 
@@ -43,10 +48,56 @@ extern "C" void ScaLBL_AllocateDeviceMemory(void** address, size_t size){
 	}
 }
 
+// First touch the sites [start,finish) of a block with the partition of the kernel loops
+static void FirstTouchSites(char *block, size_t site_size, int start, int finish){
+#ifdef USE_OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int n=start; n<finish; n++)
+		memset(&block[n*site_size],0,site_size);
+}
+
+extern "C" void ScaLBL_AllocateSiteMemory(void** address, size_t size, size_t stride, int Np,
+		int LastExterior, int FirstInterior, int LastInterior){
+	(*address) = _mm_malloc(size,64);
+	if (*address==NULL){
+		printf("Memory allocation failed! \n");
+		return;
+	}
+	char *data = (char *) (*address);
+	size_t count = (stride > 0) ? size/stride : 0;
+	if (Np <= 0 || stride%Np != 0 || LastInterior > Np){
+		memset(data,0,size);
+		return;
+	}
+	// the kernels update [0,LastExterior) and [FirstInterior,LastInterior) of each block in
+	// separate loops, so each range is first touched with its own static schedule
+	size_t site_size = stride/Np;
+	for (size_t q=0; q<count; q++){
+		char *block = &data[q*stride];
+		FirstTouchSites(block,site_size,0,LastExterior);
+		memset(&block[LastExterior*site_size],0,(FirstInterior-LastExterior)*site_size);
+		FirstTouchSites(block,site_size,FirstInterior,LastInterior);
+		memset(&block[LastInterior*site_size],0,(Np-LastInterior)*site_size);
+	}
+	memset(&data[count*stride],0,size-count*stride);
+}
+
 extern "C" void ScaLBL_FreeDeviceMemory(void* pointer){
 	_mm_free(pointer);
 }
 
+extern "C" void ScaLBL_AllocateHostMemory(void** address, size_t size){
+	(*address) = _mm_malloc(size,64);
+	if (*address==NULL){
+		printf("Memory allocation failed! \n");
+	}
+}
+
+extern "C" void ScaLBL_FreeHostMemory(void* pointer){
+	_mm_free(pointer);
+}
+
 extern "C" void ScaLBL_CopyToDevice(void* dest, const void* source, size_t size){
 //	cudaMemcpy(dest,source,size,cudaMemcpyHostToDevice);
 	memcpy(dest, source, size);
@@ -58,6 +109,16 @@ extern "C" void ScaLBL_CopyToHost(void* dest, const void* source, size_t size){
 	memcpy(dest, source, size);
 }
 
+extern "C" void ScaLBL_CopyDistToDevice(dist_t* dest, const double* source, size_t count){
+	ScaLBL_SITE_LOOP
+	for (size_t n=0; n<count; n++) dest[n] = source[n];
+}
+
+extern "C" void ScaLBL_CopyDistToHost(double* dest, const dist_t* source, size_t count){
+	ScaLBL_SITE_LOOP
+	for (size_t n=0; n<count; n++) dest[n] = source[n];
+}
+
 extern "C" void ScaLBL_CopyToZeroCopy(void* dest, const void* source, size_t size){
 //	cudaMemcpy(dest,source,size,cudaMemcpyDeviceToHost);
 	memcpy(dest, source, size);
@@ -0,0 +1,41 @@
+/*
+  Copyright 2013--2018 James E. McClure, Virginia Polytechnic & State University
+
+  This file is part of the Open Porous Media project (OPM).
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* ScaLBL_omp.h
+ *  Loop annotations for the CPU kernels
+ *     - USE_OPENMP threads the site loop over [start,finish) with a static schedule
+ *     - USE_SIMD vectorizes the site loop
+ *  ScaLBL_AllocateSiteMemory first-touches the exterior and interior sites with the same
+ *  static schedule, so the kernel loops over [0,LastExterior) and [FirstInterior,LastInterior)
+ *  annotated with ScaLBL_SITE_LOOP update pages on their own NUMA node
+ */
+#ifndef ScaLBL_omp_H
+#define ScaLBL_omp_H
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#if defined(USE_OPENMP) && defined(USE_SIMD)
+#define ScaLBL_SITE_LOOP _Pragma("omp parallel for simd schedule(static)")
+#elif defined(USE_OPENMP)
+#define ScaLBL_SITE_LOOP _Pragma("omp parallel for schedule(static)")
+#elif defined(USE_SIMD)
+#define ScaLBL_SITE_LOOP _Pragma("omp simd")
+#else
+#define ScaLBL_SITE_LOOP
+#endif
+
+#endif
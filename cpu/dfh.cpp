@@ -30,6 +30,8 @@
 */
 #include <math.h>
 #include <stdio.h>
+#include "ScaLBL_omp.h"
+#include "common/ScaLBL_Dist.h"
 
 extern "C" void ScaLBL_Gradient_Unpack(double weight, double Cqx, double Cqy, double Cqz, 
 		int *list, int start, int count, double *recvbuf, double *phi, double *grad, int N){
@@ -53,11 +55,12 @@ extern "C" void ScaLBL_Gradient_Unpack(double weight, double Cqx, double Cqy, do
 	}
 }
 
-extern "C" void ScaLBL_DFH_Init(double *Phi, double *Den, double *Aq, double *Bq, int start, int finish, int Np){
-	int idx,n;
-	double phi,nA,nB;
+extern "C" void ScaLBL_DFH_Init(double *Phi, double *Den, dist_t *Aq, dist_t *Bq, int start, int finish, int Np){
+	ScaLBL_SITE_LOOP
+	for (int idx=start; idx<finish; idx++){
+		int n;
+		double phi,nA,nB;
 
-	for (idx=start; idx<finish; idx++){
 		phi = Phi[idx];
 		if (phi > 0.f){
 			nA = 1.0; nB = 0.f;
@@ -88,24 +91,9 @@ extern "C" void ScaLBL_DFH_Init(double *Phi, double *Den, double *Aq, double *Bq
 
 
 // LBM based on density functional hydrodynamics
-extern "C" void ScaLBL_D3Q19_AAeven_DFH(int *neighborList, double *dist, double *Aq, double *Bq, double *Den, double *Phi,
+extern "C" void ScaLBL_D3Q19_AAeven_DFH(int *neighborList, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, double *Phi,
 		double *Gradient, double *SolidForce, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int start, int finish, int Np){
-
-	int ijk,nn,n;
-	double fq;
-	// conserved momemnts
-	double rho,jx,jy,jz;
-	// non-conserved moments
-	double m1,m2,m4,m6,m8,m9,m10,m11,m12,m13,m14,m15,m16,m17,m18;
-	double m3,m5,m7;
-	double nA,nB; // number density
-	double a1,b1,a2,b2,nAB,delta;
-	double C,nx,ny,nz; //color gradient magnitude and direction
-	double ux,uy,uz;
-	double phi,tau,rho0,rlx_setA,rlx_setB;
-	double force_x,force_y,force_z;
-	
 	const double mrt_V1=0.05263157894736842;
 	const double mrt_V2=0.012531328320802;
 	const double mrt_V3=0.04761904761904762;
@@ -119,8 +107,21 @@ extern "C" void ScaLBL_D3Q19_AAeven_DFH(int *neighborList, double *dist, double
 	const double mrt_V11=0.01388888888888889;
 	const double mrt_V12=0.04166666666666666;
 
-
+	ScaLBL_SITE_LOOP
 	for (int n=start; n<finish; n++){
+		int ijk,nn;
+		double fq;
+		// conserved momemnts
+		double rho,jx,jy,jz;
+		// non-conserved moments
+		double m1,m2,m4,m6,m8,m9,m10,m11,m12,m13,m14,m15,m16,m17,m18;
+		double m3,m5,m7;
+		double nA,nB; // number density
+		double a1,b1,a2,b2,nAB,delta;
+		double C,nx,ny,nz; //color gradient magnitude and direction
+		double ux,uy,uz;
+		double phi,tau,rho0,rlx_setA,rlx_setB;
+		double force_x,force_y,force_z;
 		
 		// read the component number densities
 		nA = Den[n];
@@ -612,27 +613,10 @@ extern "C" void ScaLBL_D3Q19_AAeven_DFH(int *neighborList, double *dist, double
 	
 }
 
-extern "C" void ScaLBL_D3Q19_AAodd_DFH(int *neighborList, double *dist, double *Aq, double *Bq, double *Den, 
+extern "C" void ScaLBL_D3Q19_AAodd_DFH(int *neighborList, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, 
 		double *Phi, double *Gradient, double *SolidForce, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int start, int finish, int Np){
-	
-	int n,nn,ijk,nread;
-	int nr1,nr2,nr3,nr4,nr5,nr6;
-	int nr7,nr8,nr9,nr10;
-	int nr11,nr12,nr13,nr14;
 	//int nr15,nr16,nr17,nr18;
-	double fq;
-	// conserved momemnts
-	double rho,jx,jy,jz;
-	// non-conserved moments
-	double m1,m2,m4,m6,m8,m9,m10,m11,m12,m13,m14,m15,m16,m17,m18;
-	double m3,m5,m7;
-	double nA,nB; // number density
-	double a1,b1,a2,b2,nAB,delta;
-	double C,nx,ny,nz; //color gradient magnitude and direction
-	double ux,uy,uz;
-	double phi,tau,rho0,rlx_setA,rlx_setB;
-	double force_x,force_y,force_z;
 
 	const double mrt_V1=0.05263157894736842;
 	const double mrt_V2=0.012531328320802;
@@ -647,7 +631,24 @@ extern "C" void ScaLBL_D3Q19_AAodd_DFH(int *neighborList, double *dist, double *
 	const double mrt_V11=0.01388888888888889;
 	const double mrt_V12=0.04166666666666666;
 
+	ScaLBL_SITE_LOOP
 	for (int n=start; n<finish; n++){
+		int nn,ijk,nread;
+		int nr1,nr2,nr3,nr4,nr5,nr6;
+		int nr7,nr8,nr9,nr10;
+		int nr11,nr12,nr13,nr14;
+		double fq;
+		// conserved momemnts
+		double rho,jx,jy,jz;
+		// non-conserved moments
+		double m1,m2,m4,m6,m8,m9,m10,m11,m12,m13,m14,m15,m16,m17,m18;
+		double m3,m5,m7;
+		double nA,nB; // number density
+		double a1,b1,a2,b2,nAB,delta;
+		double C,nx,ny,nz; //color gradient magnitude and direction
+		double ux,uy,uz;
+		double phi,tau,rho0,rlx_setA,rlx_setB;
+		double force_x,force_y,force_z;
 		
 		// read the component number densities
 		nA = Den[n];
@@ -1211,13 +1212,12 @@ extern "C" void ScaLBL_D3Q19_AAodd_DFH(int *neighborList, double *dist, double *
 	}	
 }
 
-extern "C" void ScaLBL_D3Q7_AAodd_DFH(int *neighborList, double *Aq, double *Bq, 
+extern "C" void ScaLBL_D3Q7_AAodd_DFH(int *neighborList, dist_t *Aq, dist_t *Bq, 
 			double *Den, double *Phi, int start, int finish, int Np){
-
-	int idx,n,nread;
-	double fq,nA,nB;
-
+	ScaLBL_SITE_LOOP
 	for (int n=start; n<finish; n++){
+		int idx,nread;
+		double fq,nA,nB;
 		
 		//..........Compute the number density for component A............
 		// q=0
@@ -1299,11 +1299,12 @@ extern "C" void ScaLBL_D3Q7_AAodd_DFH(int *neighborList, double *Aq, double *Bq,
 	}
 }
 
-extern "C" void ScaLBL_D3Q7_AAeven_DFH(double *Aq, double *Bq, double *Den, double *Phi, 
+extern "C" void ScaLBL_D3Q7_AAeven_DFH(dist_t *Aq, dist_t *Bq, double *Den, double *Phi, 
 			int start, int finish, int Np){
-	int idx,n,nread;
-	double fq,nA,nB;
+	ScaLBL_SITE_LOOP
 	for (int n=start; n<finish; n++){
+		int idx,nread;
+		double fq,nA,nB;
 		
 		// compute number density for component A
 		// q=0
@@ -1374,17 +1375,14 @@ extern "C" void ScaLBL_D3Q7_AAeven_DFH(double *Aq, double *Bq, double *Den, doub
 }
 
 extern "C" void ScaLBL_D3Q19_Gradient_DFH(int *neighborList, double *Phi, double *ColorGrad, int start, int finish, int Np){
-	
-	int n,nn;
-	// distributions
-	double m1,m2,m4,m6,m8,m9,m10,m11,m12,m13,m14,m15,m16,m17,m18;
-	double m3,m5,m7;
-	double nx,ny,nz;
-
-	// non-conserved moments
-	// additional variables needed for computations
+	ScaLBL_SITE_LOOP
+	for (int n=start; n<finish; n++){
+		int nn;
+		// distributions
+		double m1,m2,m4,m6,m8,m9,m10,m11,m12,m13,m14,m15,m16,m17,m18;
+		double m3,m5,m7;
+		double nx,ny,nz;
 
-	for (n=start; n<finish; n++){
 		nn = neighborList[n+Np]%Np;
 		m1 = Phi[nn];
 		nn = neighborList[n]%Np;
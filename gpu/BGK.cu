@@ -14,11 +14,12 @@
   along with OPM.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdio.h>
+#include "common/ScaLBL_Dist.h"
 
 #define NBLOCKS 1024
 #define NTHREADS 256
 
-__global__ void dvc_ScaLBL_D3Q19_AAeven_BGK(double *dist, int start, int finish, int Np, double rlx, double Fx, double Fy, double Fz){
+__global__ void dvc_ScaLBL_D3Q19_AAeven_BGK(dist_t *dist, int start, int finish, int Np, double rlx, double Fx, double Fy, double Fz){
 	int n;
 	// conserved momemnts
 	double rho,ux,uy,uz,uu;
@@ -136,7 +137,7 @@ __global__ void dvc_ScaLBL_D3Q19_AAeven_BGK(double *dist, int start, int finish,
 	}
 }
 
-__global__ void dvc_ScaLBL_D3Q19_AAodd_BGK(int *neighborList, double *dist, int start, int finish, int Np, double rlx, double Fx, double Fy, double Fz){
+__global__ void dvc_ScaLBL_D3Q19_AAodd_BGK(int *neighborList, dist_t *dist, int start, int finish, int Np, double rlx, double Fx, double Fy, double Fz){
 	int n;
 	// conserved momemnts
 	double rho,ux,uy,uz,uu;
@@ -306,7 +307,7 @@ __global__ void dvc_ScaLBL_D3Q19_AAodd_BGK(int *neighborList, double *dist, int
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_AAeven_BGK(double *dist, int start, int finish, int Np, double rlx, double Fx, double Fy, double Fz){
+extern "C" void ScaLBL_D3Q19_AAeven_BGK(dist_t *dist, int start, int finish, int Np, double rlx, double Fx, double Fy, double Fz){
 	
     dvc_ScaLBL_D3Q19_AAeven_BGK<<<NBLOCKS,NTHREADS >>>(dist,start,finish,Np,rlx,Fx,Fy,Fz);
 
@@ -316,7 +317,7 @@ extern "C" void ScaLBL_D3Q19_AAeven_BGK(double *dist, int start, int finish, int
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_AAodd_BGK(int *neighborList, double *dist, int start, int finish, int Np, double rlx, double Fx, double Fy, double Fz){
+extern "C" void ScaLBL_D3Q19_AAodd_BGK(int *neighborList, dist_t *dist, int start, int finish, int Np, double rlx, double Fx, double Fy, double Fz){
     dvc_ScaLBL_D3Q19_AAodd_BGK<<<NBLOCKS,NTHREADS >>>(neighborList,dist,start,finish,Np,rlx,Fx,Fy,Fz);
 
     cudaError_t err = cudaGetLastError();
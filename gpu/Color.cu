@@ -16,6 +16,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <cuda_profiler_api.h>
+#include "common/ScaLBL_Dist.h"
 
 #define NBLOCKS 1024
 #define NTHREADS 256
@@ -1256,7 +1257,7 @@ __global__  void dvc_ScaLBL_SetSlice_z(double *Phi, double value, int Nx, int Ny
 
 
 
-__global__  void dvc_ScaLBL_D3Q19_AAeven_Color(int *Map, double *dist, double *Aq, double *Bq, double *Den, double *Phi,
+__global__  void dvc_ScaLBL_D3Q19_AAeven_Color(int *Map, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, double *Phi,
 		double *Velocity, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int strideY, int strideZ, int start, int finish, int Np){
 	int ijk,nn,n;
@@ -1839,7 +1840,7 @@ __global__  void dvc_ScaLBL_D3Q19_AAeven_Color(int *Map, double *dist, double *A
 }
 
 
-__global__ void dvc_ScaLBL_D3Q19_AAodd_Color(int *neighborList, int *Map, double *dist, double *Aq, double *Bq, double *Den,
+__global__ void dvc_ScaLBL_D3Q19_AAodd_Color(int *neighborList, int *Map, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den,
 		 double *Phi, double *Velocity, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int strideY, int strideZ, int start, int finish, int Np){
 
@@ -3680,7 +3681,7 @@ __global__ void dvc_ScaLBL_D3Q19_AAodd_ColorMass(int *neighborList, double *Aq,
 	}
 }
 
-__global__  void dvc_ScaLBL_D3Q7_AAodd_PhaseField(int *neighborList, int *Map, double *Aq, double *Bq, 
+__global__  void dvc_ScaLBL_D3Q7_AAodd_PhaseField(int *neighborList, int *Map, dist_t *Aq, dist_t *Bq, 
 		double *Den, double *Phi, int start, int finish, int Np){
 	int idx,n,nread;
 	double fq,nA,nB;
@@ -3750,7 +3751,7 @@ __global__  void dvc_ScaLBL_D3Q7_AAodd_PhaseField(int *neighborList, int *Map, d
 	}
 }
 
-__global__  void dvc_ScaLBL_D3Q7_AAeven_PhaseField(int *Map, double *Aq, double *Bq, double *Den, double *Phi, 
+__global__  void dvc_ScaLBL_D3Q7_AAeven_PhaseField(int *Map, dist_t *Aq, dist_t *Bq, double *Den, double *Phi, 
 		int start, int finish, int Np){
 	int idx,n;
 	double fq,nA,nB;
@@ -3907,7 +3908,7 @@ __global__ void dvc_ScaLBL_D3Q19_Gradient(int *Map, double *phi, double *ColorGr
 		}
 	}
 }
-__global__ void dvc_ScaLBL_PhaseField_Init(int *Map, double *Phi, double *Den, double *Aq, double *Bq, int start, int finish, int Np){
+__global__ void dvc_ScaLBL_PhaseField_Init(int *Map, double *Phi, double *Den, dist_t *Aq, dist_t *Bq, int start, int finish, int Np){
 	int idx,n;
 	double phi,nA,nB;
 
@@ -3951,6 +3952,68 @@ __global__ void dvc_ScaLBL_PhaseField_Init(int *Map, double *Phi, double *Den, d
 	}
 }
 
+__global__ void dvc_ScaLBL_D3Q19_PhaseSums(int *Map, dist_t *dist, double *Den, double *Vel, double *BlockSums,
+		double rhoA, double rhoB, int imin, int jmin, int kmin, int kmax, int strideY, int strideZ,
+		int start, int finish, int Np){
+	// same selection and sums as SubPhase::Basic; one partial sum per block
+	__shared__ double temp[NTHREADS];
+	double sum[15];
+	for (int m=0; m<15; m++) sum[m] = 0.0;
+	int origin = strideZ + strideY + 1;
+	for (int n=start+blockIdx.x*blockDim.x+threadIdx.x; n<finish; n+=blockDim.x*gridDim.x){
+		int idx = Map[n];
+		if (idx < 0) continue;
+		int k = idx/strideZ;
+		int j = (idx-k*strideZ)/strideY;
+		int i = idx-k*strideZ-j*strideY;
+		bool inside = !(i < imin || j < jmin || k < kmin || !(k < kmax));
+		double nA = Den[n];
+		double nB = Den[Np+n];
+		double phi = (nA-nB)/(nA+nB);
+		if (inside){
+			if (phi > 0.0){
+				sum[0] += 1.0;
+				sum[1] += rhoA;
+				sum[2] += rhoA*Vel[n];
+				sum[3] += rhoA*Vel[Np+n];
+				sum[4] += rhoA*Vel[2*Np+n];
+			}
+			else{
+				sum[5] += 1.0;
+				sum[6] += rhoB;
+				sum[7] += rhoB*Vel[n];
+				sum[8] += rhoB*Vel[Np+n];
+				sum[9] += rhoB*Vel[2*Np+n];
+			}
+		}
+		if (idx == origin || (inside && (phi > 0.99 || phi < -0.99))){
+			double f[19];
+			for (int q=0; q<19; q++) f[q] = dist[q*Np+n];
+			double p = 0.3333333333333333*(f[0]+f[2]+f[1]+f[4]+f[3]+f[6]+f[5]+f[8]+f[7]+f[10]+
+					f[9]+f[12]+f[11]+f[14]+f[13]+f[16]+f[15]+f[18]+f[17]);
+			if (idx == origin) sum[14] += p;
+			if (inside && phi > 0.99){
+				sum[10] += p;
+				sum[11] += 1.0;
+			}
+			else if (inside && phi < -0.99){
+				sum[12] += p;
+				sum[13] += 1.0;
+			}
+		}
+	}
+	for (int m=0; m<15; m++){
+		temp[threadIdx.x] = sum[m];
+		__syncthreads();
+		for (int s=blockDim.x/2; s>0; s/=2){
+			if (threadIdx.x < s) temp[threadIdx.x] += temp[threadIdx.x+s];
+			__syncthreads();
+		}
+		if (threadIdx.x == 0) BlockSums[blockIdx.x*15+m] = temp[0];
+		__syncthreads();
+	}
+}
+
 extern "C" void ScaLBL_SetSlice_z(double *Phi, double value, int Nx, int Ny, int Nz, int Slice){
 	int GRID = Nx*Ny / 512 + 1;
 	dvc_ScaLBL_SetSlice_z<<<GRID,512>>>(Phi,value,Nx,Ny,Nz,Slice);
@@ -4001,7 +4064,7 @@ extern "C" void ScaLBL_D3Q7_ColorCollideMass(char *ID, double *A_even, double *A
 }
 // Pressure Boundary Conditions Functions
 
-extern "C" void ScaLBL_D3Q19_AAeven_Color(int *Map, double *dist, double *Aq, double *Bq, double *Den, double *Phi,
+extern "C" void ScaLBL_D3Q19_AAeven_Color(int *Map, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, double *Phi,
 		double *Vel, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int strideY, int strideZ, int start, int finish, int Np){
 
@@ -4018,7 +4081,7 @@ extern "C" void ScaLBL_D3Q19_AAeven_Color(int *Map, double *dist, double *Aq, do
 
 }
 
-extern "C" void ScaLBL_D3Q19_AAodd_Color(int *d_neighborList, int *Map, double *dist, double *Aq, double *Bq, double *Den, 
+extern "C" void ScaLBL_D3Q19_AAodd_Color(int *d_neighborList, int *Map, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, 
 		double *Phi, double *Vel, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int strideY, int strideZ, int start, int finish, int Np){
 
@@ -4035,7 +4098,7 @@ extern "C" void ScaLBL_D3Q19_AAodd_Color(int *d_neighborList, int *Map, double *
 	cudaProfilerStop();
 }
 
-extern "C" void ScaLBL_D3Q7_AAodd_PhaseField(int *NeighborList, int *Map, double *Aq, double *Bq, 
+extern "C" void ScaLBL_D3Q7_AAodd_PhaseField(int *NeighborList, int *Map, dist_t *Aq, dist_t *Bq, 
 		double *Den, double *Phi, int start, int finish, int Np){
 
 	cudaProfilerStart();
@@ -4048,7 +4111,7 @@ extern "C" void ScaLBL_D3Q7_AAodd_PhaseField(int *NeighborList, int *Map, double
 	cudaProfilerStop();
 }
 
-extern "C" void ScaLBL_D3Q7_AAeven_PhaseField(int *Map, double *Aq, double *Bq, double *Den, double *Phi, 
+extern "C" void ScaLBL_D3Q7_AAeven_PhaseField(int *Map, dist_t *Aq, dist_t *Bq, double *Den, double *Phi, 
 		int start, int finish, int Np){
 
 	cudaProfilerStart();
@@ -4061,6 +4124,27 @@ extern "C" void ScaLBL_D3Q7_AAeven_PhaseField(int *Map, double *Aq, double *Bq,
 
 }
 
+// On the device there is no ordering between thread blocks, so the fused variants are launched
+// as the phase field followed by the collision over the full range (lag and block are unused)
+extern "C" void ScaLBL_D3Q19_AAodd_ColorFused(int *d_neighborList, int *Map, dist_t *dist, dist_t *Aq, dist_t *Bq,
+		double *Den, double *Phi, double *Vel, double rhoA, double rhoB, double tauA, double tauB, double alpha,
+		double beta, double Fx, double Fy, double Fz, int strideY, int strideZ, int start, int finish, int lag,
+		int block, int Np){
+
+	ScaLBL_D3Q7_AAodd_PhaseField(d_neighborList, Map, Aq, Bq, Den, Phi, start, finish, Np);
+	ScaLBL_D3Q19_AAodd_Color(d_neighborList, Map, dist, Aq, Bq, Den, Phi, Vel, rhoA, rhoB, tauA, tauB,
+			alpha, beta, Fx, Fy, Fz, strideY, strideZ, start, finish, Np);
+}
+
+extern "C" void ScaLBL_D3Q19_AAeven_ColorFused(int *Map, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den,
+		double *Phi, double *Vel, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
+		double Fx, double Fy, double Fz, int strideY, int strideZ, int start, int finish, int lag, int block, int Np){
+
+	ScaLBL_D3Q7_AAeven_PhaseField(Map, Aq, Bq, Den, Phi, start, finish, Np);
+	ScaLBL_D3Q19_AAeven_Color(Map, dist, Aq, Bq, Den, Phi, Vel, rhoA, rhoB, tauA, tauB,
+			alpha, beta, Fx, Fy, Fz, strideY, strideZ, start, finish, Np);
+}
+
 extern "C" void ScaLBL_D3Q19_Gradient(int *Map, double *Phi, double *ColorGrad, int start, int finish, int Np,
 		int Nx, int Ny, int Nz){
 
@@ -4074,7 +4158,7 @@ extern "C" void ScaLBL_D3Q19_Gradient(int *Map, double *Phi, double *ColorGrad,
 
 }
 
-extern "C" void ScaLBL_PhaseField_Init(int *Map, double *Phi, double *Den, double *Aq, double *Bq, int start, int finish, int Np){
+extern "C" void ScaLBL_PhaseField_Init(int *Map, double *Phi, double *Den, dist_t *Aq, dist_t *Bq, int start, int finish, int Np){
 	dvc_ScaLBL_PhaseField_Init<<<NBLOCKS,NTHREADS >>>(Map, Phi, Den, Aq, Bq, start, finish, Np); 
 	cudaError_t err = cudaGetLastError();
 	if (cudaSuccess != err){
@@ -4153,5 +4237,22 @@ extern "C" void ScaLBL_Color_BC_Z(int *list, int *Map, double *Phi, double *Den,
 	}
 }
 
-
-
+extern "C" void ScaLBL_D3Q19_PhaseSums(int *Map, dist_t *dist, double *Den, double *Vel, double *Sums,
+		double rhoA, double rhoB, int imin, int jmin, int kmin, int kmax, int strideY, int strideZ,
+		int start, int finish, int Np){
+	double *dvcSums;
+	cudaMalloc((void **)&dvcSums,sizeof(double)*15*NBLOCKS);
+	dvc_ScaLBL_D3Q19_PhaseSums<<<NBLOCKS,NTHREADS>>>(Map, dist, Den, Vel, dvcSums, rhoA, rhoB,
+			imin, jmin, kmin, kmax, strideY, strideZ, start, finish, Np);
+	cudaError_t err = cudaGetLastError();
+	if (cudaSuccess != err){
+		printf("CUDA error in ScaLBL_D3Q19_PhaseSums: %s \n",cudaGetErrorString(err));
+	}
+	double *BlockSums = new double[15*NBLOCKS];
+	cudaMemcpy(BlockSums,dvcSums,sizeof(double)*15*NBLOCKS,cudaMemcpyDeviceToHost);
+	for (int m=0; m<15; m++) Sums[m] = 0.0;
+	for (int b=0; b<NBLOCKS; b++)
+		for (int m=0; m<15; m++) Sums[m] += BlockSums[b*15+m];
+	delete [] BlockSums;
+	cudaFree(dvcSums);
+}
@@ -15,6 +15,7 @@
 */
 #include <stdio.h>
 #include <cooperative_groups.h>
+#include "common/ScaLBL_Dist.h"
 
 #define NBLOCKS 1024
 #define NTHREADS 256
@@ -142,7 +143,7 @@ __global__ void deviceReduceKernel(double *in, double* out, int N) {
 		out[blockIdx.x]=sum;
 }
 
-__global__ void dvc_ScaLBL_D3Q19_Pack(int q, int *list, int start, int count, double *sendbuf, double *dist, int N){
+__global__ void dvc_ScaLBL_D3Q19_Pack(int q, int *list, int start, int count, double *sendbuf, dist_t *dist, int N){
 	//....................................................................................
 	// Pack distribution q into the send buffer for the listed lattice sites
 	// dist may be even or odd distributions stored by stream layout
@@ -157,8 +158,31 @@ __global__ void dvc_ScaLBL_D3Q19_Pack(int q, int *list, int start, int count, do
 
 }
 
+__global__ void dvc_ScaLBL_PackDist(int *list, int count, double *sendbuf, dist_t *dist){
+	//....................................................................................
+	// Pack all distributions sent to one neighbor in a single pass
+	// list holds the offset q*N+n for each entry of the send buffer
+	//....................................................................................
+	int idx = blockIdx.x*blockDim.x + threadIdx.x;
+	if (idx<count){
+		sendbuf[idx] = dist[list[idx]];
+	}
+}
+
+__global__ void dvc_ScaLBL_UnpackDist(int *list, int count, double *recvbuf, dist_t *dist){
+	//....................................................................................
+	// Unpack all distributions recieved from one neighbor in a single pass
+	// list holds the offset q*N+n for each entry of the recv buffer (negative to skip)
+	//....................................................................................
+	int idx = blockIdx.x*blockDim.x + threadIdx.x;
+	if (idx<count){
+		int n = list[idx];
+		if (!(n<0)) dist[n] = recvbuf[idx];
+	}
+}
+
 __global__ void dvc_ScaLBL_D3Q19_Unpack(int q,  int *list,  int start, int count,
-		double *recvbuf, double *dist, int N){
+		double *recvbuf, dist_t *dist, int N){
 	//....................................................................................
 	// Unpack distribution from the recv buffer
 	// Distribution q matche Cqx, Cqy, Cqz
@@ -251,7 +275,7 @@ __global__ void dvc_ScaLBL_D3Q19_AA_Init(double *f_even, double *f_odd, int Np)
 	}
 }
 
-__global__ void dvc_ScaLBL_D3Q19_Init(double *dist, int Np)
+__global__ void dvc_ScaLBL_D3Q19_Init(dist_t *dist, int Np)
 {
 	int n;
 	int S = Np/NBLOCKS/NTHREADS + 1;
@@ -446,7 +470,7 @@ dvc_ScaLBL_AAodd_Compact(char * ID, int *d_neighborList, double *dist, int Np) {
 
 
 __global__ void 
-dvc_ScaLBL_AAodd_MRT(int *neighborList, double *dist, int start, int finish, int Np, double rlx_setA, double rlx_setB, double Fx, double Fy, double Fz) {
+dvc_ScaLBL_AAodd_MRT(int *neighborList, dist_t *dist, int start, int finish, int Np, double rlx_setA, double rlx_setB, double Fx, double Fy, double Fz) {
 
 	int n;
 	double fq;
@@ -915,7 +939,7 @@ dvc_ScaLBL_AAodd_MRT(int *neighborList, double *dist, int start, int finish, int
 
 //__launch_bounds__(512,1)
 __global__ void 
-dvc_ScaLBL_AAeven_MRT(double *dist, int start, int finish, int Np, double rlx_setA, double rlx_setB, double Fx, double Fy, double Fz) {
+dvc_ScaLBL_AAeven_MRT(dist_t *dist, int start, int finish, int Np, double rlx_setA, double rlx_setB, double Fx, double Fy, double Fz) {
 
 	int n;
 	double fq;
@@ -1546,7 +1570,7 @@ __global__  void dvc_ScaLBL_D3Q19_Swap(char *ID, double *disteven, double *disto
 }
 
 
-__global__  void dvc_ScaLBL_D3Q19_Momentum(double *dist, double *vel, int N)
+__global__  void dvc_ScaLBL_D3Q19_Momentum(dist_t *dist, double *vel, int N)
 {
 	int n;
 	// distributions
@@ -1594,7 +1618,7 @@ __global__  void dvc_ScaLBL_D3Q19_Momentum(double *dist, double *vel, int N)
 	}
 }
 
-__global__  void dvc_ScaLBL_D3Q19_Pressure(const double *dist, double *Pressure, int N)
+__global__  void dvc_ScaLBL_D3Q19_Pressure(const dist_t *dist, double *Pressure, int N)
 {
 	int n;
 	// distributions
@@ -1638,7 +1662,7 @@ __global__  void dvc_ScaLBL_D3Q19_Pressure(const double *dist, double *Pressure,
 	}
 }
 
-__global__  void dvc_ScaLBL_D3Q19_AAeven_Pressure_BC_z(int *list, double *dist, double din, int count, int Np)
+__global__  void dvc_ScaLBL_D3Q19_AAeven_Pressure_BC_z(int *list, dist_t *dist, double din, int count, int Np)
 {
 	int idx, n;
 	// distributions
@@ -1689,7 +1713,7 @@ __global__  void dvc_ScaLBL_D3Q19_AAeven_Pressure_BC_z(int *list, double *dist,
 	}
 }
 
-__global__  void dvc_ScaLBL_D3Q19_AAeven_Pressure_BC_Z(int *list, double *dist, double dout, int count, int Np)
+__global__  void dvc_ScaLBL_D3Q19_AAeven_Pressure_BC_Z(int *list, dist_t *dist, double dout, int count, int Np)
 {
 	int idx,n;
 	// distributions
@@ -1745,7 +1769,7 @@ __global__  void dvc_ScaLBL_D3Q19_AAeven_Pressure_BC_Z(int *list, double *dist,
 	}
 }
 
-__global__  void dvc_ScaLBL_D3Q19_AAodd_Pressure_BC_z(int *d_neighborList, int *list, double *dist, double din, int count, int Np)
+__global__  void dvc_ScaLBL_D3Q19_AAodd_Pressure_BC_z(int *d_neighborList, int *list, dist_t *dist, double din, int count, int Np)
 {
 	int idx, n;
 	int nread;
@@ -1832,7 +1856,7 @@ __global__  void dvc_ScaLBL_D3Q19_AAodd_Pressure_BC_z(int *d_neighborList, int *
 	}
 }
 
-__global__  void dvc_ScaLBL_D3Q19_AAodd_Pressure_BC_Z(int *d_neighborList, int *list, double *dist, double dout, int count, int Np)
+__global__  void dvc_ScaLBL_D3Q19_AAodd_Pressure_BC_Z(int *d_neighborList, int *list, dist_t *dist, double dout, int count, int Np)
 {
 	int idx,n,nread;
 	int nr6,nr12,nr13,nr16,nr17;
@@ -1926,7 +1950,7 @@ __global__  void dvc_ScaLBL_D3Q19_AAodd_Pressure_BC_Z(int *d_neighborList, int *
 }
 
 
-__global__  void dvc_ScaLBL_D3Q19_AAeven_Flux_BC_z(int *list, double *dist, double flux, double Area, 
+__global__  void dvc_ScaLBL_D3Q19_AAeven_Flux_BC_z(int *list, dist_t *dist, double flux, double Area, 
 		double *dvcsum, int count, int Np)
 {
 	int idx, n;
@@ -1970,7 +1994,7 @@ __global__  void dvc_ScaLBL_D3Q19_AAeven_Flux_BC_z(int *list, double *dist, doub
 }
 
 
-__global__  void dvc_ScaLBL_D3Q19_AAodd_Flux_BC_z(int *d_neighborList, int *list, double *dist, double flux, 
+__global__  void dvc_ScaLBL_D3Q19_AAodd_Flux_BC_z(int *d_neighborList, int *list, dist_t *dist, double flux, 
 		double Area, double *dvcsum, int count, int Np)
 {
 	int idx, n;
@@ -2317,15 +2341,25 @@ __global__ void dvc_ScaLBL_D3Q19_Init_Simple(char *ID, double *f_even, double *f
 //	dvc_ScaLBL_D3Q19_Unpack <<<GRID,512 >>>(q, Cqx, Cqy, Cqz, list, start, count, d3q19_recvlist, Nx, Ny, Nz);
 //}
 
-extern "C" void ScaLBL_D3Q19_Pack(int q, int *list, int start, int count, double *sendbuf, double *dist, int N){
+extern "C" void ScaLBL_D3Q19_Pack(int q, int *list, int start, int count, double *sendbuf, dist_t *dist, int N){
 	int GRID = count / 512 + 1;
 	dvc_ScaLBL_D3Q19_Pack <<<GRID,512 >>>(q, list, start, count, sendbuf, dist, N);
 }
 
-extern "C" void ScaLBL_D3Q19_Unpack(int q, int *list,  int start, int count, double *recvbuf, double *dist, int N){
+extern "C" void ScaLBL_D3Q19_Unpack(int q, int *list,  int start, int count, double *recvbuf, dist_t *dist, int N){
 	int GRID = count / 512 + 1;
 	dvc_ScaLBL_D3Q19_Unpack <<<GRID,512 >>>(q, list, start, count, recvbuf, dist, N);
 }
+
+extern "C" void ScaLBL_PackDist(int *list, int count, double *sendbuf, dist_t *dist){
+	int GRID = count / 512 + 1;
+	dvc_ScaLBL_PackDist <<<GRID,512 >>>(list, count, sendbuf, dist);
+}
+
+extern "C" void ScaLBL_UnpackDist(int *list, int count, double *recvbuf, dist_t *dist){
+	int GRID = count / 512 + 1;
+	dvc_ScaLBL_UnpackDist <<<GRID,512 >>>(list, count, recvbuf, dist);
+}
 //*************************************************************************
 
 extern "C" void ScaLBL_D3Q19_AA_Init(double *f_even, double *f_odd, int Np){
@@ -2336,7 +2370,7 @@ extern "C" void ScaLBL_D3Q19_AA_Init(double *f_even, double *f_odd, int Np){
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_Init(double *dist, int Np){
+extern "C" void ScaLBL_D3Q19_Init(dist_t *dist, int Np){
 	dvc_ScaLBL_D3Q19_Init<<<NBLOCKS,NTHREADS >>>(dist, Np);
 	cudaError_t err = cudaGetLastError();
 	if (cudaSuccess != err){
@@ -2387,7 +2421,7 @@ extern "C" void ScaLBL_D3Q19_AAodd_Compact(char * ID, int *d_neighborList, doubl
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_Momentum(double *dist, double *vel, int Np){
+extern "C" void ScaLBL_D3Q19_Momentum(dist_t *dist, double *vel, int Np){
 
 	dvc_ScaLBL_D3Q19_Momentum<<<NBLOCKS,NTHREADS >>>(dist, vel, Np);
 
@@ -2397,7 +2431,7 @@ extern "C" void ScaLBL_D3Q19_Momentum(double *dist, double *vel, int Np){
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_Pressure(double *fq, double *Pressure, int Np){
+extern "C" void ScaLBL_D3Q19_Pressure(dist_t *fq, double *Pressure, int Np){
 	dvc_ScaLBL_D3Q19_Pressure<<< NBLOCKS,NTHREADS >>>(fq, Pressure, Np);
 }
 
@@ -2465,7 +2499,7 @@ extern "C" double ScaLBL_D3Q19_Flux_BC_z(double *disteven, double *distodd, doub
 }
 
 
-extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_z(int *list, double *dist, double din, int count, int N){
+extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_z(int *list, dist_t *dist, double din, int count, int N){
 	int GRID = count / 512 + 1;
 	dvc_ScaLBL_D3Q19_AAeven_Pressure_BC_z<<<GRID,512>>>(list, dist, din, count, N);
 	cudaError_t err = cudaGetLastError();
@@ -2474,7 +2508,7 @@ extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_z(int *list, double *dist, doubl
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_Z(int *list, double *dist, double dout, int count, int N){
+extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_Z(int *list, dist_t *dist, double dout, int count, int N){
 	int GRID = count / 512 + 1;
 	dvc_ScaLBL_D3Q19_AAeven_Pressure_BC_Z<<<GRID,512>>>(list, dist, dout, count, N);
 	cudaError_t err = cudaGetLastError();
@@ -2483,7 +2517,7 @@ extern "C" void ScaLBL_D3Q19_AAeven_Pressure_BC_Z(int *list, double *dist, doubl
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_z(int *neighborList, int *list, double *dist, double din, int count, int N){
+extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_z(int *neighborList, int *list, dist_t *dist, double din, int count, int N){
 	int GRID = count / 512 + 1;
 	dvc_ScaLBL_D3Q19_AAodd_Pressure_BC_z<<<GRID,512>>>(neighborList, list, dist, din, count, N);
 	cudaError_t err = cudaGetLastError();
@@ -2492,7 +2526,7 @@ extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_z(int *neighborList, int *list, d
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_Z(int *neighborList, int *list, double *dist, double dout, int count, int N){
+extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_Z(int *neighborList, int *list, dist_t *dist, double dout, int count, int N){
 	int GRID = count / 512 + 1;
 	dvc_ScaLBL_D3Q19_AAodd_Pressure_BC_Z<<<GRID,512>>>(neighborList, list, dist, dout, count, N);
 	cudaError_t err = cudaGetLastError();
@@ -2502,7 +2536,7 @@ extern "C" void ScaLBL_D3Q19_AAodd_Pressure_BC_Z(int *neighborList, int *list, d
 }
 
 
-extern "C" double ScaLBL_D3Q19_AAeven_Flux_BC_z(int *list, double *dist, double flux, double area, 
+extern "C" double ScaLBL_D3Q19_AAeven_Flux_BC_z(int *list, dist_t *dist, double flux, double area, 
 		 int count, int N){
 
 	int GRID = count / 512 + 1;
@@ -2546,7 +2580,7 @@ extern "C" double ScaLBL_D3Q19_AAeven_Flux_BC_z(int *list, double *dist, double
 	return din;
 }
 
-extern "C" double ScaLBL_D3Q19_AAodd_Flux_BC_z(int *neighborList, int *list, double *dist, double flux, 
+extern "C" double ScaLBL_D3Q19_AAodd_Flux_BC_z(int *neighborList, int *list, dist_t *dist, double flux, 
 		double area, int count, int N){
 
 	int GRID = count / 512 + 1;
@@ -2636,7 +2670,7 @@ extern "C" double deviceReduce(double *in, double* out, int N) {
 //	dvc_ScaLBL_D3Q19_Pressure_BC_Z<<<GRID,512>>>(disteven, distodd, dout, Nx, Ny, Nz, outlet);
 //}
 
-extern "C" void ScaLBL_D3Q19_AAeven_MRT(double *dist, int start, int finish, int Np, double rlx_setA, double rlx_setB, double Fx,
+extern "C" void ScaLBL_D3Q19_AAeven_MRT(dist_t *dist, int start, int finish, int Np, double rlx_setA, double rlx_setB, double Fx,
        double Fy, double Fz){
        
        dvc_ScaLBL_AAeven_MRT<<<NBLOCKS,NTHREADS >>>(dist,start,finish,Np,rlx_setA,rlx_setB,Fx,Fy,Fz);
@@ -2647,7 +2681,7 @@ extern "C" void ScaLBL_D3Q19_AAeven_MRT(double *dist, int start, int finish, int
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_AAodd_MRT(int *neighborlist, double *dist, int start, int finish, int Np, double rlx_setA, double rlx_setB, double Fx,
+extern "C" void ScaLBL_D3Q19_AAodd_MRT(int *neighborlist, dist_t *dist, int start, int finish, int Np, double rlx_setA, double rlx_setB, double Fx,
        double Fy, double Fz){
        
        dvc_ScaLBL_AAodd_MRT<<<NBLOCKS,NTHREADS >>>(neighborlist,dist,start,finish,Np,rlx_setA,rlx_setB,Fx,Fy,Fz);
@@ -14,6 +14,7 @@
   along with OPM.  If not, see <http://www.gnu.org/licenses/>.
 */
 // GPU Functions for D3Q7 Lattice Boltzmann Methods
+#include "common/ScaLBL_Dist.h"
 
 #define NBLOCKS 560
 #define NTHREADS 128
@@ -75,7 +76,7 @@ __global__ void dvc_ScaLBL_UnpackDenD3Q7(int *list, int count, double *recvbuf,
 }
 
 __global__ void dvc_ScaLBL_D3Q7_Unpack(int q,  int *list,  int start, int count,
-		double *recvbuf, double *dist, int N){
+		double *recvbuf, dist_t *dist, int N){
 	//....................................................................................
 	// Unpack distribution from the recv buffer
 	// Distribution q matche Cqx, Cqy, Cqz
@@ -222,7 +223,7 @@ __global__  void dvc_ScaLBL_D3Q7_Density(char *ID, double *disteven, double *dis
 	}
 }
 
-extern "C" void ScaLBL_D3Q7_Unpack(int q, int *list,  int start, int count, double *recvbuf, double *dist, int N){
+extern "C" void ScaLBL_D3Q7_Unpack(int q, int *list,  int start, int count, double *recvbuf, dist_t *dist, int N){
 	int GRID = count / 512 + 1;
 	dvc_ScaLBL_D3Q7_Unpack <<<GRID,512 >>>(q, list, start, count, recvbuf, dist, N);
 }
@@ -16,6 +16,7 @@
 // Basic cuda functions callable from C/C++ code
 #include <cuda.h>
 #include <stdio.h>
+#include "common/ScaLBL_Dist.h"
 
 extern "C" int ScaLBL_SetDevice(int rank){
 	int n_devices; 
@@ -36,10 +37,28 @@ extern "C" void ScaLBL_AllocateDeviceMemory(void** address, size_t size){
 	}	
 }
 
+extern "C" void ScaLBL_AllocateSiteMemory(void** address, size_t size, size_t stride, int Np,
+		int LastExterior, int FirstInterior, int LastInterior){
+	// placement does not depend on the access pattern on the device
+	ScaLBL_AllocateDeviceMemory(address,size);
+}
+
 extern "C" void ScaLBL_FreeDeviceMemory(void* pointer){
        cudaFree(pointer);
 }
 
+extern "C" void ScaLBL_AllocateHostMemory(void** address, size_t size){
+	cudaMallocHost(address,size);
+	cudaError_t err = cudaGetLastError();
+	if (cudaSuccess != err){
+		printf("Error in cudaMallocHost: %s \n",cudaGetErrorString(err));
+	}
+}
+
+extern "C" void ScaLBL_FreeHostMemory(void* pointer){
+	cudaFreeHost(pointer);
+}
+
 extern "C" void ScaLBL_CopyToDevice(void* dest, const void* source, size_t size){
 	cudaMemcpy(dest,source,size,cudaMemcpyHostToDevice);
 	cudaError_t err = cudaGetLastError();
@@ -72,6 +91,20 @@ extern "C" void ScaLBL_CopyToHost(void* dest, const void* source, size_t size){
 	}
 }
 
+extern "C" void ScaLBL_CopyDistToDevice(dist_t* dest, const double* source, size_t count){
+	dist_t *tmp = new dist_t[count];
+	for (size_t n=0; n<count; n++) tmp[n] = source[n];
+	ScaLBL_CopyToDevice(dest, tmp, count*sizeof(dist_t));
+	delete [] tmp;
+}
+
+extern "C" void ScaLBL_CopyDistToHost(double* dest, const dist_t* source, size_t count){
+	dist_t *tmp = new dist_t[count];
+	ScaLBL_CopyToHost(tmp, source, count*sizeof(dist_t));
+	for (size_t n=0; n<count; n++) dest[n] = tmp[n];
+	delete [] tmp;
+}
+
 extern "C" void ScaLBL_DeviceBarrier(){
 	cudaDeviceSynchronize();
 }
@@ -31,6 +31,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <cuda_profiler_api.h>
+#include "common/ScaLBL_Dist.h"
 
 #define NBLOCKS 1024
 #define NTHREADS 256
@@ -77,7 +78,7 @@ __global__ void dvc_ScaLBL_Gradient_Unpack(double weight, double Cqx, double Cqy
 	}
 }
 
-__global__ void dvc_ScaLBL_DFH_Init(double *Phi, double *Den, double *Aq, double *Bq, int start, int finish, int Np){
+__global__ void dvc_ScaLBL_DFH_Init(double *Phi, double *Den, dist_t *Aq, dist_t *Bq, int start, int finish, int Np){
 	int idx;
 	double phi,nA,nB;
 
@@ -118,7 +119,7 @@ __global__ void dvc_ScaLBL_DFH_Init(double *Phi, double *Den, double *Aq, double
 
 
 // LBM based on density functional hydrodynamics
-__global__ void dvc_ScaLBL_D3Q19_AAeven_DFH(int *neighborList, double *dist, double *Aq, double *Bq, double *Den, double *Phi,
+__global__ void dvc_ScaLBL_D3Q19_AAeven_DFH(int *neighborList, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, double *Phi,
 			double *Gradient, double *SolidForce, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 			double Fx, double Fy, double Fz, int start, int finish, int Np){
 	int nn,n;
@@ -643,7 +644,7 @@ __global__ void dvc_ScaLBL_D3Q19_AAeven_DFH(int *neighborList, double *dist, dou
 }
 
 
-__global__ void dvc_ScaLBL_D3Q19_AAodd_DFH(int *neighborList, double *dist, double *Aq, double *Bq, double *Den, 
+__global__ void dvc_ScaLBL_D3Q19_AAodd_DFH(int *neighborList, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, 
 		double *Phi, double *Gradient, double *SolidForce, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int start, int finish, int Np){
 
@@ -1246,7 +1247,7 @@ __global__ void dvc_ScaLBL_D3Q19_AAodd_DFH(int *neighborList, double *dist, doub
 	}
 }
 
-__global__  void dvc_ScaLBL_D3Q7_AAodd_DFH(int *neighborList, double *Aq, double *Bq, 
+__global__  void dvc_ScaLBL_D3Q7_AAodd_DFH(int *neighborList, dist_t *Aq, dist_t *Bq, 
 		double *Den, double *Phi, int start, int finish, int Np){
 	int n,nread;
 	double fq,nA,nB;
@@ -1316,7 +1317,7 @@ __global__  void dvc_ScaLBL_D3Q7_AAodd_DFH(int *neighborList, double *Aq, double
 	}
 }
 
-__global__  void dvc_ScaLBL_D3Q7_AAeven_DFH(double *Aq, double *Bq, double *Den, double *Phi, 
+__global__  void dvc_ScaLBL_D3Q7_AAeven_DFH(dist_t *Aq, dist_t *Bq, double *Den, double *Phi, 
 		int start, int finish, int Np){
 	int idx,n;
 	double fq,nA,nB;
@@ -1468,7 +1469,7 @@ extern "C" void ScaLBL_Gradient_Unpack(double weight, double Cqx, double Cqy, do
 	}
 }
 
-extern "C" void ScaLBL_DFH_Init(double *Phi, double *Den, double *Aq, double *Bq, int start, int finish, int Np){
+extern "C" void ScaLBL_DFH_Init(double *Phi, double *Den, dist_t *Aq, dist_t *Bq, int start, int finish, int Np){
 	dvc_ScaLBL_DFH_Init<<<NBLOCKS,NTHREADS >>>(Phi, Den, Aq, Bq, start, finish, Np); 
 	cudaError_t err = cudaGetLastError();
 	if (cudaSuccess != err){
@@ -1476,7 +1477,7 @@ extern "C" void ScaLBL_DFH_Init(double *Phi, double *Den, double *Aq, double *Bq
 	}
 }
 
-extern "C" void ScaLBL_D3Q19_AAeven_DFH(int *neighborList, double *dist, double *Aq, double *Bq, double *Den, double *Phi,
+extern "C" void ScaLBL_D3Q19_AAeven_DFH(int *neighborList, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, double *Phi,
 		double *Gradient, double *SolidForce, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int start, int finish, int Np){
 
@@ -1492,7 +1493,7 @@ extern "C" void ScaLBL_D3Q19_AAeven_DFH(int *neighborList, double *dist, double
 	cudaProfilerStop();
 }
 
-extern "C" void ScaLBL_D3Q19_AAodd_DFH(int *neighborList, double *dist, double *Aq, double *Bq, double *Den, 
+extern "C" void ScaLBL_D3Q19_AAodd_DFH(int *neighborList, dist_t *dist, dist_t *Aq, dist_t *Bq, double *Den, 
 		double *Phi, double *Gradient, double *SolidForce, double rhoA, double rhoB, double tauA, double tauB, double alpha, double beta,
 		double Fx, double Fy, double Fz, int start, int finish, int Np){
 
@@ -1509,7 +1510,7 @@ extern "C" void ScaLBL_D3Q19_AAodd_DFH(int *neighborList, double *dist, double *
 	cudaProfilerStop();
 }
 
-extern "C" void ScaLBL_D3Q7_AAodd_DFH(int *NeighborList, double *Aq, double *Bq, 
+extern "C" void ScaLBL_D3Q7_AAodd_DFH(int *NeighborList, dist_t *Aq, dist_t *Bq, 
 		double *Den, double *Phi, int start, int finish, int Np){
 
 	cudaProfilerStart();
@@ -1522,7 +1523,7 @@ extern "C" void ScaLBL_D3Q7_AAodd_DFH(int *NeighborList, double *Aq, double *Bq,
 	cudaProfilerStop();
 }
 
-extern "C" void ScaLBL_D3Q7_AAeven_DFH(double *Aq, double *Bq, double *Den, double *Phi, 
+extern "C" void ScaLBL_D3Q7_AAeven_DFH(dist_t *Aq, dist_t *Bq, double *Den, double *Phi, 
 		int start, int finish, int Np){
 
 	cudaProfilerStart();
@@ -29,6 +29,10 @@ Fx(0),Fy(0),Fz(0),flux(0),din(0),dout(0),inletA(0),inletB(0),outletA(0),outletB(
 Nx(0),Ny(0),Nz(0),N(0),Np(0),nprocx(0),nprocy(0),nprocz(0),BoundaryCondition(0),Lx(0),Ly(0),Lz(0),comm(COMM)
 {
 	REVERSE_FLOW_DIRECTION = false;
+	FUSED_KERNEL = false;
+	AGGREGATED_EXCHANGE = false;
+	fused_lag = 0;
+	fused_block_size = 0;
 }
 ScaLBL_ColorModel::~ScaLBL_ColorModel(){
 
@@ -130,6 +134,13 @@ void ScaLBL_ColorModel::ReadParams(string filename){
 	if (color_db->keyExists( "flux" )){
 		flux = color_db->getScalar<double>( "flux" );
 	}
+	if (color_db->keyExists( "fused_kernel" )){
+		FUSED_KERNEL = color_db->getScalar<bool>( "fused_kernel" );
+	}
+	fused_block_size = color_db->getWithDefault<int>( "fused_block_size", 8192 );
+	if (color_db->keyExists( "aggregated_exchange" )){
+		AGGREGATED_EXCHANGE = color_db->getScalar<bool>( "aggregated_exchange" );
+	}
 	inletA=1.f;
 	inletB=0.f;
 	outletA=0.f;
@@ -347,20 +358,24 @@ void ScaLBL_ColorModel::Create(){
 	//...........................................................................
 	// LBM variables
 	if (rank==0)    printf ("Allocating distributions \n");
+	// sites updated by the kernels (first touch of the site memory)
+	int lastExterior = ScaLBL_Comm->LastExterior();
+	int firstInterior = ScaLBL_Comm->FirstInterior();
+	int lastInterior = ScaLBL_Comm->LastInterior();
 	//......................device distributions.................................
-	dist_mem_size = Np*sizeof(double);
+	dist_mem_size = Np*sizeof(dist_t);
 	neighborSize=18*(Np*sizeof(int));
 	//...........................................................................
-	ScaLBL_AllocateDeviceMemory((void **) &NeighborList, neighborSize);
-	ScaLBL_AllocateDeviceMemory((void **) &dvcMap, sizeof(int)*Np);
-	ScaLBL_AllocateDeviceMemory((void **) &fq, 19*dist_mem_size);
-	ScaLBL_AllocateDeviceMemory((void **) &Aq, 7*dist_mem_size);
-	ScaLBL_AllocateDeviceMemory((void **) &Bq, 7*dist_mem_size);
-	ScaLBL_AllocateDeviceMemory((void **) &Den, 2*dist_mem_size);
+	ScaLBL_AllocateSiteMemory((void **) &NeighborList, neighborSize, sizeof(int)*Np, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &dvcMap, sizeof(int)*Np, sizeof(int)*Np, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &fq, 19*dist_mem_size, dist_mem_size, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &Aq, 7*dist_mem_size, dist_mem_size, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &Bq, 7*dist_mem_size, dist_mem_size, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &Den, 2*sizeof(double)*Np, sizeof(double)*Np, Np, lastExterior, firstInterior, lastInterior);
 	ScaLBL_AllocateDeviceMemory((void **) &Phi, sizeof(double)*Nx*Ny*Nz);		
-	ScaLBL_AllocateDeviceMemory((void **) &Pressure, sizeof(double)*Np);
-	ScaLBL_AllocateDeviceMemory((void **) &Velocity, 3*sizeof(double)*Np);
-	ScaLBL_AllocateDeviceMemory((void **) &ColorGrad, 3*sizeof(double)*Np);
+	ScaLBL_AllocateSiteMemory((void **) &Pressure, sizeof(double)*Np, sizeof(double)*Np, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &Velocity, 3*sizeof(double)*Np, sizeof(double)*Np, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &ColorGrad, 3*sizeof(double)*Np, sizeof(double)*Np, Np, lastExterior, firstInterior, lastInterior);
 	//...........................................................................
 	// Update GPU data structures
 	if (rank==0)	printf ("Setting up device map and neighbor list \n");
@@ -391,6 +406,23 @@ void ScaLBL_ColorModel::Create(){
 			TmpMap[idx] = Nx*Ny*Nz-1;
 		}
 	}
+	// largest forward offset from an interior site to a neighbor used in the phase field gradient
+	int D3Q19[18][3]={{1,0,0},{-1,0,0},{0,1,0},{0,-1,0},{0,0,1},{0,0,-1},
+			{1,1,0},{-1,-1,0},{1,-1,0},{-1,1,0},{1,0,1},{-1,0,-1},{1,0,-1},{-1,0,1},
+			{0,1,1},{0,-1,-1},{0,1,-1},{0,-1,1}};
+	fused_lag = 0;
+	for (int idx=ScaLBL_Comm->FirstInterior(); idx<ScaLBL_Comm->LastInterior(); idx++){
+		int n = TmpMap[idx];
+		int k = n/(Nx*Ny);
+		int j = (n-Nx*Ny*k)/Nx;
+		int i = n-Nx*Ny*k-Nx*j;
+		if (i<1 || j<1 || k<1 || i>Nx-2 || j>Ny-2 || k>Nz-2) continue;
+		for (int q=0; q<18; q++){
+			int nbr = Map(i+D3Q19[q][0],j+D3Q19[q][1],k+D3Q19[q][2]);
+			if (nbr-idx > fused_lag) fused_lag = nbr-idx;
+		}
+	}
+	if (FUSED_KERNEL && rank==0) printf ("Fused phase field / collision kernel (lag=%i, block=%i) \n",fused_lag,fused_block_size);
 	ScaLBL_CopyToDevice(dvcMap, TmpMap, sizeof(int)*Np);
 	ScaLBL_DeviceBarrier();
 	delete [] TmpMap;
@@ -431,23 +463,33 @@ void ScaLBL_ColorModel::Initialize(){
 		ScaLBL_CopyToHost(TmpMap, dvcMap, Np*sizeof(int));
         ScaLBL_CopyToHost(cPhi, Phi, N*sizeof(double));
     	
-		ifstream File(LocalRestartFile,ios::binary);
 		int idx;
 		double value,va,vb;
-		for (int n=0; n<Np; n++){
-			File.read((char*) &va, sizeof(va));
-			File.read((char*) &vb, sizeof(vb));
-			cDen[n]    = va;
-			cDen[Np+n] = vb;
+		if (analysis_db->getWithDefault<std::string>( "restart_format", "rank" ) == "shared"){
+			// single restart file (may have been written with a different decomposition)
+			auto restart_file = analysis_db->getWithDefault<std::string>( "restart_file", "Restart" );
+			ScaLBL_CopyDistToHost(cDist,fq,19*Np);
+			ReadRestartFile(restart_file.c_str(), comm, *Dm, Map, cDen, cDist, Np);
 		}
-		for (int n=0; n<Np; n++){
-			// Read the distributions
-			for (int q=0; q<19; q++){
-				File.read((char*) &value, sizeof(value));
-				cDist[q*Np+n] = value;
+		else {
+			ifstream File(LocalRestartFile,ios::binary);
+			if (!File.is_open())
+				ERROR(std::string("ColorModel: unable to open restart file ")+LocalRestartFile);
+			for (int n=0; n<Np; n++){
+				File.read((char*) &va, sizeof(va));
+				File.read((char*) &vb, sizeof(vb));
+				cDen[n]    = va;
+				cDen[Np+n] = vb;
 			}
+			for (int n=0; n<Np; n++){
+				// Read the distributions
+				for (int q=0; q<19; q++){
+					File.read((char*) &value, sizeof(value));
+					cDist[q*Np+n] = value;
+				}
+			}
+			File.close();
 		}
-		File.close();
 		
 		for (int n=0; n<ScaLBL_Comm->LastExterior(); n++){
 			va = cDen[n];
@@ -468,7 +510,7 @@ void ScaLBL_ColorModel::Initialize(){
 		
 		// Copy the restart data to the GPU
 		ScaLBL_CopyToDevice(Den,cDen,2*Np*sizeof(double));
-		ScaLBL_CopyToDevice(fq,cDist,19*Np*sizeof(double));
+		ScaLBL_CopyDistToDevice(fq,cDist,19*Np);
 		ScaLBL_CopyToDevice(Phi,cPhi,N*sizeof(double));
 		ScaLBL_DeviceBarrier();
 
@@ -673,27 +715,55 @@ void ScaLBL_ColorModel::Run(){
 		PROFILE_START("Update");
 		// *************ODD TIMESTEP*************
 		timestep++;
-		// Compute the Phase indicator field
-		// Read for Aq, Bq happens in this routine (requires communication)
-		ScaLBL_Comm->BiSendD3Q7AA(Aq,Bq); //READ FROM NORMAL
-		ScaLBL_D3Q7_AAodd_PhaseField(NeighborList, dvcMap, Aq, Bq, Den, Phi, ScaLBL_Comm->FirstInterior(), ScaLBL_Comm->LastInterior(), Np);
-		ScaLBL_Comm->BiRecvD3Q7AA(Aq,Bq); //WRITE INTO OPPOSITE
-		ScaLBL_DeviceBarrier();
-		ScaLBL_D3Q7_AAodd_PhaseField(NeighborList, dvcMap, Aq, Bq, Den, Phi, 0, ScaLBL_Comm->LastExterior(), Np);
-
-		// Perform the collision operation
-		ScaLBL_Comm->SendD3Q19AA(fq); //READ FROM NORMAL
-		if (BoundaryCondition > 0){
-			ScaLBL_Comm->Color_BC_z(dvcMap, Phi, Den, inletA, inletB);
-			ScaLBL_Comm->Color_BC_Z(dvcMap, Phi, Den, outletA, outletB);
+		if (FUSED_KERNEL){
+			// The exterior phase field is needed first, the interior is then computed with the collision
+			// (the exchange is not overlapped: interior sites next to the exterior read its phase field)
+			if (AGGREGATED_EXCHANGE){
+				ScaLBL_Comm->SendD3Q19D3Q7AA(fq,Aq,Bq); //READ FROM NORMAL
+				ScaLBL_Comm->RecvD3Q19D3Q7AA(fq,Aq,Bq); //WRITE INTO OPPOSITE
+			}
+			else {
+				ScaLBL_Comm->BiSendD3Q7AA(Aq,Bq); //READ FROM NORMAL
+				ScaLBL_Comm->BiRecvD3Q7AA(Aq,Bq); //WRITE INTO OPPOSITE
+			}
+			ScaLBL_DeviceBarrier();
+			ScaLBL_D3Q7_AAodd_PhaseField(NeighborList, dvcMap, Aq, Bq, Den, Phi, 0, ScaLBL_Comm->LastExterior(), Np);
+			if (!AGGREGATED_EXCHANGE) ScaLBL_Comm->SendD3Q19AA(fq); //READ FROM NORMAL
+			if (BoundaryCondition > 0){
+				ScaLBL_Comm->Color_BC_z(dvcMap, Phi, Den, inletA, inletB);
+				ScaLBL_Comm->Color_BC_Z(dvcMap, Phi, Den, outletA, outletB);
+			}
+			ScaLBL_Comm_Regular->SendHalo(Phi);
+			ScaLBL_D3Q19_AAodd_ColorFused(NeighborList, dvcMap, fq, Aq, Bq, Den, Phi, Velocity, rhoA, rhoB, tauA, tauB,
+					alpha, beta, Fx, Fy, Fz, Nx, Nx*Ny, ScaLBL_Comm->FirstInterior(), ScaLBL_Comm->LastInterior(),
+					fused_lag, fused_block_size, Np);
 		}
-		// Halo exchange for phase field
-		ScaLBL_Comm_Regular->SendHalo(Phi);
+		else {
+			// Compute the Phase indicator field
+			// Read for Aq, Bq happens in this routine (requires communication)
+			// (with the aggregated exchange fq travels in the same message as Aq, Bq)
+			if (AGGREGATED_EXCHANGE) ScaLBL_Comm->SendD3Q19D3Q7AA(fq,Aq,Bq); //READ FROM NORMAL
+			else ScaLBL_Comm->BiSendD3Q7AA(Aq,Bq); //READ FROM NORMAL
+			ScaLBL_D3Q7_AAodd_PhaseField(NeighborList, dvcMap, Aq, Bq, Den, Phi, ScaLBL_Comm->FirstInterior(), ScaLBL_Comm->LastInterior(), Np);
+			if (AGGREGATED_EXCHANGE) ScaLBL_Comm->RecvD3Q19D3Q7AA(fq,Aq,Bq); //WRITE INTO OPPOSITE
+			else ScaLBL_Comm->BiRecvD3Q7AA(Aq,Bq); //WRITE INTO OPPOSITE
+			ScaLBL_DeviceBarrier();
+			ScaLBL_D3Q7_AAodd_PhaseField(NeighborList, dvcMap, Aq, Bq, Den, Phi, 0, ScaLBL_Comm->LastExterior(), Np);
+
+			// Perform the collision operation
+			if (!AGGREGATED_EXCHANGE) ScaLBL_Comm->SendD3Q19AA(fq); //READ FROM NORMAL
+			if (BoundaryCondition > 0){
+				ScaLBL_Comm->Color_BC_z(dvcMap, Phi, Den, inletA, inletB);
+				ScaLBL_Comm->Color_BC_Z(dvcMap, Phi, Den, outletA, outletB);
+			}
+			// Halo exchange for phase field
+			ScaLBL_Comm_Regular->SendHalo(Phi);
 
-		ScaLBL_D3Q19_AAodd_Color(NeighborList, dvcMap, fq, Aq, Bq, Den, Phi, Velocity, rhoA, rhoB, tauA, tauB,
-				alpha, beta, Fx, Fy, Fz, Nx, Nx*Ny, ScaLBL_Comm->FirstInterior(), ScaLBL_Comm->LastInterior(), Np);
+			ScaLBL_D3Q19_AAodd_Color(NeighborList, dvcMap, fq, Aq, Bq, Den, Phi, Velocity, rhoA, rhoB, tauA, tauB,
+					alpha, beta, Fx, Fy, Fz, Nx, Nx*Ny, ScaLBL_Comm->FirstInterior(), ScaLBL_Comm->LastInterior(), Np);
+		}
 		ScaLBL_Comm_Regular->RecvHalo(Phi);
-		ScaLBL_Comm->RecvD3Q19AA(fq); //WRITE INTO OPPOSITE
+		if (!AGGREGATED_EXCHANGE) ScaLBL_Comm->RecvD3Q19AA(fq); //WRITE INTO OPPOSITE
 		ScaLBL_DeviceBarrier();
 		// Set BCs
 		if (BoundaryCondition == 3){
@@ -710,25 +780,51 @@ void ScaLBL_ColorModel::Run(){
 
 		// *************EVEN TIMESTEP*************
 		timestep++;
-		// Compute the Phase indicator field
-		ScaLBL_Comm->BiSendD3Q7AA(Aq,Bq); //READ FROM NORMAL
-		ScaLBL_D3Q7_AAeven_PhaseField(dvcMap, Aq, Bq, Den, Phi, ScaLBL_Comm->FirstInterior(), ScaLBL_Comm->LastInterior(), Np);
-		ScaLBL_Comm->BiRecvD3Q7AA(Aq,Bq); //WRITE INTO OPPOSITE
-		ScaLBL_DeviceBarrier();
-		ScaLBL_D3Q7_AAeven_PhaseField(dvcMap, Aq, Bq, Den, Phi, 0, ScaLBL_Comm->LastExterior(), Np);
-
-		// Perform the collision operation
-		ScaLBL_Comm->SendD3Q19AA(fq); //READ FORM NORMAL
-		// Halo exchange for phase field
-		if (BoundaryCondition > 0){
-			ScaLBL_Comm->Color_BC_z(dvcMap, Phi, Den, inletA, inletB);
-			ScaLBL_Comm->Color_BC_Z(dvcMap, Phi, Den, outletA, outletB);
+		if (FUSED_KERNEL){
+			if (AGGREGATED_EXCHANGE){
+				ScaLBL_Comm->SendD3Q19D3Q7AA(fq,Aq,Bq); //READ FROM NORMAL
+				ScaLBL_Comm->RecvD3Q19D3Q7AA(fq,Aq,Bq); //WRITE INTO OPPOSITE
+			}
+			else {
+				ScaLBL_Comm->BiSendD3Q7AA(Aq,Bq); //READ FROM NORMAL
+				ScaLBL_Comm->BiRecvD3Q7AA(Aq,Bq); //WRITE INTO OPPOSITE
+			}
+			ScaLBL_DeviceBarrier();
+			ScaLBL_D3Q7_AAeven_PhaseField(dvcMap, Aq, Bq, Den, Phi, 0, ScaLBL_Comm->LastExterior(), Np);
+			if (!AGGREGATED_EXCHANGE) ScaLBL_Comm->SendD3Q19AA(fq); //READ FORM NORMAL
+			if (BoundaryCondition > 0){
+				ScaLBL_Comm->Color_BC_z(dvcMap, Phi, Den, inletA, inletB);
+				ScaLBL_Comm->Color_BC_Z(dvcMap, Phi, Den, outletA, outletB);
+			}
+			ScaLBL_Comm_Regular->SendHalo(Phi);
+			ScaLBL_D3Q19_AAeven_ColorFused(dvcMap, fq, Aq, Bq, Den, Phi, Velocity, rhoA, rhoB, tauA, tauB,
+					alpha, beta, Fx, Fy, Fz, Nx, Nx*Ny, ScaLBL_Comm->FirstInterior(), ScaLBL_Comm->LastInterior(),
+					fused_lag, fused_block_size, Np);
+		}
+		else {
+			// Compute the Phase indicator field
+			// (with the aggregated exchange fq travels in the same message as Aq, Bq)
+			if (AGGREGATED_EXCHANGE) ScaLBL_Comm->SendD3Q19D3Q7AA(fq,Aq,Bq); //READ FROM NORMAL
+			else ScaLBL_Comm->BiSendD3Q7AA(Aq,Bq); //READ FROM NORMAL
+			ScaLBL_D3Q7_AAeven_PhaseField(dvcMap, Aq, Bq, Den, Phi, ScaLBL_Comm->FirstInterior(), ScaLBL_Comm->LastInterior(), Np);
+			if (AGGREGATED_EXCHANGE) ScaLBL_Comm->RecvD3Q19D3Q7AA(fq,Aq,Bq); //WRITE INTO OPPOSITE
+			else ScaLBL_Comm->BiRecvD3Q7AA(Aq,Bq); //WRITE INTO OPPOSITE
+			ScaLBL_DeviceBarrier();
+			ScaLBL_D3Q7_AAeven_PhaseField(dvcMap, Aq, Bq, Den, Phi, 0, ScaLBL_Comm->LastExterior(), Np);
+
+			// Perform the collision operation
+			if (!AGGREGATED_EXCHANGE) ScaLBL_Comm->SendD3Q19AA(fq); //READ FORM NORMAL
+			// Halo exchange for phase field
+			if (BoundaryCondition > 0){
+				ScaLBL_Comm->Color_BC_z(dvcMap, Phi, Den, inletA, inletB);
+				ScaLBL_Comm->Color_BC_Z(dvcMap, Phi, Den, outletA, outletB);
+			}
+			ScaLBL_Comm_Regular->SendHalo(Phi);
+			ScaLBL_D3Q19_AAeven_Color(dvcMap, fq, Aq, Bq, Den, Phi, Velocity, rhoA, rhoB, tauA, tauB,
+					alpha, beta, Fx, Fy, Fz,  Nx, Nx*Ny, ScaLBL_Comm->FirstInterior(), ScaLBL_Comm->LastInterior(), Np);
 		}
-		ScaLBL_Comm_Regular->SendHalo(Phi);
-		ScaLBL_D3Q19_AAeven_Color(dvcMap, fq, Aq, Bq, Den, Phi, Velocity, rhoA, rhoB, tauA, tauB,
-				alpha, beta, Fx, Fy, Fz,  Nx, Nx*Ny, ScaLBL_Comm->FirstInterior(), ScaLBL_Comm->LastInterior(), Np);
 		ScaLBL_Comm_Regular->RecvHalo(Phi);
-		ScaLBL_Comm->RecvD3Q19AA(fq); //WRITE INTO OPPOSITE
+		if (!AGGREGATED_EXCHANGE) ScaLBL_Comm->RecvD3Q19AA(fq); //WRITE INTO OPPOSITE
 		ScaLBL_DeviceBarrier();
 		// Set boundary conditions
 		if (BoundaryCondition == 3){
@@ -1213,8 +1309,8 @@ double ScaLBL_ColorModel::SeedPhaseField(const double seed_water_in_oil){
 	Aq_tmp = new double [7*Np];
 	Bq_tmp = new double [7*Np];
 
-	ScaLBL_CopyToHost(Aq_tmp, Aq, 7*Np*sizeof(double));
-	ScaLBL_CopyToHost(Bq_tmp, Bq, 7*Np*sizeof(double));
+	ScaLBL_CopyDistToHost(Aq_tmp, Aq, 7*Np);
+	ScaLBL_CopyDistToHost(Bq_tmp, Bq, 7*Np);
 	
 /*	for (int k=1; k<Nz-1; k++){
 		for (int j=1; j<Ny-1; j++){
@@ -1292,8 +1388,8 @@ double ScaLBL_ColorModel::SeedPhaseField(const double seed_water_in_oil){
 
 	// Need to initialize Aq, Bq, Den, Phi directly
 	//ScaLBL_CopyToDevice(Phi,phase.data(),7*Np*sizeof(double));
-	ScaLBL_CopyToDevice(Aq, Aq_tmp, 7*Np*sizeof(double));
-	  ScaLBL_CopyToDevice(Bq, Bq_tmp, 7*Np*sizeof(double));
+	ScaLBL_CopyDistToDevice(Aq, Aq_tmp, 7*Np);
+	ScaLBL_CopyDistToDevice(Bq, Bq_tmp, 7*Np);
 
 	return(mass_loss);
 }
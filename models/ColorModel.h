@@ -48,6 +48,8 @@ public:
 	
 	bool Restart,pBC;
 	bool REVERSE_FLOW_DIRECTION;
+	bool FUSED_KERNEL;
+	bool AGGREGATED_EXCHANGE;
 	int timestep,timestepMax;
 	int BoundaryCondition;
 	double tauA,tauB,rhoA,rhoB,alpha,beta;
@@ -76,7 +78,7 @@ public:
     signed char *id;    
 	int *NeighborList;
 	int *dvcMap;
-	double *fq, *Aq, *Bq;
+	dist_t *fq, *Aq, *Bq;
 	double *Den, *Phi;
 	double *ColorGrad;
 	double *Velocity;
@@ -87,6 +89,7 @@ private:
     
 	int dist_mem_size;
 	int neighborSize;
+	int fused_lag, fused_block_size;
 	// filenames
     char LocalRankString[8];
     char LocalRankFilename[40];
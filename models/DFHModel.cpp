@@ -214,22 +214,26 @@ void ScaLBL_DFHModel::Create(){
 	//...........................................................................
 	// LBM variables
 	if (rank==0)    printf ("Allocating distributions \n");
+	// sites updated by the kernels (first touch of the site memory)
+	int lastExterior = ScaLBL_Comm->LastExterior();
+	int firstInterior = ScaLBL_Comm->FirstInterior();
+	int lastInterior = ScaLBL_Comm->LastInterior();
 	//......................device distributions.................................
-	dist_mem_size = Np*sizeof(double);
+	dist_mem_size = Np*sizeof(dist_t);
 	neighborSize=18*(Np*sizeof(int));
 
 	//...........................................................................
-	ScaLBL_AllocateDeviceMemory((void **) &NeighborList, neighborSize);
-	ScaLBL_AllocateDeviceMemory((void **) &dvcMap, sizeof(int)*Np);
-	ScaLBL_AllocateDeviceMemory((void **) &fq, 19*dist_mem_size);
-	ScaLBL_AllocateDeviceMemory((void **) &Aq, 7*dist_mem_size);
-	ScaLBL_AllocateDeviceMemory((void **) &Bq, 7*dist_mem_size);
-	ScaLBL_AllocateDeviceMemory((void **) &Den, 2*dist_mem_size);
-	ScaLBL_AllocateDeviceMemory((void **) &Phi, sizeof(double)*Np);        
-	ScaLBL_AllocateDeviceMemory((void **) &Pressure, sizeof(double)*Np);
-	ScaLBL_AllocateDeviceMemory((void **) &Velocity, 3*sizeof(double)*Np);
-	ScaLBL_AllocateDeviceMemory((void **) &Gradient, 3*sizeof(double)*Np);
-	ScaLBL_AllocateDeviceMemory((void **) &SolidPotential, 3*sizeof(double)*Np);
+	ScaLBL_AllocateSiteMemory((void **) &NeighborList, neighborSize, sizeof(int)*Np, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &dvcMap, sizeof(int)*Np, sizeof(int)*Np, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &fq, 19*dist_mem_size, dist_mem_size, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &Aq, 7*dist_mem_size, dist_mem_size, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &Bq, 7*dist_mem_size, dist_mem_size, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &Den, 2*sizeof(double)*Np, sizeof(double)*Np, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &Phi, sizeof(double)*Np, sizeof(double)*Np, Np, lastExterior, firstInterior, lastInterior);        
+	ScaLBL_AllocateSiteMemory((void **) &Pressure, sizeof(double)*Np, sizeof(double)*Np, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &Velocity, 3*sizeof(double)*Np, sizeof(double)*Np, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &Gradient, 3*sizeof(double)*Np, sizeof(double)*Np, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &SolidPotential, 3*sizeof(double)*Np, sizeof(double)*Np, Np, lastExterior, firstInterior, lastInterior);
 
 	//...........................................................................
 	// Update GPU data structures
@@ -450,23 +454,53 @@ void ScaLBL_DFHModel::Initialize(){
 		MPI_Bcast(&timestep,1,MPI_INT,0,comm);
 		// Read in the restart file to CPU buffers
 		double *cPhi = new double[Np];
+		double *cDen = new double[2*Np];
 		double *cDist = new double[19*Np];
-		ifstream File(LocalRestartFile,ios::binary);
-		double value;
-		for (int n=0; n<Np; n++){
-			File.read((char*) &value, sizeof(value));
-			cPhi[n] = value;
-			// Read the distributions
-			for (int q=0; q<19; q++){
-				File.read((char*) &value, sizeof(value));
-				cDist[q*Np+n] = value;
+		ScaLBL_CopyToHost(cPhi, Phi, Np*sizeof(double));
+		double value,va,vb;
+		if (analysis_db->getWithDefault<std::string>( "restart_format", "rank" ) == "shared"){
+			// single restart file (may have been written with a different decomposition)
+			auto restart_file = analysis_db->getWithDefault<std::string>( "restart_file", "Restart" );
+			ScaLBL_CopyDistToHost(cDist,fq,19*Np);
+			ReadRestartFile(restart_file.c_str(), comm, *Dm, Map, cDen, cDist, Np);
+		}
+		else {
+			ifstream File(LocalRestartFile,ios::binary);
+			if (!File.is_open())
+				ERROR(std::string("DFHModel: unable to open restart file ")+LocalRestartFile);
+			for (int n=0; n<Np; n++){
+				File.read((char*) &va, sizeof(va));
+				File.read((char*) &vb, sizeof(vb));
+				cDen[n]    = va;
+				cDen[Np+n] = vb;
+			}
+			for (int n=0; n<Np; n++){
+				// Read the distributions
+				for (int q=0; q<19; q++){
+					File.read((char*) &value, sizeof(value));
+					cDist[q*Np+n] = value;
+				}
 			}
+			if (!File)
+				ERROR(std::string("DFHModel: error reading restart file ")+LocalRestartFile);
+			File.close();
+		}
+		// phase field from the densities
+		for (int n=0; n<ScaLBL_Comm->LastExterior(); n++){
+			va = cDen[n];
+			vb = cDen[Np + n];
+			cPhi[n] = (va-vb)/(va+vb);
+		}
+		for (int n=ScaLBL_Comm->FirstInterior(); n<ScaLBL_Comm->LastInterior(); n++){
+			va = cDen[n];
+			vb = cDen[Np + n];
+			cPhi[n] = (va-vb)/(va+vb);
 		}
-		File.close();
 		// Copy the restart data to the GPU
-		ScaLBL_CopyToDevice(fq,cDist,19*Np*sizeof(double));
+		ScaLBL_CopyDistToDevice(fq,cDist,19*Np);
 		ScaLBL_CopyToDevice(Phi,cPhi,Np*sizeof(double));
 		ScaLBL_DeviceBarrier();
+		delete [] cDen;
 		delete [] cPhi;
 		delete [] cDist;
 		MPI_Barrier(comm);
@@ -494,7 +528,7 @@ void ScaLBL_DFHModel::Run(){
 
 	bool Regular = true;
 	PROFILE_START("Loop");
-	runAnalysis analysis( analysis_db, rank_info, ScaLBL_Comm, Dm, Np, Regular, Map );
+	runAnalysis analysis( db, rank_info, ScaLBL_Comm, Dm, Np, Regular, Map );
 	while (timestep < timestepMax ) {
 		//if ( rank==0 ) { printf("Running timestep %i (%i MB)\n",timestep+1,(int)(Utilities::getMemoryUsage()/1048576)); }
 		PROFILE_START("Update");
@@ -575,7 +609,7 @@ void ScaLBL_DFHModel::Run(){
 		PROFILE_STOP("Update");
 
 		// Run the analysis
-		analysis.run(timestep, analysis_db, *Averages, Phi, Pressure, Velocity, fq, Den );
+		analysis.run(timestep, db, *Averages, Phi, Pressure, Velocity, fq, Den );
 	}
 	analysis.finish();
 	PROFILE_STOP("Loop");
@@ -58,7 +58,7 @@ public:
     char *id;
     int *NeighborList;
     int *dvcMap;
-    double *fq, *Aq, *Bq;
+    dist_t *fq, *Aq, *Bq;
     double *Den, *Phi;
     double *SolidPotential;
     double *Velocity;
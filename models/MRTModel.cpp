@@ -176,14 +176,18 @@ void ScaLBL_MRTModel::Create(){
 	//...........................................................................
 	// LBM variables
 	if (rank==0)    printf ("Allocating distributions \n");
+	// sites updated by the kernels (first touch of the site memory)
+	int lastExterior = ScaLBL_Comm->LastExterior();
+	int firstInterior = ScaLBL_Comm->FirstInterior();
+	int lastInterior = ScaLBL_Comm->LastInterior();
 	//......................device distributions.................................
-	int dist_mem_size = Np*sizeof(double);
+	int dist_mem_size = Np*sizeof(dist_t);
 	int neighborSize=18*(Np*sizeof(int));
 	//...........................................................................
-	ScaLBL_AllocateDeviceMemory((void **) &NeighborList, neighborSize);
-	ScaLBL_AllocateDeviceMemory((void **) &fq, 19*dist_mem_size);  
-	ScaLBL_AllocateDeviceMemory((void **) &Pressure, sizeof(double)*Np);
-	ScaLBL_AllocateDeviceMemory((void **) &Velocity, 3*sizeof(double)*Np);
+	ScaLBL_AllocateSiteMemory((void **) &NeighborList, neighborSize, sizeof(int)*Np, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &fq, 19*dist_mem_size, dist_mem_size, Np, lastExterior, firstInterior, lastInterior);  
+	ScaLBL_AllocateSiteMemory((void **) &Pressure, sizeof(double)*Np, sizeof(double)*Np, Np, lastExterior, firstInterior, lastInterior);
+	ScaLBL_AllocateSiteMemory((void **) &Velocity, 3*sizeof(double)*Np, sizeof(double)*Np, Np, lastExterior, firstInterior, lastInterior);
 	//...........................................................................
 	// Update GPU data structures
 	if (rank==0)    printf ("Setting up device map and neighbor list \n");
@@ -384,6 +388,8 @@ void ScaLBL_MRTModel::VelocityField(){
 						Morphology.V(),Morphology.A(),Morphology.J(),Morphology.X(),vax,vay,vaz);
 						*/
 	
+	// the silo output places each sub-domain at iproc*nx (etc.)
+	if (!Dm->UniformBlocks()) ERROR("MRT model: VelocityField requires Decomposition = \"uniform\"");
 	std::vector<IO::MeshDataStruct> visData;
 	fillHalo<double> fillData(Dm->Comm,Dm->rank_info,{Dm->Nx-2,Dm->Ny-2,Dm->Nz-2},{1,1,1},0,1);
 
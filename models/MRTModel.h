@@ -68,7 +68,7 @@ public:
     IntArray Map;
     DoubleArray Distance;
     int *NeighborList;
-    double *fq;
+    dist_t *fq;
     double *Velocity;
     double *Pressure;
     
@@ -0,0 +1,161 @@
+//*************************************************************************
+// Check the snapshots of the simulation state taken by runAnalysis
+//   - runAnalysis::basic copies the state into a pinned buffer and returns,
+//     the device arrays can be overwritten while the analysis threads work
+//   - the regular layout and SubPhase::Basic match a synchronous copy
+//   TestAnalysisSnapshot [n] runs on an n^3 sub-domain per rank
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include "analysis/runAnalysis.h"
+#include "common/ScaLBL.h"
+#include "common/MPI_Helpers.h"
+#include "TestSiteLayout.h"
+
+// site values as a function of the global site
+static inline double SiteValue( int x, int y, int z, int q, int step )
+{
+	return sin(0.1*x + 0.37*y + 0.73*z + 1.3*q + 0.61*step);
+}
+
+int main(int argc, char **argv)
+{
+	int provided_thread_support = -1;
+	MPI_Init_thread(&argc,&argv,MPI_THREAD_MULTIPLE,&provided_thread_support);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = MPI_WORLD_RANK();
+	int nprocs = MPI_WORLD_SIZE();
+	int error = 0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running unit test: TestAnalysisSnapshot	\n");
+			printf("********************************************************\n");
+		}
+		auto nproc = TestProcessGrid(nprocs,"TestAnalysisSnapshot");
+		int n = (argc > 1) ? atoi(argv[1]) : 16;
+
+		auto db = std::make_shared<Database>();
+		auto domain_db = TestDomainDatabase(nproc,{ n, n, n });
+		auto analysis_db = std::make_shared<Database>();
+		auto vis_db = std::make_shared<Database>();
+		analysis_db->putScalar<int>( "analysis_interval", 10 );
+		analysis_db->putScalar<int>( "restart_interval", 1000000 );
+		analysis_db->putScalar<std::string>( "restart_file", "Restart" );
+		analysis_db->putScalar<std::string>( "basic_analysis", "regular" );
+		analysis_db->putScalar<int>( "N_threads", 2 );
+		vis_db->putScalar<bool>( "save_phase_field", false );
+		db->putDatabase( "Domain", domain_db );
+		db->putDatabase( "Analysis", analysis_db );
+		db->putDatabase( "Visualization", vis_db );
+		db->putDatabase( "Color", std::make_shared<Database>() );
+
+		std::shared_ptr<Domain> Dm(new Domain(domain_db,comm));
+		int Nx = Dm->Nx, Ny = Dm->Ny, Nz = Dm->Nz;
+		int ox = Dm->slab_x[Dm->iproc()];
+		int oy = Dm->slab_y[Dm->jproc()];
+		int oz = Dm->slab_z[Dm->kproc()];
+		IntArray Map;
+		int Np = 0;
+		auto ScaLBL_Comm = CreateTestLayout(Dm,7,Map,Np);
+
+		double *dvcPhi, *dvcDen, *dvcVel, *dvcPressure;
+		dist_t *dvcfq;
+		ScaLBL_AllocateDeviceMemory((void **) &dvcPhi, Np*sizeof(double));
+		ScaLBL_AllocateDeviceMemory((void **) &dvcDen, 2*Np*sizeof(double));
+		ScaLBL_AllocateDeviceMemory((void **) &dvcVel, 3*Np*sizeof(double));
+		ScaLBL_AllocateDeviceMemory((void **) &dvcPressure, Np*sizeof(double));
+		ScaLBL_AllocateDeviceMemory((void **) &dvcfq, 19*Np*sizeof(dist_t));
+		// state of the simulation at each step (values < 0 are overwritten after the snapshot)
+		auto SetState = [&]( int step ) {
+			std::vector<double> Den(2*Np,0.0), Vel(3*Np,0.0), fq(19*Np,0.0);
+			for (int k=1; k<Nz-1; k++){
+				for (int j=1; j<Ny-1; j++){
+					for (int i=1; i<Nx-1; i++){
+						int idx = Map(i,j,k);
+						if (idx < 0) continue;
+						int x = ox+i-1, y = oy+j-1, z = oz+k-1;
+						double phi = std::max(-1.0,std::min(1.0,1.5*SiteValue(x,y,z,0,step)));
+						Den[idx] = 0.5*(1.0+phi);
+						Den[Np+idx] = 0.5*(1.0-phi) + 1e-3;
+						for (int d=0; d<3; d++) Vel[d*Np+idx] = 1e-3*SiteValue(x,y,z,d+1,step);
+						for (int q=0; q<19; q++) fq[q*Np+idx] = 0.05 + 0.01*SiteValue(x,y,z,q+4,step);
+						if (step < 0){
+							Den[idx] = Den[Np+idx] = -1.0;
+							for (int q=0; q<19; q++) fq[q*Np+idx] = -1.0;
+						}
+					}
+				}
+			}
+			ScaLBL_CopyToDevice(dvcDen, Den.data(), 2*Np*sizeof(double));
+			ScaLBL_CopyToDevice(dvcVel, Vel.data(), 3*Np*sizeof(double));
+			ScaLBL_CopyDistToDevice(dvcfq, fq.data(), 19*Np);
+		};
+
+		// synchronous copy of the last step
+		SubPhase Reference(Dm);
+		Reference.SetParams(1.0,0.8,0.7,1.0,0.0,0.0,1e-5,0.005,0.95);
+		int steps = 4;
+		SetState(steps);
+		MPI_Barrier(comm);
+		double starttime = MPI_Wtime();
+		ScaLBL_D3Q19_Pressure(dvcfq,dvcPressure,Np);
+		ScaLBL_Comm->RegularLayout(Map,dvcPressure,Reference.Pressure);
+		ScaLBL_Comm->RegularLayout(Map,&dvcDen[0],Reference.Rho_n);
+		ScaLBL_Comm->RegularLayout(Map,&dvcDen[Np],Reference.Rho_w);
+		ScaLBL_Comm->RegularLayout(Map,&dvcVel[0],Reference.Vel_x);
+		ScaLBL_Comm->RegularLayout(Map,&dvcVel[Np],Reference.Vel_y);
+		ScaLBL_Comm->RegularLayout(Map,&dvcVel[2*Np],Reference.Vel_z);
+		double copy_time = maxReduce(comm,MPI_Wtime() - starttime);
+		if (rank == 0) printf("Synchronous copy to the regular layout: %0.4f s \n",copy_time);
+		Reference.Basic();
+
+		SubPhase Averages(Dm);
+		Averages.SetParams(1.0,0.8,0.7,1.0,0.0,0.0,1e-5,0.005,0.95);
+		{
+			RankInfoStruct rank_info(rank,nproc[0],nproc[1],nproc[2]);
+			runAnalysis analysis( db, rank_info, ScaLBL_Comm, Dm, Np, false, Map );
+			for (int step=1; step<=steps; step++){
+				SetState(step);
+				analysis.basic(10*step, db, Averages, dvcPhi, dvcPressure, dvcVel, dvcfq, dvcDen );
+				// the simulation continues while the snapshot is converted
+				SetState(-1);
+				ScaLBL_D3Q19_Pressure(dvcfq,dvcPressure,Np);
+			}
+			analysis.finish();
+		}
+
+		int bad = 0;
+		for (int k=1; k<Nz-1; k++){
+			for (int j=1; j<Ny-1; j++){
+				for (int i=1; i<Nx-1; i++){
+					if (Averages.Pressure(i,j,k) != Reference.Pressure(i,j,k)) bad++;
+					if (Averages.Rho_n(i,j,k) != Reference.Rho_n(i,j,k)) bad++;
+					if (Averages.Rho_w(i,j,k) != Reference.Rho_w(i,j,k)) bad++;
+					if (Averages.Vel_x(i,j,k) != Reference.Vel_x(i,j,k)) bad++;
+					if (Averages.Vel_y(i,j,k) != Reference.Vel_y(i,j,k)) bad++;
+					if (Averages.Vel_z(i,j,k) != Reference.Vel_z(i,j,k)) bad++;
+				}
+			}
+		}
+		bad = sumReduce(comm,bad);
+		if (Averages.gnb.V != Reference.gnb.V || Averages.gnb.M != Reference.gnb.M || Averages.gnb.p != Reference.gnb.p
+			|| Averages.gwb.V != Reference.gwb.V || Averages.gwb.M != Reference.gwb.M || Averages.gwb.p != Reference.gwb.p)
+			bad++;
+		if (rank == 0) printf("Snapshot of step %i: %i errors (Sw = %f) \n",steps,bad,
+			Reference.gwb.V/(Reference.gnb.V+Reference.gwb.V));
+		if (bad > 0) error++;
+
+		ScaLBL_FreeDeviceMemory(dvcPhi);
+		ScaLBL_FreeDeviceMemory(dvcDen);
+		ScaLBL_FreeDeviceMemory(dvcVel);
+		ScaLBL_FreeDeviceMemory(dvcPressure);
+		ScaLBL_FreeDeviceMemory(dvcfq);
+		if (error == 0 && rank == 0) printf("Analysis snapshot passed \n");
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return error;
+}
@@ -0,0 +1,130 @@
+//*************************************************************************
+// Check the distributed labeling of the blobs (ComputeGlobalBlobIDs)
+//   - the blobs match a flood fill of the global (periodic) image
+//   - the ids are ordered by size, largest first, and agree across ranks
+//   TestBlobLabel [n] times the labeling on an n^3 sub-domain per rank
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include "analysis/analysis.h"
+#include "common/MPI_Helpers.h"
+#include "TestSiteLayout.h"
+
+// phase indicator as a function of the global cell (blobs of varying size)
+static inline double PhaseValue( int x, int y, int z )
+{
+	return sin(0.45*x+0.3)*sin(0.5*y)*sin(0.55*z+0.2) + 0.2*sin(0.13*(x+2*y+3*z)) - 0.3;
+}
+static inline bool IsSolid( int x, int y, int z )
+{
+	return (x*7+y*11+z*5)%23 == 0;
+}
+static inline bool IsBlob( int x, int y, int z )
+{
+	return PhaseValue(x,y,z) > 0.0 && !IsSolid(x,y,z);
+}
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = MPI_WORLD_RANK();
+	int nprocs = MPI_WORLD_SIZE();
+	int error = 0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running unit test: TestBlobLabel	\n");
+			printf("********************************************************\n");
+		}
+		auto nproc = TestProcessGrid(nprocs,"TestBlobLabel","xzy");
+		int n = (argc > 1) ? atoi(argv[1]) : 0;
+		bool check = (n == 0);
+		if (check) n = 20;
+		RankInfoStruct rank_info(rank,nproc[0],nproc[1],nproc[2]);
+		int nx = n, ny = n, nz = n;
+		int Lx = nx*nproc[0], Ly = ny*nproc[1], Lz = nz*nproc[2];
+		int ox = rank_info.ix*nx, oy = rank_info.jy*ny, oz = rank_info.kz*nz;
+
+		// local part of the image (with the halo)
+		DoubleArray Phase(nx+2,ny+2,nz+2), SignDist(nx+2,ny+2,nz+2);
+		for (int k=0; k<nz+2; k++){
+			for (int j=0; j<ny+2; j++){
+				for (int i=0; i<nx+2; i++){
+					int x = (ox+i-1+Lx)%Lx, y = (oy+j-1+Ly)%Ly, z = (oz+k-1+Lz)%Lz;
+					Phase(i,j,k) = PhaseValue(x,y,z);
+					SignDist(i,j,k) = IsSolid(x,y,z) ? -1.0 : 1.0;
+				}
+			}
+		}
+		BlobIDArray GlobalBlobID;
+		MPI_Barrier(comm);
+		double starttime = MPI_Wtime();
+		int nblobs = ComputeGlobalBlobIDs(nx,ny,nz,rank_info,Phase,SignDist,0.0,0.0,GlobalBlobID,comm);
+		double label_time = maxReduce(comm,MPI_Wtime() - starttime);
+		if (rank == 0) printf("%i^3 per rank: %i blobs, labeling %0.4f s \n",n,nblobs,label_time);
+
+		if (check){
+			// flood fill of the global (periodic) image
+			Array<int> ID0(Lx,Ly,Lz);
+			ID0.fill(-1);
+			int nblobs0 = 0;
+			std::vector<int> stack;
+			for (int c=0; c<Lx*Ly*Lz; c++){
+				if (ID0(c) >= 0 || !IsBlob(c%Lx,(c/Lx)%Ly,c/(Lx*Ly))) continue;
+				ID0(c) = nblobs0;
+				stack.push_back(c);
+				while (!stack.empty()){
+					int m = stack.back();
+					stack.pop_back();
+					int x = m%Lx, y = (m/Lx)%Ly, z = m/(Lx*Ly);
+					const int d[6][3] = {{1,0,0},{-1,0,0},{0,1,0},{0,-1,0},{0,0,1},{0,0,-1}};
+					for (int p=0; p<6; p++){
+						int x2 = (x+d[p][0]+Lx)%Lx, y2 = (y+d[p][1]+Ly)%Ly, z2 = (z+d[p][2]+Lz)%Lz;
+						if (ID0(x2,y2,z2) >= 0 || !IsBlob(x2,y2,z2)) continue;
+						ID0(x2,y2,z2) = nblobs0;
+						stack.push_back(x2+y2*Lx+z2*Lx*Ly);
+					}
+				}
+				nblobs0++;
+			}
+			std::vector<int> size(nblobs0,0);
+			for (size_t i=0; i<ID0.length(); i++)
+				if (ID0(i) >= 0) size[ID0(i)]++;
+			// every global id corresponds to one flood fill id (and the reverse), including the halo
+			std::vector<int> map(nblobs,-1), map0(nblobs0,-1);
+			int bad = 0;
+			for (int k=0; k<nz+2; k++){
+				for (int j=0; j<ny+2; j++){
+					for (int i=0; i<nx+2; i++){
+						int x = (ox+i-1+Lx)%Lx, y = (oy+j-1+Ly)%Ly, z = (oz+k-1+Lz)%Lz;
+						int id = GlobalBlobID(i,j,k), id0 = ID0(x,y,z);
+						if ((id < 0) != (id0 < 0)){ bad++; continue; }
+						if (id < 0) continue;
+						if (id >= nblobs){ bad++; continue; }
+						if (map[id] == -1) map[id] = id0;
+						if (map0[id0] == -1) map0[id0] = id;
+						if (map[id] != id0 || map0[id0] != id) bad++;
+					}
+				}
+			}
+			// the ids are ordered by size and all ranks agree on the mapping
+			std::vector<int> global_map(nblobs,-1);
+			MPI_Allreduce(map.data(),global_map.data(),nblobs,MPI_INT,MPI_MAX,comm);
+			for (int id=0; id<nblobs; id++){
+				if (map[id] >= 0 && map[id] != global_map[id]) bad++;
+				if (global_map[id] < 0) bad++;
+				else if (id > 0 && global_map[id-1] >= 0 && size[global_map[id]] > size[global_map[id-1]]) bad++;
+			}
+			bad = sumReduce(comm,bad);
+			if (rank == 0) printf("flood fill: %i blobs, %i errors \n",nblobs0,bad);
+			if (nblobs != nblobs0 || bad > 0) error++;
+		}
+		if (error == 0 && rank == 0) printf("Blob labeling passed \n");
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return error;
+}
@@ -0,0 +1,192 @@
+//*************************************************************************
+// Check the blob tracker (BlobTracker) on a sequence of sphere packs
+//   - a blob is born, one dies, two merge, one splits and one moves
+//   - the time-consistent ids match computeIDMap / getNewIDs
+//   - the event log contains the events with the sizes and centroids, also
+//     with a weighted decomposition (slab_x)
+//   - the id map matches the one written by writeIDMap
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <array>
+#include <iostream>
+#include "analysis/analysis.h"
+#include "common/MPI_Helpers.h"
+#include "TestSiteLayout.h"
+
+static const int L = 32;
+
+// the spheres of each step (x, y, z, radius)
+static std::vector<std::array<double,4> > getSpheres( int step )
+{
+	std::vector<std::array<double,4> > spheres;
+	spheres.push_back( {{ step==0 ? 8.0:9.0, 8, 8, 4 }} );	// moves
+	spheres.push_back( {{ 20, 8, 8, 3 }} );				// merges with the next sphere
+	spheres.push_back( {{ 27, 8, 8, 3 }} );
+	if ( step==0 ) {
+		spheres.push_back( {{ 8, 22, 8, 4 }} );			// splits
+		spheres.push_back( {{ 22, 22, 22, 3 }} );		// dies
+	} else {
+		spheres.push_back( {{ 8, 19, 8, 2.5 }} );
+		spheres.push_back( {{ 8, 25, 8, 2.5 }} );
+		spheres.push_back( {{ 8, 8, 24, 3 }} );			// is born
+	}
+	return spheres;
+}
+static inline bool InBlob( int x, int y, int z, int step )
+{
+	std::vector<std::array<double,4> > spheres = getSpheres( step );
+	for (size_t i=0; i<spheres.size(); i++) {
+		double dx = x-spheres[i][0], dy = y-spheres[i][1], dz = z-spheres[i][2];
+		if ( dx*dx+dy*dy+dz*dz < spheres[i][3]*spheres[i][3] )
+			return true;
+	}
+	// bridge between the merging spheres
+	return step>0 && x>=20 && x<=27 && (y-8)*(y-8)+(z-8)*(z-8) <= 2;
+}
+
+static std::string readFile( const char *filename )
+{
+	std::string data;
+	FILE *fid = fopen(filename,"rb");
+	if ( fid == NULL )
+		return data;
+	char buf[1024];
+	size_t N = 0;
+	while ( (N=fread(buf,1,sizeof(buf),fid)) > 0 )
+		data.append(buf,N);
+	fclose(fid);
+	return data;
+}
+
+// track the blobs on the given decomposition (slab_x empty: uniform blocks)
+static int TrackBlobs( const std::vector<int>& slab_x, MPI_Comm comm )
+{
+	int rank = comm_rank(comm);
+	int nprocs = comm_size(comm);
+	int error = 0;
+	// x is split first, so the weighted decomposition can move the cut along x
+	auto nproc = TestProcessGrid(nprocs,"TestBlobTrack","xyz");
+	auto db = TestDomainDatabase(nproc,{ L/nproc[0], L/nproc[1], L/nproc[2] });
+	if ( !slab_x.empty() ) {
+		db->putScalar<std::string>( "Decomposition", "weighted" );
+		db->putVector<int>( "slab_x", slab_x );
+		db->putVector<int>( "slab_y", nproc[1]==1 ? std::vector<int>{ 0, L } : std::vector<int>{ 0, L/2, L } );
+		db->putVector<int>( "slab_z", nproc[2]==1 ? std::vector<int>{ 0, L } : std::vector<int>{ 0, L/2, L } );
+	}
+	Domain Dm( db, comm );
+	const RankInfoStruct& rank_info = Dm.rank_info;
+	int nx = Dm.Nx-2, ny = Dm.Ny-2, nz = Dm.Nz-2;
+	int ox = Dm.slab_x[Dm.iproc()], oy = Dm.slab_y[Dm.jproc()], oz = Dm.slab_z[Dm.kproc()];
+
+	const char *filename = "TestBlobTrack.bin";
+	BlobTracker tracker( filename, comm, "TestBlobTrack.txt" );
+	writeIDMap(ID_map_struct(),0,"TestBlobTrack2.txt");
+	BlobIDArray LastID;
+	BlobIDType id_max = -1;
+	const int steps = 3;
+	for (int step=0; step<steps; step++){
+		DoubleArray Phase(nx+2,ny+2,nz+2), SignDist(nx+2,ny+2,nz+2);
+		for (int k=0; k<nz+2; k++){
+			for (int j=0; j<ny+2; j++){
+				for (int i=0; i<nx+2; i++){
+					int x = (ox+i-1+L)%L, y = (oy+j-1+L)%L, z = (oz+k-1+L)%L;
+					Phase(i,j,k) = InBlob(x,y,z,std::min(step,1)) ? 1.0:-1.0;
+					SignDist(i,j,k) = 1.0;
+				}
+			}
+		}
+		BlobIDArray GlobalBlobID;
+		int nblobs = ComputeGlobalBlobIDs(nx,ny,nz,rank_info,Phase,SignDist,0.0,0.0,GlobalBlobID,comm);
+		std::vector<BlobIDType> new_ids;
+		tracker.update( 10*step, Dm, GlobalBlobID, new_ids, comm );
+		// time-consistent ids from the full id map
+		std::vector<BlobIDType> new_ids2;
+		BlobIDArray ID = GlobalBlobID;
+		if ( step==0 ) {
+			ID_map_struct map( nblobs );
+			getNewIDs(map,id_max,new_ids2);
+			writeIDMap(map,10*step,"TestBlobTrack2.txt");
+		} else {
+			ID_map_struct map = computeIDMap(nx+2,ny+2,nz+2,LastID,ID,comm);
+			getNewIDs(map,id_max,new_ids2);
+			writeIDMap(map,10*step,"TestBlobTrack2.txt");
+		}
+		renumberIDs(new_ids2,ID);
+		LastID = ID;
+		if ( new_ids != new_ids2 ) {
+			if (rank == 0) printf("step %i: the new ids do not match getNewIDs \n",step);
+			error++;
+		}
+	}
+
+	// check the event log
+	if ( rank == 0 ) {
+		std::vector<BlobEvent> events = readBlobEvents( filename );
+		int count[5] = { 0, 0, 0, 0, 0 };
+		for (size_t i=0; i<events.size(); i++){
+			const BlobEvent& event = events[i];
+			count[event.type]++;
+			printf("step %lli: type %i, %i -> %i blobs \n",event.timestep,event.type,
+				(int)event.src.size(),(int)event.dst.size());
+			if ( event.timestep==0 && event.type!=BlobEvent::Birth ) error++;
+			if ( event.timestep>10 ) error++;
+			if ( event.timestep==10 && event.type==BlobEvent::Birth ) {
+				// the new sphere is symmetric about its center
+				const BlobSummary& blob = event.dst_info[0];
+				if ( fabs(blob.centroid[0]-8)+fabs(blob.centroid[1]-8)+fabs(blob.centroid[2]-24) > 1e-12 ) error++;
+			}
+			if ( event.type==BlobEvent::Death ) {
+				const BlobSummary& blob = event.src_info[0];
+				int N = 0;
+				for (int z=0; z<L; z++)
+					for (int y=0; y<L; y++)
+						for (int x=0; x<L; x++)
+							N += (x-22)*(x-22)+(y-22)*(y-22)+(z-22)*(z-22) < 9 ? 1:0;
+				if ( blob.count!=N || fabs(blob.centroid[0]-22)+fabs(blob.centroid[1]-22)+fabs(blob.centroid[2]-22) > 1e-12 ) error++;
+			}
+			if ( event.type==BlobEvent::Split && event.dst.size()!=2 ) error++;
+			if ( event.type==BlobEvent::Merge && event.src.size()!=2 ) error++;
+		}
+		if ( count[BlobEvent::Birth]!=6 || count[BlobEvent::Death]!=1 || count[BlobEvent::Split]!=1
+			|| count[BlobEvent::Merge]!=1 || count[BlobEvent::MergeSplit]!=0 ) {
+			printf("unexpected events: %i %i %i %i %i \n",count[0],count[1],count[2],count[3],count[4]);
+			error++;
+		}
+		if ( tracker.blobs().size()!=5 ) error++;
+		// check the id map
+		std::string id_map = readFile("TestBlobTrack.txt");
+		if ( id_map.empty() || id_map != readFile("TestBlobTrack2.txt") ) {
+			printf("the id map does not match writeIDMap \n");
+			error++;
+		}
+	}
+	return sumReduce(comm,error);
+}
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = MPI_WORLD_RANK();
+	int nprocs = MPI_WORLD_SIZE();
+	int error = 0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running unit test: TestBlobTrack	\n");
+			printf("********************************************************\n");
+		}
+		error += TrackBlobs( std::vector<int>(), comm );
+		if ( nprocs > 1 ) {
+			// weighted decomposition: the second slab starts at x = 12 (the blob that dies is at x = 22)
+			if (rank == 0) printf("slab_x = 0 12 32: \n");
+			error += TrackBlobs( { 0, 12, L }, comm );
+		}
+		if (error == 0 && rank == 0) printf("Blob tracking passed \n");
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return error;
+}
@@ -266,12 +266,12 @@ int main(int argc, char **argv)
 		// LBM variables
 		if (rank==0)	printf ("Allocating distributions \n");
 		//......................device distributions.................................
-		int dist_mem_size = Np*sizeof(double);
+		int dist_mem_size = Np*sizeof(dist_t);
 		int neighborSize=18*(Np*sizeof(int));
 
 		int *NeighborList;
 		int *dvcMap;
-		double *fq, *Aq, *Bq;
+		dist_t *fq, *Aq, *Bq;
 		double *Den, *Phi;
 		double *SolidPotential;
 		double *Velocity;
@@ -284,7 +284,7 @@ int main(int argc, char **argv)
 		ScaLBL_AllocateDeviceMemory((void **) &fq, 19*dist_mem_size);
 		ScaLBL_AllocateDeviceMemory((void **) &Aq, 7*dist_mem_size);
 		ScaLBL_AllocateDeviceMemory((void **) &Bq, 7*dist_mem_size);
-		ScaLBL_AllocateDeviceMemory((void **) &Den, 2*dist_mem_size);
+		ScaLBL_AllocateDeviceMemory((void **) &Den, 2*sizeof(double)*Np);
 		ScaLBL_AllocateDeviceMemory((void **) &Phi, sizeof(double)*Np);		
 		ScaLBL_AllocateDeviceMemory((void **) &Pressure, sizeof(double)*Np);
 		ScaLBL_AllocateDeviceMemory((void **) &Velocity, 3*sizeof(double)*Np);
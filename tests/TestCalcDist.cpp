@@ -0,0 +1,169 @@
+//*************************************************************************
+// Check the exact distance transform used by CalcDist
+//   - the signed distance matches a brute force search on a sphere pack
+//     (periodic and non-periodic, including the halo, any decomposition)
+//   - the time is compared with the vector sweep (DistanceMethod = "vector")
+//   TestCalcDist [n] runs the comparison on an n^3 sub-domain per rank
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include "analysis/distance.h"
+#include "common/MPI_Helpers.h"
+#include "TestSiteLayout.h"
+
+// Random overlapping solid spheres (periodic) with porosity near 0.5
+static void SpherePack( Array<char> &id, const Domain &Dm, unsigned int seed )
+{
+	int Nx = Dm.Nx, Ny = Dm.Ny, Nz = Dm.Nz;
+	int Gx = Dm.slab_x.back(), Gy = Dm.slab_y.back(), Gz = Dm.slab_z.back();
+	int ox = Dm.slab_x[Dm.iproc()], oy = Dm.slab_y[Dm.jproc()], oz = Dm.slab_z[Dm.kproc()];
+	int G = std::min(std::min(Gx,Gy),Gz);
+	double R = std::max(2.5,G/16.0);
+	int count = int(0.7*double(Gx)*Gy*Gz/(4.18879*R*R*R));
+	id.fill(1);
+	srand(seed);
+	for (int s=0; s<count; s++){
+		double cx = Gx*(rand()/(RAND_MAX+1.0));
+		double cy = Gy*(rand()/(RAND_MAX+1.0));
+		double cz = Gz*(rand()/(RAND_MAX+1.0));
+		for (int k=0; k<Nz; k++){
+			double dz = fabs(oz+k-1-cz);
+			dz = std::min(dz,fabs(Gz-dz));
+			if (dz > R) continue;
+			for (int j=0; j<Ny; j++){
+				double dy = fabs(oy+j-1-cy);
+				dy = std::min(dy,fabs(Gy-dy));
+				if (dy > R) continue;
+				for (int i=0; i<Nx; i++){
+					double dx = fabs(ox+i-1-cx);
+					dx = std::min(dx,fabs(Gx-dx));
+					if (dx*dx+dy*dy+dz*dz < R*R) id(i,j,k) = 0;
+				}
+			}
+		}
+	}
+}
+
+// Previous CalcDist: vector distance sweeps until converged
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = MPI_WORLD_RANK();
+	int nprocs = MPI_WORLD_SIZE();
+	int error = 0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running unit test: TestCalcDist	\n");
+			printf("********************************************************\n");
+		}
+		auto nproc = TestProcessGrid(nprocs,"TestCalcDist");
+		int size = (argc > 1) ? atoi(argv[1]) : 0;
+
+		if (size == 0){
+			// brute force check on a 20^3 image
+			int L = 20;
+			auto db = TestDomainDatabase(nproc,{ L/nproc[0], L/nproc[1], L/nproc[2] });
+			Domain Dm(db,comm);
+			int Nx = Dm.Nx, Ny = Dm.Ny, Nz = Dm.Nz;
+			int ox = Dm.slab_x[Dm.iproc()], oy = Dm.slab_y[Dm.jproc()], oz = Dm.slab_z[Dm.kproc()];
+			Array<char> id(Nx,Ny,Nz);
+			SpherePack(id,Dm,7);
+			// the global image
+			Array<char> image(L,L,L);
+			image.fill(0);
+			for (int k=1; k<Nz-1; k++)
+				for (int j=1; j<Ny-1; j++)
+					for (int i=1; i<Nx-1; i++)
+						image(ox+i-1,oy+j-1,oz+k-1) = id(i,j,k);
+			Array<char> global(L,L,L);
+			MPI_Allreduce(image.data(),global.data(),L*L*L,MPI_CHAR,MPI_SUM,comm);
+
+			for (int p=0; p<2; p++){
+				bool periodic = (p == 0);
+				DoubleArray Distance(Nx,Ny,Nz);
+				CalcDist(Distance,id,Dm,{periodic,periodic,periodic});
+				int bad = 0;
+				for (int k=0; k<Nz; k++){
+					for (int j=0; j<Ny; j++){
+						for (int i=0; i<Nx; i++){
+							// global cell (wrapped, or nearest cell on a non-periodic boundary)
+							int x = ox+i-1, y = oy+j-1, z = oz+k-1;
+							if (periodic){
+								x = (x+L)%L; y = (y+L)%L; z = (z+L)%L;
+							}
+							else{
+								x = std::min(std::max(x,0),L-1);
+								y = std::min(std::max(y,0),L-1);
+								z = std::min(std::max(z,0),L-1);
+							}
+							char value = global(x,y,z);
+							double dsq = 1e100;
+							for (int c=0; c<L*L*L; c++){
+								if ((global(c) == 0) == (value == 0)) continue;
+								int dx = abs(c%L-x), dy = abs((c/L)%L-y), dz = abs(c/(L*L)-z);
+								if (periodic){
+									dx = std::min(dx,L-dx); dy = std::min(dy,L-dy); dz = std::min(dz,L-dz);
+								}
+								dsq = std::min(dsq,double(dx*dx+dy*dy+dz*dz));
+							}
+							double dist = (value == 0) ? -(sqrt(dsq)-0.5) : sqrt(dsq)-0.5;
+							if (fabs(Distance(i,j,k)-dist) > 1e-12) bad++;
+						}
+					}
+				}
+				bad = sumReduce(comm,bad);
+				if (rank == 0) printf("%s: %i errors \n",periodic ? "periodic" : "non-periodic",bad);
+				if (bad > 0) error++;
+			}
+			size = 40;
+		}
+
+		// compare with the vector sweep
+		auto db = TestDomainDatabase(nproc,{ size, size, size });
+		Domain Dm(db,comm);
+		Dm.CommInit();
+		Array<char> id(Dm.Nx,Dm.Ny,Dm.Nz);
+		SpherePack(id,Dm,11);
+		auto sweep_db = db->cloneDatabase();
+		sweep_db->putScalar<std::string>( "DistanceMethod", "vector" );
+		Domain Ds(sweep_db,comm);
+		DoubleArray Distance(Dm.Nx,Dm.Ny,Dm.Nz), Sweep(Dm.Nx,Dm.Ny,Dm.Nz);
+		MPI_Barrier(comm);
+		double starttime = MPI_Wtime();
+		CalcDist(Distance,id,Dm);
+		double edt_time = MPI_Wtime() - starttime;
+		MPI_Barrier(comm);
+		starttime = MPI_Wtime();
+		CalcDist(Sweep,id,Ds);
+		double sweep_time = MPI_Wtime() - starttime;
+		double diff = 0.0, maxdiff = 0.0, count = 0.0;
+		for (int k=1; k<Dm.Nz-1; k++){
+			for (int j=1; j<Dm.Ny-1; j++){
+				for (int i=1; i<Dm.Nx-1; i++){
+					double d = fabs(Distance(i,j,k)-Sweep(i,j,k));
+					diff += d;
+					maxdiff = std::max(maxdiff,d);
+					count += 1.0;
+				}
+			}
+		}
+		diff = sumReduce(comm,diff)/sumReduce(comm,count);
+		maxdiff = maxReduce(comm,maxdiff);
+		edt_time = maxReduce(comm,edt_time);
+		sweep_time = maxReduce(comm,sweep_time);
+		if (rank == 0){
+			printf("%i^3 per rank: exact transform %0.3f s, vector sweep %0.3f s \n",size,edt_time,sweep_time);
+			printf("   difference from the sweep: mean %0.4f, max %0.4f \n",diff,maxdiff);
+		}
+		// the sweep is approximate, but only by a fraction of a cell on average
+		if (diff > 0.1) error++;
+		if (error == 0 && rank == 0) printf("Distance transform passed \n");
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return error;
+}
@@ -0,0 +1,130 @@
+//*************************************************************************
+// Compare the aggregated D3Q19 + D3Q7 halo exchange against the separate exchanges
+//*************************************************************************
+#include <stdio.h>
+#include <math.h>
+#include <iostream>
+#include <fstream>
+#include "common/ScaLBL.h"
+#include "common/MPI_Helpers.h"
+#include "models/ColorModel.h"
+
+using namespace std;
+
+inline void InitializeBubble(ScaLBL_ColorModel &ColorModel, double BubbleRadius){
+	int nprocx = ColorModel.Dm->nprocx();
+	int nprocy = ColorModel.Dm->nprocy();
+	int nprocz = ColorModel.Dm->nprocz();
+	int Nx = ColorModel.Dm->Nx;
+	int Ny = ColorModel.Dm->Ny;
+	int Nz = ColorModel.Dm->Nz;
+	for (int k=0;k<Nz;k++){
+		for (int j=0;j<Ny;j++){
+			for (int i=0;i<Nx;i++){
+				int n = k*Nx*Ny + j*Nx + i;
+				ColorModel.Averages->SDs(i,j,k) = 100.f;
+				double iglobal= double(i+(Nx-2)*ColorModel.Dm->iproc())-double((Nx-2)*nprocx)*0.5;
+				double jglobal= double(j+(Ny-2)*ColorModel.Dm->jproc())-double((Ny-2)*nprocy)*0.5;
+				double kglobal= double(k+(Nz-2)*ColorModel.Dm->kproc())-double((Nz-2)*nprocz)*0.5;
+				if ((iglobal*iglobal)+(jglobal*jglobal)+(kglobal*kglobal) < BubbleRadius*BubbleRadius)
+					ColorModel.Mask->id[n] = 2;
+				else
+					ColorModel.Mask->id[n] = 1;
+				ColorModel.id[n] = ColorModel.Mask->id[n];
+				ColorModel.Dm->id[n] = ColorModel.Mask->id[n];
+			}
+		}
+	}
+}
+
+inline double MaxDifference(const double *A, const double *B, int count){
+	double err = 0.0;
+	for (int n=0; n<count; n++){
+		double diff = fabs(A[n]-B[n]);
+		if (diff > err) err = diff;
+	}
+	return err;
+}
+
+int main(int argc, char **argv)
+{
+	int rank,nprocs;
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	MPI_Comm_rank(comm,&rank);
+	MPI_Comm_size(comm,&nprocs);
+	int check=0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running Color Model: TestColorAggregated	\n");
+			printf("********************************************************\n");
+			if ( argc < 2 ) {
+				std::cerr << "Invalid number of arguments, no input file specified\n";
+				return -1;
+			}
+		}
+		auto filename = argv[1];
+		int timesteps = 20;
+		double radius=15.5;
+
+		ScaLBL_ColorModel Reference(rank,nprocs,comm);
+		Reference.ReadParams(filename);
+		Reference.timestepMax = timesteps;
+		Reference.SetDomain();
+		InitializeBubble(Reference,radius);
+		Reference.Create();
+		Reference.Initialize();
+		Reference.Run();
+
+		// aggregated exchange with the unfused and fused kernels
+		for (int fused=0; fused<2; fused++){
+			ScaLBL_ColorModel Aggregated(rank,nprocs,comm);
+			Aggregated.ReadParams(filename);
+			Aggregated.timestepMax = timesteps;
+			Aggregated.AGGREGATED_EXCHANGE = true;
+			Aggregated.FUSED_KERNEL = (fused > 0);
+			Aggregated.SetDomain();
+			InitializeBubble(Aggregated,radius);
+			Aggregated.Create();
+			Aggregated.Initialize();
+			Aggregated.Run();
+
+			int Np = Reference.Np;
+			int N = Reference.N;
+			if (Aggregated.Np != Np){
+				printf("Mismatch in number of sites: %i vs. %i \n",Np,Aggregated.Np);
+				check = 1;
+				continue;
+			}
+			double *A = new double[19*Np];
+			double *B = new double[19*Np];
+			double *PhiA = new double[N];
+			double *PhiB = new double[N];
+			ScaLBL_CopyDistToHost(A, Reference.fq, 19*Np);
+			ScaLBL_CopyDistToHost(B, Aggregated.fq, 19*Np);
+			double dist_err = MaxDifference(A,B,19*Np);
+			ScaLBL_CopyDistToHost(A, Reference.Aq, 7*Np);
+			ScaLBL_CopyDistToHost(B, Aggregated.Aq, 7*Np);
+			double aq_err = MaxDifference(A,B,7*Np);
+			ScaLBL_CopyToHost(PhiA, Reference.Phi, N*sizeof(double));
+			ScaLBL_CopyToHost(PhiB, Aggregated.Phi, N*sizeof(double));
+			double phi_err = MaxDifference(PhiA,PhiB,N);
+			dist_err = maxReduce(comm,dist_err);
+			aq_err = maxReduce(comm,aq_err);
+			phi_err = maxReduce(comm,phi_err);
+			if (rank==0) printf("Max difference (%s kernel): fq=%e, Aq=%e, Phi=%e \n",fused ? "fused" : "unfused",dist_err,aq_err,phi_err);
+			if (dist_err > 1e-12 || aq_err > 1e-12 || phi_err > 1e-12){
+				if (rank==0) printf("FAILED: aggregated exchange does not match separate exchanges \n");
+				check = 1;
+			}
+			delete [] A;
+			delete [] B;
+			delete [] PhiA;
+			delete [] PhiB;
+		}
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return check;
+}
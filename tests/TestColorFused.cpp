@@ -0,0 +1,127 @@
+//*************************************************************************
+// Compare the fused phase field / collision kernel against the unfused path
+//*************************************************************************
+#include <stdio.h>
+#include <math.h>
+#include <iostream>
+#include <fstream>
+#include "common/ScaLBL.h"
+#include "common/MPI_Helpers.h"
+#include "models/ColorModel.h"
+
+using namespace std;
+
+inline void InitializeBubble(ScaLBL_ColorModel &ColorModel, double BubbleRadius){
+	int nprocx = ColorModel.Dm->nprocx();
+	int nprocy = ColorModel.Dm->nprocy();
+	int nprocz = ColorModel.Dm->nprocz();
+	int Nx = ColorModel.Dm->Nx;
+	int Ny = ColorModel.Dm->Ny;
+	int Nz = ColorModel.Dm->Nz;
+	for (int k=0;k<Nz;k++){
+		for (int j=0;j<Ny;j++){
+			for (int i=0;i<Nx;i++){
+				int n = k*Nx*Ny + j*Nx + i;
+				ColorModel.Averages->SDs(i,j,k) = 100.f;
+				double iglobal= double(i+(Nx-2)*ColorModel.Dm->iproc())-double((Nx-2)*nprocx)*0.5;
+				double jglobal= double(j+(Ny-2)*ColorModel.Dm->jproc())-double((Ny-2)*nprocy)*0.5;
+				double kglobal= double(k+(Nz-2)*ColorModel.Dm->kproc())-double((Nz-2)*nprocz)*0.5;
+				if ((iglobal*iglobal)+(jglobal*jglobal)+(kglobal*kglobal) < BubbleRadius*BubbleRadius)
+					ColorModel.Mask->id[n] = 2;
+				else
+					ColorModel.Mask->id[n] = 1;
+				ColorModel.id[n] = ColorModel.Mask->id[n];
+				ColorModel.Dm->id[n] = ColorModel.Mask->id[n];
+			}
+		}
+	}
+}
+
+inline double MaxDifference(const double *A, const double *B, int count){
+	double err = 0.0;
+	for (int n=0; n<count; n++){
+		double diff = fabs(A[n]-B[n]);
+		if (diff > err) err = diff;
+	}
+	return err;
+}
+
+int main(int argc, char **argv)
+{
+	int rank,nprocs;
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	MPI_Comm_rank(comm,&rank);
+	MPI_Comm_size(comm,&nprocs);
+	int check=0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running Color Model: TestColorFused	\n");
+			printf("********************************************************\n");
+			if ( argc < 2 ) {
+				std::cerr << "Invalid number of arguments, no input file specified\n";
+				return -1;
+			}
+		}
+		auto filename = argv[1];
+		int timesteps = 20;
+		double radius=15.5;
+
+		ScaLBL_ColorModel Unfused(rank,nprocs,comm);
+		Unfused.ReadParams(filename);
+		Unfused.timestepMax = timesteps;
+		Unfused.SetDomain();
+		InitializeBubble(Unfused,radius);
+		Unfused.Create();
+		Unfused.Initialize();
+		Unfused.Run();
+
+		ScaLBL_ColorModel Fused(rank,nprocs,comm);
+		Fused.ReadParams(filename);
+		Fused.timestepMax = timesteps;
+		Fused.FUSED_KERNEL = true;
+		Fused.SetDomain();
+		InitializeBubble(Fused,radius);
+		Fused.Create();
+		Fused.Initialize();
+		Fused.Run();
+
+		int Np = Unfused.Np;
+		int N = Unfused.N;
+		if (Fused.Np != Np){
+			printf("Mismatch in number of sites: %i vs. %i \n",Np,Fused.Np);
+			check = 1;
+		}
+		else {
+			double *A = new double[19*Np];
+			double *B = new double[19*Np];
+			double *PhiA = new double[N];
+			double *PhiB = new double[N];
+			ScaLBL_CopyDistToHost(A, Unfused.fq, 19*Np);
+			ScaLBL_CopyDistToHost(B, Fused.fq, 19*Np);
+			double dist_err = MaxDifference(A,B,19*Np);
+			ScaLBL_CopyToHost(A, Unfused.Den, 2*Np*sizeof(double));
+			ScaLBL_CopyToHost(B, Fused.Den, 2*Np*sizeof(double));
+			double den_err = MaxDifference(A,B,2*Np);
+			ScaLBL_CopyToHost(PhiA, Unfused.Phi, N*sizeof(double));
+			ScaLBL_CopyToHost(PhiB, Fused.Phi, N*sizeof(double));
+			double phi_err = MaxDifference(PhiA,PhiB,N);
+			dist_err = maxReduce(comm,dist_err);
+			den_err = maxReduce(comm,den_err);
+			phi_err = maxReduce(comm,phi_err);
+			if (rank==0) printf("Max difference: fq=%e, Den=%e, Phi=%e \n",dist_err,den_err,phi_err);
+			if (dist_err > 1e-12 || den_err > 1e-12 || phi_err > 1e-12){
+				if (rank==0) printf("FAILED: fused kernel does not match unfused kernel \n");
+				check = 1;
+			}
+			delete [] A;
+			delete [] B;
+			delete [] PhiA;
+			delete [] PhiB;
+		}
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return check;
+}
@@ -127,7 +127,7 @@ extern int GlobalCheckDebugDist(double *dist, IntArray Map, int Np, int Nx, int
 					z = kproc*Nz+k;
 					for (q=0; q<18; q++){
 
-						if (dist[(q+1)*Np+idx] != (z*X*Y+y*X+x) + (q+1)*0.01){
+						if (dist[(q+1)*Np+idx] != dist_t((z*X*Y+y*X+x) + (q+1)*0.01)){
 							printf("******************************************\n");
 							printf("error in distribution q = %i \n", (q+1));
 							printf("i,j,k= %i, %i, %i \n", x,y,z);
@@ -303,12 +303,12 @@ int main(int argc, char **argv)
 		MPI_Barrier(comm);
 		int neighborSize=18*Np*sizeof(int);
 		//......................device distributions.................................
-		dist_mem_size = Np*sizeof(double);
+		dist_mem_size = Np*sizeof(dist_t);
 		if (rank==0)	printf ("Allocating distributions \n");
 		
 		int *NeighborList;
 		int *dvcMap;
-		double *fq;
+		dist_t *fq;
 		//...........................................................................
 		ScaLBL_AllocateDeviceMemory((void **) &NeighborList, neighborSize);
 		ScaLBL_AllocateDeviceMemory((void **) &dvcMap, sizeof(int)*Np);
@@ -368,7 +368,7 @@ int main(int argc, char **argv)
 		if (rank==0)	printf("Setting the distributions, size = : %i\n", Np);
 		//...........................................................................
 		GlobalFlipScaLBL_D3Q19_Init(fq_host, Map, Np, Nx-2, Ny-2, Nz-2, iproc,jproc,kproc,nprocx,nprocy,nprocz);
-		ScaLBL_CopyToDevice(fq, fq_host, 19*dist_mem_size);
+		ScaLBL_CopyDistToDevice(fq, fq_host, 19*Np);
 		ScaLBL_DeviceBarrier();
 		MPI_Barrier(comm);
 		//*************************************************************************
@@ -383,7 +383,7 @@ int main(int argc, char **argv)
 		ScaLBL_Comm.RecvD3Q19AA(fq); //WRITE INTO OPPOSITE
 		
 		//...........................................................................
-		ScaLBL_CopyToHost(fq_host,fq,19*Np*sizeof(double));
+		ScaLBL_CopyDistToHost(fq_host,fq,19*Np);
 		check =	GlobalCheckDebugDist(fq_host, Map, Np, Nx-2, Ny-2, Nz-2,iproc,jproc,kproc,nprocx,nprocy,nprocz,0,ScaLBL_Comm.next);
 		//...........................................................................
 
@@ -0,0 +1,105 @@
+//*************************************************************************
+// Check the interface cubes of the two phase averages (TwoPhase::SetupCubes)
+//   - every cube with a point on the wn, ns or ws interface or the common
+//     curve is in the cube list, and each cube is listed once
+//   TestCubeList [n] times ComputeLocal on an n^3 domain
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include "analysis/TwoPhase.h"
+#include "common/MPI_Helpers.h"
+#include "TestSiteLayout.h"
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = MPI_WORLD_RANK();
+	int error = 0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running unit test: TestCubeList	\n");
+			printf("********************************************************\n");
+		}
+		int n = (argc > 1) ? atoi(argv[1]) : 40;
+		auto db = TestDomainDatabase({ 1, 1, 1 },{ n, n, n });
+		std::shared_ptr<Domain> Dm( new Domain( db, MPI_COMM_SELF ) );
+		int Nx = Dm->Nx, Ny = Dm->Ny, Nz = Dm->Nz;
+		for (int i=0; i<Nx*Ny*Nz; i++) Dm->id[i] = 1;
+		Dm->CommInit();
+
+		// a drop in a tube (moving along z)
+		TwoPhase Averages( Dm );
+		double C = 0.5*n, R = 0.3*n, Rd = 0.2*n;
+		for (int k=0; k<Nz; k++){
+			for (int j=0; j<Ny; j++){
+				for (int i=0; i<Nx; i++){
+					double r = sqrt((i-C)*(i-C)+(j-C)*(j-C));
+					double d = sqrt(r*r+(k-C)*(k-C)) - Rd - 0.1*n;
+					Averages.SDs(i,j,k) = R - r;
+					Averages.SDn(i,j,k) = d;
+					Averages.Phase(i,j,k) = d;
+					Averages.Phase_tminus(i,j,k) = sqrt(r*r+(k-C+1)*(k-C+1)) - Rd - 0.1*n;
+					Averages.Phase_tplus(i,j,k) = sqrt(r*r+(k-C-1)*(k-C-1)) - Rd - 0.1*n;
+				}
+			}
+		}
+		Averages.UpdateSolid();
+		Averages.Initialize();
+		Averages.UpdateMeshValues();
+		double t0 = MPI_Wtime();
+		Averages.ComputeLocal();
+		double t1 = MPI_Wtime();
+
+		// mark the listed cubes
+		int nc = Averages.NumberCubes();
+		Array<char> listed(Nx,Ny,Nz);
+		listed.fill(0);
+		int bad = 0;
+		for (int c=0; c<nc; c++){
+			char &x = listed(Averages.cubeList(0,c),Averages.cubeList(1,c),Averages.cubeList(2,c));
+			bad += x ? 1:0;
+			x = 1;
+		}
+		// construct the interfaces of every cube
+		DTMutableList<Point> nw_pts(20), ns_pts(20), ws_pts(20), nws_pts(20), local_sol_pts(20), local_nws_pts(20);
+		IntArray nw_tris(3,20), ns_tris(3,20), ws_tris(3,20), nws_seg(2,20), local_sol_tris(3,18);
+		DoubleArray Values(20);
+		int n_local_sol_tris, n_local_sol_pts, n_nw_pts, n_nw_tris, n_ws_pts, n_ws_tris;
+		int n_ns_tris, n_ns_pts, n_local_nws_pts, n_nws_pts, n_nws_seg;
+		int N_interface = 0;
+		for (int k=1; k<Nz-1; k++){
+			for (int j=1; j<Ny-1; j++){
+				for (int i=1; i<Nx-1; i++){
+					pmmc_ConstructLocalCube(Averages.SDs, Averages.SDn, 0.0, 0.0,
+						nw_pts, nw_tris, Values, ns_pts, ns_tris, ws_pts, ws_tris,
+						local_nws_pts, nws_pts, nws_seg, local_sol_pts, local_sol_tris,
+						n_local_sol_tris, n_local_sol_pts, n_nw_pts, n_nw_tris,
+						n_ws_pts, n_ws_tris, n_ns_tris, n_ns_pts, n_local_nws_pts, n_nws_pts, n_nws_seg,
+						i, j, k, Nx, Ny, Nz);
+					int count = n_nw_pts + n_local_nws_pts + n_local_sol_pts + n_local_sol_tris;
+					double v = 0.0;
+					int n_pts = 0, n_tris = 0;
+					geomavg_MarchingCubes(Averages.SDn,v,i,j,k,nw_pts,n_pts,nw_tris,n_tris);
+					count += n_pts;
+					if ( count > 0 ) {
+						N_interface++;
+						bad += listed(i,j,k) ? 0:1;
+					}
+				}
+			}
+		}
+		if (rank == 0) printf("%i of %i cubes listed, %i with interfaces: %i errors, ComputeLocal %0.3f s \n",
+			nc,(Nx-2)*(Ny-2)*(Nz-2),N_interface,bad,t1-t0);
+		if ( bad > 0 || N_interface == 0 || nc < N_interface )
+			error++;
+		error = sumReduce( comm, error );
+		if (error == 0 && rank == 0) printf("Interface cube list passed \n");
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return error;
+}
@@ -0,0 +1,199 @@
+//*************************************************************************
+// Check the porosity weighted domain decomposition
+//   - the slabs reduce the load imbalance of a heterogeneous image
+//   - each rank recieves its part of the image
+//   - halo communication is correct with sub-domains of different size
+//   - the collective (mpiio) and rank 0 (serial) readers give the same sub-domains
+//   - AggregateLabels reassembles the image from sub-domains of different size
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include "common/Domain.h"
+#include "common/MPI_Helpers.h"
+#include "TestSiteLayout.h"
+
+// porosity increases along x and z
+static inline char ImageValue( int x, int y, int z, int Lx, int Lz )
+{
+	double porosity = 0.05 + 0.9*(double(x)/Lx)*(double(z)/Lz);
+	return ((x*7 + y*13 + z*3)%100 < 100*porosity) ? 1 : 0;
+}
+
+// Number of sites (including the halo) where the serial reader gives a different id
+static int CompareReaders( std::shared_ptr<Database> db, MPI_Comm comm )
+{
+	db->putScalar<std::string>( "ReadMethod", "mpiio" );
+	Domain Dm(db,comm);
+	Dm.Decomp("balance.raw");
+	db->putScalar<std::string>( "ReadMethod", "serial" );
+	Domain Ds(db,comm);
+	Ds.Decomp("balance.raw");
+	int N = Dm.Nx*Dm.Ny*Dm.Nz;
+	int bad = 0;
+	if (Ds.Nx*Ds.Ny*Ds.Nz != N) bad++;
+	else for (int n=0; n<N; n++) if (Dm.id[n] != Ds.id[n]) bad++;
+	return sumReduce(comm,bad);
+}
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = MPI_WORLD_RANK();
+	int nprocs = MPI_WORLD_SIZE();
+	int error = 0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running unit test: TestDomainBalance	\n");
+			printf("********************************************************\n");
+		}
+		auto nproc = TestProcessGrid(nprocs,"TestDomainBalance");
+		int n = 16;
+		int Lx = n*nproc[0];
+		int Ly = n*nproc[1];
+		int Lz = n*nproc[2];
+		if (rank == 0){
+			char *image = new char[Lx*Ly*Lz];
+			for (int k=0; k<Lz; k++)
+				for (int j=0; j<Ly; j++)
+					for (int i=0; i<Lx; i++)
+						image[k*Lx*Ly+j*Lx+i] = ImageValue(i,j,k,Lx,Lz);
+			FILE *OUT = fopen("balance.raw","wb");
+			fwrite(image,1,Lx*Ly*Lz,OUT);
+			fclose(OUT);
+			delete [] image;
+		}
+		MPI_Barrier(comm);
+
+		auto db = TestDomainDatabase(nproc,{ n, n, n });
+		db->putVector<int>( "N", { Lx, Ly, Lz } );
+		db->putScalar<std::string>( "Filename", "balance.raw" );
+		db->putScalar<std::string>( "ReadType", "8bit" );
+		db->putVector<int>( "ReadValues", { 0, 1 } );
+		db->putVector<int>( "WriteValues", { 0, 1 } );
+		db->putScalar<std::string>( "Decomposition", "weighted" );
+		Domain Dm(db,comm);
+		Dm.Decomp("balance.raw");
+		int Nx = Dm.Nx;
+		int Ny = Dm.Ny;
+		int Nz = Dm.Nz;
+		int ox = Dm.slab_x[Dm.iproc()];
+		int oy = Dm.slab_y[Dm.jproc()];
+		int oz = Dm.slab_z[Dm.kproc()];
+
+		// local part of the image and the pore count
+		double count = 0.0;
+		for (int k=1; k<Nz-1; k++){
+			for (int j=1; j<Ny-1; j++){
+				for (int i=1; i<Nx-1; i++){
+					char value = ImageValue(ox+i-1,oy+j-1,oz+k-1,Lx,Lz);
+					if (Dm.id[k*Nx*Ny+j*Nx+i] != value) error = 1;
+					if (value > 0) count += 1.0;
+				}
+			}
+		}
+		error = sumReduce(comm,error);
+		if (error > 0 && rank == 0) printf("FAILED: sub-domain does not match the image \n");
+
+		// uniform blocks for comparison
+		double uniform_count = 0.0;
+		for (int k=Dm.kproc()*n; k<(Dm.kproc()+1)*n; k++)
+			for (int j=Dm.jproc()*n; j<(Dm.jproc()+1)*n; j++)
+				for (int i=Dm.iproc()*n; i<(Dm.iproc()+1)*n; i++)
+					if (ImageValue(i,j,k,Lx,Lz) > 0) uniform_count += 1.0;
+		double weighted = maxReduce(comm,count)/(sumReduce(comm,count)/nprocs);
+		double uniform = maxReduce(comm,uniform_count)/(sumReduce(comm,uniform_count)/nprocs);
+		if (rank == 0) printf("Load imbalance: uniform %f, weighted %f \n",uniform,weighted);
+		if (nprocs > 1 && !(weighted < uniform)){
+			if (rank == 0) printf("FAILED: weighted decomposition does not reduce the load imbalance \n");
+			error++;
+		}
+
+		// halo exchange of the (periodic) global index of each pore site
+		Dm.CommInit();
+		DoubleArray Mesh(Nx,Ny,Nz);
+		Mesh.fill(-1.0);
+		for (int k=1; k<Nz-1; k++)
+			for (int j=1; j<Ny-1; j++)
+				for (int i=1; i<Nx-1; i++)
+					if (Dm.id[k*Nx*Ny+j*Nx+i] > 0)
+						Mesh(i,j,k) = double((oz+k-1)*Lx*Ly + (oy+j-1)*Lx + ox+i-1);
+		Dm.CommunicateMeshHalo(Mesh);
+		int halo = 0, bad = 0;
+		for (int k=0; k<Nz; k++){
+			for (int j=0; j<Ny; j++){
+				for (int i=0; i<Nx; i++){
+					if (i>0 && j>0 && k>0 && i<Nx-1 && j<Ny-1 && k<Nz-1) continue;
+					if (Mesh(i,j,k) < 0.0) continue;
+					int x = (ox+i-1+Lx)%Lx;
+					int y = (oy+j-1+Ly)%Ly;
+					int z = (oz+k-1+Lz)%Lz;
+					if (Mesh(i,j,k) != double(z*Lx*Ly + y*Lx + x)) bad++;
+					halo++;
+				}
+			}
+		}
+		int expected = Dm.recvCount_x + Dm.recvCount_X + Dm.recvCount_y + Dm.recvCount_Y + Dm.recvCount_z + Dm.recvCount_Z
+				+ Dm.recvCount_xy + Dm.recvCount_xY + Dm.recvCount_Xy + Dm.recvCount_XY
+				+ Dm.recvCount_xz + Dm.recvCount_xZ + Dm.recvCount_Xz + Dm.recvCount_XZ
+				+ Dm.recvCount_yz + Dm.recvCount_yZ + Dm.recvCount_Yz + Dm.recvCount_YZ;
+		if (halo != expected) bad++;
+		bad = sumReduce(comm,bad);
+		if (bad > 0){
+			if (rank == 0) printf("FAILED: halo values do not match the neighboring sub-domains \n");
+			error++;
+		}
+
+		// the aggregated labels are the image
+		char aggregate_file[] = "balance_aggregate.raw";
+		Dm.AggregateLabels(aggregate_file);
+		if (rank == 0){
+			std::vector<char> image(Lx*Ly*Lz,-1);
+			FILE *IN = fopen(aggregate_file,"rb");
+			size_t size = fread(image.data(),1,image.size(),IN);
+			fclose(IN);
+			bad = (size != image.size()) ? 1 : 0;
+			for (int k=0; k<Lz; k++)
+				for (int j=0; j<Ly; j++)
+					for (int i=0; i<Lx; i++)
+						if (image[k*Lx*Ly+j*Lx+i] != ImageValue(i,j,k,Lx,Lz)) bad++;
+			if (bad > 0){
+				printf("FAILED: aggregated labels do not match the image (%i sites) \n",bad);
+				error++;
+			}
+		}
+		if (Dm.UniformBlocks() && nprocs > 1){
+			if (rank == 0) printf("FAILED: weighted slabs reported as uniform blocks \n");
+			error++;
+		}
+
+		// parallel and serial readers: weighted slabs, then offset / clamped uniform blocks with checkerboard layers
+		bad = CompareReaders(db,comm);
+		db = TestDomainDatabase(nproc,{ n-4, n-4, n-4 });
+		db->putVector<int>( "N", { Lx, Ly, Lz } );
+		db->putScalar<std::string>( "ReadType", "8bit" );
+		db->putVector<int>( "ReadValues", { 0, 1, 1 } );
+		db->putVector<int>( "WriteValues", { 0, 2, 3 } );
+		db->putScalar<int>( "checkerSize", 3 );
+		db->putVector<int>( "offset", { 2, 1, 3 } );
+		db->putVector<int>( "InletLayers", { 1, 2, 2 } );
+		db->putVector<int>( "OutletLayers", { 2, 1, 1 } );
+		bad += CompareReaders(db,comm);
+		db->putVector<int>( "offset", { 0, 0, 0 } );
+		db->putVector<int>( "InletLayers", { 0, 0, 3 } );
+		db->putVector<int>( "OutletLayers", { 0, 0, 0 } );
+		db->putVector<int>( "n", { n+3, n+2, n+3 } );
+		bad += CompareReaders(db,comm);
+		if (bad > 0){
+			if (rank == 0) printf("FAILED: mpiio and serial readers give different sub-domains (%i sites) \n",bad);
+			error++;
+		}
+		if (error == 0 && rank == 0) printf("Weighted decomposition passed \n");
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return error;
+}
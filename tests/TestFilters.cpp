@@ -0,0 +1,168 @@
+//*************************************************************************
+// Check the median and non-local means filters (Med3D, NLM3D)
+//   - Med3D matches a sort of each 3x3x3 window exactly, for 8-bit,
+//     16-bit and non-integer images
+//   - NLM3D matches a direct sum over each window to round-off
+//   TestFilters [n] times both filters on an n^3 image
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include "analysis/filters.h"
+#include "common/MPI_Helpers.h"
+
+// median of each 3x3x3 window (partial selection sort)
+static void Med3DSort( const Array<float> &Input, Array<float> &Output )
+{
+	int Nx = Input.size(0), Ny = Input.size(1), Nz = Input.size(2);
+	float List[27];
+	for (int k=1; k<Nz-1; k++){
+		for (int j=1; j<Ny-1; j++){
+			for (int i=1; i<Nx-1; i++){
+				int Number=0;
+				for (int kk=k-1; kk<k+2; kk++)
+					for (int jj=j-1; jj<j+2; jj++)
+						for (int ii=i-1; ii<i+2; ii++)
+							List[Number++] = Input(ii,jj,kk);
+				for (int ii=0; ii<14; ii++){
+					for (int jj=ii+1; jj<27; jj++){
+						if (List[jj] < List[ii])
+							std::swap(List[ii],List[jj]);
+					}
+				}
+				Output(i,j,k) = List[13];
+			}
+		}
+	}
+}
+
+// local means and non-local means by direct sums over each window
+static int NLM3DSum( const Array<float> &Input, Array<float> &Mean,
+	const Array<float> &Distance, Array<float> &Output, const int d, const float h )
+{
+	int Nx = Input.size(0), Ny = Input.size(1), Nz = Input.size(2);
+	int count = 0;
+	for (int k=1; k<Nz-1; k++){
+		for (int j=1; j<Ny-1; j++){
+			for (int i=1; i<Nx-1; i++){
+				float sum = 0, weight = 0;
+				for (int kk=std::max(0,k-d); kk<std::min(Nz-1,k+d); kk++)
+					for (int jj=std::max(0,j-d); jj<std::min(Ny-1,j+d); jj++)
+						for (int ii=std::max(0,i-d); ii<std::min(Nx-1,i+d); ii++){
+							sum += Input(ii,jj,kk);
+							weight++;
+						}
+				Mean(i,j,k) = sum / weight;
+			}
+		}
+	}
+	for (int k=1; k<Nz-1; k++){
+		for (int j=1; j<Ny-1; j++){
+			for (int i=1; i<Nx-1; i++){
+				if (fabs(Distance(i,j,k)) < float(d)){
+					float sum = 0, weight = 0;
+					for (int kk=std::max(0,k-d); kk<std::min(Nz-1,k+d); kk++)
+						for (int jj=std::max(0,j-d); jj<std::min(Ny-1,j+d); jj++)
+							for (int ii=std::max(0,i-d); ii<std::min(Nx-1,i+d); ii++){
+								float tmp = Mean(i,j,k) - Mean(ii,jj,kk);
+								sum += exp(-tmp*tmp*h)*Input(ii,jj,kk);
+								weight += exp(-tmp*tmp*h);
+							}
+					count++;
+					Output(i,j,k) = sum / weight;
+				} else {
+					Output(i,j,k) = Mean(i,j,k);
+				}
+			}
+		}
+	}
+	return count;
+}
+
+// noisy two phase image (a sphere pack) with values in [a,b]
+static Array<float> createImage( int Nx, int Ny, int Nz, float a, float b, bool round )
+{
+	Array<float> A(Nx,Ny,Nz);
+	for (int k=0; k<Nz; k++){
+		for (int j=0; j<Ny; j++){
+			for (int i=0; i<Nx; i++){
+				double r = sin(0.35*i)*sin(0.3*j)*sin(0.25*k);
+				double noise = 0.05*sin(12.9898*i+78.233*j+37.719*k);
+				double v = (r > 0.1 ? 0.7:0.3) + noise;
+				v = a + (b-a)*std::min(1.0,std::max(0.0,v));
+				A(i,j,k) = round ? floor(v):v;
+			}
+		}
+	}
+	return A;
+}
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	int rank = MPI_WORLD_RANK();
+	int error = 0;
+	if (rank == 0){
+		printf("********************************************************\n");
+		printf("Running unit test: TestFilters	\n");
+		printf("********************************************************\n");
+	}
+	int n = (argc > 1) ? atoi(argv[1]) : 0;
+	int Nx = 41, Ny = 30, Nz = 23;
+	if (n > 0) Nx = Ny = Nz = n;
+
+	// median filter
+	const float range[3][2] = { { 0, 255 }, { 1000, 60000 }, { -1.5, 2.5 } };
+	for (int t=0; t<3; t++){
+		Array<float> A = createImage( Nx, Ny, Nz, range[t][0], range[t][1], t<2 );
+		Array<float> B(Nx,Ny,Nz), B0(Nx,Ny,Nz);
+		B.fill(0);
+		B0.fill(0);
+		double t0 = MPI_Wtime();
+		Med3D( A, B );
+		double t1 = MPI_Wtime();
+		Med3DSort( A, B0 );
+		double t2 = MPI_Wtime();
+		int bad = 0;
+		for (size_t i=0; i<A.length(); i++)
+			bad += B(i)!=B0(i) ? 1:0;
+		if (rank == 0) printf("Med3D (%s): %i errors, %0.3f s (sort %0.3f s) \n",
+			t==0 ? "8-bit":(t==1 ? "16-bit":"float"),bad,t1-t0,t2-t1);
+		if (bad > 0) error++;
+	}
+
+	// non-local means near the interface of the image
+	{
+		int d = 3;
+		float h = 10.0;
+		Array<float> A = createImage( Nx, Ny, Nz, 0, 1, false );
+		Array<float> Dist(Nx,Ny,Nz);
+		for (int k=0; k<Nz; k++)
+			for (int j=0; j<Ny; j++)
+				for (int i=0; i<Nx; i++)
+					Dist(i,j,k) = 20*sin(0.35*i)*sin(0.3*j)*sin(0.25*k) - 2;
+		Array<float> Mean(Nx,Ny,Nz), Mean0(Nx,Ny,Nz), B(Nx,Ny,Nz), B0(Nx,Ny,Nz);
+		Mean.fill(0.5);
+		Mean0.fill(0.5);
+		B.fill(0);
+		B0.fill(0);
+		double t0 = MPI_Wtime();
+		int count = NLM3D( A, Mean, Dist, B, d, h );
+		double t1 = MPI_Wtime();
+		int count0 = NLM3DSum( A, Mean0, Dist, B0, d, h );
+		double t2 = MPI_Wtime();
+		double err_mean = 0, err = 0;
+		for (size_t i=0; i<A.length(); i++){
+			err_mean = std::max<double>(err_mean,fabs(Mean(i)-Mean0(i)));
+			err = std::max<double>(err,fabs(B(i)-B0(i)));
+		}
+		if (rank == 0) printf("NLM3D: %i of %i sites, max error %0.2e (mean %0.2e), %0.3f s (direct %0.3f s) \n",
+			count,(Nx-2)*(Ny-2)*(Nz-2),err,err_mean,t1-t0,t2-t1);
+		if (count != count0 || err > 1e-5 || err_mean > 1e-5) error++;
+	}
+	if (error == 0 && rank == 0) printf("Filters passed \n");
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Finalize();
+	return error;
+}
@@ -25,6 +25,8 @@ int main (int argc, char **argv)
 	// set the error code
 	// Note: the error code should be consistent across all processors
 	int error = 0;
+	// flux is recovered to round-off of the distribution storage type
+	const double tol = (sizeof(dist_t) == sizeof(double)) ? 1e-12 : 1e-5;
 
 	if (nprocs != 1){
 		printf("FAIL: Unit test TestFluxBC requires 1 MPI process! \n");
@@ -100,12 +102,12 @@ int main (int argc, char **argv)
 		MPI_Barrier(comm);
 
 		//......................device distributions.................................
-		int dist_mem_size = Np*sizeof(double);
+		int dist_mem_size = Np*sizeof(dist_t);
 		if (rank==0)	printf ("Allocating distributions \n");
 
 		int *NeighborList;
 		int *dvcMap;
-		double *fq;
+		dist_t *fq;
 		
 		//...........................................................................
 		ScaLBL_AllocateDeviceMemory((void **) &NeighborList, neighborSize);
@@ -177,9 +179,9 @@ int main (int argc, char **argv)
     	// respect backwards read / write!!!
 		printf("Inlet Flux: input=%f, output=%f \n",flux,Q);
 		err = fabs(flux + Q);
-		if (err > 1e-12){
+		if (err > tol){
 			error = 1;
-			printf("  Inlet error %f \n",err);
+			printf("  Inlet error %e \n",err);
 		}		
 		
 		// Consider a larger number of timesteps and simulate flow
@@ -267,9 +269,9 @@ int main (int argc, char **argv)
 
 		printf("Inlet Flux: input=%f, output=%f \n",flux,Q);
 		err = fabs(flux - Q);
-		if (err > 1e-12){
+		if (err > tol){
 			error = 1;
-			printf("  Inlet error %f \n",err);
+			printf("  Inlet error %e \n",err);
 		}
 		
 
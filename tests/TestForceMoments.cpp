@@ -191,11 +191,11 @@ int main(int argc, char **argv)
 		MPI_Barrier(comm);
 
 		//......................device distributions.................................
-		int dist_mem_size = Np*sizeof(double);
+		int dist_mem_size = Np*sizeof(dist_t);
 
 		int *NeighborList;
 		//		double *f_even,*f_odd;
-		double * dist;
+		dist_t * dist;
 		double * Velocity;
 		//...........................................................................
 		ScaLBL_AllocateDeviceMemory((void **) &dist, 19*dist_mem_size);
@@ -260,10 +260,9 @@ int main(int argc, char **argv)
 		if (rank==0) printf("Lattice update rate (process)= %f MLUPS \n", MLUPS);
 		if (rank==0) printf("********************************************************\n");
 		
-		int SIZE=Np*sizeof(double);
 		double *DIST;
 		DIST= new double [19*Np];
-		ScaLBL_CopyToHost(&DIST[0],&dist[0],19*SIZE);
+		ScaLBL_CopyDistToHost(DIST,dist,19*Np);
 		
 		i=Nx/2;
 		printf("x = constant \n");
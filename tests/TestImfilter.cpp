@@ -0,0 +1,143 @@
+//*************************************************************************
+// Check the separable filters (imfilter::imfilter_separable)
+//   - the tiled filters match a filter of each line (bitwise) for all BCs
+//   - the filter functions match the filter arrays
+//   TestImfilter [n] times the gaussian filter used by the uCT
+//   pre-processing on an n^3 image
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include "analysis/imfilter.h"
+#include "common/MPI_Helpers.h"
+
+// filter each line of A in direction d (one line at a time)
+template<class TYPE>
+static void filterLines( Array<TYPE>& A, int d, const Array<TYPE>& H, imfilter::BC BC, TYPE X )
+{
+	int N = A.size(d);
+	int Nh = (H.length()-1)/2;
+	size_t Ns = 1, Ne = 1;
+	for (int d2=0; d2<d; d2++)
+		Ns *= A.size(d2);
+	for (int d2=d+1; d2<A.ndim(); d2++)
+		Ne *= A.size(d2);
+	std::vector<TYPE> tmp(N+2*Nh);
+	for (size_t j=0; j<Ne; j++) {
+		for (size_t i=0; i<Ns; i++) {
+			TYPE *A2 = &A(i+j*Ns*N);
+			for (int k=-Nh; k<N+Nh; k++) {
+				int k2 = k;
+				if ( k<0 || k>=N ) {
+					if ( BC == imfilter::BC::symmetric )
+						k2 = ( 2 * N - k ) % N;
+					else if ( BC == imfilter::BC::replicate )
+						k2 = k < 0 ? 0 : N - 1;
+					else if ( BC == imfilter::BC::circular )
+						k2 = ( k + N ) % N;
+					else
+						k2 = -1;
+				}
+				tmp[k+Nh] = k2==-1 ? X : A2[k2*Ns];
+			}
+			for (int k=0; k<N; k++) {
+				TYPE sum = 0;
+				for (int m=0; m<=2*Nh; m++)
+					sum += H(m) * tmp[k+m];
+				A2[k*Ns] = sum;
+			}
+		}
+	}
+}
+
+template<class TYPE>
+static int testFilter( const std::vector<size_t>& N, const std::vector<int>& Nh, imfilter::BC bc )
+{
+	Array<TYPE> A(N);
+	for (size_t i=0; i<A.length(); i++)
+		A(i) = sin(0.37*i) + 0.1*cos(1.3*i);
+	std::vector<Array<TYPE>> H(N.size());
+	std::vector<imfilter::BC> BC(N.size(),bc);
+	for (size_t d=0; d<N.size(); d++) {
+		TYPE sigma = 0.7 + 0.3*d;
+		H[d] = imfilter::create_filter<TYPE>( { Nh[d] }, "gaussian", &sigma );
+	}
+	const TYPE X = 0.25;
+	auto B = imfilter::imfilter_separable( A, H, BC, X );
+	auto B0 = A;
+	for (size_t d=0; d<N.size(); d++)
+		filterLines( B0, d, H[d], bc, X );
+	// the same filters as functions
+	std::vector<std::function<TYPE(int,const TYPE*)>> H1(N.size());
+	std::vector<std::function<TYPE(const Array<TYPE>&)>> H2(N.size());
+	for (size_t d=0; d<N.size(); d++) {
+		Array<TYPE> h = H[d];
+		H1[d] = [h]( int N2, const TYPE* data ) {
+			TYPE sum = 0;
+			for (int m=0; m<N2; m++)
+				sum += h(m) * data[m];
+			return sum;
+		};
+		H2[d] = [h]( const Array<TYPE>& data ) {
+			TYPE sum = 0;
+			for (size_t m=0; m<data.length(); m++)
+				sum += h(m) * data(m);
+			return sum;
+		};
+	}
+	auto B1 = imfilter::imfilter_separable( A, Nh, H1, BC, X );
+	auto B2 = imfilter::imfilter_separable( A, Nh, H2, BC, X );
+	int bad = 0;
+	for (size_t i=0; i<A.length(); i++) {
+		if ( B(i) != B0(i) || B1(i) != B0(i) || B2(i) != B0(i) )
+			bad++;
+	}
+	return bad;
+}
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	int rank = MPI_WORLD_RANK();
+	int error = 0;
+	if (rank == 0){
+		printf("********************************************************\n");
+		printf("Running unit test: TestImfilter	\n");
+		printf("********************************************************\n");
+	}
+	if (argc > 1) {
+		// time the gaussian filter of the uCT pre-processing
+		int n = atoi(argv[1]);
+		Array<float> A(n,n,n);
+		for (size_t i=0; i<A.length(); i++)
+			A(i) = sin(0.37*i);
+		float sigma = 1.0;
+		std::vector<Array<float>> H(3,imfilter::create_filter<float>( { 2 }, "gaussian", &sigma ));
+		std::vector<imfilter::BC> BC(3,imfilter::BC::replicate);
+		double t0 = MPI_Wtime();
+		auto B = imfilter::imfilter_separable( A, H, BC );
+		double t1 = MPI_Wtime();
+		auto B0 = A;
+		for (int d=0; d<3; d++)
+			filterLines( B0, d, H[d], BC[d], 0.0f );
+		double t2 = MPI_Wtime();
+		if (rank == 0) printf("%i^3: imfilter_separable %0.3f s, line by line %0.3f s \n",n,t1-t0,t2-t1);
+	}
+	const imfilter::BC BCs[4] = { imfilter::BC::fixed, imfilter::BC::symmetric,
+		imfilter::BC::replicate, imfilter::BC::circular };
+	for (int b=0; b<4; b++) {
+		int bad = 0;
+		bad += testFilter<double>( { 37, 29, 23 }, { 1, 2, 3 }, BCs[b] );
+		bad += testFilter<float>( { 37, 29, 23 }, { 4, 0, 2 }, BCs[b] );
+		bad += testFilter<float>( { 130, 65, 3 }, { 2, 2, 2 }, BCs[b] );
+		bad += testFilter<double>( { 70, 5 }, { 3, 1 }, BCs[b] );
+		bad += testFilter<float>( { 50 }, { 5 }, BCs[b] );
+		if (rank == 0) printf("BC %i: %i errors \n",b,bad);
+		if (bad > 0) error++;
+	}
+	if (error == 0 && rank == 0) printf("Separable filters passed \n");
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Finalize();
+	return error;
+}
@@ -156,7 +156,7 @@ int main(int argc, char **argv)
 	int count_negative_A = 0;
 	int count_negative_B = 0;
 	ScaLBL_CopyToHost(DenFinal,CM.Den,2*Np*sizeof(double));
-	ScaLBL_CopyToHost(A_q,CM.Aq,7*Np*sizeof(double));
+	ScaLBL_CopyDistToHost(A_q,CM.Aq,7*Np);
 	for (i=0; i<N; i++) Error[i]=0.0;
 	for (k=1;k<Nz-1;k++){
 		for (j=1;j<Ny-1;j++){
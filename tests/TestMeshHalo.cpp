@@ -0,0 +1,139 @@
+//*************************************************************************
+// Check the halo exchange of several arrays at once
+//   - Domain::CommunicateMeshHalo of a list of arrays matches one
+//     exchange per array (bitwise) and fills the periodic halo (faces
+//     and edges, the domain does not communicate the corners)
+//   - fillHalo::fill of a list of arrays matches one fill per array
+//   TestMeshHalo [n] times the exchange of the eight TwoPhase distance
+//   arrays on an n^3 domain per rank
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include "common/Domain.h"
+#include "common/Communication.h"
+#include "common/MPI_Helpers.h"
+#include "TestSiteLayout.h"
+
+// value of array m at the global cell (periodic)
+static inline double MeshValue( int m, int x, int y, int z, const int L[3] )
+{
+	x = (x+L[0])%L[0];  y = (y+L[1])%L[1];  z = (z+L[2])%L[2];
+	return m + sin(0.3*x+0.1*m)*cos(0.2*y) + 0.01*z;
+}
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = MPI_WORLD_RANK();
+	int nprocs = MPI_WORLD_SIZE();
+	int error = 0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running unit test: TestMeshHalo	\n");
+			printf("********************************************************\n");
+		}
+		auto nproc = TestProcessGrid(nprocs,"TestMeshHalo","xyz");
+		int n = (argc > 1) ? atoi(argv[1]) : 12;
+		int L[3] = { n*nproc[0], n*nproc[1], n*nproc[2] };
+		auto db = TestDomainDatabase(nproc,{ n, n, n });
+		Domain Dm( db, comm );
+		int Nx = Dm.Nx, Ny = Dm.Ny, Nz = Dm.Nz;
+		for (int i=0; i<Nx*Ny*Nz; i++) Dm.id[i] = 1;
+		Dm.CommInit();
+		int ox = Dm.iproc()*n, oy = Dm.jproc()*n, oz = Dm.kproc()*n;
+
+		// the arrays (interior set, halo zero)
+		const int N = 8;
+		std::vector<DoubleArray> A(N), A0(N), B(N);
+		for (int m=0; m<N; m++){
+			A[m].resize(Nx,Ny,Nz);
+			A[m].fill(0);
+			for (int k=1; k<Nz-1; k++)
+				for (int j=1; j<Ny-1; j++)
+					for (int i=1; i<Nx-1; i++)
+						A[m](i,j,k) = MeshValue(m,ox+i-1,oy+j-1,oz+k-1,L);
+			A0[m] = A[m];
+			B[m] = A[m];
+		}
+		std::vector<DoubleArray*> list(N);
+		for (int m=0; m<N; m++) list[m] = &A[m];
+		Dm.CommunicateMeshHalo( list );
+		for (int m=0; m<N; m++)
+			Dm.CommunicateMeshHalo( B[m] );
+		auto corner = [Nx,Ny,Nz]( int i, int j, int k ) {
+			return (i==0||i==Nx-1) && (j==0||j==Ny-1) && (k==0||k==Nz-1);
+		};
+		int bad = 0;
+		for (int m=0; m<N; m++){
+			for (int k=0; k<Nz; k++){
+				for (int j=0; j<Ny; j++){
+					for (int i=0; i<Nx; i++){
+						bad += A[m](i,j,k)!=B[m](i,j,k) ? 1:0;
+						if ( !corner(i,j,k) )
+							bad += A[m](i,j,k)!=MeshValue(m,ox+i-1,oy+j-1,oz+k-1,L) ? 1:0;
+					}
+				}
+			}
+		}
+		bad = sumReduce( comm, bad );
+		if (rank == 0) printf("CommunicateMeshHalo: %i errors \n",bad);
+		if (bad > 0) error++;
+
+		// fillHalo with a list of arrays (a 4D array counts by its depth)
+		{
+			fillHalo<double> fillData( Dm.Comm, Dm.rank_info, {n,n,n}, {1,1,1}, 0, N+2 );
+			std::vector<DoubleArray> C(N+1), D(N+1);
+			for (int m=0; m<N; m++)
+				C[m] = A0[m];
+			C[N].resize(ArraySize(Nx,Ny,Nz,2));
+			for (size_t i=0; i<C[N].length(); i++) C[N](i) = sin(0.7*i+rank);
+			std::vector<DoubleArray*> list2(N+1);
+			for (int m=0; m<=N; m++){
+				D[m] = C[m];
+				list2[m] = &C[m];
+			}
+			fillData.fill( list2 );
+			for (int m=0; m<=N; m++)
+				fillData.fill( D[m] );
+			bad = 0;
+			for (int m=0; m<=N; m++){
+				for (size_t i=0; i<C[m].length(); i++)
+					bad += C[m](i)!=D[m](i) ? 1:0;
+				if (m < N){
+					for (int k=0; k<Nz; k++)
+						for (int j=0; j<Ny; j++)
+							for (int i=0; i<Nx; i++)
+								bad += !corner(i,j,k) && C[m](i,j,k)!=A[m](i,j,k) ? 1:0;
+				}
+			}
+			bad = sumReduce( comm, bad );
+			if (rank == 0) printf("fillHalo: %i errors \n",bad);
+			if (bad > 0) error++;
+		}
+
+		// time the exchanges
+		if ( argc > 1 ){
+			int it = 20;
+			MPI_Barrier(comm);
+			double t0 = MPI_Wtime();
+			for (int i=0; i<it; i++)
+				Dm.CommunicateMeshHalo( list );
+			double t1 = MPI_Wtime();
+			for (int i=0; i<it; i++)
+				for (int m=0; m<N; m++)
+					Dm.CommunicateMeshHalo( A[m] );
+			double t2 = MPI_Wtime();
+			if (rank == 0) printf("%i exchanges of %i arrays: one message per neighbor %0.4f s, one per array %0.4f s \n",
+				it,N,t1-t0,t2-t1);
+		}
+		error = sumReduce( comm, error );
+		if (error == 0 && rank == 0) printf("Mesh halo exchange passed \n");
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return error;
+}
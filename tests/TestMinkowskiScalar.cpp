@@ -0,0 +1,165 @@
+//*************************************************************************
+// Check the marching cubes tables used by Minkowski::ComputeScalar
+//   - area, mean curvature, Euler characteristic and volume are identical
+//     to the original ComputeScalar (DECL construction in every cube, one
+//     running sum) for a plane, a cylinder, a sphere and a random field
+//     with values on the cube corners (with USE_OPENMP: to round-off, and
+//     identical for any number of threads)
+//   TestMinkowskiScalar [n] times both methods on an n^3 sphere pack
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#include "analysis/Minkowski.h"
+#include "common/MPI_Helpers.h"
+#include "TestSiteLayout.h"
+
+// DECL measures, summed in the order of the original ComputeScalar
+static void DECLScalar( const DoubleArray &Field, double isovalue, double *measures )
+{
+	int Nx = Field.size(0), Ny = Field.size(1), Nz = Field.size(2);
+	DECL object;
+	double Ai = 0.0, Ji = 0.0, Xi = 0.0, Vi = 0.0;
+	for (int k=1; k<Nz-1; k++){
+		for (int j=1; j<Ny-1; j++){
+			for (int i=1; i<Nx-1; i++){
+				object.LocalIsosurface(Field,isovalue,i,j,k);
+				for (int idx=0; idx<object.TriangleCount; idx++){
+					int e1 = object.Face(idx);
+					int e2 = object.halfedge.next(e1);
+					int e3 = object.halfedge.next(e2);
+					auto P1 = object.vertex.coords(object.halfedge.v1(e1));
+					auto P2 = object.vertex.coords(object.halfedge.v1(e2));
+					auto P3 = object.vertex.coords(object.halfedge.v1(e3));
+					double s1 = Distance( P1, P2 );
+					double s2 = Distance( P2, P3 );
+					double s3 = Distance( P1, P3 );
+					double s = 0.5*(s1+s2+s3);
+					Ai += sqrt(s*(s-s1)*(s-s2)*(s-s3));
+					double a1 = object.EdgeAngle(e1);
+					double a2 = object.EdgeAngle(e2);
+					double a3 = object.EdgeAngle(e3);
+					Ji += (a1*s1+a2*s2+a3*s3);
+					Xi -= 0.5;
+				}
+				Xi += 0.25*double(object.VertexCount);
+			}
+		}
+	}
+	for (int k=1; k<Nz-1; k++)
+		for (int j=1; j<Ny-1; j++)
+			for (int i=1; i<Nx-1; i++)
+				if (Field(i,j,k) < isovalue) Vi += 1.0;
+	measures[0] = Ai;
+	measures[1] = Ji;
+	measures[2] = 0.5*Xi;
+	measures[3] = Vi;
+}
+
+static int Compare( Minkowski &object, const DoubleArray &Field, const char *name )
+{
+	double reference[4];
+	DECLScalar(Field,0.0,reference);
+	object.ComputeScalar(Field,0.0);
+	double measures[4] = { object.Ai, object.Ji, object.Xi, object.Vi };
+	int bad = 0;
+#ifdef USE_OPENMP
+	// the slabs are summed separately: round-off from the reference, but the same for any number of threads
+	for (int m=0; m<4; m++)
+		if (fabs(measures[m]-reference[m]) > 1e-10*std::max(1.0,fabs(reference[m]))) bad++;
+	int nthreads = omp_get_max_threads();
+	omp_set_num_threads(1);
+	object.ComputeScalar(Field,0.0);
+	omp_set_num_threads(nthreads);
+	double single[4] = { object.Ai, object.Ji, object.Xi, object.Vi };
+	for (int m=0; m<4; m++)
+		if (measures[m] != single[m]) bad++;
+#else
+	for (int m=0; m<4; m++)
+		if (measures[m] != reference[m]) bad++;
+#endif
+	printf("%s: A=%f (%f), H=%f (%f), X=%f (%f), V=%f (%f) \n",name,measures[0],reference[0],
+		measures[1],reference[1],measures[2],reference[2],measures[3],reference[3]);
+	return bad;
+}
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_SELF;
+	int error = 0;
+	{
+		printf("********************************************************\n");
+		printf("Running unit test: TestMinkowskiScalar	\n");
+		printf("********************************************************\n");
+		int n = 32;
+		auto db = TestDomainDatabase({ 1, 1, 1 },{ n, n, n });
+		auto Dm = std::make_shared<Domain>( db, comm );
+		int Nx = n+2, Ny = n+2, Nz = n+2;
+		DoubleArray Phase(Nx,Ny,Nz);
+		Minkowski object(Dm);
+
+		for (int k=0; k<Nz; k++)
+			for (int j=0; j<Ny; j++)
+				for (int i=0; i<Nx; i++)
+					Phase(i,j,k) = k-0.5*double(Nz+1);
+		error += Compare(object,Phase,"plane");
+
+		for (int k=0; k<Nz; k++)
+			for (int j=0; j<Ny; j++)
+				for (int i=0; i<Nx; i++)
+					Phase(i,j,k) = sqrt((1.0*i-0.5*Nx)*(1.0*i-0.5*Nx)+(1.0*k-0.5*Nz)*(1.0*k-0.5*Nz))-0.4*Nx;
+		error += Compare(object,Phase,"cylinder");
+
+		for (int k=0; k<Nz; k++)
+			for (int j=0; j<Ny; j++)
+				for (int i=0; i<Nx; i++)
+					Phase(i,j,k) = sqrt((1.0*i-0.5*Nx)*(1.0*i-0.5*Nx)+(1.0*j-0.5*Ny)*(1.0*j-0.5*Ny)+(1.0*k-0.5*Nz)*(1.0*k-0.5*Nz))-0.4*Nx;
+		error += Compare(object,Phase,"sphere");
+
+		// every sign case, with some values exactly on the isovalue (vertices on cube corners)
+		srand(17);
+		for (size_t idx=0; idx<Phase.length(); idx++)
+			Phase(idx) = double(rand()%5) - 2.0;
+		error += Compare(object,Phase,"random");
+
+		// timing on a sphere pack
+		int size = (argc > 1) ? atoi(argv[1]) : 0;
+		if (size > 0){
+			db->putVector<int>( "n", { size, size, size } );
+			auto Dm2 = std::make_shared<Domain>( db, comm );
+			DoubleArray Field(size+2,size+2,size+2);
+			Field.fill(1e10);
+			srand(23);
+			double R = std::max(3.0,size/16.0);
+			int count = int(0.7*double(size)*size*size/(4.18879*R*R*R));
+			for (int s=0; s<count; s++){
+				double cx = size*(rand()/(RAND_MAX+1.0));
+				double cy = size*(rand()/(RAND_MAX+1.0));
+				double cz = size*(rand()/(RAND_MAX+1.0));
+				for (int k=0; k<size+2; k++)
+					for (int j=0; j<size+2; j++)
+						for (int i=0; i<size+2; i++){
+							double d = sqrt((i-cx)*(i-cx)+(j-cy)*(j-cy)+(k-cz)*(k-cz))-R;
+							Field(i,j,k) = std::min(Field(i,j,k),d);
+						}
+			}
+			Minkowski sample(Dm2);
+			double reference[4];
+			double starttime = MPI_Wtime();
+			DECLScalar(Field,0.0,reference);
+			double decl_time = MPI_Wtime() - starttime;
+			starttime = MPI_Wtime();
+			sample.ComputeScalar(Field,0.0);
+			double table_time = MPI_Wtime() - starttime;
+			printf("%i^3: DECL %0.3f s, tables %0.3f s \n",size,decl_time,table_time);
+		}
+		if (error == 0) printf("Minkowski scalar passed \n");
+	}
+	MPI_Finalize();
+	return error;
+}
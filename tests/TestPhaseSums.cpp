@@ -0,0 +1,139 @@
+//*************************************************************************
+// Check the basic averages computed on the compact arrays
+//   - ScaLBL_D3Q19_PhaseSums + SubPhase::BasicCompact give the same volume,
+//     mass, momentum and pressure of each phase as SubPhase::Basic on the
+//     regular layout (with inlet / outlet layers excluded)
+//   TestPhaseSums [n] times both on an n^3 sub-domain per rank
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include "analysis/SubPhase.h"
+#include "common/ScaLBL.h"
+#include "common/MPI_Helpers.h"
+#include "TestSiteLayout.h"
+
+// site values as a function of the global site
+static inline double SiteValue( int x, int y, int z, int q )
+{
+	return sin(0.1*x + 0.37*y + 0.73*z + 1.3*q);
+}
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = MPI_WORLD_RANK();
+	int nprocs = MPI_WORLD_SIZE();
+	int error = 0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running unit test: TestPhaseSums	\n");
+			printf("********************************************************\n");
+		}
+		auto nproc = TestProcessGrid(nprocs,"TestPhaseSums");
+		int n = (argc > 1) ? atoi(argv[1]) : 16;
+
+		auto db = TestDomainDatabase(nproc,{ n, n, n });
+		db->putVector<int>( "InletLayers", { 2, 0, 3 } );
+		db->putVector<int>( "OutletLayers", { 0, 0, 2 } );
+		std::shared_ptr<Domain> Dm(new Domain(db,comm));
+		int Nx = Dm->Nx, Ny = Dm->Ny, Nz = Dm->Nz;
+		int ox = Dm->slab_x[Dm->iproc()];
+		int oy = Dm->slab_y[Dm->jproc()];
+		int oz = Dm->slab_z[Dm->kproc()];
+		IntArray Map;
+		int Np = 0;
+		auto ScaLBL_Comm = CreateTestLayout(Dm,7,Map,Np);
+
+		// densities with bulk regions of both phases and an interface in between
+		std::vector<double> Den(2*Np,0.0), Vel(3*Np,0.0), fq(19*Np,0.0);
+		std::vector<int> TmpMap(Np,-1);
+		for (int k=1; k<Nz-1; k++){
+			for (int j=1; j<Ny-1; j++){
+				for (int i=1; i<Nx-1; i++){
+					int idx = Map(i,j,k);
+					if (idx < 0) continue;
+					int x = ox+i-1, y = oy+j-1, z = oz+k-1;
+					double phi = std::max(-1.0,std::min(1.0,1.5*SiteValue(x,y,z,0)));
+					Den[idx] = 0.5*(1.0+phi);
+					Den[Np+idx] = 0.5*(1.0-phi) + 1e-3;
+					for (int d=0; d<3; d++) Vel[d*Np+idx] = 1e-3*SiteValue(x,y,z,d+1);
+					for (int q=0; q<19; q++) fq[q*Np+idx] = 0.05 + 0.01*SiteValue(x,y,z,q+4);
+					TmpMap[idx] = k*Nx*Ny + j*Nx + i;
+				}
+			}
+		}
+		double *dvcDen, *dvcVel, *dvcPressure;
+		dist_t *dvcfq;
+		int *dvcMap;
+		ScaLBL_AllocateDeviceMemory((void **) &dvcDen, 2*Np*sizeof(double));
+		ScaLBL_AllocateDeviceMemory((void **) &dvcVel, 3*Np*sizeof(double));
+		ScaLBL_AllocateDeviceMemory((void **) &dvcPressure, Np*sizeof(double));
+		ScaLBL_AllocateDeviceMemory((void **) &dvcfq, 19*Np*sizeof(dist_t));
+		ScaLBL_AllocateDeviceMemory((void **) &dvcMap, Np*sizeof(int));
+		ScaLBL_CopyToDevice(dvcDen, Den.data(), 2*Np*sizeof(double));
+		ScaLBL_CopyToDevice(dvcVel, Vel.data(), 3*Np*sizeof(double));
+		ScaLBL_CopyDistToDevice(dvcfq, fq.data(), 19*Np);
+		ScaLBL_CopyToDevice(dvcMap, TmpMap.data(), Np*sizeof(int));
+
+		SubPhase Averages(Dm);
+		Averages.SetParams(1.0,0.8,0.7,1.0,0.0,0.0,1e-5,0.005,0.95);
+
+		// regular layout (runAnalysis::basic with basic_analysis = "regular")
+		MPI_Barrier(comm);
+		double starttime = MPI_Wtime();
+		ScaLBL_D3Q19_Pressure(dvcfq,dvcPressure,Np);
+		ScaLBL_Comm->RegularLayout(Map,dvcPressure,Averages.Pressure);
+		ScaLBL_Comm->RegularLayout(Map,&dvcDen[0],Averages.Rho_n);
+		ScaLBL_Comm->RegularLayout(Map,&dvcDen[Np],Averages.Rho_w);
+		ScaLBL_Comm->RegularLayout(Map,&dvcVel[0],Averages.Vel_x);
+		ScaLBL_Comm->RegularLayout(Map,&dvcVel[Np],Averages.Vel_y);
+		ScaLBL_Comm->RegularLayout(Map,&dvcVel[2*Np],Averages.Vel_z);
+		Averages.Basic();
+		double regular_time = MPI_Wtime() - starttime;
+		double regular[12] = { Averages.gnb.V, Averages.gnb.M, Averages.gnb.Px, Averages.gnb.Py, Averages.gnb.Pz, Averages.gnb.p,
+			Averages.gwb.V, Averages.gwb.M, Averages.gwb.Px, Averages.gwb.Py, Averages.gwb.Pz, Averages.gwb.p };
+
+		// compact arrays
+		MPI_Barrier(comm);
+		starttime = MPI_Wtime();
+		int imin, jmin, kmin, kmax;
+		Averages.AverageRange(imin,jmin,kmin,kmax);
+		double sums[15];
+		ScaLBL_D3Q19_PhaseSums(dvcMap,dvcfq,dvcDen,dvcVel,sums,Averages.rho_n,Averages.rho_w,
+			imin,jmin,kmin,kmax,Nx,Nx*Ny,0,Np,Np);
+		Averages.BasicCompact(sums);
+		double compact_time = MPI_Wtime() - starttime;
+		double compact[12] = { Averages.gnb.V, Averages.gnb.M, Averages.gnb.Px, Averages.gnb.Py, Averages.gnb.Pz, Averages.gnb.p,
+			Averages.gwb.V, Averages.gwb.M, Averages.gwb.Px, Averages.gwb.Py, Averages.gwb.Pz, Averages.gwb.p };
+
+		const char *names[12] = { "Vn", "Mn", "Pnx", "Pny", "Pnz", "pn", "Vw", "Mw", "Pwx", "Pwy", "Pwz", "pw" };
+		for (int m=0; m<12; m++){
+			double diff = fabs(compact[m]-regular[m]);
+			if (diff > 1e-12*std::max(1.0,fabs(regular[m]))){
+				if (rank == 0) printf("   %s: regular %0.12g, compact %0.12g \n",names[m],regular[m],compact[m]);
+				error++;
+			}
+		}
+		if (regular[0] == 0.0 || regular[6] == 0.0 || regular[5] == 0.0 || regular[11] == 0.0) error++;
+		regular_time = maxReduce(comm,regular_time);
+		compact_time = maxReduce(comm,compact_time);
+		if (rank == 0){
+			printf("Sw = %f, pn = %f, pw = %f \n",regular[6]/(regular[0]+regular[6]),regular[5],regular[11]);
+			printf("%i^3 per rank: regular layout %0.4f s, compact arrays %0.4f s \n",n,regular_time,compact_time);
+		}
+
+		ScaLBL_FreeDeviceMemory(dvcDen);
+		ScaLBL_FreeDeviceMemory(dvcVel);
+		ScaLBL_FreeDeviceMemory(dvcPressure);
+		ScaLBL_FreeDeviceMemory(dvcfq);
+		ScaLBL_FreeDeviceMemory(dvcMap);
+		if (error == 0 && rank == 0) printf("Phase sums passed \n");
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return error;
+}
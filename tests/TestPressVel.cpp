@@ -137,9 +137,9 @@ int main(int argc, char **argv)
 
 		//......................device distributions.................................
 		if (rank==0)	printf ("Allocating distributions \n");
-		int dist_mem_size = Np*sizeof(double);
+		int dist_mem_size = Np*sizeof(dist_t);
 		int *NeighborList;
-		double * dist;
+		dist_t * dist;
 		double * Velocity;
 		//...........................................................................
 		ScaLBL_AllocateDeviceMemory((void **) &dist, 19*dist_mem_size);
@@ -179,7 +179,7 @@ int main(int argc, char **argv)
 		   DIST[17*Np + n] = 1.0;
 		   DIST[18*Np + n] = 1.0;
 	 	}
-		ScaLBL_CopyToDevice(dist, DIST, 19*Np*sizeof(double));	
+		ScaLBL_CopyDistToDevice(dist, DIST, 19*Np);	
 
 	   double *Vz;
   	   Vz= new double [Np];
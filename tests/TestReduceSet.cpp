@@ -0,0 +1,94 @@
+//*************************************************************************
+// Check the packed reductions (ReduceSet)
+//   - the sums, maxima and minima of a set of values match one reduction
+//     per value (bitwise)
+//   - the non-blocking reduction uses the local values at the start
+//   TestReduceSet [n] times n reductions of the TwoPhase averages
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include "common/MPI_Helpers.h"
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = MPI_WORLD_RANK();
+	int error = 0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running unit test: TestReduceSet	\n");
+			printf("********************************************************\n");
+		}
+		// local values (as many as the TwoPhase averages)
+		const int N = 45;
+		std::vector<double> local(N), sum(N), max(N), min(N);
+		for (int i=0; i<N; i++)
+			local[i] = sin(1.3*i+0.7*rank) + 0.01*rank*i;
+
+		// blocking reduction
+		ReduceSet set;
+		set.add( ReduceSet::SUM, local.data(), sum.data(), N );
+		set.add( ReduceSet::MAX, local.data(), max.data(), 10 );
+		set.add( ReduceSet::MIN, &local[10], &min[10], 5 );
+		set.reduce( comm );
+		int bad = 0;
+		if ( set.size(ReduceSet::SUM)!=N || set.size(ReduceSet::MAX)!=10 || set.size(ReduceSet::MIN)!=5 )
+			bad++;
+		for (int i=0; i<N; i++){
+			double x = local[i], y = 0;
+			MPI_Allreduce(&x,&y,1,MPI_DOUBLE,MPI_SUM,comm);
+			bad += sum[i]!=y ? 1:0;
+			if ( i < 10 )
+				bad += max[i]!=maxReduce(comm,x) ? 1:0;
+			if ( i >= 10 && i < 15 ) {
+				MPI_Allreduce(&x,&y,1,MPI_DOUBLE,MPI_MIN,comm);
+				bad += min[i]!=y ? 1:0;
+			}
+		}
+		if (rank == 0) printf("reduce: %i errors \n",bad);
+		if (bad > 0) error++;
+
+		// non-blocking reduction (the local values change after the start)
+		std::vector<double> sum0 = sum;
+		std::fill(sum.begin(),sum.end(),0.0);
+		set.clear();
+		set.add( ReduceSet::SUM, local.data(), sum.data(), N );
+		set.start( comm );
+		if ( !set.busy() )
+			error++;
+		for (int i=0; i<N; i++)
+			local[i] = -1;
+		set.finish( );
+		bad = 0;
+		for (int i=0; i<N; i++)
+			bad += sum[i]!=sum0[i] ? 1:0;
+		if (rank == 0) printf("start/finish: %i errors \n",bad);
+		if (bad > 0 || set.busy()) error++;
+
+		// time the reductions
+		int n = (argc > 1) ? atoi(argv[1]) : 0;
+		if ( n > 0 ) {
+			MPI_Barrier(comm);
+			double t0 = MPI_Wtime();
+			for (int it=0; it<n; it++)
+				set.reduce( comm );
+			double t1 = MPI_Wtime();
+			for (int it=0; it<n; it++){
+				for (int i=0; i<N; i++)
+					sum[i] = sumReduce(comm,local[i]);
+			}
+			double t2 = MPI_Wtime();
+			if (rank == 0) printf("%i reductions of %i values: ReduceSet %0.4f s, one value at a time %0.4f s \n",
+				n,N,t1-t0,t2-t1);
+		}
+		error = sumReduce( comm, error );
+		if (error == 0 && rank == 0) printf("Packed reductions passed \n");
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return error;
+}
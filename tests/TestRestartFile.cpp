@@ -0,0 +1,116 @@
+//*************************************************************************
+// Check the shared restart file
+//   - a restart written by one decomposition is read back by another
+//   - the values are restored in the memory optimized layout of the reader
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include "common/ScaLBL.h"
+#include "common/MPI_Helpers.h"
+#include "TestSiteLayout.h"
+
+// restart values as a function of the global site
+static inline double SiteValue( int x, int y, int z, int q )
+{
+	return 1.0 + 0.001*q + 1.0e-6*(x + 37*y + 1009*z);
+}
+
+// Domain with the given process grid, the memory optimized layout and its Map
+static std::shared_ptr<Domain> CreateDomain( MPI_Comm comm, const std::vector<int>& nproc, int L,
+		const std::string& ordering, IntArray& Map, int& Np )
+{
+	auto db = TestDomainDatabase(nproc,{ L/nproc[0], L/nproc[1], L/nproc[2] });
+	db->putScalar<std::string>( "SiteOrdering", ordering );
+	std::shared_ptr<Domain> Dm(new Domain(db,comm));
+	CreateTestLayout(Dm,6,Map,Np);
+	return Dm;
+}
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = MPI_WORLD_RANK();
+	int nprocs = MPI_WORLD_SIZE();
+	int error = 0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running unit test: TestRestartFile	\n");
+			printf("********************************************************\n");
+		}
+		// writer and reader process grids
+		std::vector<int> write_grid = { 1, 1, 1 }, read_grid = { 1, 1, 1 };
+		if (nprocs == 2){
+			write_grid = { 2, 1, 1 };
+			read_grid = { 1, 1, 2 };
+		}
+		else if (nprocs == 4){
+			write_grid = { 2, 2, 1 };
+			read_grid = { 1, 2, 2 };
+		}
+		else if (nprocs != 1) ERROR("TestRestartFile runs with 1, 2 or 4 processes");
+		int L = 16;
+
+		IntArray Map;
+		int Np;
+		auto Dm = CreateDomain(comm,write_grid,L,"ijk",Map,Np);
+		std::vector<double> cDen(2*Np,0.0), cfq(19*Np,0.0);
+		int ox = Dm->slab_x[Dm->iproc()];
+		int oy = Dm->slab_y[Dm->jproc()];
+		int oz = Dm->slab_z[Dm->kproc()];
+		for (int k=1; k<Dm->Nz-1; k++){
+			for (int j=1; j<Dm->Ny-1; j++){
+				for (int i=1; i<Dm->Nx-1; i++){
+					int n = Map(i,j,k);
+					if (n < 0) continue;
+					cDen[n] = SiteValue(ox+i-1,oy+j-1,oz+k-1,-2);
+					cDen[Np+n] = SiteValue(ox+i-1,oy+j-1,oz+k-1,-1);
+					for (int q=0; q<19; q++) cfq[q*Np+n] = SiteValue(ox+i-1,oy+j-1,oz+k-1,q);
+				}
+			}
+		}
+		MPI_Barrier(comm);
+		double starttime = MPI_Wtime();
+		WriteRestartFile("restart.lbpm",comm,*Dm,Map,cDen.data(),cfq.data(),Np);
+		double writetime = MPI_Wtime() - starttime;
+
+		// read back with the same decomposition and with a different one (and site ordering)
+		const char *cases[2] = { "same decomposition", "different decomposition" };
+		for (int c=0; c<2; c++){
+			IntArray Map2;
+			int Np2;
+			auto Dm2 = CreateDomain(comm,(c==0) ? write_grid : read_grid,L,(c==0) ? "ijk" : "morton",Map2,Np2);
+			std::vector<double> rDen(2*Np2,0.0), rfq(19*Np2,0.0);
+			MPI_Barrier(comm);
+			starttime = MPI_Wtime();
+			ReadRestartFile("restart.lbpm",comm,*Dm2,Map2,rDen.data(),rfq.data(),Np2);
+			double readtime = MPI_Wtime() - starttime;
+			int ox = Dm2->slab_x[Dm2->iproc()];
+			int oy = Dm2->slab_y[Dm2->jproc()];
+			int oz = Dm2->slab_z[Dm2->kproc()];
+			int bad = 0;
+			for (int k=1; k<Dm2->Nz-1; k++){
+				for (int j=1; j<Dm2->Ny-1; j++){
+					for (int i=1; i<Dm2->Nx-1; i++){
+						int n = Map2(i,j,k);
+						if (n < 0) continue;
+						if (rDen[n] != SiteValue(ox+i-1,oy+j-1,oz+k-1,-2)) bad++;
+						if (rDen[Np2+n] != SiteValue(ox+i-1,oy+j-1,oz+k-1,-1)) bad++;
+						for (int q=0; q<19; q++)
+							if (rfq[q*Np2+n] != SiteValue(ox+i-1,oy+j-1,oz+k-1,q)) bad++;
+					}
+				}
+			}
+			bad = sumReduce(comm,bad);
+			if (rank == 0) printf("%s: write %0.4f s, read %0.4f s, %i errors \n",cases[c],writetime,readtime,bad);
+			if (bad > 0) error++;
+		}
+		if (error == 0 && rank == 0) printf("Restart file passed \n");
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return error;
+}
@@ -0,0 +1,157 @@
+//*************************************************************************
+// Check the multiscale segmentation of the uCT data (segmentLevels)
+//   - gathering a level onto a subset of the ranks and scattering it back
+//     is exact (gatherDomain)
+//   - the segmentation with the coarse levels gathered matches the
+//     segmentation on all ranks and the two phase image
+//   TestSegmentLevels [n] segments an n^3 image
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include "analysis/uCT.h"
+#include "common/MPI_Helpers.h"
+#include "TestSiteLayout.h"
+
+// two phase image with noise (as a function of the global cell)
+static inline bool InPhase( int x, int y, int z )
+{
+	return sin(0.11*x)*sin(0.12*y+0.4)*sin(0.1*z+0.2) > -0.1;
+}
+static inline float ImageValue( int x, int y, int z )
+{
+	float noise = 0.3*sin(12.9898*x+78.233*y+37.719*z);
+	float value = (InPhase(x,y,z) ? 0.7:-0.7) + noise;
+	return std::min(1.0f,std::max(-1.0f,value));
+}
+
+struct Levels {
+	std::vector<Array<float>> Mean, Dist, MultiScaleSmooth, NonLocalMean;
+	std::vector<Array<char>> ID;
+	Levels( const std::vector<Array<float>>& VOL ): Mean(VOL), Dist(VOL),
+		MultiScaleSmooth(VOL), NonLocalMean(VOL), ID(VOL.size())
+	{
+		for (size_t i=0; i<VOL.size(); i++) {
+			Mean[i].fill(0);
+			Dist[i].fill(0);
+			MultiScaleSmooth[i].fill(0);
+			NonLocalMean[i].fill(0);
+			ID[i].resize(VOL[i].size());
+			ID[i].fill(0);
+		}
+	}
+};
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = MPI_WORLD_RANK();
+	int nprocs = MPI_WORLD_SIZE();
+	int error = 0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running unit test: TestSegmentLevels	\n");
+			printf("********************************************************\n");
+		}
+		auto nproc = TestProcessGrid(nprocs,"TestSegmentLevels","xyz");
+		int L = (argc > 1) ? atoi(argv[1]) : 64;
+		int N_levels = 3;
+
+		// create the levels (each coarsened by 2 in every direction)
+		std::vector<std::shared_ptr<Domain>> Dm(N_levels);
+		std::vector<std::shared_ptr<fillHalo<float>>> fillFloat(N_levels);
+		std::vector<Array<float>> VOL(N_levels);
+		for (int i=0; i<N_levels; i++) {
+			int n = (L>>i);
+			auto db = TestDomainDatabase(nproc,{ n/nproc[0], n/nproc[1], n/nproc[2] });
+			Dm[i].reset( new Domain( db, comm ) );
+			int nx = Dm[i]->Nx-2, ny = Dm[i]->Ny-2, nz = Dm[i]->Nz-2;
+			fillFloat[i].reset( new fillHalo<float>( Dm[i]->Comm, Dm[i]->rank_info, {nx,ny,nz}, {1,1,1}, 0, 1 ) );
+			VOL[i].resize( nx+2, ny+2, nz+2 );
+			VOL[i].fill( 0 );
+			if ( i == 0 ) {
+				int ox = Dm[i]->iproc()*nx, oy = Dm[i]->jproc()*ny, oz = Dm[i]->kproc()*nz;
+				for (int kk=1; kk<=nz; kk++)
+					for (int jj=1; jj<=ny; jj++)
+						for (int ii=1; ii<=nx; ii++)
+							VOL[i](ii,jj,kk) = ImageValue(ox+ii-1,oy+jj-1,oz+kk-1);
+			} else {
+				Array<float> filter(2,2,2);
+				filter.fill(0.125f);
+				Array<float> tmp(2*nx,2*ny,2*nz);
+				fillFloat[i-1]->copy( VOL[i-1], tmp );
+				Array<float> coarse = tmp.coarsen( filter );
+				fillFloat[i]->copy( coarse, VOL[i] );
+			}
+			fillFloat[i]->fill( VOL[i] );
+		}
+
+		// gather the finest level onto one rank and scatter it back
+		{
+			auto factor = gatherDomain::getFactor( *Dm[0], L );
+			gatherDomain level( *Dm[0], factor );
+			Array<float> VOL2, VOL3;
+			level.gather( VOL[0], VOL2 );
+			level.scatter( VOL2, VOL3 );
+			int bad = 0;
+			if ( level.active() != (rank==0) )
+				bad++;
+			if ( level.active() ) {
+				if ( VOL2.size() != ArraySize(L+2,L+2,L+2) ) {
+					bad++;
+				} else {
+					for (int k=0; k<L+2; k++)
+						for (int j=0; j<L+2; j++)
+							for (int i=0; i<L+2; i++)
+								bad += VOL2(i,j,k)!=ImageValue((i+L-1)%L,(j+L-1)%L,(k+L-1)%L) ? 1:0;
+				}
+			}
+			for (size_t i=0; i<VOL[0].length(); i++)
+				bad += VOL3(i)!=VOL[0](i) ? 1:0;
+			bad = sumReduce( comm, bad );
+			if (rank == 0) printf("gather/scatter: %i errors \n",bad);
+			if (bad > 0) error++;
+		}
+
+		// segment the image on all ranks and with the levels gathered onto one rank
+		float threshold = 0.0, lamda = 0.5, sigsq = 0.1;
+		int depth = 3;
+		Levels A( VOL ), B( VOL );
+		if (rank == 0) printf("all ranks: \n");
+		auto timeA = segmentLevels( Dm, VOL, A.Mean, A.ID, A.Dist, A.MultiScaleSmooth, A.NonLocalMean,
+			fillFloat, threshold, lamda, sigsq, depth, 0 );
+		if (rank == 0) printf("gathered: \n");
+		auto timeB = segmentLevels( Dm, VOL, B.Mean, B.ID, B.Dist, B.MultiScaleSmooth, B.NonLocalMean,
+			fillFloat, threshold, lamda, sigsq, depth, L );
+		if ( timeA.size() != (size_t)N_levels || timeB.size() != (size_t)N_levels )
+			error++;
+		int nx = Dm[0]->Nx-2, ny = Dm[0]->Ny-2, nz = Dm[0]->Nz-2;
+		int ox = Dm[0]->iproc()*nx, oy = Dm[0]->jproc()*ny, oz = Dm[0]->kproc()*nz;
+		int diff = 0, wrongA = 0, wrongB = 0;
+		for (int k=1; k<=nz; k++){
+			for (int j=1; j<=ny; j++){
+				for (int i=1; i<=nx; i++){
+					char id = InPhase(ox+i-1,oy+j-1,oz+k-1) ? 0:1;
+					diff += A.ID[0](i,j,k)!=B.ID[0](i,j,k) ? 1:0;
+					wrongA += A.ID[0](i,j,k)!=id ? 1:0;
+					wrongB += B.ID[0](i,j,k)!=id ? 1:0;
+				}
+			}
+		}
+		double N = double(L)*double(L)*double(L);
+		double frac_diff = sumReduce( comm, diff ) / N;
+		double frac_A = sumReduce( comm, wrongA ) / N;
+		double frac_B = sumReduce( comm, wrongB ) / N;
+		if (rank == 0) printf("gathered differs at %0.4f of the cells, misclassified %0.4f (all ranks), %0.4f (gathered) \n",
+			frac_diff,frac_A,frac_B);
+		if ( (nprocs==1 && frac_diff>0) || frac_diff>0.02 || frac_A>0.06 || frac_B>0.06 )
+			error++;
+		if (error == 0 && rank == 0) printf("Multiscale segmentation passed \n");
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return error;
+}
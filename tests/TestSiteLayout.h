@@ -0,0 +1,58 @@
+// Common setup of the unit tests: process grid, periodic domain and test media in the memory optimized layout
+#ifndef TestSiteLayout_INC
+#define TestSiteLayout_INC
+
+#include "common/ScaLBL.h"
+#include "common/MPI_Helpers.h"
+
+// Solid pattern as a function of the global site: pores out of every 10 sites are open
+static inline signed char TestSiteID( int x, int y, int z, int pores )
+{
+	return ((x*7 + y*13 + z*3)%10 < pores) ? 1 : 0;
+}
+
+// Process grid of the tests that run on 1, 2, 4 or 8 processes: the axes are split in two
+// in the given order (2 processes split order[0], 4 split order[0] and order[1], 8 split all three)
+static inline std::vector<int> TestProcessGrid( int nprocs, const std::string& test, const std::string& order = "zxy" )
+{
+	int splits = (nprocs == 1) ? 0 : (nprocs == 2) ? 1 : (nprocs == 4) ? 2 : (nprocs == 8) ? 3 : -1;
+	if (splits < 0) ERROR(test + " runs with 1, 2, 4 or 8 processes");
+	std::vector<int> nproc = { 1, 1, 1 };
+	for (int s=0; s<splits; s++) nproc[order[s]-'x'] = 2;
+	return nproc;
+}
+
+// Database of a periodic domain with the process grid nproc and the sub-domain size n
+static inline std::shared_ptr<Database> TestDomainDatabase( const std::vector<int>& nproc, const std::vector<int>& n )
+{
+	auto db = std::make_shared<Database>();
+	db->putScalar<int>( "BC", 0 );
+	db->putVector<int>( "nproc", nproc );
+	db->putVector<int>( "n", n );
+	db->putVector<double>( "L", { 1, 1, 1 } );
+	return db;
+}
+
+// Fill the domain with the (periodic) pattern, and set up the communication and the memory optimized layout
+static inline std::shared_ptr<ScaLBL_Communicator> CreateTestLayout( std::shared_ptr<Domain> Dm, int pores, IntArray& Map, int& Np )
+{
+	int Nx = Dm->Nx, Ny = Dm->Ny, Nz = Dm->Nz;
+	int Lx = Dm->slab_x.back(), Ly = Dm->slab_y.back(), Lz = Dm->slab_z.back();
+	int ox = Dm->slab_x[Dm->iproc()];
+	int oy = Dm->slab_y[Dm->jproc()];
+	int oz = Dm->slab_z[Dm->kproc()];
+	for (int k=0; k<Nz; k++)
+		for (int j=0; j<Ny; j++)
+			for (int i=0; i<Nx; i++)
+				Dm->id[k*Nx*Ny+j*Nx+i] = TestSiteID((ox+i-1+Lx)%Lx,(oy+j-1+Ly)%Ly,(oz+k-1+Lz)%Lz,pores);
+	Dm->CommInit();
+	Np = Dm->PoreCount();
+	std::shared_ptr<ScaLBL_Communicator> ScaLBL_Comm(new ScaLBL_Communicator(Dm));
+	int *neighborList = new int[18*(Np+32)];
+	Map.resize(Nx,Ny,Nz);
+	Np = ScaLBL_Comm->MemoryOptimizedLayoutAA(Map,neighborList,Dm->id,Np);
+	delete [] neighborList;
+	return ScaLBL_Comm;
+}
+
+#endif
@@ -0,0 +1,222 @@
+//*************************************************************************
+// Check the interior site orderings for MemoryOptimizedLayoutAA
+//   - each ordering must produce a valid layout (exterior/interior split preserved)
+//   - MRT flow through a random sphere pack must not depend on the ordering
+//   - with arguments (timesteps, sub-domain size) the lattice update rate is
+//     reported for each ordering and porosity (benchmark)
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include "common/ScaLBL.h"
+#include "common/MPI_Helpers.h"
+
+std::shared_ptr<Database> loadInputs( int n )
+{
+    auto db = std::make_shared<Database>();
+    db->putScalar<int>( "BC", 0 );
+    db->putVector<int>( "nproc", { 1, 1, 1 } );
+    db->putVector<int>( "n", { n, n, n } );
+    db->putScalar<int>( "nspheres", 1 );
+    db->putVector<double>( "L", { 1, 1, 1 } );
+    return db;
+}
+
+// Random overlapping solid spheres until the porosity drops to the target
+static void SpherePack(signed char *id, int Nx, int Ny, int Nz, double porosity, unsigned int seed)
+{
+	int N = Nx*Ny*Nz;
+	int n, count;
+	for (n=0; n<N; n++) id[n] = 1;
+	count = (Nx-2)*(Ny-2)*(Nz-2);
+	int target = int(porosity*count);
+	srand(seed);
+	int R = 4;
+	while (count > target){
+		int cx = 1 + rand()%(Nx-2);
+		int cy = 1 + rand()%(Ny-2);
+		int cz = 1 + rand()%(Nz-2);
+		for (int dk=-R; dk<=R; dk++){
+			for (int dj=-R; dj<=R; dj++){
+				for (int di=-R; di<=R; di++){
+					if (di*di+dj*dj+dk*dk > R*R) continue;
+					// periodic image of the sphere
+					int i = (cx+di-1+(Nx-2))%(Nx-2)+1;
+					int j = (cy+dj-1+(Ny-2))%(Ny-2)+1;
+					int k = (cz+dk-1+(Nz-2))%(Nz-2)+1;
+					n = k*Nx*Ny+j*Nx+i;
+					if (id[n] > 0){
+						id[n] = 0;
+						count--;
+					}
+				}
+			}
+		}
+	}
+}
+
+// Run the MRT model with a body force and return the velocity in the regular layout
+static int RunFlow(std::shared_ptr<Database> db, MPI_Comm comm, const signed char *id, const std::string &ordering,
+		int timesteps, DoubleArray &Velocity, double &MLUPS)
+{
+	int i,j,k,n;
+	int error = 0;
+	db->putScalar<std::string>( "SiteOrdering", ordering );
+	std::shared_ptr<Domain> Dm(new Domain(db,comm));
+	int Nx = Dm->Nx;
+	int Ny = Dm->Ny;
+	int Nz = Dm->Nz;
+	int N = Nx*Ny*Nz;
+	for (n=0; n<N; n++) Dm->id[n] = id[n];
+	Dm->CommInit();
+	int Np = Dm->PoreCount();
+	std::shared_ptr<ScaLBL_Communicator> ScaLBL_Comm(new ScaLBL_Communicator(Dm));
+
+	int Npad = Np+32;
+	int neighborSize = 18*Npad*sizeof(int);
+	int *neighborList = new int[18*Npad];
+	IntArray Map(Nx,Ny,Nz);
+	Np = ScaLBL_Comm->MemoryOptimizedLayoutAA(Map,neighborList,Dm->id,Np);
+
+	// Every interior site is visited exactly once
+	std::vector<int> visits(Np,0);
+	int last_exterior = ScaLBL_Comm->LastExterior();
+	int first_interior = ScaLBL_Comm->FirstInterior();
+	int last_interior = ScaLBL_Comm->LastInterior();
+	for (k=1; k<Nz-1; k++){
+		for (j=1; j<Ny-1; j++){
+			for (i=1; i<Nx-1; i++){
+				int idx = Map(i,j,k);
+				if (idx < 0) continue;
+				bool exterior = (i==1 || j==1 || k==1 || i==Nx-2 || j==Ny-2 || k==Nz-2);
+				if (exterior && idx >= last_exterior) error = 1;
+				if (!exterior && (idx < first_interior || idx >= last_interior)) error = 1;
+				visits[idx]++;
+			}
+		}
+	}
+	for (int idx=0; idx<Np; idx++){
+		bool used = (idx < last_exterior) || (idx >= first_interior && idx < last_interior);
+		if (used && visits[idx] != 1) error = 1;
+		if (!used && visits[idx] != 0) error = 1;
+	}
+	if (error) printf("  %s: layout does not match the exterior / interior split \n",ordering.c_str());
+
+	int *NeighborList;
+	dist_t *fq;
+	double *Velocity_dvc;
+	ScaLBL_AllocateDeviceMemory((void **) &NeighborList, neighborSize);
+	ScaLBL_AllocateDeviceMemory((void **) &fq, 19*Np*sizeof(dist_t));
+	ScaLBL_AllocateDeviceMemory((void **) &Velocity_dvc, 3*Np*sizeof(double));
+	ScaLBL_CopyToDevice(NeighborList, neighborList, neighborSize);
+	ScaLBL_D3Q19_Init(fq, Np);
+
+	double tau = 1.0;
+	double rlx_setA = 1.0/tau;
+	double rlx_setB = 8.f*(2.f-rlx_setA)/(8.f-rlx_setA);
+	double Fx = 0.0, Fy = 0.0, Fz = 1.0e-5;
+	ScaLBL_DeviceBarrier(); MPI_Barrier(comm);
+	double starttime = MPI_Wtime();
+	int timestep = 0;
+	while (timestep < timesteps){
+		ScaLBL_Comm->SendD3Q19AA(fq); //READ FROM NORMAL
+		ScaLBL_D3Q19_AAodd_MRT(NeighborList, fq, first_interior, last_interior, Np, rlx_setA, rlx_setB, Fx, Fy, Fz);
+		ScaLBL_Comm->RecvD3Q19AA(fq); //WRITE INTO OPPOSITE
+		ScaLBL_D3Q19_AAodd_MRT(NeighborList, fq, 0, last_exterior, Np, rlx_setA, rlx_setB, Fx, Fy, Fz);
+		ScaLBL_DeviceBarrier();
+		timestep++;
+		ScaLBL_Comm->SendD3Q19AA(fq); //READ FORM NORMAL
+		ScaLBL_D3Q19_AAeven_MRT(fq, first_interior, last_interior, Np, rlx_setA, rlx_setB, Fx, Fy, Fz);
+		ScaLBL_Comm->RecvD3Q19AA(fq); //WRITE INTO OPPOSITE
+		ScaLBL_D3Q19_AAeven_MRT(fq, 0, last_exterior, Np, rlx_setA, rlx_setB, Fx, Fy, Fz);
+		ScaLBL_DeviceBarrier();
+		timestep++;
+	}
+	double cputime = MPI_Wtime() - starttime;
+	MLUPS = double(Np)*timesteps/cputime/1000000;
+
+	ScaLBL_D3Q19_Momentum(fq, Velocity_dvc, Np);
+	double *VEL = new double[3*Np];
+	ScaLBL_CopyToHost(VEL, Velocity_dvc, 3*Np*sizeof(double));
+	Velocity.resize(Nx,Ny,Nz*3);
+	Velocity.fill(0.0);
+	for (k=1; k<Nz-1; k++){
+		for (j=1; j<Ny-1; j++){
+			for (i=1; i<Nx-1; i++){
+				int idx = Map(i,j,k);
+				if (idx < 0) continue;
+				Velocity(i,j,k) = VEL[idx];
+				Velocity(i,j,Nz+k) = VEL[Np+idx];
+				Velocity(i,j,2*Nz+k) = VEL[2*Np+idx];
+			}
+		}
+	}
+	delete [] VEL;
+	delete [] neighborList;
+	ScaLBL_FreeDeviceMemory(NeighborList);
+	ScaLBL_FreeDeviceMemory(fq);
+	ScaLBL_FreeDeviceMemory(Velocity_dvc);
+	return error;
+}
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = MPI_WORLD_RANK();
+	int nprocs = MPI_WORLD_SIZE();
+	int error = 0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running unit test: TestSiteOrdering	\n");
+			printf("********************************************************\n");
+		}
+		if (nprocs != 1){
+			printf("FAIL: Unit test TestSiteOrdering requires 1 MPI process! \n");
+			ASSERT(nprocs==1);
+		}
+		// optional arguments: timesteps, sub-domain size (for benchmarking)
+		// the default is a small domain that only checks the orderings
+		bool benchmark = (argc > 1);
+		int timesteps = 4;
+		int size = 16;
+		if (argc > 1) timesteps = atoi(argv[1]);
+		if (argc > 2) size = atoi(argv[2]);
+
+		auto db = loadInputs( size );
+		int Nx = db->getVector<int>( "n" )[0] + 2;
+		int Ny = db->getVector<int>( "n" )[1] + 2;
+		int Nz = db->getVector<int>( "n" )[2] + 2;
+		signed char *id = new signed char[Nx*Ny*Nz];
+
+		const char *orderings[4] = {"ijk", "morton", "hilbert", "brick"};
+		double porosity[3] = {0.2, 0.5, 0.8};
+		if (benchmark) printf("porosity  ijk        morton     hilbert    brick (MLUPS) \n");
+		for (int p=0; p<3; p++){
+			SpherePack(id, Nx, Ny, Nz, porosity[p], 101+p);
+			DoubleArray Reference, Velocity;
+			double rate[4];
+			for (int r=0; r<4; r++){
+				error += RunFlow(db, comm, id, orderings[r], timesteps, (r==0) ? Reference : Velocity, rate[r]);
+				if (r == 0) continue;
+				double vmax = 0.0, err = 0.0;
+				for (size_t n=0; n<Reference.length(); n++){
+					vmax = std::max(vmax,fabs(Reference(n)));
+					err = std::max(err,fabs(Reference(n)-Velocity(n)));
+				}
+				if (err > 1e-12*vmax){
+					printf("  %s: velocity differs from ijk ordering (porosity %0.1f, error %e) \n",orderings[r],porosity[p],err);
+					error++;
+				}
+			}
+			if (benchmark) printf("%0.1f       %-10.3f %-10.3f %-10.3f %-10.3f \n",porosity[p],rate[0],rate[1],rate[2],rate[3]);
+		}
+		delete [] id;
+		if (error == 0) printf("Site orderings agree \n");
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return error;
+}
@@ -0,0 +1,178 @@
+//*************************************************************************
+// Check the mpiio format of the writer (IO::initialize( path, "mpiio" ))
+//   - the meshes and variables of every rank are read back through the
+//     binary index (getMeshList, getMesh and getVariable)
+//   - with ranks_per_file the ranks of each group share a file
+//   TestWriterMPIIO [n] times n timesteps written with the new format (one
+//   file per rank) and with the mpiio format
+//*************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include "IO/MeshDatabase.h"
+#include "IO/Reader.h"
+#include "IO/Writer.h"
+#include "common/MPI_Helpers.h"
+
+// value of the variables of the given rank
+static inline double VarValue( int rank, size_t i )
+{
+	return rank + sin(0.1*i);
+}
+
+// the meshes of the given rank (the number of points depends on the rank)
+static std::vector<IO::MeshDataStruct> CreateMeshes( int rank, int nprocs )
+{
+	const auto NodeVar = IO::VariableType::NodeVariable;
+	const auto VolVar  = IO::VariableType::VolumeVariable;
+	int N_points = 5 + 3*rank;
+	auto points = std::make_shared<IO::PointList>(N_points);
+	for (int i=0; i<N_points; i++)
+		points->points[i] = Point(i,rank,0.5*i);
+	auto trimesh = std::make_shared<IO::TriMesh>(N_points-2,points);
+	for (int i=0; i<N_points-2; i++) {
+		trimesh->A[i] = i;
+		trimesh->B[i] = i+1;
+		trimesh->C[i] = i+2;
+	}
+	RankInfoStruct rank_data( rank, nprocs, 1, 1 );
+	auto domain = std::make_shared<IO::DomainMesh>(rank_data,4,5,6,1.0,1.0,1.0);
+	auto point_var  = std::make_shared<IO::Variable>(3,NodeVar,"point_vec");
+	auto tri_var    = std::make_shared<IO::Variable>(1,VolVar,"tri_mag");
+	auto domain_var = std::make_shared<IO::Variable>(1,VolVar,"domain_mag");
+	auto node_var   = std::make_shared<IO::Variable>(3,NodeVar,"domain_vec");
+	point_var->data.resize( N_points, 3 );
+	tri_var->data.resize( N_points-2 );
+	domain_var->data.resize( 4, 5, 6 );
+	node_var->data.resize( { 5, 6, 7, 3 } );
+	for ( auto var : { point_var, tri_var, domain_var, node_var } )
+		for (size_t i=0; i<var->data.length(); i++)
+			var->data(i) = VarValue(rank,i);
+	std::vector<IO::MeshDataStruct> meshData(3);
+	meshData[0].meshName = "pointmesh";
+	meshData[0].mesh = points;
+	meshData[0].vars.push_back(point_var);
+	meshData[1].meshName = "trimesh";
+	meshData[1].mesh = trimesh;
+	meshData[1].vars.push_back(tri_var);
+	meshData[2].meshName = "domain";
+	meshData[2].mesh = domain;
+	meshData[2].vars.push_back(domain_var);
+	meshData[2].vars.push_back(node_var);
+	return meshData;
+}
+
+// write two timesteps and read back the data of all ranks
+static int TestFormat( const std::string& path, int ranks_per_file, MPI_Comm comm )
+{
+	int rank = comm_rank(comm);
+	int nprocs = comm_size(comm);
+	auto meshData = CreateMeshes( rank, nprocs );
+	IO::initialize( path, "mpiio", false, ranks_per_file );
+	IO::writeData( 0, meshData, comm );
+	IO::writeData( 3, meshData, comm );
+	MPI_Barrier(comm);
+	int bad = 0;
+	auto timesteps = IO::readTimesteps( path + "/summary.LBM" );
+	if ( timesteps.size() != 2 )
+		bad++;
+	int group_size = ranks_per_file>0 ? std::min(ranks_per_file,nprocs) : nprocs;
+	for ( const auto& timestep : timesteps ) {
+		auto databaseList = IO::getMeshList( path, timestep );
+		if ( databaseList.size() != meshData.size() ) {
+			bad++;
+			continue;
+		}
+		for ( const auto& database : databaseList ) {
+			if ( (int) database.domains.size() != nprocs ) {
+				bad++;
+				continue;
+			}
+			for (int k=0; k<nprocs; k++) {
+				char file[100];
+				sprintf(file,"LBM.%05i",k/group_size);
+				bad += database.domains[k].file!=file ? 1:0;
+				auto mesh0 = CreateMeshes( k, nprocs );
+				const IO::MeshDataStruct* data0 = NULL;
+				for ( const auto& tmp : mesh0 ) {
+					if ( tmp.meshName == database.name )
+						data0 = &tmp;
+				}
+				auto mesh = IO::getMesh( path, timestep, database, k );
+				if ( data0==NULL || mesh.get()==NULL || mesh->className()!=data0->mesh->className() ) {
+					bad++;
+					continue;
+				}
+				auto pack1 = mesh->pack(0);
+				auto pack2 = data0->mesh->pack(0);
+				if ( pack1.first!=pack2.first || memcmp(pack1.second,pack2.second,pack1.first)!=0 )
+					bad++;
+				delete [] (char*) pack1.second;
+				delete [] (char*) pack2.second;
+				if ( database.variables.size() != data0->vars.size() )
+					bad++;
+				for ( const auto& var0 : data0->vars ) {
+					auto var = IO::getVariable( path, timestep, database, k, var0->name );
+					if ( var.get()==NULL || var->dim!=var0->dim || var->type!=var0->type ||
+						 var->data.length()!=var0->data.length() ) {
+						bad++;
+						continue;
+					}
+					for (size_t i=0; i<var->data.length(); i++)
+						bad += var->data(i)!=var0->data(i) ? 1:0;
+				}
+			}
+		}
+	}
+	return sumReduce( comm, bad );
+}
+
+int main(int argc, char **argv)
+{
+	MPI_Init(&argc,&argv);
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = MPI_WORLD_RANK();
+	int nprocs = MPI_WORLD_SIZE();
+	int error = 0;
+	{
+		if (rank == 0){
+			printf("********************************************************\n");
+			printf("Running unit test: TestWriterMPIIO	\n");
+			printf("********************************************************\n");
+		}
+		// one shared file per timestep
+		int bad = TestFormat( "test_mpiio", 0, comm );
+		if (rank == 0) printf("single file: %i errors \n",bad);
+		if (bad > 0) error++;
+		// one file per group of two ranks
+		bad = TestFormat( "test_mpiio2", 2, comm );
+		if (rank == 0) printf("2 ranks per file: %i errors \n",bad);
+		if (bad > 0) error++;
+
+		// time the writes
+		int n = (argc > 1) ? atoi(argv[1]) : 0;
+		if ( n > 0 ) {
+			auto meshData = CreateMeshes( rank, nprocs );
+			IO::initialize( "test_mpiio_new", "new", false );
+			MPI_Barrier(comm);
+			double t0 = MPI_Wtime();
+			for (int it=0; it<n; it++)
+				IO::writeData( it, meshData, comm );
+			double t1 = MPI_Wtime();
+			IO::initialize( "test_mpiio", "mpiio", false );
+			MPI_Barrier(comm);
+			double t2 = MPI_Wtime();
+			for (int it=0; it<n; it++)
+				IO::writeData( it, meshData, comm );
+			double t3 = MPI_Wtime();
+			if (rank == 0) printf("%i timesteps on %i ranks: new format %0.4f s, mpiio %0.4f s \n",
+				n,nprocs,t1-t0,t3-t2);
+		}
+		error = sumReduce( comm, error );
+		if (error == 0 && rank == 0) printf("MPI-IO writer passed \n");
+	}
+	MPI_Barrier(comm);
+	MPI_Finalize();
+	return error;
+}
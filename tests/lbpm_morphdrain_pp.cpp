@@ -55,6 +55,13 @@ int main(int argc, char **argv)
 		auto ReadValues = domain_db->getVector<int>( "ReadValues" );
 		auto WriteValues = domain_db->getVector<int>( "WriteValues" );
 		SW = domain_db->getScalar<double>("Sw");
+		// "thickness" (default) computes the opening radius once, "iterative" repeats the opening for each radius
+		std::string MorphMethod = "iterative";
+		if (domain_db->keyExists( "MorphMethod" )){
+			MorphMethod = domain_db->getScalar<std::string>("MorphMethod");
+		}
+		if (MorphMethod != "thickness" && MorphMethod != "iterative")
+			ERROR("MorphMethod must be \"thickness\" or \"iterative\"");
 		auto READFILE = domain_db->getScalar<std::string>( "Filename" );
 
 		// Generate the NWP configuration
@@ -129,7 +136,10 @@ int main(int argc, char **argv)
 		MPI_Barrier(comm);
 
 		// Run the morphological opening
-		MorphDrain(SignDist, id, Dm, SW);
+		if (MorphMethod == "iterative")
+			MorphDrain(SignDist, id, Dm, SW);
+		else
+			MorphDrainThickness(SignDist, id, Dm, SW);
 	
 		// calculate distance to non-wetting fluid
 		if (domain_db->keyExists( "HistoryLabels" )){
@@ -56,6 +56,13 @@ int main(int argc, char **argv)
 		auto ReadValues = domain_db->getVector<int>( "ReadValues" );
 		auto WriteValues = domain_db->getVector<int>( "WriteValues" );
 		SW = domain_db->getScalar<double>("Sw");
+		// "thickness" (default) computes the opening radius once, "iterative" repeats the opening for each radius
+		std::string MorphMethod = "iterative";
+		if (domain_db->keyExists( "MorphMethod" )){
+			MorphMethod = domain_db->getScalar<std::string>("MorphMethod");
+		}
+		if (MorphMethod != "thickness" && MorphMethod != "iterative")
+			ERROR("MorphMethod must be \"thickness\" or \"iterative\"");
 		signed char ErodeLabel=2;
 		signed char OpenLabel=1;
 		if (domain_db->keyExists( "OpenLabel" )){
@@ -132,7 +139,10 @@ int main(int argc, char **argv)
 		MPI_Barrier(comm);
 
 		// Run the morphological opening
-		MorphOpen(SignDist, id, Dm, SW, ErodeLabel, OpenLabel);
+		if (MorphMethod == "iterative")
+			MorphOpen(SignDist, id, Dm, SW, ErodeLabel, OpenLabel);
+		else
+			MorphOpenThickness(SignDist, id, Dm, SW, ErodeLabel, OpenLabel);
 		
 		// calculate distance to non-wetting fluid
 		if (domain_db->keyExists( "HistoryLabels" )){
@@ -82,6 +82,9 @@ int main(int argc, char **argv)
         auto center       = uct_db->getVector<int>( "center" );
         auto CylRad       = uct_db->getScalar<float>( "cylinder_radius" );
         auto maxLevels    = uct_db->getScalar<int>( "max_levels" );
+        int gather_size = 0;
+        if ( uct_db->keyExists( "gather_size" ) )
+            gather_size = uct_db->getScalar<int>( "gather_size" );
         std::vector<int> offset( 3, 0 );
         if ( uct_db->keyExists( "offset" ) )
             offset = uct_db->getVector<int>( "offset" );
@@ -127,6 +130,7 @@ int main(int argc, char **argv)
             // This line is no good -- will create identical Domain structures instead of
             // Need a way to define a coarse structure for the coarse domain (see above)
             Dm[i].reset( new Domain(multidomain_db[i], comm) );
+            if (!Dm[i]->UniformBlocks()) ERROR("lbpm_uCT_pp: the netcdf and silo output require Decomposition = \"uniform\"");
             int N = (Nx[i]+2)*(Ny[i]+2)*(Nz[i]+2);
             for (int n=0; n<N; n++){
                 Dm[i]->id[n] = 1;
@@ -300,28 +304,14 @@ int main(int argc, char **argv)
         }
         PROFILE_STOP("CoarsenMesh");
 
-        // Initialize the coarse level
-        PROFILE_START("Solve coarse mesh");
+        // Solve the coarse level and refine the solution
+        //    levels with fewer than gather_size cells per rank are gathered onto a subset of the ranks
+        PROFILE_START("Segment levels");
         if (rank==0)
-            printf("Initialize full mesh\n");
-        solve( LOCVOL.back(), Mean.back(), ID.back(), Dist.back(), MultiScaleSmooth.back(),
-                NonLocalMean.back(), *fillFloat.back(), *Dm.back(), nprocx, 
-                rough_cutoff, lamda, nlm_sigsq, nlm_depth);
-        PROFILE_STOP("Solve coarse mesh");
-        MPI_Barrier(comm);
-
-        // Refine the solution
-        PROFILE_START("Refine distance");
-        if (rank==0)
-            printf("Refine mesh\n");
-        for (int i=N_levels-2; i>=0; i--) {
-            if (rank==0)
-                printf("   Refining to level %i\n",i);
-            refine( Dist[i+1], LOCVOL[i], Mean[i], ID[i], Dist[i], MultiScaleSmooth[i],
-                    NonLocalMean[i], *fillFloat[i], *Dm[i], nprocx, i, 
-                rough_cutoff, lamda, nlm_sigsq, nlm_depth);
-        }
-        PROFILE_STOP("Refine distance");
+            printf("Segment levels\n");
+        segmentLevels( Dm, LOCVOL, Mean, ID, Dist, MultiScaleSmooth, NonLocalMean, fillFloat,
+            rough_cutoff, lamda, nlm_sigsq, nlm_depth, gather_size );
+        PROFILE_STOP("Segment levels");
         MPI_Barrier(comm);    
 
         // Perform a final filter